@@ -0,0 +1,54 @@
+#!/usr/bin/env ruby
+# Compares two simulator_bench JSON outputs and fails on regressions.
+#
+#   ruby benchmarks/compare.rb <baseline.json> <current.json> [threshold %]
+#
+# Throughput (items_per_second) is compared when both runs report it,
+# CPU time otherwise. A benchmark regresses when it is more than threshold
+# percent slower than the baseline (5 by default).
+
+require "json"
+
+def load_results(path)
+  JSON.parse(File.read(path))["benchmarks"]
+    .reject { |benchmark| benchmark["run_type"] == "aggregate" || benchmark["error_occurred"] }
+    .to_h { |benchmark| [benchmark["name"], benchmark] }
+end
+
+# Relative speed of current against baseline, above 1.0 is faster.
+def speedup(baseline, current)
+  if baseline["items_per_second"] && current["items_per_second"]
+    current["items_per_second"] / baseline["items_per_second"]
+  else
+    baseline["cpu_time"] / current["cpu_time"]
+  end
+end
+
+if ARGV.size < 2 || ARGV.size > 3
+  warn "Usage: #{$PROGRAM_NAME} <baseline.json> <current.json> [threshold %]"
+  exit 2
+end
+
+baseline = load_results(ARGV[0])
+current = load_results(ARGV[1])
+threshold = (ARGV[2] || 5).to_f / 100
+
+regressions = 0
+width = (baseline.keys | current.keys).map(&:size).max || 0
+current.each do |name, result|
+  unless baseline.key?(name)
+    puts "#{name.ljust(width)}  new"
+    next
+  end
+
+  ratio = speedup(baseline[name], result)
+  change = format("%+.1f%%", (ratio - 1) * 100)
+  regressed = ratio < 1 - threshold
+  regressions += 1 if regressed
+  puts "#{name.ljust(width)}  #{change.rjust(8)}#{regressed ? '  REGRESSION' : ''}"
+end
+
+(baseline.keys - current.keys).each { |name| puts "#{name.ljust(width)}  missing" }
+
+puts "#{regressions} regression(s) over #{(threshold * 100).round(1)}%"
+exit(regressions.zero? ? 0 : 1)
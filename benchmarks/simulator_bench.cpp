@@ -0,0 +1,318 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "alu_kernels.hpp"
+#include "assembler.hpp"
+#include "cpu.hpp"
+#include "instruction_parser.hpp"
+#include "jit_compiler.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "test_encoding.hpp"
+
+namespace {
+
+using simulator::ExecutionEngine;
+using simulator::MemoryAccess;
+namespace opcodes = simulator::opcodes;
+using simulator::test::create_branch;
+using simulator::test::create_ldp;
+using simulator::test::create_memory_format;
+using simulator::test::create_rformat;
+using simulator::test::create_two_reg;
+
+constexpr std::uint32_t kSyscall = 0x00000038;
+constexpr std::size_t kMemorySize = 1 << 22;
+constexpr std::uint32_t kDataAddress = 0x10000;
+
+// A guest loop run by the end-to-end benchmarks. r3 counts iterations down
+// by r5 = -1 and the loop ends with bne r3, r0.
+struct Workload {
+  std::vector<std::uint32_t> program;
+  std::vector<std::pair<std::uint8_t, std::uint32_t>> registers;
+};
+
+// examples/fib.rb
+Workload fib_workload() {
+  return {{
+      create_rformat(opcodes::kADD, 4, 1, 2),
+      create_rformat(opcodes::kADD, 1, 2, 0),
+      create_rformat(opcodes::kADD, 2, 4, 0),
+      create_rformat(opcodes::kADD, 3, 3, 5),
+      create_branch(opcodes::kBNE, 3, 0, -4),
+      kSyscall,
+  }, {{2, 1}}};
+}
+
+// Copies r3 words from r1 to r2.
+Workload memory_copy_workload() {
+  return {{
+      create_memory_format(opcodes::kLD, 4, 0, 1),
+      create_memory_format(opcodes::kST, 4, 0, 2),
+      create_rformat(opcodes::kADD, 1, 1, 6),
+      create_rformat(opcodes::kADD, 2, 2, 6),
+      create_rformat(opcodes::kADD, 3, 3, 5),
+      create_branch(opcodes::kBNE, 3, 0, -5),
+      kSyscall,
+  }, {{1, kDataAddress}, {2, kDataAddress + kMemorySize / 2}, {6, 4}}};
+}
+
+// Sums a 16-byte record with paired loads on every iteration.
+Workload ldp_workload() {
+  return {{
+      create_ldp(4, 7, 0, 1),
+      create_ldp(9, 10, 8, 1),
+      create_rformat(opcodes::kADD, 11, 11, 4),
+      create_rformat(opcodes::kADD, 11, 11, 7),
+      create_rformat(opcodes::kADD, 11, 11, 9),
+      create_rformat(opcodes::kADD, 11, 11, 10),
+      create_rformat(opcodes::kADD, 3, 3, 5),
+      create_branch(opcodes::kBNE, 3, 0, -7),
+      kSyscall,
+  }, {{1, kDataAddress}}};
+}
+
+// Chains bit deposits through a changing value so no result is constant.
+Workload bdep_workload() {
+  return {{
+      create_two_reg(opcodes::kBDEP, 4, 1, 2),
+      create_two_reg(opcodes::kBDEP, 6, 4, 7),
+      create_two_reg(opcodes::kCLZ, 9, 6, 0),
+      create_rformat(opcodes::kXOR, 1, 1, 6),
+      create_rformat(opcodes::kADD, 1, 1, 9),
+      create_rformat(opcodes::kADD, 3, 3, 5),
+      create_branch(opcodes::kBNE, 3, 0, -6),
+      kSyscall,
+  }, {{1, 0x12345678}, {2, 0xF0F0F0F0}, {7, 0x0FF00FF0}}};
+}
+
+// Benchmark argument 0 selects the engine, 3 is the block engine with JIT.
+void apply_engine_argument(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"engine", "iterations"});
+  for (int engine = 0; engine < 4; ++engine) {
+    benchmark->Args({engine, 100000});
+  }
+}
+
+void load_workload(simulator::Memory& memory, const Workload& workload) {
+  for (std::size_t i = 0; i < workload.program.size(); ++i) {
+    memory.write_word(i * 4, workload.program[i]);
+  }
+}
+
+// Runs the workload from the start for state.range(1) iterations.
+void run_workload(benchmark::State& state, simulator::Cpu& cpu, const Workload& workload) {
+  std::uint64_t instructions = 0;
+  for (auto _ : state) {
+    for (std::uint8_t i = 0; i < 32; ++i) {
+      cpu.set_register(i, 0);
+    }
+    for (const auto& [index, value] : workload.registers) {
+      cpu.set_register(index, value);
+    }
+    cpu.set_register(3, static_cast<std::uint32_t>(state.range(1)));
+    cpu.set_register(5, 0xFFFFFFFF);
+    cpu.set_pc(0);
+
+    std::uint64_t before = cpu.get_instruction_count();
+    cpu.run_program();
+    instructions += cpu.get_instruction_count() - before;
+  }
+
+  state.SetItemsProcessed(static_cast<std::int64_t>(instructions));
+  state.SetLabel("guest instructions");
+}
+
+void BM_Workload(benchmark::State& state, Workload (*make_workload)()) {
+  static constexpr ExecutionEngine kEngines[] = {
+      ExecutionEngine::kStaged, ExecutionEngine::kThreaded,
+      ExecutionEngine::kBlock, ExecutionEngine::kBlock};
+  const bool jit = state.range(0) == 3;
+  if (jit && !simulator::JitCompiler::is_supported()) {
+    state.SkipWithError("JIT is not supported on this host");
+    return;
+  }
+
+  Workload workload = make_workload();
+  simulator::Memory memory(kMemorySize);
+  load_workload(memory, workload);
+  simulator::Cpu cpu(memory, kEngines[state.range(0)]);
+  cpu.set_jit_enabled(jit);
+  run_workload(state, cpu, workload);
+}
+
+BENCHMARK_CAPTURE(BM_Workload, fib, fib_workload)
+    ->Apply(apply_engine_argument)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Workload, memory_copy, memory_copy_workload)
+    ->Apply(apply_engine_argument)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Workload, ldp, ldp_workload)
+    ->Apply(apply_engine_argument)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Workload, bdep, bdep_workload)
+    ->Apply(apply_engine_argument)->Unit(benchmark::kMillisecond);
+
+// The block engine with the default cache hierarchy against without.
+void BM_CachedWorkload(benchmark::State& state, Workload (*make_workload)()) {
+  Workload workload = make_workload();
+  simulator::Memory memory(kMemorySize);
+  load_workload(memory, workload);
+  simulator::Cpu cpu(memory, ExecutionEngine::kBlock);
+  cpu.set_cache_enabled(state.range(0) != 0);
+  run_workload(state, cpu, workload);
+}
+
+BENCHMARK_CAPTURE(BM_CachedWorkload, fib, fib_workload)
+    ->ArgNames({"cache", "iterations"})->Args({0, 100000})->Args({1, 100000})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_CachedWorkload, memory_copy, memory_copy_workload)
+    ->ArgNames({"cache", "iterations"})->Args({0, 100000})->Args({1, 100000})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_CachedWorkload, ldp, ldp_workload)
+    ->ArgNames({"cache", "iterations"})->Args({0, 100000})->Args({1, 100000})
+    ->Unit(benchmark::kMillisecond);
+
+// The block engine predicting branches with each predictor, kind 0 runs
+// without one.
+void BM_PredictedWorkload(benchmark::State& state, Workload (*make_workload)()) {
+  Workload workload = make_workload();
+  simulator::Memory memory(kMemorySize);
+  load_workload(memory, workload);
+  simulator::Cpu cpu(memory, ExecutionEngine::kBlock);
+  if (state.range(0) != 0) {
+    cpu.set_branch_prediction_enabled(
+        true, {static_cast<simulator::PredictorKind>(state.range(0) - 1)});
+  }
+  run_workload(state, cpu, workload);
+}
+
+BENCHMARK_CAPTURE(BM_PredictedWorkload, fib, fib_workload)
+    ->ArgNames({"kind", "iterations"})->ArgsProduct({{0, 1, 2, 3, 4}, {100000}})
+    ->Unit(benchmark::kMillisecond);
+
+std::vector<std::uint32_t> random_words(std::size_t count, std::uint32_t seed = 42) {
+  std::mt19937 generator(seed);
+  std::vector<std::uint32_t> words(count);
+  for (std::uint32_t& word : words) {
+    word = generator();
+  }
+  return words;
+}
+
+void BM_InstructionParserParse(benchmark::State& state) {
+  std::vector<std::uint32_t> program = fib_workload().program;
+  for (const auto& workload : {memory_copy_workload(), ldp_workload(), bdep_workload()}) {
+    program.insert(program.end(), workload.program.begin(), workload.program.end());
+  }
+
+  for (auto _ : state) {
+    for (std::uint32_t raw : program) {
+      benchmark::DoNotOptimize(simulator::InstructionParser::parse(raw));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(program.size()));
+}
+BENCHMARK(BM_InstructionParserParse);
+
+// A generated source of state.range(0) blocks, each a label, a memory and
+// an ALU instruction and a branch back to the previous block.
+void BM_AssemblerAssemble(benchmark::State& state) {
+  std::string source;
+  for (std::int64_t block = 0; block < state.range(0); ++block) {
+    std::string label = "block" + std::to_string(block);
+    source += label + ":\n  ld r4, 8(r1)\n  add r1, r1, r6\n  bne r3, r0, "
+              + (block == 0 ? label : "block" + std::to_string(block - 1)) + "\n";
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(simulator::assemble(source));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 3);
+  state.SetLabel("instructions");
+}
+BENCHMARK(BM_AssemblerAssemble)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+template <MemoryAccess kAccess>
+void BM_MemoryReadWord(benchmark::State& state) {
+  simulator::Memory memory(kMemorySize);
+  std::vector<std::uint32_t> addresses = random_words(4096);
+  for (std::uint32_t& address : addresses) {
+    address = (address % (kMemorySize - 4)) & ~3u;
+  }
+
+  for (auto _ : state) {
+    for (std::uint32_t address : addresses) {
+      benchmark::DoNotOptimize(memory.read_word<kAccess>(address));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(addresses.size()));
+}
+BENCHMARK_TEMPLATE(BM_MemoryReadWord, MemoryAccess::kChecked);
+BENCHMARK_TEMPLATE(BM_MemoryReadWord, MemoryAccess::kTrapping);
+BENCHMARK_TEMPLATE(BM_MemoryReadWord, MemoryAccess::kUnchecked);
+
+template <MemoryAccess kAccess>
+void BM_MemoryWriteWord(benchmark::State& state) {
+  simulator::Memory memory(kMemorySize);
+  std::vector<std::uint32_t> addresses = random_words(4096);
+  for (std::uint32_t& address : addresses) {
+    address = (address % (kMemorySize - 4)) & ~3u;
+  }
+
+  for (auto _ : state) {
+    for (std::uint32_t address : addresses) {
+      memory.write_word<kAccess>(address, address);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(addresses.size()));
+}
+BENCHMARK_TEMPLATE(BM_MemoryWriteWord, MemoryAccess::kChecked);
+BENCHMARK_TEMPLATE(BM_MemoryWriteWord, MemoryAccess::kTrapping);
+BENCHMARK_TEMPLATE(BM_MemoryWriteWord, MemoryAccess::kUnchecked);
+
+void BM_CountLeadingZeros(benchmark::State& state) {
+  std::vector<std::uint32_t> values = random_words(4096);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] >>= i % 32;
+  }
+
+  for (auto _ : state) {
+    for (std::uint32_t value : values) {
+      benchmark::DoNotOptimize(simulator::Cpu::count_leading_zeros(value));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(values.size()));
+}
+BENCHMARK(BM_CountLeadingZeros);
+
+void BM_BitDeposit(benchmark::State& state) {
+  std::vector<std::uint32_t> values = random_words(4096);
+  std::vector<std::uint32_t> masks = random_words(values.size(), 7);
+
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      benchmark::DoNotOptimize(simulator::Cpu::bit_deposit(values[i], masks[i]));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(values.size()));
+  state.SetLabel(simulator::alu::bit_deposit_kernel_name());
+}
+BENCHMARK(BM_BitDeposit);
+
+void BM_BitDepositReference(benchmark::State& state) {
+  std::vector<std::uint32_t> values = random_words(4096);
+  std::vector<std::uint32_t> masks = random_words(values.size(), 7);
+
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      benchmark::DoNotOptimize(simulator::alu::reference_bit_deposit(values[i], masks[i]));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(values.size()));
+}
+BENCHMARK(BM_BitDepositReference);
+
+} // namespace
+
+BENCHMARK_MAIN();
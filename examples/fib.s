@@ -0,0 +1,9 @@
+# Fibonacci numbers, the same program as fib.rb.
+# r1 and r2 hold two consecutive numbers, r3 counts down by r5 = -1.
+loop:
+  add r4, r1, r2
+  add r1, r2, r0
+  add r2, r4, r0
+  add r3, r3, r5
+  bne r3, r0, loop
+  syscall
@@ -0,0 +1,34 @@
+#ifndef ALU_KERNELS_HPP_
+#define ALU_KERNELS_HPP_
+
+#include <bit>
+#include <cstdint>
+
+namespace simulator::alu {
+
+using BitDepositKernel = std::uint32_t (*)(std::uint32_t value, std::uint32_t mask);
+
+// Bit-serial definitions of CLZ and BDEP, the kernels below must match them.
+std::uint32_t reference_count_leading_zeros(std::uint32_t value);
+std::uint32_t reference_bit_deposit(std::uint32_t value, std::uint32_t mask);
+
+// Compiles to LZCNT, or to BSR with a zero check on hosts without it.
+inline std::uint32_t count_leading_zeros(std::uint32_t value) {
+  return static_cast<std::uint32_t>(std::countl_zero(value));
+}
+
+// Visits only the set bits of mask.
+std::uint32_t portable_bit_deposit(std::uint32_t value, std::uint32_t mask);
+// BMI2 PDEP, nullptr if the host does not have it.
+BitDepositKernel hardware_bit_deposit();
+
+// PDEP unless the host lacks it or runs it in microcode (AMD before Zen 3),
+// portable_bit_deposit otherwise. Picked from cpuid on first use.
+BitDepositKernel bit_deposit_kernel();
+const char* bit_deposit_kernel_name();
+
+std::uint32_t bit_deposit(std::uint32_t value, std::uint32_t mask);
+
+} // namespace simulator::alu
+
+#endif // ALU_KERNELS_HPP_
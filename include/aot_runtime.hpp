@@ -0,0 +1,57 @@
+#ifndef AOT_RUNTIME_HPP_
+#define AOT_RUNTIME_HPP_
+
+#include <cstdint>
+
+#include "cpu.hpp"
+#include "memory.hpp"
+
+namespace simulator {
+
+// Signature of a program translated by translate_program(). It runs like
+// Cpu::run_program(max_instructions) on the image it was translated from,
+// which has to be loaded at address 0.
+using AotProgram = StopReason (*)(Cpu& cpu, std::uint64_t max_instructions);
+
+// The only way translated code reaches into a Cpu. Translated code keeps
+// the guest registers in locals, stores them back before it calls in here
+// and leaves through finish(), fault() or interpret().
+class AotRuntime {
+ public:
+  enum class SyscallResult {
+    kContinue,
+    kExited,
+    // The syscall wrote into the translated image.
+    kInterpret,
+  };
+
+  // Translated code does not check breakpoints, watchpoints or limits per
+  // instruction and does not feed the profiler, the trace, the timing model
+  // or observers, so it only runs without them.
+  static bool can_run(const Cpu& cpu);
+
+  static std::uint32_t* registers(Cpu& cpu);
+  static Memory& memory(Cpu& cpu);
+  // Instruction count at which the run stops.
+  static std::uint64_t limit(const Cpu& cpu, std::uint64_t max_instructions);
+
+  // Runs the syscall at program_counter with count instructions retired
+  // before it and leaves the cpu after it.
+  static SyscallResult syscall(Cpu& cpu, std::uint32_t program_counter,
+                               std::uint64_t count, std::uint32_t image_end);
+
+  // Leaves the cpu at program_counter with count instructions retired.
+  static StopReason finish(Cpu& cpu, std::uint32_t program_counter,
+                           std::uint64_t count, StopReason reason);
+  // Publishes the faulting instruction before the exception propagates.
+  static void fault(Cpu& cpu, std::uint32_t program_counter, std::uint64_t count);
+  // Continues in the interpreter, for code outside the translated image,
+  // after writes into it and for the instructions before the limit that do
+  // not fill a whole block.
+  static StopReason interpret(Cpu& cpu, std::uint32_t program_counter,
+                              std::uint64_t count, std::uint64_t limit);
+};
+
+} // namespace simulator
+
+#endif // AOT_RUNTIME_HPP_
@@ -0,0 +1,40 @@
+#ifndef AOT_TRANSLATOR_HPP_
+#define AOT_TRANSLATOR_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace simulator {
+
+// Straight-line instructions [start, end) of a program image.
+struct ImageBlock {
+  std::uint32_t start;
+  std::uint32_t end;
+  // Addresses control may continue at, in order: the taken target first.
+  // Addresses outside the translated code are left to the interpreter.
+  std::vector<std::uint32_t> successors;
+};
+
+// Splits a program image loaded at address 0 into basic blocks. Blocks
+// start at address 0, at every branch and jump target inside the image and
+// after every branch, jump and syscall. A word that does not decode is not
+// translated, the block before it continues at its address.
+std::vector<ImageBlock> recover_blocks(const std::vector<std::uint8_t>& image);
+
+// Emits a C++ translation unit that defines
+//   simulator::StopReason <symbol>(simulator::Cpu& cpu,
+//                                  std::uint64_t max_instructions);
+// with the signature of AotProgram. Every block becomes a label, registers
+// live in locals and memory goes through the cpu's Memory with the checks
+// of MemoryAccess::kChecked, so faults, syscalls and instruction counts
+// match Cpu::run_program(). Runs entering mid block, leaving the image,
+// writing into it or reaching the instruction limit continue in the
+// interpreter. Throws std::runtime_error for a symbol that is not a C++
+// identifier.
+std::string translate_program(const std::vector<std::uint8_t>& image,
+                              const std::string& symbol);
+
+} // namespace simulator
+
+#endif // AOT_TRANSLATOR_HPP_
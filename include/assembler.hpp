@@ -0,0 +1,50 @@
+#ifndef ASSEMBLER_HPP_
+#define ASSEMBLER_HPP_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace simulator {
+
+struct Symbol {
+  std::string name;
+  std::uint32_t address;
+};
+
+struct AssembledProgram {
+  // Little endian words to be loaded at address 0, like a .bin image.
+  std::vector<std::uint8_t> image;
+  // Labels in the order they are defined, so sorted by address.
+  std::vector<Symbol> symbols;
+
+  std::optional<std::uint32_t> find_symbol(std::string_view name) const;
+};
+
+// Text assembly, one statement per line:
+//   loop:  add r4, r1, r2      # comments start with # or ;
+//          ld r4, -8(r1)
+//          ldp r11, r12, 0(r1)
+//          bne r3, r0, loop
+//          j loop
+//          .word 0x1234, loop
+// Mnemonics are those of opcodes.hpp in any case, registers r0-r31.
+// Branch and jump targets are labels or addresses. Throws
+// std::runtime_error with "<name>:<line>: " in front of the message.
+AssembledProgram assemble(std::string_view source,
+                          std::string_view name = "<input>");
+
+// Whether path names an assembly source rather than a program image.
+bool is_assembly_file(std::string_view path);
+// Throws std::runtime_error when path cannot be read or assembled.
+AssembledProgram assemble_file(const std::string& path);
+
+// "loop+0x8" for an address after the label loop, plain hex before the
+// first label.
+std::string symbolize(const std::vector<Symbol>& symbols, std::uint32_t address);
+
+} // namespace simulator
+
+#endif // ASSEMBLER_HPP_
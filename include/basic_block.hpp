@@ -0,0 +1,59 @@
+#ifndef BASIC_BLOCK_HPP_
+#define BASIC_BLOCK_HPP_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "instruction_formats.hpp"
+
+namespace simulator {
+
+struct JitContext;
+
+// Native code for a block. Returns the next program counter in the low 32
+// bits and the number of retired instructions in the high 32 bits.
+using NativeBlock = std::uint64_t (*)(JitContext* context);
+
+// Kinds of micro-operations. Single instructions keep their opcode, fused
+// superinstructions are numbered after the 6-bit opcode space.
+namespace micro_ops {
+  constexpr std::uint8_t kAddAdd = 64;
+  constexpr std::uint8_t kAddBne = 65;
+  constexpr std::uint8_t kLdAdd  = 66;
+  constexpr std::uint8_t kLdpLdp = 67;
+} // namespace micro_ops
+
+struct MicroOp {
+  std::uint8_t kind;
+  std::int32_t program_counter;
+
+  DecodedInstruction first;
+  DecodedInstruction second;
+};
+
+// Straight-line run of instructions ending with a branch, jump, syscall,
+// the block length limit or before a breakpoint. Successor links are valid until the block cache
+// is flushed.
+struct BasicBlock {
+  static constexpr std::size_t kNumberOfSuccessors = 2;
+
+  std::uint32_t start_address;
+  std::uint32_t end_address;
+  std::uint32_t instruction_count;
+
+  std::vector<MicroOp> ops;
+
+  std::array<std::int32_t, kNumberOfSuccessors> successor_addresses = {};
+  std::array<BasicBlock*, kNumberOfSuccessors> successors = {};
+
+  std::uint32_t execution_count = 0;
+  NativeBlock native_code = nullptr;
+  // Starts at a breakpoint, so it never runs as native code, which may loop
+  // back to its start without leaving.
+  bool breakpoint = false;
+};
+
+} // namespace simulator
+
+#endif // BASIC_BLOCK_HPP_
@@ -0,0 +1,110 @@
+#ifndef BATCH_CPU_HPP_
+#define BATCH_CPU_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "decode_cache.hpp"
+#include "instruction_formats.hpp"
+#include "memory.hpp"
+
+namespace simulator {
+
+enum class LaneStatus {
+  kRunning,
+  kExited,
+  kFaulted,
+};
+
+// Runs one program for many guest contexts (lanes) in lockstep. Registers
+// are stored as structure-of-arrays so ALU instructions and branches are
+// vector operations across lanes. Each step executes the instruction at
+// the lowest PC among running lanes for every lane at that PC, so lanes
+// that diverged at a BEQ/BNE are masked off until they reconverge.
+//
+// Every lane has its own memory. Instructions are decoded once from the
+// loaded program image; a lane that stores into its copy of the program,
+// or runs outside of it, decodes its own code and steps alone.
+class BatchCpu {
+ private:
+  static constexpr std::size_t kNumberOfRegirsters = 32;
+  static constexpr std::uint32_t kInstrucionSize = 4;
+  static constexpr std::uint32_t kLaneEnabled = UINT32_MAX;
+
+ public:
+  BatchCpu(std::size_t lanes, std::size_t memory_size);
+  ~BatchCpu();
+
+  BatchCpu(const BatchCpu&) = delete;
+  BatchCpu& operator=(const BatchCpu&) = delete;
+
+  std::size_t lanes() const { return lanes_; }
+
+  void load_program(const std::vector<std::uint8_t>& program);
+
+  std::uint32_t get_pc(std::size_t lane) const;
+  void set_pc(std::size_t lane, std::uint32_t program_counter);
+
+  std::uint32_t get_register(std::size_t lane, std::uint8_t index) const;
+  void set_register(std::size_t lane, std::uint8_t index, std::uint32_t data);
+
+  std::uint64_t get_instruction_count(std::size_t lane) const;
+  LaneStatus get_status(std::size_t lane) const;
+  const std::string& get_fault(std::size_t lane) const;
+
+  Memory& get_memory(std::size_t lane);
+
+  // Runs until every lane has exited or faulted.
+  void run_program();
+
+ private:
+  class LaneCodeWatcher final : public CodeWriteListener {
+   public:
+    LaneCodeWatcher(BatchCpu& batch, std::size_t lane) : batch_(batch), lane_(lane) {}
+    void on_code_write(std::uint32_t address, std::size_t size) override;
+
+   private:
+    BatchCpu& batch_;
+    std::size_t lane_;
+  };
+
+  std::uint32_t* lane_registers(std::uint8_t index) {
+    return registers_.data() + index * lanes_;
+  }
+
+  void step_group(std::uint32_t program_counter);
+  void step_lane_alone(std::size_t lane, std::uint32_t program_counter);
+  void execute(const DecodedInstruction& instruction,
+               std::uint32_t program_counter, std::size_t begin,
+               std::size_t end);
+  void execute_memory(const DecodedInstruction& instruction,
+                      std::size_t begin, std::size_t end);
+  void execute_scalar(const DecodedInstruction& instruction,
+                      std::size_t begin, std::size_t end);
+  void execute_syscall(std::size_t begin, std::size_t end);
+  void fault(std::size_t lane, const std::string& message);
+
+  std::size_t lanes_;
+
+  std::vector<std::uint32_t> registers_;
+  std::vector<std::uint32_t> program_counters_;
+  std::vector<std::uint64_t> instruction_counts_;
+  std::vector<std::uint32_t> running_;
+  std::vector<std::uint32_t> active_;
+  std::vector<LaneStatus> statuses_;
+  std::vector<std::string> faults_;
+
+  std::vector<std::unique_ptr<Memory>> memories_;
+  std::vector<std::unique_ptr<LaneCodeWatcher>> watchers_;
+  std::vector<std::uint8_t> code_modified_;
+  std::size_t code_modified_lanes_ = 0;
+
+  std::unique_ptr<Memory> program_image_;
+  std::unique_ptr<DecodeCache> decode_cache_;
+};
+
+} // namespace simulator
+
+#endif // BATCH_CPU_HPP_
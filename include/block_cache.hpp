@@ -0,0 +1,49 @@
+#ifndef BLOCK_CACHE_HPP_
+#define BLOCK_CACHE_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "basic_block.hpp"
+#include "decode_cache.hpp"
+
+namespace simulator {
+
+// Translated basic blocks keyed by start address. Code writes only request
+// a flush: blocks stay alive until the next lookup so the block being
+// executed is never freed under the engine.
+class BlockCache {
+ private:
+  static constexpr std::uint32_t kMaxBlockInstructions = 64;
+  static constexpr std::size_t kInstructionSize = 4;
+
+ public:
+  BlockCache(DecodeCache& decode_cache);
+
+  BasicBlock& lookup(std::uint32_t address);
+  BasicBlock& successor(BasicBlock& block, std::int32_t address);
+
+  // Blocks end before a breakpoint, so every breakpoint starts a block.
+  void set_breakpoint(std::uint32_t address, bool enabled);
+
+  void request_flush() { flush_pending_ = true; }
+  bool flush_pending() const { return flush_pending_; }
+  std::uint64_t flush_count() const { return flush_count_; }
+
+ private:
+  std::unique_ptr<BasicBlock> translate(std::uint32_t address);
+  static bool try_fuse(MicroOp& op, const DecodedInstruction& next);
+
+  DecodeCache& decode_cache_;
+
+  std::unordered_map<std::uint32_t, std::unique_ptr<BasicBlock>> blocks_;
+  std::unordered_set<std::uint32_t> breakpoints_;
+  bool flush_pending_ = false;
+  std::uint64_t flush_count_ = 0;
+};
+
+} // namespace simulator
+
+#endif // BLOCK_CACHE_HPP_
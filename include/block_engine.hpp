@@ -0,0 +1,44 @@
+#ifndef BLOCK_ENGINE_HPP_
+#define BLOCK_ENGINE_HPP_
+
+#include <cstdint>
+
+#include "basic_block.hpp"
+#include "memory.hpp"
+
+namespace simulator {
+
+class Cpu;
+
+// Executes translated basic blocks. The program counter, the retired
+// instruction count and the stop condition are updated once per block.
+// With the JIT enabled, hot blocks run as native code. A block that no
+// longer fits in the instruction limit is finished by the threaded engine.
+// Breakpoints are checked when a block is entered, and a load or store
+// that hits a watchpoint leaves its block right after the instruction.
+// With the cache model or the branch predictor enabled, blocks are
+// interpreted and feed them what the staged pipeline would, and the staged
+// pipeline finishes the last block instead.
+class BlockEngine {
+ public:
+  static void run(Cpu& cpu);
+
+ private:
+  template <MemoryAccess kAccess>
+  static void run_with(Cpu& cpu);
+
+  template <bool kJit, MemoryAccess kAccess, bool kModels>
+  static void select_breakpoints(Cpu& cpu);
+  template <bool kJit, MemoryAccess kAccess, bool kBreakpoints, bool kModels>
+  static void run_blocks(Cpu& cpu);
+
+  template <MemoryAccess kAccess, bool kModels>
+  static std::int32_t execute_block(Cpu& cpu, const BasicBlock& block);
+  static std::int32_t execute_native(Cpu& cpu, const BasicBlock& block);
+  static void retire_until(Cpu& cpu, const BasicBlock& block,
+                           std::int32_t program_counter);
+};
+
+} // namespace simulator
+
+#endif // BLOCK_ENGINE_HPP_
@@ -0,0 +1,261 @@
+#ifndef BRANCH_PREDICTOR_HPP_
+#define BRANCH_PREDICTOR_HPP_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "execution_observer.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+
+namespace simulator {
+
+enum class PredictorKind {
+  kNotTaken,
+  // Two bit counters indexed by PC.
+  kBimodal,
+  // Two bit counters indexed by PC xor global history.
+  kGshare,
+  // Bimodal base with four tagged tables over growing history lengths.
+  kTage,
+};
+
+struct PredictorConfig {
+  PredictorKind kind = PredictorKind::kGshare;
+  // Entries of the counter table and of each tagged table, as a power of
+  // two.
+  std::uint32_t table_bits = 12;
+  // Global history gshare hashes in, at most 64.
+  std::uint32_t history_bits = 12;
+  // Entries of the direct mapped target buffer for J, a power of two.
+  std::uint32_t btb_entries = 512;
+};
+
+struct BranchStats {
+  // BEQ and BNE.
+  std::uint64_t conditional = 0;
+  std::uint64_t mispredicted = 0;
+  // J, mispredicted when the target buffer does not hold its target.
+  std::uint64_t jumps = 0;
+  std::uint64_t btb_misses = 0;
+
+  std::uint64_t branches() const { return conditional + jumps; }
+  std::uint64_t mispredictions() const { return mispredicted + btb_misses; }
+  // Mispredictions per thousand instructions.
+  double mpki(std::uint64_t instructions) const {
+    return instructions != 0 ? 1000.0 * static_cast<double>(mispredictions())
+                                   / static_cast<double>(instructions)
+                             : 0.0;
+  }
+};
+
+// Predicts every branch before training on its outcome. Counters live in
+// byte arrays and the common predictors are updated inline; mispredictions
+// are also counted per PC.
+class BranchPredictor {
+ private:
+  static constexpr std::size_t kInstructionSize = 4;
+  static constexpr std::size_t kEntriesPerPage = Memory::kPageSize / kInstructionSize;
+
+ public:
+  struct PcCounts {
+    std::uint64_t executed = 0;
+    std::uint64_t taken = 0;
+    std::uint64_t mispredicted = 0;
+  };
+
+  // Throws std::runtime_error for an invalid config.
+  explicit BranchPredictor(const PredictorConfig& config = {});
+
+  // Returns whether the branch was predicted right.
+  bool conditional(std::uint32_t program_counter, bool taken) {
+    bool predicted = false;
+    switch (config_.kind) {
+      case PredictorKind::kNotTaken:
+        break;
+      case PredictorKind::kBimodal:
+        predicted = train(counters_[bimodal_index(program_counter)], taken);
+        break;
+      case PredictorKind::kGshare:
+        predicted = train(counters_[gshare_index(program_counter)], taken);
+        break;
+      case PredictorKind::kTage:
+        predicted = tage(program_counter, taken);
+        push_folded(taken);
+        break;
+    }
+    history_ = (history_ << 1) | (taken ? 1 : 0);
+
+    bool correct = predicted == taken;
+    ++stats_.conditional;
+    stats_.mispredicted += correct ? 0 : 1;
+    PcCounts& entry = counts(program_counter);
+    ++entry.executed;
+    entry.taken += taken ? 1 : 0;
+    entry.mispredicted += correct ? 0 : 1;
+    return correct;
+  }
+
+  bool jump(std::uint32_t program_counter, std::uint32_t target) {
+    std::size_t index = (program_counter >> 2) & (btb_pcs_.size() - 1);
+    bool correct = btb_pcs_[index] == program_counter && btb_targets_[index] == target;
+    btb_pcs_[index] = program_counter;
+    btb_targets_[index] = target;
+
+    ++stats_.jumps;
+    stats_.btb_misses += correct ? 0 : 1;
+    PcCounts& entry = counts(program_counter);
+    ++entry.executed;
+    ++entry.taken;
+    entry.mispredicted += correct ? 0 : 1;
+    return correct;
+  }
+
+  const PredictorConfig& get_config() const { return config_; }
+  const BranchStats& stats() const { return stats_; }
+  PcCounts pc_counts(std::uint32_t program_counter) const;
+  // Branches with mispredictions, most mispredicted first.
+  std::vector<std::pair<std::uint32_t, PcCounts>> mispredicted_branches() const;
+
+  // Totals, MPKI over instructions and the most mispredicted branches, at
+  // most top.
+  void write_report(std::ostream& output, std::uint64_t instructions,
+                    std::size_t top = 20) const;
+  // Forgets the history and the statistics.
+  void clear();
+
+ private:
+  static constexpr std::uint8_t kWeaklyNotTaken = 1;
+  static constexpr std::uint8_t kWeaklyTaken = 2;
+  static constexpr std::uint8_t kStronglyTaken = 3;
+
+  static constexpr std::size_t kTageTables = 4;
+  static constexpr std::array<std::uint32_t, kTageTables> kTageHistory = {4, 8, 16, 32};
+  static constexpr std::uint32_t kTagBits = 10;
+
+  // Wider than kTagBits, so it matches no branch.
+  static constexpr std::uint16_t kNoTag = UINT16_MAX;
+
+  struct TageEntry {
+    std::uint16_t tag = kNoTag;
+    // Taken when not negative, saturates at -4 and 3.
+    std::int8_t counter = 0;
+    // Whether the entry predicted right where the alternate did not,
+    // saturates at 3.
+    std::uint8_t useful = 0;
+  };
+
+  // XOR of the newest history bits in chunks of bits, updated one outcome
+  // at a time: the register rotates left by one, takes the new outcome
+  // into bit 0 and drops the bit leaving the history window.
+  struct FoldedHistory {
+    std::uint32_t value = 0;
+    // 1 << (length % bits), where the leaving bit sits after the rotation.
+    std::uint32_t outgoing_bit = 0;
+    // 1 << bits, the bit the rotation carries out of the fold into bit 0.
+    std::uint32_t wrap_bit = 0;
+
+    // outgoing is all ones when the leaving bit is set.
+    void push(std::uint32_t incoming, std::uint32_t outgoing) {
+      value = (value << 1) | incoming;
+      value ^= outgoing & outgoing_bit;
+      value ^= (value & wrap_bit) != 0 ? wrap_bit | 1 : 0;
+    }
+  };
+
+  // Folds of one tagged table's history for its index and its tag.
+  struct TageHistory {
+    std::uint32_t length = 0;
+    FoldedHistory index;
+    FoldedHistory tag;
+    FoldedHistory tag_shifted;
+  };
+
+  // Predicts with counter, then moves it towards the outcome.
+  static bool train(std::uint8_t& counter, bool taken) {
+    bool predicted = counter >= kWeaklyTaken;
+    if (taken && counter < kStronglyTaken) {
+      ++counter;
+    } else if (!taken && counter > 0) {
+      --counter;
+    }
+    return predicted;
+  }
+
+  std::size_t bimodal_index(std::uint32_t program_counter) const {
+    return (program_counter >> 2) & table_mask_;
+  }
+  std::size_t gshare_index(std::uint32_t program_counter) const {
+    return ((program_counter >> 2) ^ (history_ & history_mask_)) & table_mask_;
+  }
+  bool tage(std::uint32_t program_counter, bool taken);
+  // Runs before taken is shifted into history_.
+  void push_folded(bool taken) {
+    std::uint32_t incoming = taken ? 1 : 0;
+    for (TageHistory& folded : tage_histories_) {
+      std::uint32_t leaving = static_cast<std::uint32_t>(history_ >> (folded.length - 1)) & 1;
+      std::uint32_t outgoing = 0u - leaving;
+      folded.index.push(incoming, outgoing);
+      folded.tag.push(incoming, outgoing);
+      folded.tag_shifted.push(incoming, outgoing);
+    }
+  }
+
+  PcCounts& counts(std::uint32_t program_counter) {
+    std::uint32_t page_index = program_counter >> Memory::kPageShift;
+    if (page_index != last_page_index_) {
+      last_page_ = &get_page(page_index);
+      last_page_index_ = page_index;
+    }
+    return (*last_page_)[(program_counter & (Memory::kPageSize - 1)) / kInstructionSize];
+  }
+  using Page = std::array<PcCounts, kEntriesPerPage>;
+  Page& get_page(std::uint32_t page_index);
+
+  PredictorConfig config_;
+  std::size_t table_mask_;
+  std::uint64_t history_mask_;
+  // Outcomes of the last conditional branches, the newest in bit 0.
+  std::uint64_t history_ = 0;
+
+  std::vector<std::uint8_t> counters_;
+  std::array<std::vector<TageEntry>, kTageTables> tage_tables_;
+  std::array<TageHistory, kTageTables> tage_histories_;
+  std::vector<std::uint32_t> btb_pcs_;
+  std::vector<std::uint32_t> btb_targets_;
+
+  BranchStats stats_;
+  std::unordered_map<std::uint32_t, std::unique_ptr<Page>> pages_;
+  std::uint32_t last_page_index_ = UINT32_MAX;
+  Page* last_page_ = nullptr;
+};
+
+// Feeds a branch predictor from an observed run.
+class PredictorObserver final : public ExecutionObserver<PredictorObserver> {
+ public:
+  explicit PredictorObserver(BranchPredictor& predictor) : predictor_(predictor) {}
+
+  void on_fetch(std::uint32_t /*program_counter*/, const DecodedInstruction& instruction) {
+    opcode_ = instruction.opcode;
+  }
+  void on_branch(std::uint32_t program_counter, std::uint32_t target, bool taken) {
+    if (opcode_ == opcodes::kJj) {
+      predictor_.jump(program_counter, target);
+    } else {
+      predictor_.conditional(program_counter, taken);
+    }
+  }
+
+ private:
+  BranchPredictor& predictor_;
+  std::uint8_t opcode_ = 0;
+};
+
+} // namespace simulator
+
+#endif // BRANCH_PREDICTOR_HPP_
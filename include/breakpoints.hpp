@@ -0,0 +1,52 @@
+#ifndef BREAKPOINTS_HPP_
+#define BREAKPOINTS_HPP_
+
+#include <cstdint>
+
+namespace simulator {
+
+// Register condition of a breakpoint, values are compared unsigned.
+struct BreakCondition {
+  enum class Compare : std::uint8_t {
+    kEqual,
+    kNotEqual,
+    kLess,
+    kLessOrEqual,
+    kGreater,
+    kGreaterOrEqual,
+  };
+
+  std::uint8_t reg;
+  Compare compare;
+  std::uint32_t value;
+
+  bool holds(std::uint32_t register_value) const {
+    switch (compare) {
+      case Compare::kEqual:
+        return register_value == value;
+      case Compare::kNotEqual:
+        return register_value != value;
+      case Compare::kLess:
+        return register_value < value;
+      case Compare::kLessOrEqual:
+        return register_value <= value;
+      case Compare::kGreater:
+        return register_value > value;
+      case Compare::kGreaterOrEqual:
+        return register_value >= value;
+    }
+    return false;
+  }
+};
+
+// Access that stopped a run at a watchpoint.
+struct WatchpointHit {
+  std::uint32_t address = 0;
+  // PC of the accessing instruction; the run stops after it.
+  std::uint32_t program_counter = 0;
+  bool write = false;
+};
+
+} // namespace simulator
+
+#endif // BREAKPOINTS_HPP_
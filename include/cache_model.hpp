@@ -0,0 +1,222 @@
+#ifndef CACHE_MODEL_HPP_
+#define CACHE_MODEL_HPP_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "execution_observer.hpp"
+#include "memory.hpp"
+
+namespace simulator {
+
+enum class Replacement {
+  kLru,
+  // Tree of one bit per pair of subtrees pointing away from the last use.
+  kPseudoLru,
+  kRandom,
+};
+
+enum class WritePolicy {
+  // Stores allocate on a miss and mark the line dirty, dirty lines are
+  // written to the next level when evicted.
+  kWriteBack,
+  // Stores go to the next level as well and do not allocate on a miss.
+  kWriteThrough,
+};
+
+struct CacheConfig {
+  // Size, associativity and line size are powers of two, associativity at
+  // most 64 and lines at least a word.
+  std::uint32_t size = 32 * 1024;
+  std::uint32_t associativity = 8;
+  std::uint32_t line_size = 64;
+  Replacement replacement = Replacement::kLru;
+  WritePolicy write_policy = WritePolicy::kWriteBack;
+};
+
+struct CacheHierarchyConfig {
+  CacheConfig instruction;
+  CacheConfig data;
+  CacheConfig unified {256 * 1024, 8, 64, Replacement::kLru, WritePolicy::kWriteBack};
+};
+
+struct CacheStats {
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+  // Valid lines replaced by a fill.
+  std::uint64_t evictions = 0;
+  // Dirty lines written to the next level on eviction.
+  std::uint64_t writebacks = 0;
+
+  std::uint64_t accesses() const { return hits + misses; }
+  double miss_rate() const {
+    return accesses() != 0 ? static_cast<double>(misses) / static_cast<double>(accesses()) : 0.0;
+  }
+};
+
+// One set-associative level. Tags of a set are packed next to each other
+// and compared four at a time. Only presence is modelled, data stays in
+// Memory.
+class Cache {
+ public:
+  // Throws std::runtime_error for an invalid config.
+  explicit Cache(const CacheConfig& config, std::uint64_t seed = 1);
+
+  // Whether the access hit.
+  bool read(std::uint32_t address) {
+    if (address >> line_shift_ == last_tag_) {
+      ++stats_.hits;
+      return true;
+    }
+    return access(address, false);
+  }
+  bool write(std::uint32_t address) { return access(address, true); }
+  // Address of the dirty line the last miss evicted.
+  std::optional<std::uint32_t> writeback() const {
+    return writeback_ != kEmpty ? std::optional(writeback_) : std::nullopt;
+  }
+
+  bool contains(std::uint32_t address) const;
+  const CacheConfig& get_config() const { return config_; }
+  const CacheStats& stats() const { return stats_; }
+  // Empties the cache and resets the statistics.
+  void clear();
+
+ private:
+  // Ways are padded to whole compare blocks.
+  static constexpr std::uint32_t kCompareWidth = 4;
+  static constexpr std::uint32_t kEmpty = UINT32_MAX;
+  static constexpr std::uint32_t kPadding = UINT32_MAX - 1;
+
+  bool access(std::uint32_t address, bool write);
+  // Way of set holding tag, or -1.
+  int find(std::uint32_t set, std::uint32_t tag) const;
+  std::uint32_t victim(std::uint32_t set);
+  void touch(std::uint32_t set, std::uint32_t way);
+
+  CacheConfig config_;
+  std::uint32_t line_shift_;
+  std::uint32_t set_mask_;
+  std::uint32_t stride_;
+
+  // Line numbers by set and way, kEmpty for invalid ways.
+  std::vector<std::uint32_t> tags_;
+  std::vector<std::uint8_t> dirty_;
+  // Last use per line for LRU, tree bits per set for pseudo-LRU.
+  std::vector<std::uint64_t> ages_;
+  std::uint64_t clock_ = 0;
+  std::uint64_t random_state_;
+
+  // The line of the last access, hit again without a lookup. Repeating an
+  // access to it leaves every replacement policy in the same state.
+  std::uint32_t last_tag_ = kEmpty;
+  std::size_t last_index_ = 0;
+  std::uint32_t writeback_ = kEmpty;
+
+  CacheStats stats_;
+};
+
+// Split L1 instruction and data caches over a unified L2 that sees L1
+// misses, write-throughs and write-backs. Levels are neither inclusive nor
+// exclusive. Misses are also counted per PC.
+class CacheHierarchy {
+ private:
+  static constexpr std::size_t kInstructionSize = 4;
+  static constexpr std::size_t kEntriesPerPage = Memory::kPageSize / kInstructionSize;
+
+ public:
+  struct PcCounts {
+    std::uint64_t fetch_misses = 0;
+    std::uint64_t data_accesses = 0;
+    std::uint64_t data_misses = 0;
+    std::uint64_t l2_misses = 0;
+  };
+
+  explicit CacheHierarchy(const CacheHierarchyConfig& config = {});
+
+  void fetch(std::uint32_t program_counter) {
+    if (!instruction_.read(program_counter)) {
+      fill(counts(program_counter), program_counter, true);
+    }
+  }
+  void load(std::uint32_t program_counter, std::uint32_t address) {
+    PcCounts& entry = counts(program_counter);
+    ++entry.data_accesses;
+    if (!data_.read(address)) {
+      ++entry.data_misses;
+      fill(entry, address, false);
+      write_back(entry);
+    }
+  }
+  void store(std::uint32_t program_counter, std::uint32_t address);
+
+  const Cache& instruction_cache() const { return instruction_; }
+  const Cache& data_cache() const { return data_; }
+  const Cache& unified_cache() const { return unified_; }
+
+  PcCounts pc_counts(std::uint32_t program_counter) const;
+  // PCs with misses at any level, sorted by decreasing number of misses.
+  std::vector<std::pair<std::uint32_t, PcCounts>> miss_hot_spots() const;
+
+  // Per level statistics and the PCs with most misses, at most top.
+  void write_report(std::ostream& output, std::size_t top = 20) const;
+  void clear();
+
+ private:
+  using Page = std::array<PcCounts, kEntriesPerPage>;
+
+  // Reads the line missed at L1 from L2.
+  void fill(PcCounts& entry, std::uint32_t address, bool fetch);
+  // Writes the dirty line evicted by the last L1D miss to L2.
+  void write_back(PcCounts& entry);
+  void l2_access(PcCounts& entry, std::uint32_t address, bool write);
+
+  PcCounts& counts(std::uint32_t program_counter) {
+    std::uint32_t page_index = program_counter >> Memory::kPageShift;
+    if (page_index != last_page_index_) {
+      last_page_ = &get_page(page_index);
+      last_page_index_ = page_index;
+    }
+    return (*last_page_)[(program_counter & (Memory::kPageSize - 1)) / kInstructionSize];
+  }
+  Page& get_page(std::uint32_t page_index);
+
+  Cache instruction_;
+  Cache data_;
+  Cache unified_;
+
+  std::unordered_map<std::uint32_t, std::unique_ptr<Page>> pages_;
+  std::uint32_t last_page_index_ = UINT32_MAX;
+  Page* last_page_ = nullptr;
+};
+
+// Feeds a cache hierarchy from an observed run.
+class CacheObserver final : public ExecutionObserver<CacheObserver> {
+ public:
+  explicit CacheObserver(CacheHierarchy& caches) : caches_(caches) {}
+
+  void on_fetch(std::uint32_t program_counter, const DecodedInstruction& /*instruction*/) {
+    caches_.fetch(program_counter);
+  }
+  void on_mem_read(std::uint32_t program_counter, std::uint32_t address,
+                   std::uint32_t /*value*/) {
+    caches_.load(program_counter, address);
+  }
+  void on_mem_write(std::uint32_t program_counter, std::uint32_t address,
+                    std::uint32_t /*value*/) {
+    caches_.store(program_counter, address);
+  }
+
+ private:
+  CacheHierarchy& caches_;
+};
+
+} // namespace simulator
+
+#endif // CACHE_MODEL_HPP_
@@ -2,23 +2,75 @@
 #define CPU_HPP_
 
 #include <array>
+#include <chrono>
 #include <cstdint>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "memory.hpp"
+#include "block_cache.hpp"
+#include "branch_predictor.hpp"
+#include "breakpoints.hpp"
+#include "cache_model.hpp"
+#include "decode_cache.hpp"
+#include "execution_observer.hpp"
+#include "host_io.hpp"
 #include "instruction_formats.hpp"
+#include "jit_compiler.hpp"
+#include "pipeline_model.hpp"
+#include "profiler.hpp"
+#include "syscall_journal.hpp"
+#include "syscalls.hpp"
+#include "trace_writer.hpp"
 
 namespace simulator {
 
-class Cpu {
+// How run_program() executes instructions. pipeline_cycle() always uses the
+// staged path.
+enum class ExecutionEngine {
+  kStaged,
+  kThreaded,
+  kBlock,
+};
+
+// Why run_program() returned.
+enum class StopReason {
+  kExited,
+  kInstructionLimit,
+  kBreakpoint,
+  kWatchpoint,
+};
+
+// Architectural state of a Cpu, as saved in snapshots.
+struct CpuState {
+  static constexpr std::size_t kNumberOfRegisters = 32;
+
+  std::array<std::uint32_t, kNumberOfRegisters> registers;
+  std::uint32_t program_counter;
+  std::uint64_t instruction_count;
+};
+
+class Cpu : private CodeWriteListener, private WatchListener {
+  friend class ThreadedEngine;
+  friend class BlockEngine;
+  friend class InstructionSemantics;
+  friend class JitCompiler;
+  friend class BatchCpu;
+  friend class AotRuntime;
+
  private:
   static constexpr std::size_t kNumberOfRegirsters = 32;
   static constexpr std::uint32_t kNumberOfBitsInWord = 32;
   static constexpr std::size_t kInstrucionSize = 4;
 
-  static constexpr std::size_t kMaxCycles = 1000;
-
   struct PiplelineData {
     std::uint32_t raw_instruction;
-    Instruction instruction;
+    DecodedInstruction instruction;
 
     std::uint32_t command_result;
     std::uint32_t memory_read_data;
@@ -27,7 +79,11 @@ class Cpu {
   } pipeline_data_;
 
  public:
-  Cpu(Memory& memory);
+  Cpu(Memory& memory, ExecutionEngine engine = ExecutionEngine::kBlock);
+  ~Cpu() override;
+
+  Cpu(const Cpu&) = delete;
+  Cpu& operator=(const Cpu&) = delete;
 
   std::uint32_t get_pc() const;
   void set_pc(std::uint32_t program_counter);
@@ -35,24 +91,142 @@ class Cpu {
   std::uint32_t get_register(std::uint8_t index) const;
   void set_register(std::uint8_t index, std::uint32_t data);
 
-  void run_program();
+  std::uint64_t get_instruction_count() const;
+
+  CpuState get_state() const;
+  void set_state(const CpuState& state);
+
+  StopReason run_program();
+  // Stops once max_instructions more instructions have retired. The limit
+  // is exact for every engine.
+  StopReason run_program(std::uint64_t max_instructions);
+  // Like run_program(), with observer's hooks inlined into the threaded
+  // engine, see execution_observer.hpp. The profiler, the trace and the
+  // dynamic observers see the run too, the timing, cache and branch models
+  // do not.
+  // Defined in threaded_engine.hpp.
+  template <typename Observer>
+  StopReason run_observed(Observer& observer,
+                          std::uint64_t max_instructions = UINT64_MAX);
   void pipeline_cycle();
 
+  // Compiles hot blocks to native code when run_program() uses the block
+  // engine. Throws if the host is not supported.
+  void set_jit_enabled(bool enabled);
+  bool is_jit_enabled() const;
+
+  // Validation of guest loads and stores in the threaded and block engines.
+  // The staged path and native code always check.
+  void set_memory_access(MemoryAccess access);
+  MemoryAccess get_memory_access() const;
+
+  // Counts every instruction run_program() retires. Profiled runs always
+  // use the threaded engine; disabling discards the profile.
+  void set_profiling_enabled(bool enabled);
+  bool is_profiling_enabled() const;
+  // nullptr while profiling is disabled.
+  const Profiler* get_profiler() const;
+
+  // Streams every instruction run_program() retires to a binary trace file,
+  // see trace_format.hpp. Traced runs always use the threaded engine.
+  // stop_trace() flushes the file and throws if writing it failed.
+  void start_trace(const std::string& path);
+  void stop_trace();
+  bool is_tracing() const;
+
+  // Feeds every instruction run_program() and pipeline_cycle() retire to a
+  // five stage pipeline timing model. Timed runs always use the staged
+  // path, so they are neither profiled nor traced. Enabling starts a new
+  // count.
+  void set_timing_enabled(bool enabled, PipelineConfig config = {});
+  bool is_timing_enabled() const;
+  // nullptr while timing is disabled.
+  const PipelineModel* get_timing_model() const;
+
+  // Feeds the fetches and the data accesses of every instruction
+  // run_program() and pipeline_cycle() retire to a cache hierarchy. Cached
+  // runs use the block engine without native code, or the staged path for
+  // the staged engine and for timed, profiled, traced or observed runs.
+  // Enabling starts a new count.
+  void set_cache_enabled(bool enabled, const CacheHierarchyConfig& config = {});
+  bool is_cache_enabled() const;
+  // nullptr while the cache model is disabled.
+  const CacheHierarchy* get_cache_model() const;
+
+  // Predicts every BEQ, BNE and J run_program() and pipeline_cycle() retire
+  // and counts mispredictions. Predicted runs use the same engine as cached
+  // runs. Enabling starts a new count.
+  void set_branch_prediction_enabled(bool enabled, const PredictorConfig& config = {});
+  bool is_branch_prediction_enabled() const;
+  // nullptr while branch prediction is disabled.
+  const BranchPredictor* get_branch_predictor() const;
+
+  // Reports every instruction run_program() retires to observer, after the
+  // profiler and the trace and in the order observers were added. Observed
+  // runs always use the threaded engine. The observer has to outlive the
+  // cpu or its removal.
+  void add_observer(DynamicObserver* observer);
+  void remove_observer(DynamicObserver* observer);
+
+  // run_program() stops before the instruction at a breakpoint executes,
+  // if the condition holds when one is given. A run started where the last
+  // one stopped at a breakpoint executes that instruction. The block engine
+  // checks breakpoints once per block, as blocks are split so each one
+  // starts a block; runs without breakpoints do not check at all.
+  void set_breakpoint(std::uint32_t address,
+                      std::optional<BreakCondition> condition = std::nullopt);
+  void remove_breakpoint(std::uint32_t address);
+
+  // run_program() stops right after an instruction that reads or writes the
+  // byte at address, including the buffers of the WRITE and READ syscalls.
+  // Writes by the host, such as Memory::write_block() or loading a program,
+  // are not reported. While any is set, loads and stores of watched pages
+  // are reported and no native code runs. Throws std::range_error outside
+  // memory.
+  void set_watchpoint(std::uint32_t address, WatchAccess access);
+  void remove_watchpoint(std::uint32_t address);
+  // The access that stopped the last run at a watchpoint.
+  const WatchpointHit& get_watchpoint_hit() const;
+
+  // Console of the WRITE and READ syscalls, std::cout and std::cin by
+  // default. Guest writes are queued to a writer thread that the first one
+  // starts, and run_program() flushes them before it returns. Reads are
+  // served from a buffer over the input. Both streams have to outlive the
+  // cpu or the next call.
+  void set_console(std::ostream& output, std::istream& input);
+  // Records the WRITE, READ and GET_TIME syscalls into the journal and
+  // repeats those it already holds without the console, so execution that
+  // goes over them again is the same. nullptr stops journaling. The journal
+  // has to outlive the cpu or the next call.
+  void set_syscall_journal(SyscallJournal* journal) { syscall_journal_ = journal; }
+
   void print_registers() const;
+  void print_registers(std::ostream& output) const;
+
+  // Semantics of the bit manipulation instructions shared by every engine.
+  static std::uint32_t clear_bit_field(std::uint32_t value, std::uint8_t index);
+  static std::uint32_t saturate_signed(std::uint32_t value, std::uint8_t number);
+  static std::uint32_t count_leading_zeros(std::uint32_t value);
+  static std::uint32_t bit_deposit(std::uint32_t value, std::uint32_t mask);
 
  private:
+  void on_code_write(std::uint32_t address, std::size_t size) override;
+  void on_watched_access(std::uint32_t address, std::size_t size,
+                         bool write) override;
+
   void fetch();
-  void decode();
   void execute();
   void write_back();
   void advance();
 
-  static std::int32_t sign_extend(std::uint16_t value);
-  static std::int32_t calculate_branch_target(std::uint16_t offset);
-  static std::uint32_t clear_bit_field(std::uint32_t value, std::uint8_t index);
-  static std::uint32_t saturate_signed(std::uint32_t value, std::uint8_t number);
-  static std::uint32_t count_leading_zeros(std::uint32_t value);
-  static std::uint32_t bit_deposit(std::uint32_t value, std::uint32_t mask);
+  void run_staged();
+
+  // Stops the run if it reached a breakpoint.
+  bool stop_at_breakpoint();
+  // Loads and stores are reported while watchpoints are set.
+  MemoryAccess run_memory_access() const;
+  // Recomputes the watched accesses of the page holding address.
+  void update_watched_page(std::uint32_t address);
 
   std::uint32_t execute_rformat();
   std::uint32_t execute_memformat();
@@ -64,13 +238,57 @@ class Cpu {
   void execute_j_format();
   void execute_syscall_format();
 
+  using SyscallHandler = std::uint32_t (Cpu::*)();
+  static const std::array<SyscallHandler, syscalls::kNumberOfSyscalls> kSyscalls;
+
+  std::uint32_t syscall_exit();
+  std::uint32_t syscall_write();
+  std::uint32_t syscall_read();
+  std::uint32_t syscall_get_time();
+  std::uint32_t syscall_get_instruction_count();
+  // The journaled outcome of the syscall about to run, if it is repeated.
+  const SyscallOutcome* repeated_syscall() const;
+  void record_syscall(std::uint32_t result, std::span<const std::uint8_t> input = {});
+
+  void start_run(std::uint64_t max_instructions);
+  StopReason run_engine();
+  void flush_console();
+
   std::array<std::uint32_t, kNumberOfRegirsters> registers_ = {0};
   std::int32_t program_counter_ = 0;
+  std::uint64_t instruction_count_ = 0;
+  std::uint64_t instruction_limit_ = UINT64_MAX;
 
   Memory& memory_;
+  DecodeCache decode_cache_;
+  BlockCache block_cache_;
+  ExecutionEngine engine_;
+  MemoryAccess memory_access_ = MemoryAccess::kChecked;
+  std::unique_ptr<JitCompiler> jit_;
+  std::unique_ptr<Profiler> profiler_;
+  std::unique_ptr<TraceWriter> trace_;
+  std::unique_ptr<PipelineModel> timing_;
+  std::unique_ptr<CacheHierarchy> cache_;
+  std::unique_ptr<BranchPredictor> branch_predictor_;
+  std::vector<DynamicObserver*> observers_;
   std::uint32_t program_address_ = 0;
 
+  std::unordered_map<std::uint32_t, std::optional<BreakCondition>> breakpoints_;
+  std::unordered_map<std::uint32_t, WatchAccess> watchpoints_;
+  WatchpointHit watchpoint_hit_;
+  // Breakpoint the last run stopped at, passed when resuming from it.
+  std::uint64_t resume_instruction_count_ = UINT64_MAX;
+  std::int32_t resume_program_counter_ = 0;
+
+  std::ostream* console_output_;
+  std::istream* console_input_;
+  std::unique_ptr<OutputChannel> output_channel_;
+  std::unique_ptr<InputBuffer> input_buffer_;
+  SyscallJournal* syscall_journal_ = nullptr;
+  std::chrono::steady_clock::time_point start_time_ = std::chrono::steady_clock::now();
+
   bool should_run_ = false;
+  StopReason stop_reason_ = StopReason::kExited;
 };
 
 } // namespace simulator
@@ -0,0 +1,60 @@
+#ifndef DECODE_CACHE_HPP_
+#define DECODE_CACHE_HPP_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "instruction_formats.hpp"
+#include "memory.hpp"
+
+namespace simulator {
+
+// Predecoded instructions indexed by PC. Pages of decoded entries are
+// allocated lazily and kept until the cache is destroyed, entries are
+// invalidated in place when the code they were decoded from is written.
+class DecodeCache {
+ private:
+  static constexpr std::size_t kInstructionSize = 4;
+  static constexpr std::size_t kEntriesPerPage =
+      Memory::kPageSize / kInstructionSize;
+
+  using Page = std::array<DecodedInstruction, kEntriesPerPage>;
+
+ public:
+  DecodeCache(Memory& memory);
+
+  const DecodedInstruction& fetch(std::uint32_t address) {
+    std::uint32_t page_index = address >> Memory::kPageShift;
+    if (page_index == last_page_index_ && address % kInstructionSize == 0) {
+      const DecodedInstruction& entry = (*last_page_)[entry_index(address)];
+      if (entry.opcode != DecodedInstruction::kUndecoded) {
+        return entry;
+      }
+    }
+    return fetch_slow(address);
+  }
+
+  // Returns whether any entry in the range was decoded.
+  bool invalidate(std::uint32_t address, std::size_t size);
+  void clear();
+
+ private:
+  static std::size_t entry_index(std::uint32_t address) {
+    return (address & (Memory::kPageSize - 1)) / kInstructionSize;
+  }
+
+  const DecodedInstruction& fetch_slow(std::uint32_t address);
+  Page& get_page(std::uint32_t page_index);
+
+  Memory& memory_;
+
+  std::unordered_map<std::uint32_t, std::unique_ptr<Page>> pages_;
+  std::uint32_t last_page_index_ = UINT32_MAX;
+  Page* last_page_ = nullptr;
+};
+
+} // namespace simulator
+
+#endif // DECODE_CACHE_HPP_
@@ -0,0 +1,33 @@
+#ifndef EXECUTABLE_ARENA_HPP_
+#define EXECUTABLE_ARENA_HPP_
+
+#include <cstdint>
+#include <vector>
+
+namespace simulator {
+
+// Bump allocator over an mmap'd region for generated code. The region is
+// kept read+execute and is only made writable while code is copied in.
+class ExecutableArena {
+ public:
+  ExecutableArena(std::size_t capacity);
+  ~ExecutableArena();
+
+  ExecutableArena(const ExecutableArena&) = delete;
+  ExecutableArena& operator=(const ExecutableArena&) = delete;
+
+  // Returns nullptr when the arena is full.
+  const void* add(const std::vector<std::uint8_t>& code);
+  void reset();
+
+ private:
+  static constexpr std::size_t kCodeAlignment = 16;
+
+  std::uint8_t* base_ = nullptr;
+  std::size_t capacity_;
+  std::size_t used_ = 0;
+};
+
+} // namespace simulator
+
+#endif // EXECUTABLE_ARENA_HPP_
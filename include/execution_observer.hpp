@@ -0,0 +1,197 @@
+#ifndef EXECUTION_OBSERVER_HPP_
+#define EXECUTION_OBSERVER_HPP_
+
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "instruction_formats.hpp"
+
+namespace simulator {
+
+// Hooks the threaded engine calls for every instruction of an observed run.
+// An instruction is fetched, then once it completes its memory accesses,
+// branch and syscall are reported in that order and it retires. A faulting
+// instruction is fetched but reports nothing else.
+//
+// Observers derive from ExecutionObserver<Self> and hide the hooks they
+// need. The engine is instantiated per observer type, so hooks are inlined
+// into the handlers and the ones left alone compile to nothing.
+template <typename Derived>
+class ExecutionObserver {
+ public:
+  void on_fetch(std::uint32_t /*program_counter*/,
+                const DecodedInstruction& /*instruction*/) {}
+  void on_retire(std::uint32_t /*program_counter*/,
+                 const DecodedInstruction& /*instruction*/,
+                 std::uint32_t /*next_program_counter*/) {}
+  // LDP reports two reads.
+  void on_mem_read(std::uint32_t /*program_counter*/, std::uint32_t /*address*/,
+                   std::uint32_t /*value*/) {}
+  void on_mem_write(std::uint32_t /*program_counter*/, std::uint32_t /*address*/,
+                    std::uint32_t /*value*/) {}
+  // BEQ, BNE and J, which is always taken.
+  void on_branch(std::uint32_t /*program_counter*/, std::uint32_t /*target*/,
+                 bool /*taken*/) {}
+  void on_syscall(std::uint32_t /*program_counter*/, std::uint32_t /*number*/) {}
+
+  // Whether Derived hides a memory hook. Otherwise the engine does not
+  // keep the address and the stored value around.
+  static constexpr bool observes_memory() {
+    return !std::is_same_v<decltype(&Derived::on_mem_read),
+                           decltype(&ExecutionObserver::on_mem_read)>
+           || !std::is_same_v<decltype(&Derived::on_mem_write),
+                              decltype(&ExecutionObserver::on_mem_write)>;
+  }
+};
+
+class NullObserver final : public ExecutionObserver<NullObserver> {};
+
+// Calls each observer in order.
+template <typename... Observers>
+class ObserverGroup final : public ExecutionObserver<ObserverGroup<Observers...>> {
+ public:
+  explicit ObserverGroup(Observers&... observers) : observers_(observers...) {}
+
+  void on_fetch(std::uint32_t program_counter, const DecodedInstruction& instruction) {
+    std::apply([&](auto&... observer) {
+      (observer.on_fetch(program_counter, instruction), ...);
+    }, observers_);
+  }
+  void on_retire(std::uint32_t program_counter, const DecodedInstruction& instruction,
+                 std::uint32_t next_program_counter) {
+    std::apply([&](auto&... observer) {
+      (observer.on_retire(program_counter, instruction, next_program_counter), ...);
+    }, observers_);
+  }
+  void on_mem_read(std::uint32_t program_counter, std::uint32_t address,
+                   std::uint32_t value) {
+    std::apply([&](auto&... observer) {
+      (observer.on_mem_read(program_counter, address, value), ...);
+    }, observers_);
+  }
+  void on_mem_write(std::uint32_t program_counter, std::uint32_t address,
+                    std::uint32_t value) {
+    std::apply([&](auto&... observer) {
+      (observer.on_mem_write(program_counter, address, value), ...);
+    }, observers_);
+  }
+  void on_branch(std::uint32_t program_counter, std::uint32_t target, bool taken) {
+    std::apply([&](auto&... observer) {
+      (observer.on_branch(program_counter, target, taken), ...);
+    }, observers_);
+  }
+  void on_syscall(std::uint32_t program_counter, std::uint32_t number) {
+    std::apply([&](auto&... observer) {
+      (observer.on_syscall(program_counter, number), ...);
+    }, observers_);
+  }
+
+  static constexpr bool observes_memory() {
+    return (Observers::observes_memory() || ...);
+  }
+
+ private:
+  std::tuple<Observers&...> observers_;
+};
+
+// Observer for tools chosen at runtime, attached with Cpu::add_observer().
+// Every hook is a virtual call.
+class DynamicObserver {
+ public:
+  virtual ~DynamicObserver() = default;
+
+  virtual void on_fetch(std::uint32_t /*program_counter*/,
+                        const DecodedInstruction& /*instruction*/) {}
+  virtual void on_retire(std::uint32_t /*program_counter*/,
+                         const DecodedInstruction& /*instruction*/,
+                         std::uint32_t /*next_program_counter*/) {}
+  virtual void on_mem_read(std::uint32_t /*program_counter*/, std::uint32_t /*address*/,
+                           std::uint32_t /*value*/) {}
+  virtual void on_mem_write(std::uint32_t /*program_counter*/, std::uint32_t /*address*/,
+                            std::uint32_t /*value*/) {}
+  virtual void on_branch(std::uint32_t /*program_counter*/, std::uint32_t /*target*/,
+                         bool /*taken*/) {}
+  virtual void on_syscall(std::uint32_t /*program_counter*/, std::uint32_t /*number*/) {}
+};
+
+// Runs a static observer behind the dynamic interface.
+template <typename Observer>
+class DynamicObserverFor final : public DynamicObserver {
+ public:
+  explicit DynamicObserverFor(Observer observer) : observer_(observer) {}
+
+  void on_fetch(std::uint32_t program_counter, const DecodedInstruction& instruction) override {
+    observer_.on_fetch(program_counter, instruction);
+  }
+  void on_retire(std::uint32_t program_counter, const DecodedInstruction& instruction,
+                 std::uint32_t next_program_counter) override {
+    observer_.on_retire(program_counter, instruction, next_program_counter);
+  }
+  void on_mem_read(std::uint32_t program_counter, std::uint32_t address,
+                   std::uint32_t value) override {
+    observer_.on_mem_read(program_counter, address, value);
+  }
+  void on_mem_write(std::uint32_t program_counter, std::uint32_t address,
+                    std::uint32_t value) override {
+    observer_.on_mem_write(program_counter, address, value);
+  }
+  void on_branch(std::uint32_t program_counter, std::uint32_t target, bool taken) override {
+    observer_.on_branch(program_counter, target, taken);
+  }
+  void on_syscall(std::uint32_t program_counter, std::uint32_t number) override {
+    observer_.on_syscall(program_counter, number);
+  }
+
+ private:
+  Observer observer_;
+};
+
+// Static observer that forwards every hook to a list of dynamic ones.
+class DynamicObserverAdapter final : public ExecutionObserver<DynamicObserverAdapter> {
+ public:
+  explicit DynamicObserverAdapter(const std::vector<DynamicObserver*>& observers)
+    : observers_(observers) {}
+
+  void on_fetch(std::uint32_t program_counter, const DecodedInstruction& instruction) {
+    for (DynamicObserver* observer : observers_) {
+      observer->on_fetch(program_counter, instruction);
+    }
+  }
+  void on_retire(std::uint32_t program_counter, const DecodedInstruction& instruction,
+                 std::uint32_t next_program_counter) {
+    for (DynamicObserver* observer : observers_) {
+      observer->on_retire(program_counter, instruction, next_program_counter);
+    }
+  }
+  void on_mem_read(std::uint32_t program_counter, std::uint32_t address,
+                   std::uint32_t value) {
+    for (DynamicObserver* observer : observers_) {
+      observer->on_mem_read(program_counter, address, value);
+    }
+  }
+  void on_mem_write(std::uint32_t program_counter, std::uint32_t address,
+                    std::uint32_t value) {
+    for (DynamicObserver* observer : observers_) {
+      observer->on_mem_write(program_counter, address, value);
+    }
+  }
+  void on_branch(std::uint32_t program_counter, std::uint32_t target, bool taken) {
+    for (DynamicObserver* observer : observers_) {
+      observer->on_branch(program_counter, target, taken);
+    }
+  }
+  void on_syscall(std::uint32_t program_counter, std::uint32_t number) {
+    for (DynamicObserver* observer : observers_) {
+      observer->on_syscall(program_counter, number);
+    }
+  }
+
+ private:
+  const std::vector<DynamicObserver*>& observers_;
+};
+
+} // namespace simulator
+
+#endif // EXECUTION_OBSERVER_HPP_
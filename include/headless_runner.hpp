@@ -0,0 +1,71 @@
+#ifndef HEADLESS_RUNNER_HPP_
+#define HEADLESS_RUNNER_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "branch_predictor.hpp"
+#include "cache_model.hpp"
+#include "cpu.hpp"
+#include "job_farm.hpp"
+#include "memory.hpp"
+#include "sampling.hpp"
+#include "state_report.hpp"
+
+namespace simulator {
+
+struct RunOptions {
+  std::string program_path;
+  JobConfig initial_state;
+  std::uint64_t max_instructions = UINT64_MAX;
+  ExecutionEngine engine = ExecutionEngine::kBlock;
+  MemoryAccess memory_access = MemoryAccess::kChecked;
+  bool jit = false;
+  ReportFormat format = ReportFormat::kText;
+  // Profiler output files, profiling is enabled when either is set.
+  std::string profile_path;
+  std::string folded_path;
+  std::string trace_path;
+  // Pipeline timing report, timing is enabled when set.
+  std::string timing_path;
+  PipelineConfig pipeline;
+  // Times only sampled windows and writes the extrapolated estimate to
+  // timing_path instead.
+  bool sampled = false;
+  SamplingConfig sampling;
+  // Cache hierarchy report, the cache model is enabled when set.
+  std::string cache_path;
+  CacheHierarchyConfig caches;
+  // Predicts branches and adds the MPKI to the report when set, or when
+  // branches_path is.
+  bool predicted = false;
+  PredictorConfig predictor;
+  // Per branch misprediction report.
+  std::string branches_path;
+};
+
+// Arguments of the run mode:
+//   <program.bin> [--reg <n>=<value>]... [--mem <addr>=<value>]...
+//   [--pc <value>] [--max-insns <n>] [--engine staged|threaded|block]
+//   [--jit] [--trapping|--unchecked] [--json|--csv]
+//   [--profile <report.txt>] [--folded <stacks.folded>] [--trace <file>]
+//   [--timing <report.txt>] [--no-forwarding]
+//   [--sample <period>,<warmup>,<window>] [--sample-seed <n>]
+//   [--cache <report.txt>]
+//   [--cache-level l1i|l1d|l2=<size>,<ways>,<line>[,lru|plru|random][,wb|wt]]...
+//   [--predictor not-taken|bimodal|gshare|tage] [--branches <report.txt>]
+// --sample-seed randomizes the sample offsets; sampling needs --timing.
+// Values are decimal (optionally negative) or 0x-prefixed hex. Throws
+// std::runtime_error on malformed arguments.
+RunOptions parse_run_options(const std::vector<std::string>& arguments);
+
+// Runs the program once from the initial state. Faults are reported in
+// the returned state instead of being thrown; the profile, the trace, the
+// timing, the cache and the branch reports are written either way.
+StateReport run_headless(const std::vector<std::uint8_t>& program,
+                         const RunOptions& options, std::size_t memory_size);
+
+} // namespace simulator
+
+#endif // HEADLESS_RUNNER_HPP_
@@ -0,0 +1,82 @@
+#ifndef HOST_IO_HPP_
+#define HOST_IO_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace simulator {
+
+// Single producer, single consumer byte ring drained to a stream by a
+// writer thread. write() only copies into the ring and waits only while it
+// is full; both sides coordinate through atomics, the writer sleeps on
+// them while the ring is empty.
+class OutputChannel {
+ public:
+  static constexpr std::size_t kDefaultCapacity = std::size_t{1} << 16;
+
+  // capacity is rounded up to a power of two.
+  explicit OutputChannel(std::ostream& output,
+                         std::size_t capacity = kDefaultCapacity);
+  // Writes out everything queued before stopping the writer thread.
+  ~OutputChannel();
+
+  OutputChannel(const OutputChannel&) = delete;
+  OutputChannel& operator=(const OutputChannel&) = delete;
+
+  void write(const std::uint8_t* data, std::size_t size);
+  // Waits until everything written so far is passed to the stream and the
+  // stream is flushed.
+  void flush();
+
+  std::size_t capacity() const { return buffer_.size(); }
+
+ private:
+  void drain();
+
+  std::ostream& output_;
+  std::vector<std::uint8_t> buffer_;
+  std::size_t mask_;
+
+  // Bytes ever written by the producer and consumed by the writer, the
+  // ring holds [tail_, head_).
+  alignas(64) std::atomic<std::uint64_t> head_ {0};
+  alignas(64) std::atomic<std::uint64_t> tail_ {0};
+  // Bytes passed to a flushed stream.
+  alignas(64) std::atomic<std::uint64_t> flushed_ {0};
+  // Bumped on every publish and on shutdown, the writer sleeps on it.
+  std::atomic<std::uint32_t> signal_ {0};
+  std::atomic<bool> stopping_ {false};
+
+  std::thread writer_;
+};
+
+// Serves reads from a buffer over a stream. An empty buffer is refilled
+// with one blocking byte and then whatever the stream already has
+// buffered, up to the chunk size, so reads return what is available like
+// read(2) instead of waiting for a full request.
+class InputBuffer {
+ public:
+  static constexpr std::size_t kDefaultChunk = std::size_t{1} << 16;
+
+  explicit InputBuffer(std::istream& input,
+                       std::size_t chunk = kDefaultChunk);
+
+  // Buffered bytes, refilled first if none are left. Empty at end of input.
+  std::span<const std::uint8_t> fill();
+  void consume(std::size_t size);
+
+ private:
+  std::istream& input_;
+  std::vector<std::uint8_t> buffer_;
+  std::size_t begin_ = 0;
+  std::size_t end_ = 0;
+};
+
+} // namespace simulator
+
+#endif // HOST_IO_HPP_
@@ -62,6 +62,23 @@ struct Instruction {
     > fields;
 };
 
+// Compact fixed-size form of an instruction used by the decode cache.
+// Register fields are normalized so every engine can read them without
+// knowing the encoding:
+//   rd  - destination (rd, rt for LD, rt1 for LDP)
+//   rs  - first source or memory base
+//   rt  - second source (rt, rs2 for BDEP, rt2 for LDP, data for ST)
+//   imm - sign-extended memory offset, branch byte offset, jump target
+//         address bits, imm5 or syscall code
+struct DecodedInstruction {
+    static constexpr std::uint8_t kUndecoded = 0xFF;
+
+    std::uint32_t raw;
+    std::uint8_t opcode = kUndecoded;
+    std::uint8_t rd, rs, rt;
+    std::int32_t imm;
+};
+
 } // namespace simulator
 
 
@@ -10,6 +10,7 @@ namespace simulator {
 class InstructionParser {
  public:
     static Instruction parse(std::uint32_t raw_instruction);
+    static DecodedInstruction decode(std::uint32_t raw_instruction);
 
     static std::uint8_t get_opcode(std::uint32_t instruction);
 };
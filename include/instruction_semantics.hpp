@@ -0,0 +1,97 @@
+#ifndef INSTRUCTION_SEMANTICS_HPP_
+#define INSTRUCTION_SEMANTICS_HPP_
+
+#include <cstdint>
+
+#include "alu_kernels.hpp"
+#include "bit_shifts.hpp"
+#include "cpu.hpp"
+#include "instruction_formats.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+
+namespace simulator {
+
+// Execute and write back of a single predecoded instruction, shared by the
+// fast engines. Returns the program counter of the next instruction.
+// Loads and stores are validated according to kAccess.
+class InstructionSemantics {
+ public:
+  template <std::uint8_t kOpcode,
+            MemoryAccess kAccess = MemoryAccess::kChecked>
+  static std::int32_t execute(Cpu& cpu,
+                              const DecodedInstruction& instruction,
+                              std::int32_t program_counter);
+
+  static constexpr bool is_block_terminator(std::uint8_t opcode) {
+    return opcode == opcodes::kBEQ || opcode == opcodes::kBNE
+        || opcode == opcodes::kJj || opcode == opcodes::kSYSCALL;
+  }
+
+  static constexpr bool accesses_memory(std::uint8_t opcode) {
+    return opcode == opcodes::kLD || opcode == opcodes::kST
+        || opcode == opcodes::kLDP;
+  }
+};
+
+template <std::uint8_t kOpcode, MemoryAccess kAccess>
+inline std::int32_t InstructionSemantics::execute(
+    Cpu& cpu, const DecodedInstruction& instruction,
+    std::int32_t program_counter) {
+  auto& registers = cpu.registers_;
+  std::uint32_t rs_data = registers[instruction.rs];
+  std::uint32_t rt_data = registers[instruction.rt];
+  std::int32_t next_program_counter = program_counter + Cpu::kInstrucionSize;
+
+  auto write = [&registers, &instruction](std::uint32_t result) {
+    if (instruction.rd != 0) {
+      registers[instruction.rd] = result;
+    }
+  };
+
+  if constexpr (kOpcode == opcodes::kNOR) {
+    write(~(rs_data | rt_data));
+  } else if constexpr (kOpcode == opcodes::kADD) {
+    write(rs_data + rt_data);
+  } else if constexpr (kOpcode == opcodes::kXOR) {
+    write(rs_data ^ rt_data);
+  } else if constexpr (kOpcode == opcodes::kCBIT) {
+    write(Cpu::clear_bit_field(rs_data, instruction.imm));
+  } else if constexpr (kOpcode == opcodes::kSSAT) {
+    write(Cpu::saturate_signed(rs_data, instruction.imm));
+  } else if constexpr (kOpcode == opcodes::kCLZ) {
+    write(alu::count_leading_zeros(rs_data));
+  } else if constexpr (kOpcode == opcodes::kBDEP) {
+    write(alu::bit_deposit(rs_data, rt_data));
+  } else if constexpr (kOpcode == opcodes::kLD) {
+    write(cpu.memory_.read_word<kAccess>(rs_data + instruction.imm));
+  } else if constexpr (kOpcode == opcodes::kST) {
+    cpu.memory_.write_word<kAccess>(rs_data + instruction.imm, rt_data);
+  } else if constexpr (kOpcode == opcodes::kLDP) {
+    std::uint32_t address = rs_data + instruction.imm;
+    std::uint8_t rt1 = instruction.rd;
+    std::uint8_t rt2 = instruction.rt;
+    registers[rt1] = cpu.memory_.read_word<kAccess>(address);
+    registers[rt2] =
+        cpu.memory_.read_word<kAccess>(address + Cpu::kInstrucionSize);
+  } else if constexpr (kOpcode == opcodes::kBEQ) {
+    if (rs_data == rt_data) {
+      next_program_counter = program_counter + instruction.imm;
+    }
+  } else if constexpr (kOpcode == opcodes::kBNE) {
+    if (rs_data != rt_data) {
+      next_program_counter = program_counter + instruction.imm;
+    }
+  } else if constexpr (kOpcode == opcodes::kJj) {
+    std::uint32_t pc_upper_4_bits = program_counter & shifts::kFirst4BitsMask;
+    next_program_counter = pc_upper_4_bits | instruction.imm;
+  } else if constexpr (kOpcode == opcodes::kSYSCALL) {
+    cpu.execute_syscall_format();
+  }
+
+  return next_program_counter;
+}
+
+} // namespace simulator
+
+#endif // INSTRUCTION_SEMANTICS_HPP_
@@ -1,26 +1,58 @@
 #ifndef INTERACTIVE_SIMULATOR_HPP_
 #define INTERACTIVE_SIMULATOR_HPP_
 
+#include "assembler.hpp"
 #include "simulator.hpp"
+#include "time_travel.hpp"
+#include <iostream>
 #include <string>
+#include <vector>
 
 namespace simulator {
 
 class InteractiveSimulator {
  private:
     Simulator simulator_;
+    TimeTravel time_travel_ {simulator_};
     bool running_ = true;
 
+    std::istream& input_;
+    std::ostream& output_;
+    bool interactive_;
+    // Takes the acknowledgements of a replay.
+    std::ostream discarded_ {nullptr};
+    // Labels of the last program loaded from assembly.
+    std::vector<Symbol> symbols_;
+
  public:
     InteractiveSimulator(std::size_t memory_size);
 
+    // Replays commands from input without prompts or acknowledgements,
+    // only explicitly requested output such as print_reg is written.
+    // Stops at the end of input; faults are thrown to the caller.
+    InteractiveSimulator(std::size_t memory_size, std::istream& input,
+                         std::ostream& output);
+
     void start();
 
+    Simulator& get_simulator() { return simulator_; }
+
  private:
+    void execute_command(const std::string& line);
     void load_program(const std::string& filename);
+    void check_arguments(const std::string& command);
+    void report_stop(StopReason reason);
+    // " (label+0x4)" after a PC when the program came from assembly.
+    std::string location(std::uint32_t program_counter) const;
+    const Profiler& profiler();
+    const PipelineModel& timing_model();
+    const CacheHierarchy& cache_model();
+    const BranchPredictor& branch_predictor();
+
+    // Acknowledgements are only shown in interactive mode.
+    std::ostream& acknowledge();
 };
 
 } // namespace simulator
 
 #endif // INTERACTIVE_SIMULATOR_HPP_
-
@@ -0,0 +1,96 @@
+#ifndef JIT_COMPILER_HPP_
+#define JIT_COMPILER_HPP_
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "basic_block.hpp"
+#include "block_cache.hpp"
+#include "executable_arena.hpp"
+#include "memory.hpp"
+#include "x86_emitter.hpp"
+
+namespace simulator {
+
+class Cpu;
+
+// State shared between the engine and generated code. Blocks that branch
+// back to their own start loop natively, adding the instructions of each
+// completed iteration to retired, for at most loop_budget iterations.
+struct JitContext {
+  std::uint32_t* registers;
+  Memory* memory;
+  BlockCache* block_cache;
+  std::uint32_t load_values[2];
+  std::uint64_t retired;
+  std::uint32_t loop_budget;
+};
+
+// Compiles hot basic blocks to x86-64. Guest registers used most in a
+// block are pinned in callee-saved host registers for its duration, memory
+// accesses go through helpers that report faults instead of throwing.
+// Anything that cannot be compiled, and every faulting instruction, is
+// left to the interpreter by returning its PC.
+class JitCompiler {
+ public:
+  static constexpr std::uint32_t kHotThreshold = 64;
+  static constexpr std::uint32_t kLoopBudget = 1U << 16;
+
+  JitCompiler(Cpu& cpu);
+
+  static bool is_supported();
+
+  // Counts an execution of the block and compiles it once it becomes hot.
+  // Returns true when the block has native code.
+  bool prepare(BasicBlock& block);
+
+  JitContext& context() { return context_; }
+
+ private:
+  static constexpr std::size_t kArenaSize = std::size_t{16} << 20;
+  static constexpr std::size_t kNumberOfGuestRegisters = 32;
+  static constexpr std::size_t kNumberOfPinnedRegisters = 4;
+
+  enum HelperStatus : std::uint32_t {
+    kOk = 0,
+    kFault = 1,
+    kCodeModified = 2,
+  };
+
+  using GuestInstruction = std::pair<std::int32_t, DecodedInstruction>;
+
+  NativeBlock compile(const BasicBlock& block);
+
+  static std::vector<GuestInstruction> flatten(const BasicBlock& block);
+  void pin_registers(const std::vector<GuestInstruction>& instructions);
+
+  void emit_prologue();
+  void emit_loop_back(std::uint32_t retired);
+  void emit_exit(std::uint32_t next_program_counter, std::uint32_t retired);
+  bool emit_instruction(const GuestInstruction& instruction, std::uint32_t index);
+  void emit_load_guest(x86::Register dst, std::uint8_t guest);
+  void emit_store_guest(std::uint8_t guest, x86::Register src);
+  void emit_call(const void* function);
+
+  static std::uint32_t load(JitContext* context, std::uint32_t address);
+  static std::uint32_t load_pair(JitContext* context, std::uint32_t address);
+  static std::uint32_t store(JitContext* context, std::uint32_t address,
+                             std::uint32_t value);
+  static std::uint32_t saturate_signed(std::uint32_t value, std::uint32_t number);
+
+  JitContext context_;
+  ExecutableArena arena_;
+  std::uint64_t arena_flush_count_;
+
+  x86::Emitter emitter_;
+  std::vector<x86::Fixup> epilogue_jumps_;
+  std::uint32_t block_start_ = 0;
+  std::size_t loop_head_ = 0;
+  std::array<std::int8_t, kNumberOfGuestRegisters> pinned_ = {};
+};
+
+} // namespace simulator
+
+#endif // JIT_COMPILER_HPP_
@@ -0,0 +1,101 @@
+#ifndef JOB_FARM_HPP_
+#define JOB_FARM_HPP_
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace simulator {
+
+class Simulator;
+class Snapshot;
+
+// Initial state of one run on top of the shared program image.
+struct JobConfig {
+  std::vector<std::pair<std::uint8_t, std::uint32_t>> registers;
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> memory_words;
+  std::uint32_t program_counter = 0;
+};
+
+enum class JobStatus {
+  kExited,
+  kFaulted,
+  // Retired the farm's instruction budget without exiting.
+  kLimit,
+};
+
+struct JobResult {
+  static constexpr std::size_t kNumberOfRegisters = 32;
+
+  std::size_t job;
+  JobStatus status;
+  std::string fault;
+  std::uint32_t program_counter;
+  std::uint64_t instruction_count;
+  std::array<std::uint32_t, kNumberOfRegisters> registers;
+};
+
+// Runs independent jobs of one program on a pool of worker threads. Every
+// worker starts with a contiguous slice of the jobs, works through it from
+// the front and steals from the back of other slices once its own is
+// drained. Each worker loads the program image once, checkpoints it and
+// restores that checkpoint before every job, so only the pages a job wrote
+// are copied back. Results are delivered to the sink one at a time, in
+// completion order.
+class JobFarm {
+ public:
+  using ResultSink = std::function<void(const JobResult&)>;
+
+  // threads == 0 uses every hardware thread. A job stops after
+  // max_instructions instructions, so a guest that never exits cannot hold
+  // a worker forever. Throws std::range_error if memory_size exceeds the
+  // address space.
+  JobFarm(std::vector<std::uint8_t> program, std::size_t memory_size,
+          std::size_t threads = 0,
+          std::uint64_t max_instructions = UINT64_MAX);
+
+  std::size_t threads() const { return threads_; }
+  std::uint64_t max_instructions() const { return max_instructions_; }
+
+  // Rethrows the first exception of the sink or of a worker that could not
+  // create its simulator, after every worker has stopped.
+  void run(const std::vector<JobConfig>& jobs, const ResultSink& sink) const;
+  void run(const std::vector<JobConfig>& jobs, std::ostream& output) const;
+
+  JobResult run_job(std::size_t index, const JobConfig& config) const;
+
+ private:
+  // Starts from the loaded snapshot, or loads the program if it is null.
+  JobResult run_job(Simulator& simulator,
+                    const std::shared_ptr<const Snapshot>& loaded,
+                    std::size_t index, const JobConfig& config) const;
+
+  std::vector<std::uint8_t> program_;
+  std::size_t memory_size_;
+  std::size_t threads_;
+  std::uint64_t max_instructions_;
+};
+
+// One job per line of whitespace separated assignments:
+//   R<n>=<value>   register
+//   M<addr>=<value> memory word
+//   PC=<value>     start address
+// Values are decimal (optionally negative) or 0x-prefixed hex. A value
+// written as <first>..<last> is a range; a line with ranges expands to
+// every combination of them. Empty lines and lines starting with '#' are
+// skipped. Throws std::runtime_error on malformed input.
+std::vector<JobConfig> parse_jobs(std::istream& input);
+
+// "job=<n> status=<exited|faulted|limit> pc=<pc> instructions=<n> r0=... r31=..."
+// followed by fault="<message>" for faulted jobs.
+void write_job_result(std::ostream& output, const JobResult& result);
+
+} // namespace simulator
+
+#endif // JOB_FARM_HPP_
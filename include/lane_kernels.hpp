@@ -0,0 +1,52 @@
+#ifndef LANE_KERNELS_HPP_
+#define LANE_KERNELS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace simulator::lanes {
+
+// Kernels are cloned for AVX-512 and AVX2 in lane_kernels.cpp; the variant
+// is picked once by the dynamic loader from the host CPU.
+//
+// Element-wise operations over structure-of-arrays registers. Every lane
+// whose mask is all ones takes the result, the others keep dst.
+void add(std::uint32_t* dst, const std::uint32_t* lhs, const std::uint32_t* rhs,
+         const std::uint32_t* mask, std::size_t count);
+void bitwise_xor(std::uint32_t* dst, const std::uint32_t* lhs,
+                 const std::uint32_t* rhs, const std::uint32_t* mask,
+                 std::size_t count);
+void bitwise_nor(std::uint32_t* dst, const std::uint32_t* lhs,
+                 const std::uint32_t* rhs, const std::uint32_t* mask,
+                 std::size_t count);
+void bitwise_and(std::uint32_t* dst, const std::uint32_t* src,
+                 std::uint32_t value, const std::uint32_t* mask,
+                 std::size_t count);
+void count_leading_zeros(std::uint32_t* dst, const std::uint32_t* src,
+                         const std::uint32_t* mask, std::size_t count);
+
+// Smallest value among lanes whose mask is set, UINT32_MAX if none is.
+std::uint32_t masked_min(const std::uint32_t* values, const std::uint32_t* mask,
+                         std::size_t count);
+
+// mask = enabled & (values == value); returns the number of lanes set.
+std::size_t select_equal(std::uint32_t* mask, const std::uint32_t* values,
+                         std::uint32_t value, const std::uint32_t* enabled,
+                         std::size_t count);
+
+// Program counter update for BEQ/BNE: active lanes go to taken_target when
+// (lhs == rhs) == branch_if_equal, otherwise to fallthrough.
+void branch(std::uint32_t* program_counters, const std::uint32_t* lhs,
+            const std::uint32_t* rhs, bool branch_if_equal,
+            std::uint32_t taken_target, std::uint32_t fallthrough,
+            const std::uint32_t* mask, std::size_t count);
+
+void assign(std::uint32_t* dst, std::uint32_t value, const std::uint32_t* mask,
+            std::size_t count);
+
+void increment(std::uint64_t* counters, const std::uint32_t* mask,
+               std::size_t count);
+
+} // namespace simulator::lanes
+
+#endif // LANE_KERNELS_HPP_
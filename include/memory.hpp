@@ -2,10 +2,53 @@
 #define MEMORY_HPP_
 
 #include <cstdint>
+#include <cstring>
 #include <vector>
 
 namespace simulator {
 
+// How word loads and stores are validated:
+//   kChecked   - range and alignment are checked separately, as always
+//   kTrapping  - one predicted branch per access, the slow path throws the
+//                same errors as kChecked
+//   kUnchecked - no validation, only for programs already run checked
+//   kWatched   - validated like kChecked, accesses to watched pages are
+//                reported to the watch listener
+enum class MemoryAccess {
+  kChecked,
+  kTrapping,
+  kUnchecked,
+  kWatched,
+};
+
+// Accesses to a page that are reported by kWatched loads and stores.
+enum class WatchAccess : std::uint8_t {
+  kNone = 0,
+  kRead = 1,
+  kWrite = 2,
+  kReadWrite = 3,
+};
+
+// Notified when a write touches a page that holds decoded code.
+class CodeWriteListener {
+ public:
+  virtual ~CodeWriteListener() = default;
+
+  virtual void on_code_write(std::uint32_t address, std::size_t size) = 0;
+};
+
+// Notified after a kWatched load or store touches a watched page.
+class WatchListener {
+ public:
+  virtual ~WatchListener() = default;
+
+  virtual void on_watched_access(std::uint32_t address, std::size_t size,
+                                 bool write) = 0;
+};
+
+// Guest memory is an mmap reservation of memory_size bytes that the host
+// only backs with pages once they are touched, so the whole 32-bit address
+// space can be configured without paying for it up front.
 class Memory {
  private:
   static constexpr std::size_t kBitInByte = 8;
@@ -15,12 +58,23 @@ class Memory {
   static constexpr std::size_t kWordAccessSize = 4;
 
  public:
+  static constexpr std::uint32_t kPageShift = 12;
+  static constexpr std::size_t kPageSize = std::size_t{1} << kPageShift;
+  static constexpr std::size_t kAddressSpaceSize = std::size_t{1} << 32;
+
+  // Throws if memory_size exceeds the address space or cannot be reserved.
   Memory(std::size_t memory_size);
+  ~Memory();
+
+  Memory(const Memory&) = delete;
+  Memory& operator=(const Memory&) = delete;
 
   std::uint8_t read_byte(std::uint32_t address) const;
   void write_byte(std::uint32_t address, std::uint8_t byte);
 
+  template <MemoryAccess kAccess = MemoryAccess::kChecked>
   std::uint32_t read_word(std::uint32_t address) const;
+  template <MemoryAccess kAccess = MemoryAccess::kChecked>
   void write_word(std::uint32_t address, std::uint32_t word);
 
   const std::uint8_t* read_block(std::uint32_t address,
@@ -32,18 +86,124 @@ class Memory {
   std::size_t size() const;
   bool is_valid_address(std::uint32_t address) const;
 
+  // Writes through the raw pointer bypass code write notifications and
+  // dirty page tracking.
   std::uint8_t* get_row_pointer();
   const std::uint8_t* get_row_pointer() const;
 
+  void set_code_write_listener(CodeWriteListener* listener);
+  void mark_code_page(std::uint32_t address);
+
+  void set_watch_listener(WatchListener* listener);
+  // Replaces the accesses watched on a page, kNone stops watching it.
+  void watch_page(std::uint32_t page, WatchAccess access);
+
+  // Pages written since the last clear_dirty_pages(), each listed once.
+  const std::vector<std::uint32_t>& dirty_pages() const;
+  void clear_dirty_pages();
+
+  // Copy a whole page out of and back into guest memory; only the part
+  // inside memory is copied. restore_page() zero-fills for a nullptr
+  // source, notifies code writes and does not mark the page dirty.
+  void save_page(std::uint32_t page, std::uint8_t* destination) const;
+  void restore_page(std::uint32_t page, const std::uint8_t* source);
+
  private:
   static void check_allignment(std::uint32_t address, std::size_t allignment);
   void check_address_range(std::uint32_t address,
                            std::size_t access_size) const;
 
+  template <MemoryAccess kAccess>
+  void check_word_access(std::uint32_t address) const;
+  [[noreturn]] void trap_word_access(std::uint32_t address) const;
+
+  void notify_code_write(std::uint32_t address, std::size_t size);
+
+  void report_watched(std::uint32_t address, WatchAccess access) const {
+    if ((watched_pages_[address >> kPageShift] & static_cast<std::uint8_t>(access)) != 0
+        && watch_listener_ != nullptr) [[unlikely]] {
+      watch_listener_->on_watched_access(address, kWordAccessSize,
+                                         access == WatchAccess::kWrite);
+    }
+  }
+
+  void mark_dirty(std::uint32_t address) {
+    if (dirty_pages_map_[address >> kPageShift] == 0) [[unlikely]] {
+      add_dirty_page(address >> kPageShift);
+    }
+  }
+  void mark_dirty(std::uint32_t address, std::size_t size);
+  void add_dirty_page(std::uint32_t page);
+  std::size_t page_bytes(std::uint32_t page) const;
+
+  static std::uint8_t* map_zeroed(std::size_t size);
+  static void unmap(std::uint8_t* region, std::size_t size);
+
   std::size_t memory_size_;
-  std::vector<std::uint8_t> data_;
+  std::uint8_t* data_ = nullptr;
+
+  // One byte per page, reserved the same way as data_.
+  std::size_t code_pages_size_;
+  std::uint8_t* code_pages_ = nullptr;
+  CodeWriteListener* code_write_listener_ = nullptr;
+
+  // WatchAccess bits per page like code_pages_.
+  std::uint8_t* watched_pages_ = nullptr;
+  WatchListener* watch_listener_ = nullptr;
+
+  // One byte per page like code_pages_, plus the list of set bytes so
+  // clearing costs only the dirty set.
+  std::uint8_t* dirty_pages_map_ = nullptr;
+  std::vector<std::uint32_t> dirty_pages_;
 };
 
+template <MemoryAccess kAccess>
+inline void Memory::check_word_access(std::uint32_t address) const {
+  if constexpr (kAccess == MemoryAccess::kChecked
+                || kAccess == MemoryAccess::kWatched) {
+    check_address_range(address, kWordAccessSize);
+    check_allignment(address, kWordAccessSize);
+  } else if constexpr (kAccess == MemoryAccess::kTrapping) {
+    if (std::size_t{address} + kWordAccessSize > memory_size_
+        || address % kWordAccessSize != 0) [[unlikely]] {
+      trap_word_access(address);
+    }
+  }
+}
+
+template <MemoryAccess kAccess>
+inline std::uint32_t Memory::read_word(std::uint32_t address) const {
+  check_word_access<kAccess>(address);
+
+  std::uint32_t value;
+  std::memcpy(&value, data_ + address, kWordAccessSize);
+  if constexpr (kAccess == MemoryAccess::kWatched) {
+    report_watched(address, WatchAccess::kRead);
+  }
+  return value;
+}
+
+// An aligned word never spans two pages, so the unchecked paths look at the
+// code flag of its page directly.
+template <MemoryAccess kAccess>
+inline void Memory::write_word(std::uint32_t address, std::uint32_t word) {
+  check_word_access<kAccess>(address);
+
+  std::memcpy(data_ + address, &word, kWordAccessSize);
+  mark_dirty(address);
+  if constexpr (kAccess == MemoryAccess::kChecked) {
+    notify_code_write(address, kWordAccessSize);
+  } else {
+    if (code_write_listener_ != nullptr
+        && code_pages_[address >> kPageShift] != 0) [[unlikely]] {
+      code_write_listener_->on_code_write(address, kWordAccessSize);
+    }
+  }
+  if constexpr (kAccess == MemoryAccess::kWatched) {
+    report_watched(address, WatchAccess::kWrite);
+  }
+}
+
 }  // namespace simulator
 
 #endif // MEMORY_HPP_
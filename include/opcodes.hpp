@@ -20,6 +20,27 @@ namespace opcodes {
     constexpr std::uint8_t kSYSCALL = 0b111000;
     constexpr std::uint8_t kBEQ     = 0b011110;
     constexpr std::uint8_t kJj      = 0b110110;
+
+    // Assembler name of an opcode, nullptr for unused encodings.
+    constexpr const char* mnemonic(std::uint8_t opcode) {
+      switch (opcode) {
+        case kNOR:     return "NOR";
+        case kLDP:     return "LDP";
+        case kCBIT:    return "CBIT";
+        case kBDEP:    return "BDEP";
+        case kADD:     return "ADD";
+        case kSSAT:    return "SSAT";
+        case kST:      return "ST";
+        case kCLZ:     return "CLZ";
+        case kBNE:     return "BNE";
+        case kLD:      return "LD";
+        case kXOR:     return "XOR";
+        case kSYSCALL: return "SYSCALL";
+        case kBEQ:     return "BEQ";
+        case kJj:      return "J";
+        default:       return nullptr;
+      }
+    }
 } // namespace opcodes
 
 } // namespace simulator
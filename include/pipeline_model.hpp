@@ -0,0 +1,104 @@
+#ifndef PIPELINE_MODEL_HPP_
+#define PIPELINE_MODEL_HPP_
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+#include "instruction_formats.hpp"
+
+namespace simulator {
+
+struct PipelineConfig {
+  // EX/MEM and MEM/WB results are forwarded to EX and MEM. Without it an
+  // instruction waits in ID until its producers reach WB.
+  bool forwarding = true;
+};
+
+struct PipelineStats {
+  std::uint64_t cycles = 0;
+  std::uint64_t instructions = 0;
+  // Cycles an instruction waited in ID for an operand. With forwarding
+  // only loads followed by a user of their result wait.
+  std::uint64_t data_stalls = 0;
+  // Fetch cycles lost to taken branches, resolved in EX.
+  std::uint64_t branch_stalls = 0;
+  // Fetch cycles lost to jumps, resolved in ID.
+  std::uint64_t jump_stalls = 0;
+
+  double cpi() const {
+    return instructions != 0 ? static_cast<double>(cycles) / instructions : 0.0;
+  }
+};
+
+// Timing of an in-order IF/ID/EX/MEM/WB pipeline. Instructions are fed in
+// program order after they execute and advance through per-stage latches
+// one cycle at a time, stalling on data hazards and losing the fetch slots
+// of wrong-path instructions after taken branches and jumps, which are
+// predicted not taken. Only timing is modelled, results come from the
+// functional execution.
+class PipelineModel {
+ public:
+  enum Stage {
+    kFetch,
+    kDecode,
+    kExecute,
+    kMemory,
+    kWriteBack,
+    kNumberOfStages,
+  };
+
+  explicit PipelineModel(PipelineConfig config = {});
+
+  const PipelineConfig& get_config() const { return config_; }
+
+  // Feeds the next instruction; next_program_counter tells whether it
+  // branched.
+  void retire(const DecodedInstruction& instruction,
+              std::uint32_t program_counter,
+              std::uint32_t next_program_counter);
+
+  // Totals once every instruction fed so far has left the pipeline.
+  PipelineStats stats() const;
+  void write_report(std::ostream& output) const;
+
+  void clear();
+
+ private:
+  static constexpr std::uint8_t kNoRegister = 0;
+
+  enum class Redirect : std::uint8_t {
+    kNone,
+    kJump,
+    kBranch,
+  };
+
+  struct Latch {
+    bool valid = false;
+    bool load = false;
+    Redirect redirect = Redirect::kNone;
+    std::array<std::uint8_t, 2> destinations = {};
+    // Read in EX, and in MEM for store data.
+    std::array<std::uint8_t, 2> sources = {};
+    std::uint8_t store_source = kNoRegister;
+  };
+
+  static Latch make_latch(const DecodedInstruction& instruction,
+                          std::uint32_t program_counter,
+                          std::uint32_t next_program_counter);
+
+  // Advances one cycle, fetching next if the front end can. Returns
+  // whether it was fetched.
+  bool step(const Latch* next);
+  bool has_data_hazard(const Latch& consumer) const;
+  // Nothing is left before WB.
+  bool drained() const;
+
+  PipelineConfig config_;
+  std::array<Latch, kNumberOfStages> stages_;
+  PipelineStats stats_;
+};
+
+} // namespace simulator
+
+#endif // PIPELINE_MODEL_HPP_
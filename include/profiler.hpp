@@ -0,0 +1,146 @@
+#ifndef PROFILER_HPP_
+#define PROFILER_HPP_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "execution_observer.hpp"
+#include "instruction_formats.hpp"
+#include "memory.hpp"
+
+namespace simulator {
+
+// Exact guest execution counts gathered by run_program() while profiling
+// is enabled: per PC, per opcode, taken branches and loads/stores per
+// memory page. Only instructions that complete are counted. Per-PC
+// counters live in lazily allocated pages like the decode cache.
+class Profiler {
+ private:
+  static constexpr std::size_t kInstructionSize = 4;
+  static constexpr std::size_t kEntriesPerPage =
+      Memory::kPageSize / kInstructionSize;
+  static constexpr std::size_t kNumberOfOpcodes = 64;
+
+ public:
+  struct PcCounts {
+    std::uint64_t executed = 0;
+    std::uint64_t taken = 0;
+    std::uint32_t branch_target = 0;
+    std::uint8_t opcode = 0;
+  };
+
+  struct MemoryCounts {
+    std::uint64_t loads = 0;
+    std::uint64_t stores = 0;
+  };
+
+  // A backward taken branch and the code it jumps over.
+  struct Loop {
+    std::uint32_t head;
+    std::uint32_t branch;
+    std::uint64_t iterations;
+    std::uint64_t instructions;
+  };
+
+  void record_instruction(std::uint32_t program_counter, std::uint8_t opcode) {
+    PcCounts& entry = counts(program_counter);
+    ++entry.executed;
+    entry.opcode = opcode;
+    ++opcode_counts_[opcode];
+    ++total_instructions_;
+  }
+
+  void record_branch(std::uint32_t program_counter, std::uint32_t target) {
+    PcCounts& entry = counts(program_counter);
+    ++entry.taken;
+    entry.branch_target = target;
+  }
+
+  void record_load(std::uint32_t address) {
+    ++memory_counts_[address >> Memory::kPageShift].loads;
+  }
+
+  void record_store(std::uint32_t address) {
+    ++memory_counts_[address >> Memory::kPageShift].stores;
+  }
+
+  void clear();
+
+  std::uint64_t total_instructions() const { return total_instructions_; }
+  std::uint64_t opcode_count(std::uint8_t opcode) const {
+    return opcode_counts_[opcode];
+  }
+  PcCounts pc_counts(std::uint32_t program_counter) const;
+  MemoryCounts page_counts(std::uint32_t page) const;
+
+  // Executed PCs sorted by decreasing count.
+  std::vector<std::pair<std::uint32_t, PcCounts>> hot_spots() const;
+  // Loops sorted by decreasing number of instructions executed inside.
+  std::vector<Loop> hot_loops() const;
+
+  // Hot-spot report listing at most top entries per section.
+  void write_report(std::ostream& output, std::size_t top = 20) const;
+
+  // One line per executed PC in the folded stack format of flamegraph.pl,
+  // nested inside the loops that contain it.
+  void write_folded(std::ostream& output) const;
+
+ private:
+  using Page = std::array<PcCounts, kEntriesPerPage>;
+
+  PcCounts& counts(std::uint32_t program_counter) {
+    std::uint32_t page_index = program_counter >> Memory::kPageShift;
+    if (page_index != last_page_index_) {
+      last_page_ = &get_page(page_index);
+      last_page_index_ = page_index;
+    }
+    return (*last_page_)[(program_counter & (Memory::kPageSize - 1))
+                         / kInstructionSize];
+  }
+
+  Page& get_page(std::uint32_t page_index);
+
+  std::unordered_map<std::uint32_t, std::unique_ptr<Page>> pages_;
+  std::uint32_t last_page_index_ = UINT32_MAX;
+  Page* last_page_ = nullptr;
+
+  std::array<std::uint64_t, kNumberOfOpcodes> opcode_counts_ = {};
+  std::unordered_map<std::uint32_t, MemoryCounts> memory_counts_;
+  std::uint64_t total_instructions_ = 0;
+};
+
+// Feeds a profiler from an observed run.
+class ProfileObserver final : public ExecutionObserver<ProfileObserver> {
+ public:
+  explicit ProfileObserver(Profiler& profiler) : profiler_(profiler) {}
+
+  void on_retire(std::uint32_t program_counter, const DecodedInstruction& instruction,
+                 std::uint32_t /*next_program_counter*/) {
+    profiler_.record_instruction(program_counter, instruction.opcode);
+  }
+  void on_mem_read(std::uint32_t /*program_counter*/, std::uint32_t address,
+                   std::uint32_t /*value*/) {
+    profiler_.record_load(address);
+  }
+  void on_mem_write(std::uint32_t /*program_counter*/, std::uint32_t address,
+                    std::uint32_t /*value*/) {
+    profiler_.record_store(address);
+  }
+  // Only branches that leave the fall-through path count as taken.
+  void on_branch(std::uint32_t program_counter, std::uint32_t target, bool taken) {
+    if (taken && target != program_counter + 4) {
+      profiler_.record_branch(program_counter, target);
+    }
+  }
+
+ private:
+  Profiler& profiler_;
+};
+
+} // namespace simulator
+
+#endif // PROFILER_HPP_
@@ -0,0 +1,54 @@
+#ifndef SAMPLING_HPP_
+#define SAMPLING_HPP_
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "cpu.hpp"
+#include "pipeline_model.hpp"
+
+namespace simulator {
+
+// Every period instructions the pipeline model is enabled for warmup
+// instructions, which are not measured, and then for a window of measured
+// instructions. The rest of the period runs on the fast engines.
+struct SamplingConfig {
+  std::uint64_t period = 1000000;
+  std::uint64_t warmup = 1000;
+  std::uint64_t window = 10000;
+  // Places each sample at a uniformly random offset within its period
+  // instead of at its end.
+  bool randomized = false;
+  std::uint64_t seed = 0;
+  PipelineConfig pipeline;
+};
+
+// Whole-run timing extrapolated from the measured windows. Margins are
+// half widths of 95% confidence intervals from the spread of the window
+// CPIs, zero with fewer than two windows.
+struct SampledEstimate {
+  std::uint64_t instructions = 0;
+  // Totals of the measured windows.
+  PipelineStats measured;
+  std::vector<double> window_cpi;
+
+  double cpi = 0.0;
+  double cpi_margin = 0.0;
+  double cycles = 0.0;
+  double cycles_margin = 0.0;
+};
+
+// Cpu::run_program(max_instructions) with sampled timing. The estimate is
+// filled in as the run goes, so it describes the part that ran even if an
+// instruction faults. Throws std::runtime_error if the window is empty or
+// the period is shorter than warmup and window together.
+StopReason run_sampled(Cpu& cpu, const SamplingConfig& config,
+                       SampledEstimate& estimate,
+                       std::uint64_t max_instructions = UINT64_MAX);
+
+void write_sampling_report(std::ostream& output, const SampledEstimate& estimate);
+
+} // namespace simulator
+
+#endif // SAMPLING_HPP_
@@ -0,0 +1,82 @@
+#ifndef SCHEDULER_HPP_
+#define SCHEDULER_HPP_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "simulator.hpp"
+
+namespace simulator {
+
+// kRunnable while a context still gets turns, otherwise why it finished.
+enum class ContextStatus {
+  kRunnable,
+  kExited,
+  kBudgetExhausted,
+  kBreakpoint,
+  kWatchpoint,
+  kFaulted,
+};
+
+// Time-slices independent machines on the calling thread. Every turn runs
+// the next runnable context for one quantum of instructions through
+// Cpu::run_program(), so the engines check the quantum and the budget once
+// per block and a context that never exits delays the others by at most
+// one quantum per round. A context finishes when it exits, faults, stops at
+// a breakpoint or watchpoint, or retires its instruction budget.
+class Scheduler {
+ public:
+  static constexpr std::uint64_t kDefaultQuantum = std::uint64_t{1} << 16;
+
+  // Throws std::runtime_error for a zero quantum.
+  explicit Scheduler(std::uint64_t quantum = kDefaultQuantum);
+
+  // Queues a context that may retire at most budget more instructions.
+  // Returns its index.
+  std::size_t add(std::unique_ptr<Simulator> simulator,
+                  std::uint64_t budget = UINT64_MAX);
+  // Queues a context that stopped at a breakpoint or watchpoint or ran out
+  // of budget again, with a new budget. Throws std::runtime_error if it
+  // exited or faulted.
+  void resume(std::size_t context, std::uint64_t budget = UINT64_MAX);
+
+  // Gives the next runnable context a turn. Returns whether any context is
+  // still runnable.
+  bool step();
+  // Takes turns until no context is runnable.
+  void run();
+
+  std::uint64_t quantum() const { return quantum_; }
+  std::size_t size() const { return contexts_.size(); }
+  std::size_t runnable() const { return run_queue_.size(); }
+
+  Simulator& get_simulator(std::size_t context);
+  ContextStatus get_status(std::size_t context) const;
+  // What the faulting instruction threw.
+  const std::string& get_fault(std::size_t context) const;
+  // Instructions retired in turns of this scheduler.
+  std::uint64_t get_retired(std::size_t context) const;
+
+ private:
+  struct Context {
+    std::unique_ptr<Simulator> simulator;
+    std::uint64_t budget;
+    std::uint64_t retired = 0;
+    ContextStatus status = ContextStatus::kRunnable;
+    std::string fault;
+  };
+
+  Context& context(std::size_t index);
+  const Context& context(std::size_t index) const;
+
+  std::uint64_t quantum_;
+  std::vector<Context> contexts_;
+  std::deque<std::size_t> run_queue_;
+};
+
+} // namespace simulator
+
+#endif // SCHEDULER_HPP_
@@ -1,14 +1,19 @@
 #ifndef SIMULATOR_HPP
 #define SIMULATOR_HPP
 
+#include <memory>
+#include <vector>
+
 #include "cpu.hpp"
 #include "memory.hpp"
+#include "snapshot.hpp"
 
 namespace simulator {
 
 class Simulator {
  public:
-  Simulator(std::size_t memory_size);
+  Simulator(std::size_t memory_size,
+            ExecutionEngine engine = ExecutionEngine::kBlock);
 
   Cpu& get_cpu() { return cpu_; }
   const Cpu& get_cpu() const { return cpu_; }
@@ -20,9 +25,26 @@ class Simulator {
 
   void load_program(const std::uint8_t* program, std::size_t size);
 
+  // Copy of the whole machine state that does not refer to checkpoints.
+  std::shared_ptr<const Snapshot> take_snapshot() const;
+  // Saves the cpu state and only the pages written since the last
+  // checkpoint or restore, which becomes its parent.
+  std::shared_ptr<const Snapshot> checkpoint();
+  // Returns the machine to the snapshot. Only pages written since the last
+  // checkpoint or restore and pages that differ between it and the
+  // snapshot are copied.
+  void restore(const std::shared_ptr<const Snapshot>& snapshot);
+
  private:
+  // Pages whose contents may differ between the current checkpoint and
+  // snapshot, not counting pages written since.
+  std::vector<std::uint32_t> diverged_pages(const Snapshot* snapshot) const;
+
   Memory memory_;
   Cpu cpu_;
+  // Last checkpoint taken or restored, memory equals it except for the
+  // dirty pages.
+  std::shared_ptr<const Snapshot> current_;
 };
 } // namespace simulator
 
@@ -0,0 +1,48 @@
+#ifndef SNAPSHOT_HPP_
+#define SNAPSHOT_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "cpu.hpp"
+#include "memory.hpp"
+
+namespace simulator {
+
+// Machine state saved by Simulator. A snapshot holds the cpu state and the
+// memory pages written since its parent; every other page is found through
+// the parent chain, and pages found nowhere were never written and read as
+// zero. Snapshots are immutable and may be shared between restores.
+class Snapshot {
+ public:
+  const CpuState& get_cpu_state() const { return cpu_state_; }
+  const std::shared_ptr<const Snapshot>& get_parent() const { return parent_; }
+  // Pages stored in this snapshot itself.
+  std::size_t page_count() const { return pages_.size(); }
+
+  // Snapshot with the state of snapshot whose chain continues at parent
+  // instead of ancestor, which must be in the chain of snapshot and hold
+  // the same state as parent. Pages stored between them are shared, not
+  // copied, so merging checkpoints frees the pages later ones overwrote.
+  static std::shared_ptr<const Snapshot> rebase(
+      const Snapshot& snapshot, const Snapshot* ancestor,
+      std::shared_ptr<const Snapshot> parent);
+
+ private:
+  friend class Simulator;
+
+  using Page = std::shared_ptr<std::uint8_t[]>;
+
+  // Contents of the page as of this snapshot, nullptr if it is zero.
+  const std::uint8_t* find_page(std::uint32_t page) const;
+
+  CpuState cpu_state_;
+  std::shared_ptr<const Snapshot> parent_;
+  std::size_t depth_ = 0;
+  std::unordered_map<std::uint32_t, Page> pages_;
+};
+
+} // namespace simulator
+
+#endif // SNAPSHOT_HPP_
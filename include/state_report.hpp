@@ -0,0 +1,43 @@
+#ifndef STATE_REPORT_HPP_
+#define STATE_REPORT_HPP_
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+
+#include "cpu.hpp"
+
+namespace simulator {
+
+enum class ReportFormat {
+  kText,
+  kJson,
+  kCsv,
+};
+
+// Final machine state printed by the headless modes.
+struct StateReport {
+  static constexpr std::size_t kNumberOfRegisters = 32;
+
+  std::string status;
+  std::string fault;
+  std::uint32_t program_counter;
+  std::uint64_t instruction_count;
+  std::array<std::uint32_t, kNumberOfRegisters> registers;
+  // Set when the run predicted branches.
+  std::optional<BranchStats> branches;
+
+  static StateReport capture(const Cpu& cpu, std::string status,
+                             std::string fault = {});
+};
+
+// kText matches print_registers(), kJson is a single object and kCsv is a
+// header line followed by one row.
+void write_report(std::ostream& output, const StateReport& report,
+                  ReportFormat format);
+
+} // namespace simulator
+
+#endif // STATE_REPORT_HPP_
@@ -0,0 +1,63 @@
+#ifndef SYSCALL_JOURNAL_HPP_
+#define SYSCALL_JOURNAL_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace simulator {
+
+// Outcome of a syscall that depends on the host.
+struct SyscallOutcome {
+  // Retired instructions before the syscall.
+  std::uint64_t instruction_count;
+  std::uint32_t result;
+  // Bytes a READ stored.
+  std::vector<std::uint8_t> input;
+};
+
+// Outcomes of the WRITE, READ and GET_TIME syscalls by the instruction count
+// they ran at. A cpu with a journal repeats a recorded syscall from it
+// instead of the host: WRITE skips the console, READ stores the recorded
+// bytes and GET_TIME returns the recorded time.
+class SyscallJournal {
+ public:
+  // nullptr if the syscall at instruction_count was not recorded.
+  const SyscallOutcome* find(std::uint64_t instruction_count) const {
+    auto outcome = lower_bound(instruction_count);
+    if (outcome == outcomes_.end() || outcome->instruction_count != instruction_count) {
+      return nullptr;
+    }
+    return &*outcome;
+  }
+
+  // Replaces the outcomes at and after the one recorded.
+  void record(SyscallOutcome outcome) {
+    forget(outcome.instruction_count);
+    outcomes_.push_back(std::move(outcome));
+  }
+
+  // Forgets the outcomes at instruction_count and after.
+  void forget(std::uint64_t instruction_count) {
+    outcomes_.erase(lower_bound(instruction_count), outcomes_.end());
+  }
+
+  std::size_t size() const { return outcomes_.size(); }
+
+ private:
+  std::vector<SyscallOutcome>::const_iterator lower_bound(std::uint64_t instruction_count) const {
+    return std::lower_bound(
+        outcomes_.begin(), outcomes_.end(), instruction_count,
+        [](const SyscallOutcome& outcome, std::uint64_t value) {
+          return outcome.instruction_count < value;
+        });
+  }
+
+  // Ordered by instruction count.
+  std::vector<SyscallOutcome> outcomes_;
+};
+
+} // namespace simulator
+
+#endif // SYSCALL_JOURNAL_HPP_
@@ -1,18 +1,36 @@
 #ifndef SYSCALLS_HPP_
 #define SYSCALLS_HPP_
 
-
+#include <cstddef>
 #include <cstdint>
+
 namespace simulator::syscalls {
 
+// The number is taken from r8, arguments from r9 and r10, the result is
+// written to r9. r0 reads as zero for every other instruction, so it can
+// hold neither. EXIT and unknown numbers leave r9 unchanged.
+//   EXIT                  - stops the run
+//   WRITE                 - writes r10 bytes at address r9 to the console,
+//                           returns r10
+//   READ                  - reads at most r10 bytes from the console to
+//                           address r9, returns the number read, 0 at end
+//                           of input
+//   GET_TIME              - milliseconds since the cpu was created
+//   GET_INSTRUCTION_COUNT - low word of the retired instruction count
 enum SyscallCommands {
   EXIT = 0,
+  WRITE = 1,
+  READ = 2,
+  GET_TIME = 3,
+  GET_INSTRUCTION_COUNT = 4,
 };
 
+constexpr std::size_t kNumberOfSyscalls = 5;
+
 constexpr std::uint8_t kNumberRegister = 8;
-constexpr std::uint8_t kArgument0 = 0;
-constexpr std::uint8_t kArgument1 = 1;
-constexpr std::uint8_t kResult = 0;
+constexpr std::uint8_t kArgument0 = 9;
+constexpr std::uint8_t kArgument1 = 10;
+constexpr std::uint8_t kResult = 9;
 
 } // namespace simulator::syscalls
 
@@ -0,0 +1,221 @@
+#ifndef THREADED_ENGINE_HPP_
+#define THREADED_ENGINE_HPP_
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "cpu.hpp"
+#include "execution_observer.hpp"
+#include "instruction_formats.hpp"
+#include "instruction_semantics.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "profiler.hpp"
+#include "syscalls.hpp"
+#include "trace_writer.hpp"
+
+namespace simulator {
+
+// Executes predecoded instructions through a table of handlers indexed by
+// opcode. Every handler performs execute and write back in one step and
+// leaves the program counter pointing at the next instruction.
+class ThreadedEngine {
+ public:
+  // Reports to the cpu's profiler, trace and dynamic observers.
+  static void run(Cpu& cpu);
+  // Also reports to observer, see execution_observer.hpp.
+  template <typename Observer>
+  static void run(Cpu& cpu, Observer& observer);
+
+ private:
+  static constexpr std::size_t kNumberOfOpcodes = 64;
+
+  template <typename Observer>
+  using Handler = void (*)(Cpu& cpu, const DecodedInstruction& instruction,
+                           Observer& observer);
+
+  // The profiler and the trace behind the dynamic interface, for runs with
+  // dynamic observers attached.
+  class AttachedObservers {
+   public:
+    explicit AttachedObservers(Cpu& cpu);
+
+    bool empty() const { return observers_.empty(); }
+    const std::vector<DynamicObserver*>& observers() const { return observers_; }
+
+   private:
+    std::optional<DynamicObserverFor<ProfileObserver>> profile_;
+    std::optional<DynamicObserverFor<TraceObserver>> trace_;
+    std::vector<DynamicObserver*> observers_;
+  };
+
+  // Keeps the trace synced around the run.
+  template <typename Observer>
+  static void run_traced(Cpu& cpu, Observer& observer);
+  template <typename Observer>
+  static void select_access(Cpu& cpu, Observer& observer);
+  template <MemoryAccess kAccess, typename Observer>
+  static void select_breakpoints(Cpu& cpu, Observer& observer);
+
+  // Handlers are instantiated per observer, so runs with NullObserver pay
+  // nothing for the hooks. kBreakpoints checks for a breakpoint before
+  // every instruction.
+  template <MemoryAccess kAccess, bool kBreakpoints, typename Observer>
+  static void run_with(Cpu& cpu, Observer& observer);
+
+  template <std::uint8_t kOpcode, MemoryAccess kAccess, typename Observer>
+  static void handle(Cpu& cpu, const DecodedInstruction& instruction,
+                     Observer& observer);
+};
+
+template <typename Observer>
+void ThreadedEngine::run(Cpu& cpu, Observer& observer) {
+  AttachedObservers attached(cpu);
+  if (attached.empty()) {
+    select_access(cpu, observer);
+    return;
+  }
+  DynamicObserverAdapter adapter(attached.observers());
+  ObserverGroup<Observer, DynamicObserverAdapter> group(observer, adapter);
+  run_traced(cpu, group);
+}
+
+// The trace is synced around the run so it holds the state set from
+// outside and the PC execution stopped at, even after a fault.
+template <typename Observer>
+void ThreadedEngine::run_traced(Cpu& cpu, Observer& observer) {
+  if (!cpu.trace_) {
+    select_access(cpu, observer);
+    return;
+  }
+
+  cpu.trace_->sync(cpu.program_counter_, cpu.registers_);
+  try {
+    select_access(cpu, observer);
+  } catch (...) {
+    cpu.trace_->sync(cpu.program_counter_, cpu.registers_);
+    throw;
+  }
+  cpu.trace_->sync(cpu.program_counter_, cpu.registers_);
+}
+
+template <typename Observer>
+void ThreadedEngine::select_access(Cpu& cpu, Observer& observer) {
+  switch (cpu.run_memory_access()) {
+    case MemoryAccess::kChecked:
+      select_breakpoints<MemoryAccess::kChecked>(cpu, observer);
+      break;
+    case MemoryAccess::kTrapping:
+      select_breakpoints<MemoryAccess::kTrapping>(cpu, observer);
+      break;
+    case MemoryAccess::kUnchecked:
+      select_breakpoints<MemoryAccess::kUnchecked>(cpu, observer);
+      break;
+    case MemoryAccess::kWatched:
+      select_breakpoints<MemoryAccess::kWatched>(cpu, observer);
+      break;
+  }
+}
+
+template <MemoryAccess kAccess, typename Observer>
+void ThreadedEngine::select_breakpoints(Cpu& cpu, Observer& observer) {
+  if (cpu.breakpoints_.empty()) {
+    run_with<kAccess, false>(cpu, observer);
+  } else {
+    run_with<kAccess, true>(cpu, observer);
+  }
+}
+
+template <MemoryAccess kAccess, bool kBreakpoints, typename Observer>
+void ThreadedEngine::run_with(Cpu& cpu, Observer& observer) {
+  static constexpr auto kHandlers =
+      []<std::size_t... kOpcodes>(std::index_sequence<kOpcodes...> /*opcodes*/) {
+        return std::array<Handler<Observer>, kNumberOfOpcodes>{
+            &handle<kOpcodes, kAccess, Observer>...};
+      }(std::make_index_sequence<kNumberOfOpcodes>{});
+
+  DecodeCache& decode_cache = cpu.decode_cache_;
+
+  while (cpu.should_run_ && cpu.instruction_count_ < cpu.instruction_limit_) {
+    if constexpr (kBreakpoints) {
+      if (cpu.stop_at_breakpoint()) {
+        break;
+      }
+    }
+    const DecodedInstruction& instruction =
+        decode_cache.fetch(cpu.program_counter_);
+    kHandlers[instruction.opcode](cpu, instruction, observer);
+  }
+}
+
+// Hooks after execute only run once the instruction completed, so a
+// faulting instruction is neither retired nor reported.
+template <std::uint8_t kOpcode, MemoryAccess kAccess, typename Observer>
+void ThreadedEngine::handle(Cpu& cpu, const DecodedInstruction& instruction,
+                            Observer& observer) {
+  constexpr bool kReportsMemory = Observer::observes_memory()
+                                  && InstructionSemantics::accesses_memory(kOpcode);
+
+  std::uint32_t program_counter = static_cast<std::uint32_t>(cpu.program_counter_);
+  observer.on_fetch(program_counter, instruction);
+  std::uint32_t address = 0;
+  std::uint32_t store_value = 0;
+  if constexpr (kReportsMemory) {
+    address = cpu.registers_[instruction.rs] + static_cast<std::uint32_t>(instruction.imm);
+    store_value = cpu.registers_[instruction.rt];
+  }
+
+  std::int32_t next_program_counter = InstructionSemantics::execute<kOpcode, kAccess>(
+      cpu, instruction, cpu.program_counter_);
+
+  if constexpr (kReportsMemory) {
+    if constexpr (kOpcode == opcodes::kST) {
+      observer.on_mem_write(program_counter, address, store_value);
+    } else {
+      // The load succeeded, so reading the value again cannot fault.
+      observer.on_mem_read(program_counter, address,
+                           cpu.memory_.read_word<MemoryAccess::kUnchecked>(address));
+      if constexpr (kOpcode == opcodes::kLDP) {
+        std::uint32_t second = address + Cpu::kInstrucionSize;
+        observer.on_mem_read(program_counter, second,
+                             cpu.memory_.read_word<MemoryAccess::kUnchecked>(second));
+      }
+    }
+  }
+  if constexpr (kOpcode == opcodes::kBEQ || kOpcode == opcodes::kBNE) {
+    std::uint32_t rs_data = cpu.registers_[instruction.rs];
+    std::uint32_t rt_data = cpu.registers_[instruction.rt];
+    observer.on_branch(program_counter,
+                       program_counter + static_cast<std::uint32_t>(instruction.imm),
+                       kOpcode == opcodes::kBEQ ? rs_data == rt_data : rs_data != rt_data);
+  } else if constexpr (kOpcode == opcodes::kJj) {
+    observer.on_branch(program_counter, static_cast<std::uint32_t>(next_program_counter), true);
+  } else if constexpr (kOpcode == opcodes::kSYSCALL) {
+    observer.on_syscall(program_counter, cpu.registers_[syscalls::kNumberRegister]);
+  }
+  observer.on_retire(program_counter, instruction,
+                     static_cast<std::uint32_t>(next_program_counter));
+
+  cpu.program_counter_ = next_program_counter;
+  ++cpu.instruction_count_;
+}
+
+template <typename Observer>
+StopReason Cpu::run_observed(Observer& observer, std::uint64_t max_instructions) {
+  start_run(max_instructions);
+  try {
+    ThreadedEngine::run(*this, observer);
+  } catch (...) {
+    flush_console();
+    throw;
+  }
+  flush_console();
+  return should_run_ ? StopReason::kInstructionLimit : stop_reason_;
+}
+
+} // namespace simulator
+
+#endif // THREADED_ENGINE_HPP_
@@ -0,0 +1,99 @@
+#ifndef TIME_TRAVEL_HPP_
+#define TIME_TRAVEL_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "simulator.hpp"
+#include "snapshot.hpp"
+
+namespace simulator {
+
+// Records execution of a Simulator so any earlier instruction count can be
+// revisited. Running checkpoints the machine every interval instructions;
+// seeking restores the nearest checkpoint at or before the target and
+// re-executes the rest, which is exact because execution is deterministic.
+// The syscalls that depend on the host are journaled, so re-executing them
+// repeats their first outcome and writes nothing to the console.
+// When the checkpoints exceed their count or memory budget every other one
+// is merged away and the interval doubles, so memory stays bounded and a
+// seek never replays more than one interval.
+//
+// State changed from outside, such as setting a register, forgets the
+// history after the current instruction count and checkpoints the changed
+// state, so replaying across it picks the change up.
+class TimeTravel {
+ public:
+  static constexpr std::uint64_t kInitialInterval = std::uint64_t{1} << 12;
+  static constexpr std::size_t kMaxCheckpoints = 1024;
+  static constexpr std::size_t kMemoryBudget = std::size_t{64} << 20;
+
+  explicit TimeTravel(Simulator& simulator,
+                      std::uint64_t interval = kInitialInterval,
+                      std::size_t max_checkpoints = kMaxCheckpoints);
+  ~TimeTravel();
+
+  TimeTravel(const TimeTravel&) = delete;
+  TimeTravel& operator=(const TimeTravel&) = delete;
+
+  // Cpu::run_program() that checkpoints along the way.
+  StopReason run(std::uint64_t max_instructions = UINT64_MAX);
+  // Cpu::pipeline_cycle() as part of the history.
+  void step();
+
+  // Moves to the state after instruction_count instructions retired, running
+  // forward if it is past everything executed so far. Stops early if the
+  // program exits on the way, but not at breakpoints or watchpoints. Throws
+  // std::runtime_error if the count is before the history.
+  void seek(std::uint64_t instruction_count);
+  // Undoes the last instruction. Throws std::runtime_error at the start of
+  // the history.
+  void step_back();
+  // Returns to the start of the history.
+  void rewind();
+
+  // Must be called after the machine state is changed outside of run() and
+  // step().
+  void state_changed() { changed_ = true; }
+
+  // Instruction count the history starts at.
+  std::uint64_t first_instruction() const;
+  std::uint64_t interval() const { return interval_; }
+  std::size_t checkpoint_count() const { return checkpoints_.size(); }
+  // Memory held by the page copies of the checkpoints.
+  std::size_t checkpoint_bytes() const { return pages_ * Memory::kPageSize; }
+
+ private:
+  struct Checkpoint {
+    std::shared_ptr<const Snapshot> snapshot;
+    // Taken after the state was changed, so it is never merged away.
+    bool changed;
+  };
+
+  static std::uint64_t instruction_count(const Checkpoint& checkpoint) {
+    return checkpoint.snapshot->get_cpu_state().instruction_count;
+  }
+
+  // Starts a new history at the current state if it was changed.
+  void record();
+  void add_checkpoint(bool changed);
+  // Merges every other checkpoint into the next one and doubles the
+  // interval.
+  void thin();
+
+  Simulator& simulator_;
+  std::uint64_t interval_;
+  std::size_t max_checkpoints_;
+
+  // Ordered by instruction count. Every checkpoint has all earlier ones in
+  // its parent chain.
+  std::vector<Checkpoint> checkpoints_;
+  std::size_t pages_ = 0;
+  SyscallJournal syscall_journal_;
+  bool changed_ = true;
+};
+
+} // namespace simulator
+
+#endif // TIME_TRAVEL_HPP_
@@ -0,0 +1,54 @@
+#ifndef TRACE_FORMAT_HPP_
+#define TRACE_FORMAT_HPP_
+
+#include <array>
+#include <cstdint>
+
+namespace simulator::trace_format {
+
+// A trace is the magic followed by records. Every record starts with a
+// tag byte. kSync records carry the program counter and the registers that
+// changed outside of traced execution:
+//   varint pc, byte count, count x (byte register, varint value)
+// Any other tag is one retired instruction, followed by the fields whose
+// flags are set, in flag order. Its PC is the next PC of the previous
+// instruction, or the PC of the last sync.
+constexpr std::array<char, 8> kMagic = {'F', 'S', 'T', 'R', 'A', 'C', 'E', '1'};
+
+constexpr std::uint8_t kSync = 0x80;
+
+// zigzag varint: PC minus the expected one, the instruction branched.
+constexpr std::uint8_t kJumped = 0x01;
+// 4 bytes little-endian: raw instruction missing from the raw cache.
+constexpr std::uint8_t kRawInstruction = 0x02;
+// byte register, zigzag varint: new value minus the old one.
+constexpr std::uint8_t kRegister = 0x04;
+constexpr std::uint8_t kSecondRegister = 0x08;
+// zigzag varint: address minus the previous memory address.
+constexpr std::uint8_t kMemoryAddress = 0x10;
+// varint: stored word.
+constexpr std::uint8_t kStoreValue = 0x20;
+
+// Direct-mapped cache of the last raw instruction seen per slot, kept in
+// step by the writer and the reader so repeated code is not stored again.
+constexpr std::uint32_t kRawCacheSize = 4096;
+
+constexpr std::uint32_t raw_cache_slot(std::uint32_t program_counter) {
+  return (program_counter >> 2) & (kRawCacheSize - 1);
+}
+
+constexpr std::uint32_t zigzag(std::int32_t value) {
+  return (static_cast<std::uint32_t>(value) << 1)
+         ^ static_cast<std::uint32_t>(value >> 31);
+}
+
+constexpr std::int32_t unzigzag(std::uint32_t value) {
+  return static_cast<std::int32_t>((value >> 1) ^ (0U - (value & 1)));
+}
+
+// Bytes a single instruction record can take.
+constexpr std::size_t kMaxRecordSize = 1 + 5 + 4 + 2 * (1 + 5) + 5 + 5;
+
+} // namespace simulator::trace_format
+
+#endif // TRACE_FORMAT_HPP_
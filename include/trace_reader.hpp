@@ -0,0 +1,108 @@
+#ifndef TRACE_READER_HPP_
+#define TRACE_READER_HPP_
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+#include "trace_format.hpp"
+
+namespace simulator {
+
+// One retired instruction of a trace.
+struct TraceEvent {
+  std::uint64_t index = 0;
+  std::uint32_t program_counter = 0;
+  std::uint32_t raw = 0;
+
+  // Registers whose value changed, with their new values.
+  std::uint8_t register_count = 0;
+  std::array<std::uint8_t, 2> register_indices = {};
+  std::array<std::uint32_t, 2> register_values = {};
+
+  bool accesses_memory = false;
+  bool stores = false;
+  std::uint32_t address = 0;
+  std::uint32_t store_value = 0;
+};
+
+// Streams a trace written by TraceWriter from a read-only mapping of the
+// file and keeps the architectural state the trace implies. Memory is only
+// known where the trace stored to it.
+class TraceReader {
+ public:
+  static constexpr std::size_t kNumberOfRegisters = 32;
+
+  // Throws std::runtime_error if the file cannot be mapped or is not a
+  // trace.
+  explicit TraceReader(const std::string& path);
+  ~TraceReader();
+
+  TraceReader(const TraceReader&) = delete;
+  TraceReader& operator=(const TraceReader&) = delete;
+
+  // Decodes the next instruction and applies it to the state. Returns false
+  // at the end of the trace, throws std::runtime_error if it is truncated.
+  bool next(TraceEvent& event);
+
+  // Advances until index instructions have retired, leaving the exact state
+  // before instruction index. An index before the current one rescans the
+  // trace from the start. Throws std::runtime_error if the trace is
+  // shorter.
+  void seek(std::uint64_t index);
+
+  // Instructions decoded so far.
+  std::uint64_t instruction_count() const { return instruction_count_; }
+  // PC of the next instruction. After next() it assumes the last
+  // instruction did not branch, seek() makes it exact.
+  std::uint32_t get_pc() const { return program_counter_; }
+  std::uint32_t get_register(std::uint8_t index) const { return registers_[index]; }
+  // Last value stored to each word address so far. It holds one entry per
+  // distinct address, so it grows with the memory the program writes, not
+  // with the length of the trace.
+  const std::unordered_map<std::uint32_t, std::uint32_t>& stored_words() const {
+    return stored_words_;
+  }
+
+ private:
+  std::uint8_t read_byte();
+  std::uint32_t read_varint();
+  // Back to the state before the first instruction.
+  void rewind();
+  void apply_syncs();
+
+  const std::uint8_t* data_ = nullptr;
+  std::size_t size_ = 0;
+  const std::uint8_t* cursor_ = nullptr;
+  const std::uint8_t* end_ = nullptr;
+
+  std::array<std::uint32_t, kNumberOfRegisters> registers_ = {};
+  std::array<std::uint32_t, trace_format::kRawCacheSize> raw_cache_ = {};
+  std::unordered_map<std::uint32_t, std::uint32_t> stored_words_;
+  std::uint32_t program_counter_ = 0;
+  std::uint32_t last_address_ = 0;
+  std::uint64_t instruction_count_ = 0;
+};
+
+struct TraceFilter {
+  std::uint64_t first_index = 0;
+  std::uint64_t last_index = UINT64_MAX;
+  std::uint32_t first_address = 0;
+  std::uint32_t last_address = UINT32_MAX;
+};
+
+// Prints one line per instruction inside the filter.
+void write_trace(std::ostream& output, TraceReader& reader,
+                 const TraceFilter& filter);
+
+void write_trace_event(std::ostream& output, const TraceEvent& event);
+
+// Reports the first instruction where the traces differ. Returns true if
+// they are identical.
+bool diff_traces(std::ostream& output, TraceReader& lhs, TraceReader& rhs);
+
+} // namespace simulator
+
+#endif // TRACE_READER_HPP_
@@ -0,0 +1,191 @@
+#ifndef TRACE_WRITER_HPP_
+#define TRACE_WRITER_HPP_
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "execution_observer.hpp"
+#include "instruction_formats.hpp"
+#include "opcodes.hpp"
+#include "syscalls.hpp"
+#include "trace_format.hpp"
+
+namespace simulator {
+
+// Streams the trace of retired instructions to a file in the format of
+// trace_format.hpp. Records are encoded into one buffer while a background
+// thread writes the other, so the simulation only waits when the disk
+// falls a whole buffer behind.
+class TraceWriter {
+ public:
+  static constexpr std::size_t kBufferSize = std::size_t{1} << 22;
+  static constexpr std::size_t kNumberOfRegisters = 32;
+
+  // Throws std::runtime_error if the file cannot be created.
+  explicit TraceWriter(const std::string& path);
+  // Closes without reporting write errors, use close() to see them.
+  ~TraceWriter();
+
+  TraceWriter(const TraceWriter&) = delete;
+  TraceWriter& operator=(const TraceWriter&) = delete;
+
+  // Records where execution resumes and the registers changed since the
+  // last record. Needed whenever the state changes outside of traced
+  // instructions and after the last one, so the final PC is known.
+  void sync(std::uint32_t program_counter,
+            const std::array<std::uint32_t, kNumberOfRegisters>& registers);
+
+  // An instruction record is begin(), then any register writes, then at
+  // most one memory access.
+  void begin(std::uint32_t program_counter, std::uint32_t raw) {
+    if (static_cast<std::size_t>(end_ - cursor_) < trace_format::kMaxRecordSize) {
+      swap_buffers();
+    }
+    tag_ = cursor_++;
+    *tag_ = 0;
+
+    if (program_counter != expected_program_counter_) {
+      *tag_ |= trace_format::kJumped;
+      put_varint(trace_format::zigzag(static_cast<std::int32_t>(
+          program_counter - expected_program_counter_)));
+    }
+
+    RawCacheEntry& cached = raw_cache_[trace_format::raw_cache_slot(program_counter)];
+    if (cached.program_counter != program_counter || cached.raw != raw) {
+      cached = {program_counter, raw};
+      *tag_ |= trace_format::kRawInstruction;
+      for (int i = 0; i < 4; ++i) {
+        *cursor_++ = static_cast<std::uint8_t>(raw >> (8 * i));
+      }
+    }
+    expected_program_counter_ = program_counter + 4;
+  }
+
+  void write_register(std::uint8_t index, std::uint32_t value) {
+    std::uint32_t& shadow = registers_[index];
+    if (shadow == value) {
+      return;
+    }
+    *tag_ |= (*tag_ & trace_format::kRegister) ? trace_format::kSecondRegister
+                                               : trace_format::kRegister;
+    *cursor_++ = index;
+    put_varint(trace_format::zigzag(static_cast<std::int32_t>(value - shadow)));
+    shadow = value;
+  }
+
+  void access_memory(std::uint32_t address) {
+    *tag_ |= trace_format::kMemoryAddress;
+    put_varint(trace_format::zigzag(static_cast<std::int32_t>(address - last_address_)));
+    last_address_ = address;
+  }
+
+  void store(std::uint32_t address, std::uint32_t value) {
+    access_memory(address);
+    *tag_ |= trace_format::kStoreValue;
+    put_varint(value);
+  }
+
+  // Writes out everything recorded so far and closes the file. Throws
+  // std::runtime_error if any write failed.
+  void close();
+
+ private:
+  struct RawCacheEntry {
+    std::uint32_t program_counter = UINT32_MAX;
+    std::uint32_t raw = 0;
+  };
+
+  void put_varint(std::uint32_t value) {
+    while (value >= 0x80) {
+      *cursor_++ = static_cast<std::uint8_t>(value | 0x80);
+      value >>= 7;
+    }
+    *cursor_++ = static_cast<std::uint8_t>(value);
+  }
+
+  // Hands the filled buffer to the writer thread and continues in the
+  // other one once the thread is done with it.
+  void swap_buffers();
+  void write_loop();
+
+  std::FILE* file_;
+
+  std::array<std::vector<std::uint8_t>, 2> buffers_;
+  std::size_t active_ = 0;
+  std::uint8_t* cursor_;
+  std::uint8_t* end_;
+  std::uint8_t* tag_ = nullptr;
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::size_t pending_buffer_ = 0;
+  std::size_t pending_size_ = 0;
+  bool pending_ = false;
+  bool closing_ = false;
+  bool failed_ = false;
+  std::thread writer_;
+
+  std::array<std::uint32_t, kNumberOfRegisters> registers_ = {};
+  std::array<RawCacheEntry, trace_format::kRawCacheSize> raw_cache_;
+  std::uint32_t expected_program_counter_ = 0;
+  std::uint32_t last_address_ = 0;
+};
+
+// Records an observed run into a trace. The address and the stored value
+// are taken at fetch, as the instruction may overwrite their registers.
+class TraceObserver final : public ExecutionObserver<TraceObserver> {
+ public:
+  TraceObserver(TraceWriter& trace,
+                const std::array<std::uint32_t, TraceWriter::kNumberOfRegisters>& registers)
+    : trace_(trace), registers_(registers) {}
+
+  void on_fetch(std::uint32_t /*program_counter*/, const DecodedInstruction& instruction) {
+    address_ = registers_[instruction.rs] + static_cast<std::uint32_t>(instruction.imm);
+    store_value_ = registers_[instruction.rt];
+  }
+
+  void on_retire(std::uint32_t program_counter, const DecodedInstruction& instruction,
+                 std::uint32_t /*next_program_counter*/) {
+    trace_.begin(program_counter, instruction.raw);
+    switch (instruction.opcode) {
+      case opcodes::kST:
+        trace_.store(address_, store_value_);
+        break;
+      case opcodes::kLDP:
+        trace_.write_register(instruction.rd, registers_[instruction.rd]);
+        trace_.write_register(instruction.rt, registers_[instruction.rt]);
+        trace_.access_memory(address_);
+        break;
+      case opcodes::kSYSCALL:
+        trace_.write_register(syscalls::kResult, registers_[syscalls::kResult]);
+        break;
+      case opcodes::kBEQ:
+      case opcodes::kBNE:
+      case opcodes::kJj:
+        break;
+      case opcodes::kLD:
+        trace_.write_register(instruction.rd, registers_[instruction.rd]);
+        trace_.access_memory(address_);
+        break;
+      default:
+        trace_.write_register(instruction.rd, registers_[instruction.rd]);
+        break;
+    }
+  }
+
+ private:
+  TraceWriter& trace_;
+  const std::array<std::uint32_t, TraceWriter::kNumberOfRegisters>& registers_;
+  std::uint32_t address_ = 0;
+  std::uint32_t store_value_ = 0;
+};
+
+} // namespace simulator
+
+#endif // TRACE_WRITER_HPP_
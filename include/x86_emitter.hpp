@@ -0,0 +1,86 @@
+#ifndef X86_EMITTER_HPP_
+#define X86_EMITTER_HPP_
+
+#include <cstdint>
+#include <vector>
+
+namespace simulator::x86 {
+
+enum Register : std::uint8_t {
+  kRax = 0, kRcx = 1, kRdx = 2, kRbx = 3,
+  kRsp = 4, kRbp = 5, kRsi = 6, kRdi = 7,
+  kR8 = 8, kR9 = 9, kR10 = 10, kR11 = 11,
+  kR12 = 12, kR13 = 13, kR14 = 14, kR15 = 15,
+};
+
+enum Condition : std::uint8_t {
+  kEqual = 0x4,
+  kNotEqual = 0x5,
+};
+
+// Position of a rel32 jump displacement waiting for its target.
+struct Fixup {
+  std::size_t position;
+};
+
+// Minimal x86-64 encoder for the instructions the JIT needs. Register
+// operands are 32-bit unless the method name says otherwise; memory
+// operands are [base + disp8].
+class Emitter {
+ public:
+  const std::vector<std::uint8_t>& code() const { return code_; }
+  std::size_t size() const { return code_.size(); }
+
+  void push(Register reg);
+  void pop(Register reg);
+  void ret();
+  void call(Register reg);
+  void add_rsp(std::int8_t value);
+  void sub_rsp(std::int8_t value);
+
+  void mov64(Register dst, Register src);
+  void mov64(Register dst, Register base, std::int8_t disp);
+  void mov64(Register dst, std::uint64_t imm);
+
+  void mov(Register dst, Register src);
+  void mov(Register dst, std::uint32_t imm);
+  void mov(Register dst, Register base, std::int8_t disp);
+  void mov(Register base, std::int8_t disp, Register src);
+
+  void add(Register dst, Register src);
+  void add(Register dst, std::uint32_t imm);
+  void add64(Register base, std::int8_t disp, std::int8_t imm);
+  void sub(Register base, std::int8_t disp, std::int8_t imm);
+  void or_(Register dst, Register src);
+  void xor_(Register dst, Register src);
+  void and_(Register dst, std::uint32_t imm);
+  void xor_(Register dst, std::int8_t imm);
+  void not_(Register reg);
+  void cmp(Register lhs, Register rhs);
+  void cmp(Register lhs, std::int8_t imm);
+  void test(Register lhs, Register rhs);
+  void bsr(Register dst, Register src);
+
+  Fixup jcc(Condition condition);
+  Fixup jmp();
+  void bind(Fixup fixup);
+  void bind(Fixup fixup, std::size_t target);
+
+ private:
+  void emit(std::uint8_t byte) { code_.push_back(byte); }
+  void emit32(std::uint32_t value);
+  void emit64(std::uint64_t value);
+
+  void rex(bool wide, std::uint8_t reg, std::uint8_t rm);
+  // reg is a register or an opcode extension.
+  void modrm_reg(std::uint8_t opcode, std::uint8_t reg, Register rm, bool wide = false);
+  void modrm_mem(std::uint8_t opcode, std::uint8_t reg, Register base,
+                 std::int8_t disp, bool wide = false);
+  Fixup rel32();
+
+  std::vector<std::uint8_t> code_;
+};
+
+} // namespace simulator::x86
+
+#endif // X86_EMITTER_HPP_
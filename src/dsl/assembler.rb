@@ -13,7 +13,9 @@ class Assembler
     :BNE     => 0b000110,
     :LD      => 0b001010,
     :XOR     => 0b101001,
-    :SYSCALL => 0b111000
+    :SYSCALL => 0b111000,
+    :BEQ     => 0b011110,
+    :J       => 0b110110
   }
 
   def initialize
@@ -0,0 +1,116 @@
+#include "alu_kernels.hpp"
+
+#include <atomic>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SIMULATOR_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace simulator::alu {
+
+namespace {
+
+constexpr std::uint32_t kBitsInWord = 32;
+
+#ifdef SIMULATOR_X86_KERNELS
+__attribute__((target("bmi2")))
+std::uint32_t pdep_bit_deposit(std::uint32_t value, std::uint32_t mask) {
+  return _pdep_u32(value, mask);
+}
+
+bool has_pdep() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("bmi2");
+}
+
+bool has_fast_pdep() {
+  return has_pdep() && !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2");
+}
+#endif
+
+BitDepositKernel select_bit_deposit() {
+#ifdef SIMULATOR_X86_KERNELS
+  if (has_fast_pdep()) {
+    return &pdep_bit_deposit;
+  }
+#endif
+  return &portable_bit_deposit;
+}
+
+std::uint32_t resolve_bit_deposit(std::uint32_t value, std::uint32_t mask);
+
+// Starts at a trampoline that stores the selected kernel on the first call.
+std::atomic<BitDepositKernel> selected_bit_deposit {&resolve_bit_deposit};
+
+std::uint32_t resolve_bit_deposit(std::uint32_t value, std::uint32_t mask) {
+  return bit_deposit_kernel()(value, mask);
+}
+
+} // namespace
+
+std::uint32_t reference_count_leading_zeros(std::uint32_t value) {
+  if (value == 0) {
+    return kBitsInWord;
+  }
+
+  std::uint32_t count = 0;
+  for (std::uint32_t i = kBitsInWord; i > 0; --i) {
+    if (((value >> (i - 1)) & 1) != 0) {
+      break;
+    }
+    ++count;
+  }
+  return count;
+}
+
+std::uint32_t reference_bit_deposit(std::uint32_t value, std::uint32_t mask) {
+  std::uint32_t result = 0;
+  std::uint32_t value_bit = 0;
+  for (std::uint32_t i = 0; i < kBitsInWord; ++i) {
+    if (((mask >> i) & 1) != 0) {
+      if (((value >> value_bit) & 1) != 0) {
+        result |= (1U << i);
+      }
+      ++value_bit;
+    }
+  }
+  return result;
+}
+
+std::uint32_t portable_bit_deposit(std::uint32_t value, std::uint32_t mask) {
+  std::uint32_t result = 0;
+  for (; mask != 0; mask &= mask - 1, value >>= 1) {
+    // Lowest remaining mask bit, filled from the next bit of value.
+    result |= mask & (0U - (value & 1)) & (0U - mask);
+  }
+  return result;
+}
+
+BitDepositKernel hardware_bit_deposit() {
+#ifdef SIMULATOR_X86_KERNELS
+  if (has_pdep()) {
+    return &pdep_bit_deposit;
+  }
+#endif
+  return nullptr;
+}
+
+BitDepositKernel bit_deposit_kernel() {
+  BitDepositKernel kernel = selected_bit_deposit.load(std::memory_order_relaxed);
+  if (kernel == &resolve_bit_deposit) {
+    kernel = select_bit_deposit();
+    selected_bit_deposit.store(kernel, std::memory_order_relaxed);
+  }
+  return kernel;
+}
+
+const char* bit_deposit_kernel_name() {
+  return bit_deposit_kernel() == &portable_bit_deposit ? "portable" : "pdep";
+}
+
+std::uint32_t bit_deposit(std::uint32_t value, std::uint32_t mask) {
+  return selected_bit_deposit.load(std::memory_order_relaxed)(value, mask);
+}
+
+} // namespace simulator::alu
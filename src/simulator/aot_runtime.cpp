@@ -0,0 +1,65 @@
+#include "aot_runtime.hpp"
+
+#include "syscalls.hpp"
+
+namespace simulator {
+
+bool AotRuntime::can_run(const Cpu& cpu) {
+  return cpu.breakpoints_.empty() && cpu.watchpoints_.empty()
+         && !cpu.profiler_ && !cpu.trace_ && !cpu.timing_ && !cpu.cache_
+         && !cpu.branch_predictor_ && cpu.observers_.empty();
+}
+
+std::uint32_t* AotRuntime::registers(Cpu& cpu) {
+  return cpu.registers_.data();
+}
+
+Memory& AotRuntime::memory(Cpu& cpu) {
+  return cpu.memory_;
+}
+
+std::uint64_t AotRuntime::limit(const Cpu& cpu, std::uint64_t max_instructions) {
+  return max_instructions > UINT64_MAX - cpu.instruction_count_
+             ? UINT64_MAX
+             : cpu.instruction_count_ + max_instructions;
+}
+
+AotRuntime::SyscallResult AotRuntime::syscall(Cpu& cpu, std::uint32_t program_counter,
+                                              std::uint64_t count,
+                                              std::uint32_t image_end) {
+  cpu.program_counter_ = static_cast<std::int32_t>(program_counter);
+  cpu.instruction_count_ = count;
+  bool writes_image = cpu.registers_[syscalls::kNumberRegister] == syscalls::READ
+                      && cpu.registers_[syscalls::kArgument0] < image_end;
+
+  cpu.should_run_ = true;
+  cpu.execute_syscall_format();
+  cpu.program_counter_ = static_cast<std::int32_t>(program_counter + Cpu::kInstrucionSize);
+  cpu.instruction_count_ = count + 1;
+  if (!cpu.should_run_) {
+    return SyscallResult::kExited;
+  }
+  return writes_image ? SyscallResult::kInterpret : SyscallResult::kContinue;
+}
+
+StopReason AotRuntime::finish(Cpu& cpu, std::uint32_t program_counter,
+                              std::uint64_t count, StopReason reason) {
+  cpu.program_counter_ = static_cast<std::int32_t>(program_counter);
+  cpu.instruction_count_ = count;
+  cpu.should_run_ = false;
+  cpu.flush_console();
+  return reason;
+}
+
+void AotRuntime::fault(Cpu& cpu, std::uint32_t program_counter, std::uint64_t count) {
+  finish(cpu, program_counter, count, StopReason::kExited);
+}
+
+StopReason AotRuntime::interpret(Cpu& cpu, std::uint32_t program_counter,
+                                 std::uint64_t count, std::uint64_t limit) {
+  cpu.program_counter_ = static_cast<std::int32_t>(program_counter);
+  cpu.instruction_count_ = count;
+  return cpu.run_program(limit - count);
+}
+
+} // namespace simulator
@@ -0,0 +1,460 @@
+#include "aot_translator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cctype>
+#include <ios>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "bit_shifts.hpp"
+#include "instruction_parser.hpp"
+#include "instruction_semantics.hpp"
+#include "opcodes.hpp"
+#include "syscalls.hpp"
+
+namespace simulator {
+
+namespace {
+
+constexpr std::uint32_t kInstructionSize = 4;
+constexpr std::size_t kNumberOfRegisters = 32;
+
+// Decoded words of the image, nullopt for words that do not decode.
+struct ImageCode {
+  std::vector<std::optional<DecodedInstruction>> instructions;
+
+  std::uint32_t end() const {
+    return static_cast<std::uint32_t>(instructions.size()) * kInstructionSize;
+  }
+
+  const std::optional<DecodedInstruction>& at(std::uint32_t address) const {
+    return instructions[address / kInstructionSize];
+  }
+
+  bool translated(std::uint32_t address) const {
+    return address < end() && at(address).has_value();
+  }
+};
+
+ImageCode decode_image(const std::vector<std::uint8_t>& image) {
+  ImageCode code;
+  for (std::size_t offset = 0; offset + kInstructionSize <= image.size();
+       offset += kInstructionSize) {
+    std::uint32_t raw = 0;
+    for (std::uint32_t i = 0; i < kInstructionSize; ++i) {
+      raw |= static_cast<std::uint32_t>(image[offset + i]) << (8 * i);
+    }
+    try {
+      code.instructions.push_back(InstructionParser::decode(raw));
+    } catch (const std::runtime_error&) {
+      code.instructions.push_back(std::nullopt);
+    }
+  }
+  return code;
+}
+
+std::optional<std::uint32_t> branch_target(std::uint32_t address,
+                                           const DecodedInstruction& instruction) {
+  switch (instruction.opcode) {
+    case opcodes::kBEQ:
+    case opcodes::kBNE:
+      return address + static_cast<std::uint32_t>(instruction.imm);
+    case opcodes::kJj:
+      return (address & shifts::kFirst4BitsMask) | static_cast<std::uint32_t>(instruction.imm);
+    default:
+      return std::nullopt;
+  }
+}
+
+std::vector<ImageBlock> split_blocks(const ImageCode& code) {
+  std::set<std::uint32_t> leaders;
+  if (code.translated(0)) {
+    leaders.insert(0);
+  }
+  for (std::uint32_t address = 0; address < code.end(); address += kInstructionSize) {
+    const std::optional<DecodedInstruction>& instruction = code.at(address);
+    if (!instruction || !InstructionSemantics::is_block_terminator(instruction->opcode)) {
+      continue;
+    }
+    std::optional<std::uint32_t> target = branch_target(address, *instruction);
+    if (target && code.translated(*target)) {
+      leaders.insert(*target);
+    }
+    if (code.translated(address + kInstructionSize)) {
+      leaders.insert(address + kInstructionSize);
+    }
+  }
+
+  std::vector<ImageBlock> blocks;
+  for (std::uint32_t start : leaders) {
+    ImageBlock block {start, start, {}};
+    while (true) {
+      const DecodedInstruction& instruction = *code.at(block.end);
+      std::uint32_t address = block.end;
+      block.end += kInstructionSize;
+
+      if (InstructionSemantics::is_block_terminator(instruction.opcode)) {
+        if (std::optional<std::uint32_t> target = branch_target(address, instruction)) {
+          block.successors.push_back(*target);
+        }
+        if (instruction.opcode != opcodes::kJj) {
+          block.successors.push_back(block.end);
+        }
+        break;
+      }
+      if (!code.translated(block.end) || leaders.count(block.end) != 0) {
+        block.successors.push_back(block.end);
+        break;
+      }
+    }
+    blocks.push_back(std::move(block));
+  }
+  return blocks;
+}
+
+std::string hex(std::uint32_t value) {
+  std::ostringstream text;
+  text << "0x" << std::hex << value;
+  return text.str();
+}
+
+std::string label(std::uint32_t address) {
+  std::ostringstream text;
+  text << "block_" << std::hex;
+  text.width(8);
+  text.fill('0');
+  text << address;
+  return text.str();
+}
+
+std::string reg(std::uint8_t index) {
+  return "r" + std::to_string(index);
+}
+
+class Emitter {
+ public:
+  Emitter(const ImageCode& code, const std::vector<ImageBlock>& blocks,
+          std::uint32_t image_end)
+    : code_(code), blocks_(blocks), image_end_(image_end) {
+    for (const ImageBlock& block : blocks_) {
+      leaders_.insert(block.start);
+      for (std::uint32_t address = block.start; address < block.end;
+           address += kInstructionSize) {
+        const DecodedInstruction& instruction = *code_.at(address);
+        mark_registers(instruction);
+        uses_memory_ |= InstructionSemantics::accesses_memory(instruction.opcode);
+        writes_memory_ |= instruction.opcode == opcodes::kST
+                          || instruction.opcode == opcodes::kSYSCALL;
+      }
+    }
+  }
+
+  std::string emit(const std::string& symbol) {
+    std::size_t instructions = 0;
+    for (const ImageBlock& block : blocks_) {
+      instructions += (block.end - block.start) / kInstructionSize;
+    }
+
+    out_ << "// Generated by `simulator translate`, do not edit.\n"
+         << "// " << instructions << " instructions in " << blocks_.size()
+         << " blocks of a " << image_end_ << " byte image.\n"
+         << "#include <cstdint>\n\n"
+         << "#include \"alu_kernels.hpp\"\n"
+         << "#include \"aot_runtime.hpp\"\n"
+         << "#include \"cpu.hpp\"\n\n"
+         << "simulator::StopReason " << symbol
+         << "(simulator::Cpu& cpu, std::uint64_t max_instructions);\n\n"
+         << "simulator::StopReason " << symbol
+         << "(simulator::Cpu& cpu, std::uint64_t max_instructions) {\n"
+         << "  using simulator::AotRuntime;\n"
+         << "  using simulator::StopReason;\n";
+    if (writes_memory_) {
+      out_ << "  constexpr std::uint32_t kImageEnd = " << hex(image_end_) << ";\n";
+    }
+    out_ << "\n"
+         << "  if (!AotRuntime::can_run(cpu)) {\n"
+         << "    return cpu.run_program(max_instructions);\n"
+         << "  }\n"
+         << "  std::uint32_t* registers = AotRuntime::registers(cpu);\n";
+    if (uses_memory_) {
+      out_ << "  simulator::Memory& memory = AotRuntime::memory(cpu);\n";
+    }
+    out_ << "  const std::uint64_t limit = AotRuntime::limit(cpu, max_instructions);\n"
+         << "  std::uint64_t count = cpu.get_instruction_count();\n"
+         << "  std::uint32_t pc = cpu.get_pc();\n"
+         << "  // Start of the running block, a fault retires the instructions\n"
+         << "  // from it up to pc.\n"
+         << "  std::uint32_t block = pc;\n";
+    for (std::size_t i = 0; i < kNumberOfRegisters; ++i) {
+      if (used_[i]) {
+        out_ << "  std::uint32_t r" << i << " = registers[" << i << "];\n";
+      }
+    }
+
+    out_ << "\n  try {\n"
+         << "    switch (pc) {\n";
+    for (const ImageBlock& block : blocks_) {
+      out_ << "      case " << hex(block.start) << ": goto " << label(block.start) << ";\n";
+    }
+    out_ << "      default: goto interpret;\n"
+         << "    }\n";
+
+    for (std::size_t i = 0; i < blocks_.size(); ++i) {
+      std::optional<std::uint32_t> next;
+      if (i + 1 < blocks_.size()) {
+        next = blocks_[i + 1].start;
+      }
+      emit_block(blocks_[i], next);
+    }
+
+    out_ << "  } catch (...) {\n";
+    emit_store_registers("    ");
+    out_ << "    AotRuntime::fault(cpu, pc, count + (pc - block) / " << kInstructionSize << ");\n"
+         << "    throw;\n"
+         << "  }\n\n"
+         << "interpret:\n";
+    emit_store_registers("  ");
+    out_ << "  return AotRuntime::interpret(cpu, pc, count, limit);\n"
+         << "}\n";
+    return out_.str();
+  }
+
+ private:
+  void mark_registers(const DecodedInstruction& instruction) {
+    switch (instruction.opcode) {
+      case opcodes::kNOR:
+      case opcodes::kADD:
+      case opcodes::kXOR:
+      case opcodes::kBDEP:
+      case opcodes::kLDP:
+      case opcodes::kST:
+      case opcodes::kBEQ:
+      case opcodes::kBNE:
+        used_[instruction.rd] = true;
+        used_[instruction.rs] = true;
+        used_[instruction.rt] = true;
+        break;
+      case opcodes::kCBIT:
+      case opcodes::kSSAT:
+      case opcodes::kCLZ:
+      case opcodes::kLD:
+        used_[instruction.rd] = true;
+        used_[instruction.rs] = true;
+        break;
+      default:
+        break;
+    }
+  }
+
+  void emit_store_registers(const std::string& indent) {
+    for (std::size_t i = 0; i < kNumberOfRegisters; ++i) {
+      if (used_[i]) {
+        out_ << indent << "registers[" << i << "] = r" << i << ";\n";
+      }
+    }
+  }
+
+  // Continues at address, in its block or in the interpreter.
+  void emit_goto(std::uint32_t address, const std::string& indent) {
+    if (leaders_.count(address) != 0) {
+      out_ << indent << "goto " << label(address) << ";\n";
+    } else {
+      out_ << indent << "pc = " << hex(address) << ";\n"
+           << indent << "goto interpret;\n";
+    }
+  }
+
+  void emit_block(const ImageBlock& block, std::optional<std::uint32_t> next) {
+    std::uint32_t length = (block.end - block.start) / kInstructionSize;
+    std::uint32_t last = block.end - kInstructionSize;
+    // A load or store may also end the block when a leader follows it. A
+    // syscall at the end sets the block itself.
+    bool faults = false;
+    for (std::uint32_t address = block.start; address <= last; address += kInstructionSize) {
+      faults |= InstructionSemantics::accesses_memory(code_.at(address)->opcode);
+    }
+
+    out_ << "\n" << label(block.start) << ":\n"
+         << "    if (limit - count < " << length << ") {\n"
+         << "      pc = " << hex(block.start) << ";\n"
+         << "      goto interpret;\n"
+         << "    }\n";
+    if (faults) {
+      out_ << "    block = " << hex(block.start) << ";\n";
+    }
+
+    for (std::uint32_t address = block.start; address < last; address += kInstructionSize) {
+      emit_instruction(block, address);
+    }
+
+    const DecodedInstruction& terminator = *code_.at(last);
+    switch (terminator.opcode) {
+      case opcodes::kBEQ:
+      case opcodes::kBNE:
+        out_ << "    count += " << length << ";\n"
+             << "    if (" << reg(terminator.rs)
+             << (terminator.opcode == opcodes::kBEQ ? " == " : " != ")
+             << reg(terminator.rt) << ") {\n";
+        emit_goto(block.successors[0], "      ");
+        out_ << "    }\n";
+        break;
+      case opcodes::kJj:
+        out_ << "    count += " << length << ";\n";
+        emit_goto(block.successors[0], "    ");
+        return;
+      case opcodes::kSYSCALL:
+        emit_syscall(last, length - 1);
+        break;
+      default:
+        emit_instruction(block, last);
+        out_ << "    count += " << length << ";\n";
+        break;
+    }
+
+    if (next != block.end) {
+      emit_goto(block.end, "    ");
+    }
+  }
+
+  void emit_instruction(const ImageBlock& block, std::uint32_t address) {
+    const DecodedInstruction& instruction = *code_.at(address);
+    std::string rd = reg(instruction.rd);
+    std::string rs = reg(instruction.rs);
+    std::string rt = reg(instruction.rt);
+    std::string imm = std::to_string(instruction.imm);
+
+    // Results written to r0 are dropped, except by LDP.
+    auto write = [&](const std::string& value) {
+      if (instruction.rd != 0) {
+        out_ << "    " << rd << " = " << value << ";\n";
+      }
+    };
+
+    switch (instruction.opcode) {
+      case opcodes::kNOR:
+        write("~(" + rs + " | " + rt + ")");
+        break;
+      case opcodes::kADD:
+        write(rs + " + " + rt);
+        break;
+      case opcodes::kXOR:
+        write(rs + " ^ " + rt);
+        break;
+      case opcodes::kCBIT:
+        write("simulator::Cpu::clear_bit_field(" + rs + ", " + imm + ")");
+        break;
+      case opcodes::kSSAT:
+        write("simulator::Cpu::saturate_signed(" + rs + ", " + imm + ")");
+        break;
+      case opcodes::kCLZ:
+        write("simulator::alu::count_leading_zeros(" + rs + ")");
+        break;
+      case opcodes::kBDEP:
+        write("simulator::alu::bit_deposit(" + rs + ", " + rt + ")");
+        break;
+      case opcodes::kLD:
+        out_ << "    pc = " << hex(address) << ";\n";
+        if (instruction.rd != 0) {
+          out_ << "    " << rd << " = memory.read_word(" << rs << " + " << hex(static_cast<std::uint32_t>(instruction.imm)) << "u);\n";
+        } else {
+          out_ << "    static_cast<void>(memory.read_word(" << rs << " + " << hex(static_cast<std::uint32_t>(instruction.imm)) << "u));\n";
+        }
+        break;
+      case opcodes::kLDP:
+        out_ << "    pc = " << hex(address) << ";\n"
+             << "    {\n"
+             << "      std::uint32_t address = " << rs << " + " << hex(static_cast<std::uint32_t>(instruction.imm)) << "u;\n"
+             << "      " << rd << " = memory.read_word(address);\n"
+             << "      " << rt << " = memory.read_word(address + " << kInstructionSize << ");\n"
+             << "    }\n";
+        break;
+      case opcodes::kST:
+        out_ << "    pc = " << hex(address) << ";\n"
+             << "    {\n"
+             << "      std::uint32_t address = " << rs << " + " << hex(static_cast<std::uint32_t>(instruction.imm)) << "u;\n"
+             << "      memory.write_word(address, " << rt << ");\n"
+             << "      if (address < kImageEnd) {\n"
+             << "        count += " << (address - block.start) / kInstructionSize + 1 << ";\n";
+        emit_goto_interpret(address + kInstructionSize, "        ");
+        out_ << "      }\n"
+             << "    }\n";
+        break;
+      default:
+        // Opcode 0 does nothing.
+        break;
+    }
+  }
+
+  void emit_goto_interpret(std::uint32_t address, const std::string& indent) {
+    out_ << indent << "pc = " << hex(address) << ";\n"
+         << indent << "goto interpret;\n";
+  }
+
+  void emit_syscall(std::uint32_t address, std::uint32_t before) {
+    std::uint32_t after = address + kInstructionSize;
+    if (before != 0) {
+      out_ << "    count += " << before << ";\n";
+    }
+    out_ << "    pc = " << hex(address) << ";\n"
+         << "    block = pc;\n";
+    emit_store_registers("    ");
+    out_ << "    {\n"
+         << "      AotRuntime::SyscallResult result =\n"
+         << "          AotRuntime::syscall(cpu, " << hex(address) << ", count, kImageEnd);\n"
+         << "      ++count;\n";
+    if (used_[syscalls::kResult]) {
+      out_ << "      " << reg(syscalls::kResult) << " = registers["
+           << static_cast<int>(syscalls::kResult) << "];\n";
+    }
+    out_ << "      if (result == AotRuntime::SyscallResult::kExited) {\n"
+         << "        return AotRuntime::finish(cpu, " << hex(after)
+         << ", count, StopReason::kExited);\n"
+         << "      }\n"
+         << "      if (result == AotRuntime::SyscallResult::kInterpret) {\n";
+    emit_goto_interpret(after, "        ");
+    out_ << "      }\n"
+         << "    }\n";
+  }
+
+  const ImageCode& code_;
+  const std::vector<ImageBlock>& blocks_;
+  std::uint32_t image_end_;
+  std::set<std::uint32_t> leaders_;
+  std::bitset<kNumberOfRegisters> used_;
+  bool uses_memory_ = false;
+  // Stores and syscalls check for writes into the image.
+  bool writes_memory_ = false;
+  std::ostringstream out_;
+};
+
+bool is_identifier(const std::string& symbol) {
+  if (symbol.empty() || std::isdigit(static_cast<unsigned char>(symbol[0]))) {
+    return false;
+  }
+  return std::all_of(symbol.begin(), symbol.end(), [](char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+  });
+}
+
+} // namespace
+
+std::vector<ImageBlock> recover_blocks(const std::vector<std::uint8_t>& image) {
+  return split_blocks(decode_image(image));
+}
+
+std::string translate_program(const std::vector<std::uint8_t>& image,
+                              const std::string& symbol) {
+  if (!is_identifier(symbol)) {
+    throw std::runtime_error("Invalid symbol for the translated program: '" + symbol + "'");
+  }
+  ImageCode code = decode_image(image);
+  std::vector<ImageBlock> blocks = split_blocks(code);
+  Emitter emitter(code, blocks, static_cast<std::uint32_t>(image.size()));
+  return emitter.emit(symbol);
+}
+
+} // namespace simulator
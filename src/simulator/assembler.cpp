@@ -0,0 +1,465 @@
+#include "assembler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include "bit_shifts.hpp"
+#include "opcodes.hpp"
+
+namespace simulator {
+
+namespace {
+
+constexpr std::uint32_t kNumberOfRegisters = 32;
+constexpr std::uint32_t kWordSize = 4;
+constexpr std::size_t kMaxOperands = 3;
+constexpr std::int64_t kMaxImmediate5 = 31;
+constexpr std::int64_t kMaxPairOffset = 2047;
+
+// Operand layouts, the first four are encoded in the low opcode field.
+enum class Format {
+  kRegisters,
+  kBdep,
+  kClz,
+  kSyscall,
+  kImmediate5,
+  kMemory,
+  kPair,
+  kBranch,
+  kJump,
+};
+
+struct Encoding {
+  std::uint8_t opcode;
+  Format format;
+};
+
+constexpr std::array<Encoding, 14> kEncodings = {{
+    {opcodes::kNOR, Format::kRegisters},
+    {opcodes::kADD, Format::kRegisters},
+    {opcodes::kXOR, Format::kRegisters},
+    {opcodes::kBDEP, Format::kBdep},
+    {opcodes::kCLZ, Format::kClz},
+    {opcodes::kSYSCALL, Format::kSyscall},
+    {opcodes::kCBIT, Format::kImmediate5},
+    {opcodes::kSSAT, Format::kImmediate5},
+    {opcodes::kLD, Format::kMemory},
+    {opcodes::kST, Format::kMemory},
+    {opcodes::kLDP, Format::kPair},
+    {opcodes::kBNE, Format::kBranch},
+    {opcodes::kBEQ, Format::kBranch},
+    {opcodes::kJj, Format::kJump},
+}};
+
+// Label references resolved once every label is known.
+enum class Reference {
+  kBranch,
+  kJump,
+  kWord,
+};
+
+struct Fixup {
+  std::size_t word;
+  std::size_t line;
+  Reference reference;
+  std::string_view label;
+};
+
+bool equals_ignoring_case(std::string_view lhs, std::string_view rhs) {
+  return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](char a, char b) {
+    return (a >= 'a' && a <= 'z' ? a - 'a' + 'A' : a) == (b >= 'a' && b <= 'z' ? b - 'a' + 'A' : b);
+  });
+}
+
+std::string_view trim(std::string_view text) {
+  std::size_t first = text.find_first_not_of(" \t\r");
+  if (first == std::string_view::npos) {
+    return {};
+  }
+  return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+bool is_identifier(std::string_view text) {
+  auto start = [](char symbol) {
+    return (symbol >= 'a' && symbol <= 'z') || (symbol >= 'A' && symbol <= 'Z')
+           || symbol == '_' || symbol == '.';
+  };
+  return !text.empty() && start(text.front())
+         && std::all_of(text.begin() + 1, text.end(), [&start](char symbol) {
+              return start(symbol) || (symbol >= '0' && symbol <= '9');
+            });
+}
+
+bool is_number(std::string_view text) {
+  return !text.empty() && ((text.front() >= '0' && text.front() <= '9') || text.front() == '-');
+}
+
+std::string hex(std::uint32_t value) {
+  std::ostringstream text;
+  text << "0x" << std::hex << std::setw(8) << std::setfill('0') << value;
+  return text.str();
+}
+
+class Assembly {
+ public:
+  Assembly(std::string_view source, std::string_view name) : source_(source), name_(name) {}
+
+  AssembledProgram run();
+
+ private:
+  [[noreturn]] void fail(const std::string& message) const {
+    throw std::runtime_error(std::string(name_) + ":" + std::to_string(line_) + ": " + message);
+  }
+
+  void statement(std::string_view text);
+  void instruction(const Encoding& encoding, std::string_view mnemonic,
+                   std::string_view operands);
+  void words(std::string_view operands);
+  void resolve(const Fixup& fixup);
+
+  std::size_t split(std::string_view operands, std::array<std::string_view, kMaxOperands>& parts);
+  std::uint32_t parse_register(std::string_view text);
+  std::int64_t parse_number(std::string_view text, std::int64_t min, std::int64_t max);
+  // offset(base), the offset may be left out.
+  std::pair<std::int64_t, std::uint32_t> parse_memory(std::string_view text, std::int64_t min,
+                                                      std::int64_t max);
+  void reference(std::string_view text, Reference kind);
+  std::uint32_t encode_target(std::uint32_t address, std::uint32_t program_counter,
+                              Reference kind, std::string_view text);
+
+  std::uint32_t address() const { return static_cast<std::uint32_t>(words_.size() * kWordSize); }
+
+  std::string_view source_;
+  std::string_view name_;
+  std::size_t line_ = 0;
+  std::vector<std::uint32_t> words_;
+  // Indices into symbols_, which holds the labels in the order they are
+  // defined.
+  std::unordered_map<std::string_view, std::size_t> labels_;
+  std::vector<Symbol> symbols_;
+  std::vector<Fixup> fixups_;
+};
+
+AssembledProgram Assembly::run() {
+  // Every label ends with a colon and nothing else uses one.
+  labels_.reserve(static_cast<std::size_t>(std::count(source_.begin(), source_.end(), ':')));
+  for (std::size_t start = 0; start <= source_.size();) {
+    std::size_t end = std::min(source_.find('\n', start), source_.size());
+    ++line_;
+    std::string_view text = source_.substr(start, end - start);
+    statement(text.substr(0, text.find_first_of("#;")));
+    start = end + 1;
+  }
+  for (const Fixup& fixup : fixups_) {
+    resolve(fixup);
+  }
+
+  AssembledProgram program;
+  program.image.resize(words_.size() * kWordSize);
+  for (std::size_t i = 0; i < words_.size(); ++i) {
+    for (std::uint32_t byte = 0; byte < kWordSize; ++byte) {
+      program.image[i * kWordSize + byte] = static_cast<std::uint8_t>(words_[i] >> (8 * byte));
+    }
+  }
+  // Labels are defined at increasing addresses.
+  program.symbols = std::move(symbols_);
+  return program;
+}
+
+void Assembly::statement(std::string_view text) {
+  text = trim(text);
+  for (std::size_t colon = text.find(':'); colon != std::string_view::npos;
+       colon = text.find(':')) {
+    std::string_view label = trim(text.substr(0, colon));
+    if (!is_identifier(label)) {
+      fail("Invalid label: " + std::string(label));
+    }
+    if (!labels_.emplace(label, symbols_.size()).second) {
+      fail("Duplicate label: " + std::string(label));
+    }
+    symbols_.push_back({std::string(label), address()});
+    text = trim(text.substr(colon + 1));
+  }
+  if (text.empty()) {
+    return;
+  }
+
+  std::size_t space = std::min(text.find_first_of(" \t"), text.size());
+  std::string_view mnemonic = text.substr(0, space);
+  std::string_view operands = trim(text.substr(space));
+  if (equals_ignoring_case(mnemonic, ".word")) {
+    words(operands);
+    return;
+  }
+  for (const Encoding& encoding : kEncodings) {
+    if (equals_ignoring_case(mnemonic, opcodes::mnemonic(encoding.opcode))) {
+      instruction(encoding, opcodes::mnemonic(encoding.opcode), operands);
+      return;
+    }
+  }
+  fail("Unknown mnemonic: " + std::string(mnemonic));
+}
+
+void Assembly::instruction(const Encoding& encoding, std::string_view mnemonic,
+                           std::string_view operands) {
+  using namespace shifts;
+
+  std::array<std::string_view, kMaxOperands> parts;
+  std::size_t count = split(operands, parts);
+  std::size_t expected = 0;
+  switch (encoding.format) {
+    case Format::kRegisters:
+    case Format::kBdep:
+    case Format::kImmediate5:
+    case Format::kPair:
+    case Format::kBranch:
+      expected = 3;
+      break;
+    case Format::kClz:
+    case Format::kMemory:
+      expected = 2;
+      break;
+    case Format::kJump:
+      expected = 1;
+      break;
+    case Format::kSyscall:
+      expected = count == 0 ? 0 : 1;
+      break;
+  }
+  if (count != expected) {
+    fail(std::string(mnemonic) + " takes " + std::to_string(expected) + " operands");
+  }
+
+  std::uint32_t primary = static_cast<std::uint32_t>(encoding.opcode) << kOpcodeShift;
+  std::uint32_t word = 0;
+  switch (encoding.format) {
+    case Format::kRegisters:
+      word = (parse_register(parts[1]) << k21BitShift) | (parse_register(parts[2]) << k16BitShift)
+             | (parse_register(parts[0]) << k11BitShift) | encoding.opcode;
+      break;
+    case Format::kBdep:
+      word = (parse_register(parts[0]) << k21BitShift) | (parse_register(parts[1]) << k16BitShift)
+             | (parse_register(parts[2]) << k11BitShift) | encoding.opcode;
+      break;
+    case Format::kClz:
+      word = (parse_register(parts[0]) << k21BitShift) | (parse_register(parts[1]) << k16BitShift)
+             | encoding.opcode;
+      break;
+    case Format::kSyscall: {
+      std::int64_t code = count == 0 ? 0 : parse_number(parts[0], 0, k20BitMask);
+      word = (static_cast<std::uint32_t>(code) << k6BitShift) | encoding.opcode;
+      break;
+    }
+    case Format::kImmediate5: {
+      std::int64_t immediate = parse_number(parts[2], 0, kMaxImmediate5);
+      word = primary | (parse_register(parts[0]) << k21BitShift)
+             | (parse_register(parts[1]) << k16BitShift)
+             | (static_cast<std::uint32_t>(immediate) << k11BitShift);
+      break;
+    }
+    case Format::kMemory: {
+      auto [offset, base] = parse_memory(parts[1], INT16_MIN, INT16_MAX);
+      word = primary | (base << k21BitShift) | (parse_register(parts[0]) << k16BitShift)
+             | (static_cast<std::uint32_t>(offset) & k16BitMask);
+      break;
+    }
+    case Format::kPair: {
+      auto [offset, base] = parse_memory(parts[2], 0, kMaxPairOffset);
+      word = primary | (base << k21BitShift) | (parse_register(parts[0]) << k16BitShift)
+             | (parse_register(parts[1]) << k11BitShift) | static_cast<std::uint32_t>(offset);
+      break;
+    }
+    case Format::kBranch:
+      word = primary | (parse_register(parts[0]) << k21BitShift)
+             | (parse_register(parts[1]) << k16BitShift);
+      words_.push_back(word);
+      reference(parts[2], Reference::kBranch);
+      return;
+    case Format::kJump:
+      words_.push_back(primary);
+      reference(parts[0], Reference::kJump);
+      return;
+  }
+  words_.push_back(word);
+}
+
+void Assembly::words(std::string_view operands) {
+  if (operands.empty()) {
+    fail(".word takes at least one value");
+  }
+  for (std::size_t start = 0; start <= operands.size();) {
+    std::size_t comma = std::min(operands.find(',', start), operands.size());
+    std::string_view value = trim(operands.substr(start, comma - start));
+    words_.push_back(0);
+    reference(value, Reference::kWord);
+    start = comma + 1;
+  }
+}
+
+// Numbers are encoded right away, labels once they are all known.
+void Assembly::reference(std::string_view text, Reference kind) {
+  std::size_t word = words_.size() - 1;
+  if (is_number(text)) {
+    std::int64_t value = kind == Reference::kWord ? parse_number(text, INT32_MIN, UINT32_MAX)
+                                                  : parse_number(text, 0, UINT32_MAX);
+    words_[word] |= encode_target(static_cast<std::uint32_t>(value),
+                                  static_cast<std::uint32_t>(word * kWordSize), kind, text);
+  } else if (is_identifier(text)) {
+    fixups_.push_back({word, line_, kind, text});
+  } else {
+    fail("Invalid target: " + std::string(text));
+  }
+}
+
+void Assembly::resolve(const Fixup& fixup) {
+  line_ = fixup.line;
+  auto label = labels_.find(fixup.label);
+  if (label == labels_.end()) {
+    fail("Undefined label: " + std::string(fixup.label));
+  }
+  words_[fixup.word] |= encode_target(symbols_[label->second].address,
+                                      static_cast<std::uint32_t>(fixup.word * kWordSize),
+                                      fixup.reference, fixup.label);
+}
+
+std::uint32_t Assembly::encode_target(std::uint32_t address, std::uint32_t program_counter,
+                                      Reference kind, std::string_view text) {
+  using namespace shifts;
+
+  if (kind == Reference::kWord) {
+    return address;
+  }
+  if (address % kWordSize != 0) {
+    fail("Unaligned target: " + std::string(text));
+  }
+  if (kind == Reference::kBranch) {
+    std::int64_t offset = (static_cast<std::int64_t>(address) - program_counter) / kWordSize;
+    if (offset < INT16_MIN || offset > INT16_MAX) {
+      fail("Branch target out of range: " + std::string(text));
+    }
+    return static_cast<std::uint32_t>(offset) & k16BitMask;
+  }
+  if ((address & kFirst4BitsMask) != (program_counter & kFirst4BitsMask)) {
+    fail("Jump target out of range: " + std::string(text));
+  }
+  return (address >> 2) & k26BitMask;
+}
+
+std::size_t Assembly::split(std::string_view operands,
+                            std::array<std::string_view, kMaxOperands>& parts) {
+  if (operands.empty()) {
+    return 0;
+  }
+  std::size_t count = 0;
+  for (std::size_t start = 0; start <= operands.size(); ++count) {
+    std::size_t comma = std::min(operands.find(',', start), operands.size());
+    if (count == kMaxOperands) {
+      fail("Too many operands");
+    }
+    parts[count] = trim(operands.substr(start, comma - start));
+    if (parts[count].empty()) {
+      fail("Missing operand");
+    }
+    start = comma + 1;
+  }
+  return count;
+}
+
+std::uint32_t Assembly::parse_register(std::string_view text) {
+  if (text.size() >= 2 && (text.front() == 'r' || text.front() == 'R')) {
+    std::uint32_t index = 0;
+    auto [end, error] = std::from_chars(text.data() + 1, text.data() + text.size(), index);
+    if (error == std::errc() && end == text.data() + text.size()
+        && index < kNumberOfRegisters) {
+      return index;
+    }
+  }
+  fail("Invalid register: " + std::string(text));
+}
+
+std::int64_t Assembly::parse_number(std::string_view text, std::int64_t min, std::int64_t max) {
+  bool negative = !text.empty() && text.front() == '-';
+  std::string_view digits = negative ? text.substr(1) : text;
+  int base = 10;
+  if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+    digits.remove_prefix(2);
+    base = 16;
+  }
+  std::int64_t value = 0;
+  auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), value, base);
+  if (digits.empty() || error != std::errc() || end != digits.data() + digits.size()) {
+    fail("Invalid number: " + std::string(text));
+  }
+  value = negative ? -value : value;
+  if (value < min || value > max) {
+    fail("Value out of range: " + std::string(text));
+  }
+  return value;
+}
+
+std::pair<std::int64_t, std::uint32_t> Assembly::parse_memory(std::string_view text,
+                                                              std::int64_t min,
+                                                              std::int64_t max) {
+  std::size_t open = text.find('(');
+  if (open == std::string_view::npos || text.back() != ')') {
+    fail("Expected offset(base): " + std::string(text));
+  }
+  std::string_view offset = trim(text.substr(0, open));
+  std::uint32_t base = parse_register(trim(text.substr(open + 1, text.size() - open - 2)));
+  return {offset.empty() ? 0 : parse_number(offset, min, max), base};
+}
+
+} // namespace
+
+std::optional<std::uint32_t> AssembledProgram::find_symbol(std::string_view name) const {
+  for (const Symbol& symbol : symbols) {
+    if (symbol.name == name) {
+      return symbol.address;
+    }
+  }
+  return std::nullopt;
+}
+
+AssembledProgram assemble(std::string_view source, std::string_view name) {
+  return Assembly(source, name).run();
+}
+
+bool is_assembly_file(std::string_view path) {
+  return path.ends_with(".s");
+}
+
+AssembledProgram assemble_file(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Cannot open file: " + path);
+  }
+  std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  return assemble(source, path);
+}
+
+std::string symbolize(const std::vector<Symbol>& symbols, std::uint32_t address) {
+  auto next = std::upper_bound(symbols.begin(), symbols.end(), address,
+                               [](std::uint32_t value, const Symbol& symbol) {
+                                 return value < symbol.address;
+                               });
+  if (next == symbols.begin()) {
+    return hex(address);
+  }
+  const Symbol& symbol = *std::prev(next);
+  if (symbol.address == address) {
+    return symbol.name;
+  }
+  std::ostringstream text;
+  text << symbol.name << "+0x" << std::hex << address - symbol.address;
+  return text.str();
+}
+
+} // namespace simulator
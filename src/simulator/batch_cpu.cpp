@@ -0,0 +1,314 @@
+#include "batch_cpu.hpp"
+
+#include <exception>
+
+#include "bit_shifts.hpp"
+#include "cpu.hpp"
+#include "instruction_parser.hpp"
+#include "lane_kernels.hpp"
+#include "opcodes.hpp"
+#include "syscalls.hpp"
+
+namespace simulator {
+
+BatchCpu::BatchCpu(std::size_t lanes, std::size_t memory_size)
+  : lanes_(lanes),
+    registers_(kNumberOfRegirsters * lanes, 0),
+    program_counters_(lanes, 0),
+    instruction_counts_(lanes, 0),
+    running_(lanes, 0),
+    active_(lanes, 0),
+    statuses_(lanes, LaneStatus::kRunning),
+    faults_(lanes),
+    code_modified_(lanes, 0) {
+  for (std::size_t lane = 0; lane < lanes_; ++lane) {
+    memories_.push_back(std::make_unique<Memory>(memory_size));
+    watchers_.push_back(std::make_unique<LaneCodeWatcher>(*this, lane));
+    memories_.back()->set_code_write_listener(watchers_.back().get());
+  }
+}
+
+BatchCpu::~BatchCpu() {
+  for (auto& memory : memories_) {
+    memory->set_code_write_listener(nullptr);
+  }
+}
+
+void BatchCpu::LaneCodeWatcher::on_code_write(std::uint32_t /*address*/,
+                                              std::size_t /*size*/) {
+  if (batch_.code_modified_[lane_] == 0) {
+    batch_.code_modified_[lane_] = 1;
+    ++batch_.code_modified_lanes_;
+  }
+}
+
+void BatchCpu::load_program(const std::vector<std::uint8_t>& program) {
+  std::size_t image_size = std::max<std::size_t>(
+      (program.size() + kInstrucionSize - 1) & ~std::size_t{kInstrucionSize - 1},
+      kInstrucionSize);
+  decode_cache_.reset();
+  program_image_ = std::make_unique<Memory>(image_size);
+  program_image_->write_block(0, program.data(), program.size());
+  decode_cache_ = std::make_unique<DecodeCache>(*program_image_);
+
+  for (auto& memory : memories_) {
+    memory->write_block(0, program.data(), program.size());
+    for (std::size_t address = 0; address < image_size; address += Memory::kPageSize) {
+      memory->mark_code_page(address);
+    }
+  }
+  std::fill(code_modified_.begin(), code_modified_.end(), 0);
+  code_modified_lanes_ = 0;
+}
+
+std::uint32_t BatchCpu::get_pc(std::size_t lane) const {
+  return program_counters_[lane];
+}
+
+void BatchCpu::set_pc(std::size_t lane, std::uint32_t program_counter) {
+  program_counters_[lane] = program_counter;
+}
+
+std::uint32_t BatchCpu::get_register(std::size_t lane, std::uint8_t index) const {
+  return registers_[index * lanes_ + lane];
+}
+
+void BatchCpu::set_register(std::size_t lane, std::uint8_t index, std::uint32_t data) {
+  registers_[index * lanes_ + lane] = data;
+}
+
+std::uint64_t BatchCpu::get_instruction_count(std::size_t lane) const {
+  return instruction_counts_[lane];
+}
+
+LaneStatus BatchCpu::get_status(std::size_t lane) const {
+  return statuses_[lane];
+}
+
+const std::string& BatchCpu::get_fault(std::size_t lane) const {
+  return faults_[lane];
+}
+
+Memory& BatchCpu::get_memory(std::size_t lane) {
+  return *memories_[lane];
+}
+
+void BatchCpu::run_program() {
+  for (std::size_t lane = 0; lane < lanes_; ++lane) {
+    running_[lane] = statuses_[lane] == LaneStatus::kRunning ? kLaneEnabled : 0;
+  }
+
+  while (true) {
+    std::uint32_t program_counter =
+        lanes::masked_min(program_counters_.data(), running_.data(), lanes_);
+    std::size_t selected =
+        lanes::select_equal(active_.data(), program_counters_.data(),
+                            program_counter, running_.data(), lanes_);
+    if (selected == 0) {
+      return;
+    }
+    step_group(program_counter);
+  }
+}
+
+void BatchCpu::step_group(std::uint32_t program_counter) {
+  bool in_image = program_image_ != nullptr
+      && program_counter % kInstrucionSize == 0
+      && program_counter + std::size_t{kInstrucionSize} <= program_image_->size();
+  if (!in_image) {
+    for (std::size_t lane = 0; lane < lanes_; ++lane) {
+      if (active_[lane] != 0) {
+        step_lane_alone(lane, program_counter);
+      }
+    }
+    return;
+  }
+
+  const DecodedInstruction* instruction = nullptr;
+  try {
+    instruction = &decode_cache_->fetch(program_counter);
+  } catch (const std::exception& error) {
+    for (std::size_t lane = 0; lane < lanes_; ++lane) {
+      if (active_[lane] != 0 && code_modified_[lane] == 0) {
+        fault(lane, error.what());
+      }
+    }
+  }
+
+  std::vector<std::size_t> detached;
+  if (code_modified_lanes_ != 0) {
+    for (std::size_t lane = 0; lane < lanes_; ++lane) {
+      if (active_[lane] != 0 && code_modified_[lane] != 0
+          && (instruction == nullptr
+              || memories_[lane]->read_word(program_counter) != instruction->raw)) {
+        active_[lane] = 0;
+        detached.push_back(lane);
+      }
+    }
+  }
+
+  if (instruction != nullptr) {
+    execute(*instruction, program_counter, 0, lanes_);
+  }
+  for (std::size_t lane : detached) {
+    step_lane_alone(lane, program_counter);
+  }
+}
+
+void BatchCpu::step_lane_alone(std::size_t lane, std::uint32_t program_counter) {
+  DecodedInstruction instruction;
+  try {
+    instruction = InstructionParser::decode(memories_[lane]->read_word(program_counter));
+  } catch (const std::exception& error) {
+    fault(lane, error.what());
+    return;
+  }
+
+  active_[lane] = kLaneEnabled;
+  execute(instruction, program_counter, lane, lane + 1);
+}
+
+void BatchCpu::execute(const DecodedInstruction& instruction,
+                       std::uint32_t program_counter, std::size_t begin,
+                       std::size_t end) {
+  std::size_t count = end - begin;
+  const std::uint32_t* mask = active_.data() + begin;
+  auto reg = [this, begin](std::uint8_t index) {
+    return lane_registers(index) + begin;
+  };
+  std::uint32_t* program_counters = program_counters_.data() + begin;
+  std::uint32_t next_program_counter = program_counter + kInstrucionSize;
+  bool writes_rd = instruction.rd != 0;
+
+  switch (instruction.opcode) {
+    case opcodes::kADD:
+      if (writes_rd) {
+        lanes::add(reg(instruction.rd), reg(instruction.rs), reg(instruction.rt), mask, count);
+      }
+      break;
+    case opcodes::kXOR:
+      if (writes_rd) {
+        lanes::bitwise_xor(reg(instruction.rd), reg(instruction.rs), reg(instruction.rt), mask, count);
+      }
+      break;
+    case opcodes::kNOR:
+      if (writes_rd) {
+        lanes::bitwise_nor(reg(instruction.rd), reg(instruction.rs), reg(instruction.rt), mask, count);
+      }
+      break;
+    case opcodes::kCBIT:
+      if (writes_rd) {
+        lanes::bitwise_and(reg(instruction.rd), reg(instruction.rs),
+                           ~(1U << instruction.imm), mask, count);
+      }
+      break;
+    case opcodes::kCLZ:
+      if (writes_rd) {
+        lanes::count_leading_zeros(reg(instruction.rd), reg(instruction.rs), mask, count);
+      }
+      break;
+    case opcodes::kSSAT:
+    case opcodes::kBDEP:
+      execute_scalar(instruction, begin, end);
+      break;
+    case opcodes::kLD:
+    case opcodes::kST:
+    case opcodes::kLDP:
+      execute_memory(instruction, begin, end);
+      break;
+    case opcodes::kSYSCALL:
+      execute_syscall(begin, end);
+      break;
+    case opcodes::kBEQ:
+    case opcodes::kBNE:
+      lanes::branch(program_counters, reg(instruction.rs), reg(instruction.rt),
+                    instruction.opcode == opcodes::kBEQ,
+                    program_counter + instruction.imm, next_program_counter,
+                    mask, count);
+      lanes::increment(instruction_counts_.data() + begin, mask, count);
+      return;
+    case opcodes::kJj:
+      next_program_counter = (program_counter & shifts::kFirst4BitsMask) | instruction.imm;
+      break;
+    default:
+      break;
+  }
+
+  lanes::assign(program_counters, next_program_counter, mask, count);
+  lanes::increment(instruction_counts_.data() + begin, mask, count);
+}
+
+void BatchCpu::execute_scalar(const DecodedInstruction& instruction,
+                              std::size_t begin, std::size_t end) {
+  if (instruction.rd == 0) {
+    return;
+  }
+  std::uint32_t* rd = lane_registers(instruction.rd);
+  const std::uint32_t* rs = lane_registers(instruction.rs);
+  const std::uint32_t* rt = lane_registers(instruction.rt);
+
+  for (std::size_t lane = begin; lane < end; ++lane) {
+    if (active_[lane] == 0) {
+      continue;
+    }
+    rd[lane] = instruction.opcode == opcodes::kSSAT
+                   ? Cpu::saturate_signed(rs[lane], instruction.imm)
+                   : Cpu::bit_deposit(rs[lane], rt[lane]);
+  }
+}
+
+void BatchCpu::execute_memory(const DecodedInstruction& instruction,
+                              std::size_t begin, std::size_t end) {
+  std::uint32_t* rd = lane_registers(instruction.rd);
+  std::uint32_t* rt = lane_registers(instruction.rt);
+  const std::uint32_t* base = lane_registers(instruction.rs);
+
+  for (std::size_t lane = begin; lane < end; ++lane) {
+    if (active_[lane] == 0) {
+      continue;
+    }
+    Memory& memory = *memories_[lane];
+    std::uint32_t address = base[lane] + instruction.imm;
+    try {
+      if (instruction.opcode == opcodes::kLD) {
+        std::uint32_t value = memory.read_word(address);
+        if (instruction.rd != 0) {
+          rd[lane] = value;
+        }
+      } else if (instruction.opcode == opcodes::kST) {
+        memory.write_word(address, rt[lane]);
+      } else {
+        rd[lane] = memory.read_word(address);
+        rt[lane] = memory.read_word(address + kInstrucionSize);
+      }
+    } catch (const std::exception& error) {
+      fault(lane, error.what());
+    }
+  }
+}
+
+void BatchCpu::execute_syscall(std::size_t begin, std::size_t end) {
+  const std::uint32_t* numbers = lane_registers(syscalls::kNumberRegister);
+  for (std::size_t lane = begin; lane < end; ++lane) {
+    if (active_[lane] == 0) {
+      continue;
+    }
+    if (numbers[lane] == syscalls::EXIT) {
+      statuses_[lane] = LaneStatus::kExited;
+      running_[lane] = 0;
+    } else if (numbers[lane] < syscalls::kNumberOfSyscalls) {
+      // Lanes have no console or clock of their own.
+      fault(lane, "Syscall " + std::to_string(numbers[lane])
+                  + " is not supported by batch lanes");
+    }
+  }
+}
+
+void BatchCpu::fault(std::size_t lane, const std::string& message) {
+  statuses_[lane] = LaneStatus::kFaulted;
+  faults_[lane] = message;
+  running_[lane] = 0;
+  active_[lane] = 0;
+}
+
+} // namespace simulator
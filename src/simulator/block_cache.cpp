@@ -0,0 +1,116 @@
+#include "block_cache.hpp"
+
+#include <exception>
+#include <vector>
+
+#include "instruction_semantics.hpp"
+#include "opcodes.hpp"
+
+namespace simulator {
+
+BlockCache::BlockCache(DecodeCache& decode_cache)
+  : decode_cache_(decode_cache) {}
+
+BasicBlock& BlockCache::lookup(std::uint32_t address) {
+  if (flush_pending_) {
+    blocks_.clear();
+    flush_pending_ = false;
+    ++flush_count_;
+  }
+
+  auto it = blocks_.find(address);
+  if (it != blocks_.end()) {
+    return *it->second;
+  }
+
+  auto [inserted, success] = blocks_.emplace(address, translate(address));
+  return *inserted->second;
+}
+
+void BlockCache::set_breakpoint(std::uint32_t address, bool enabled) {
+  bool changed = enabled ? breakpoints_.insert(address).second
+                         : breakpoints_.erase(address) != 0;
+  if (changed) {
+    request_flush();
+  }
+}
+
+// A pending flush is checked before the links: they may point at blocks
+// translated from code the last block overwrote.
+BasicBlock& BlockCache::successor(BasicBlock& block, std::int32_t address) {
+  if (flush_pending_) {
+    return lookup(address);
+  }
+
+  for (std::size_t i = 0; i < BasicBlock::kNumberOfSuccessors; ++i) {
+    if (block.successors[i] != nullptr
+        && block.successor_addresses[i] == address) {
+      return *block.successors[i];
+    }
+  }
+
+  BasicBlock& next = lookup(address);
+  std::size_t slot = (static_cast<std::uint32_t>(address) == block.end_address) ? 0 : 1;
+  block.successor_addresses[slot] = address;
+  block.successors[slot] = &next;
+  return next;
+}
+
+std::unique_ptr<BasicBlock> BlockCache::translate(std::uint32_t address) {
+  // The first instruction is fetched unguarded so a bad PC faults exactly
+  // like the staged pipeline. Later fetch or decode failures only end the
+  // block; the fault is raised if execution actually reaches them.
+  std::vector<DecodedInstruction> instructions = {decode_cache_.fetch(address)};
+  std::uint32_t current = address + kInstructionSize;
+  while (instructions.size() < kMaxBlockInstructions
+         && !InstructionSemantics::is_block_terminator(instructions.back().opcode)
+         && !breakpoints_.contains(current)) {
+    try {
+      instructions.push_back(decode_cache_.fetch(current));
+    } catch (const std::exception&) {
+      break;
+    }
+    current += kInstructionSize;
+  }
+
+  auto block = std::make_unique<BasicBlock>();
+  block->start_address = address;
+  block->end_address = current;
+  block->instruction_count = instructions.size();
+  block->breakpoint = breakpoints_.contains(address);
+
+  std::int32_t program_counter = static_cast<std::int32_t>(address);
+  for (std::size_t i = 0; i < instructions.size(); ++i) {
+    MicroOp op = {instructions[i].opcode, program_counter, instructions[i], {}};
+    if (i + 1 < instructions.size() && try_fuse(op, instructions[i + 1])) {
+      ++i;
+      program_counter += kInstructionSize;
+    }
+    block->ops.push_back(op);
+    program_counter += kInstructionSize;
+  }
+
+  return block;
+}
+
+bool BlockCache::try_fuse(MicroOp& op, const DecodedInstruction& next) {
+  std::uint8_t first = op.first.opcode;
+  std::uint8_t second = next.opcode;
+
+  if (first == opcodes::kADD && second == opcodes::kADD) {
+    op.kind = micro_ops::kAddAdd;
+  } else if (first == opcodes::kADD && second == opcodes::kBNE) {
+    op.kind = micro_ops::kAddBne;
+  } else if (first == opcodes::kLD && second == opcodes::kADD) {
+    op.kind = micro_ops::kLdAdd;
+  } else if (first == opcodes::kLDP && second == opcodes::kLDP) {
+    op.kind = micro_ops::kLdpLdp;
+  } else {
+    return false;
+  }
+
+  op.second = next;
+  return true;
+}
+
+} // namespace simulator
@@ -0,0 +1,324 @@
+#include "block_engine.hpp"
+
+#include <algorithm>
+
+#include "cpu.hpp"
+#include "instruction_semantics.hpp"
+#include "opcodes.hpp"
+#include "threaded_engine.hpp"
+
+namespace simulator {
+
+void BlockEngine::run(Cpu& cpu) {
+  switch (cpu.run_memory_access()) {
+    case MemoryAccess::kChecked:
+      run_with<MemoryAccess::kChecked>(cpu);
+      break;
+    case MemoryAccess::kTrapping:
+      run_with<MemoryAccess::kTrapping>(cpu);
+      break;
+    case MemoryAccess::kUnchecked:
+      run_with<MemoryAccess::kUnchecked>(cpu);
+      break;
+    case MemoryAccess::kWatched:
+      run_with<MemoryAccess::kWatched>(cpu);
+      break;
+  }
+  if (cpu.cache_ || cpu.branch_predictor_) {
+    cpu.run_staged();
+  } else {
+    ThreadedEngine::run(cpu);
+  }
+}
+
+// Native code neither reports watched accesses nor feeds the models.
+template <MemoryAccess kAccess>
+void BlockEngine::run_with(Cpu& cpu) {
+  if (cpu.cache_ || cpu.branch_predictor_) {
+    select_breakpoints<false, kAccess, true>(cpu);
+    return;
+  }
+  if constexpr (kAccess != MemoryAccess::kWatched) {
+    if (cpu.jit_ != nullptr) {
+      select_breakpoints<true, kAccess, false>(cpu);
+      return;
+    }
+  }
+  select_breakpoints<false, kAccess, false>(cpu);
+}
+
+template <bool kJit, MemoryAccess kAccess, bool kModels>
+void BlockEngine::select_breakpoints(Cpu& cpu) {
+  if (cpu.breakpoints_.empty()) {
+    run_blocks<kJit, kAccess, false, kModels>(cpu);
+  } else {
+    run_blocks<kJit, kAccess, true, kModels>(cpu);
+  }
+}
+
+template <bool kJit, MemoryAccess kAccess, bool kBreakpoints, bool kModels>
+void BlockEngine::run_blocks(Cpu& cpu) {
+  BlockCache& block_cache = cpu.block_cache_;
+  BasicBlock* block = &block_cache.lookup(cpu.program_counter_);
+
+  while (true) {
+    if (cpu.instruction_limit_ - cpu.instruction_count_
+        < block->instruction_count) {
+      return;
+    }
+    if constexpr (kBreakpoints) {
+      if (block->breakpoint && cpu.stop_at_breakpoint()) {
+        return;
+      }
+    }
+
+    std::int32_t next_program_counter = 0;
+    if constexpr (kJit) {
+      bool native = (!kBreakpoints || !block->breakpoint) && cpu.jit_->prepare(*block);
+      next_program_counter = native ? execute_native(cpu, *block)
+                                    : execute_block<kAccess, kModels>(cpu, *block);
+    } else {
+      next_program_counter = execute_block<kAccess, kModels>(cpu, *block);
+    }
+    cpu.program_counter_ = next_program_counter;
+    if (!cpu.should_run_) {
+      return;
+    }
+    block = &block_cache.successor(*block, next_program_counter);
+  }
+}
+
+std::int32_t BlockEngine::execute_native(Cpu& cpu, const BasicBlock& block) {
+  JitContext& context = cpu.jit_->context();
+  std::uint64_t iterations =
+      (cpu.instruction_limit_ - cpu.instruction_count_) / block.instruction_count;
+  context.loop_budget = static_cast<std::uint32_t>(
+      std::min<std::uint64_t>(JitCompiler::kLoopBudget, iterations));
+  context.retired = 0;
+
+  std::uint64_t result = block.native_code(&context);
+  cpu.instruction_count_ += context.retired + (result >> 32);
+  return static_cast<std::int32_t>(static_cast<std::uint32_t>(result));
+}
+
+// Retires the instructions of the block that precede program_counter, for
+// blocks left early by a fault, a store into translated code or a
+// watchpoint.
+void BlockEngine::retire_until(Cpu& cpu, const BasicBlock& block,
+                               std::int32_t program_counter) {
+  cpu.instruction_count_ +=
+      (program_counter - block.start_address) / Cpu::kInstrucionSize;
+}
+
+template <MemoryAccess kAccess, bool kModels>
+std::int32_t BlockEngine::execute_block(Cpu& cpu, const BasicBlock& block) {
+  using Semantics = InstructionSemantics;
+
+  // A load or store that hit a watchpoint ends the block after its
+  // instruction.
+  auto hit_watchpoint = [&cpu] {
+    return kAccess == MemoryAccess::kWatched && !cpu.should_run_;
+  };
+
+  // The cache model sees every fetch before its instruction executes and
+  // the data accesses of an instruction once they succeeded, the branch
+  // predictor every branch, like on the staged pipeline.
+  auto fetch = [&cpu](std::int32_t pc) {
+    if constexpr (kModels) {
+      if (cpu.cache_) {
+        cpu.cache_->fetch(static_cast<std::uint32_t>(pc));
+      }
+    }
+  };
+  auto address = [&cpu](const DecodedInstruction& instruction) -> std::uint32_t {
+    if constexpr (kModels) {
+      return cpu.registers_[instruction.rs] + static_cast<std::uint32_t>(instruction.imm);
+    }
+    return 0;
+  };
+  auto load = [&cpu](std::int32_t pc, std::uint32_t data_address) {
+    if constexpr (kModels) {
+      if (cpu.cache_) {
+        cpu.cache_->load(static_cast<std::uint32_t>(pc), data_address);
+      }
+    }
+  };
+  auto store = [&cpu](std::int32_t pc, std::uint32_t data_address) {
+    if constexpr (kModels) {
+      if (cpu.cache_) {
+        cpu.cache_->store(static_cast<std::uint32_t>(pc), data_address);
+      }
+    }
+  };
+  // Called before the branch executes, taken when its registers compare
+  // as equal says.
+  auto conditional = [&cpu](std::int32_t pc, const DecodedInstruction& instruction,
+                            bool equal) {
+    if constexpr (kModels) {
+      if (cpu.branch_predictor_) {
+        bool same = cpu.registers_[instruction.rs] == cpu.registers_[instruction.rt];
+        cpu.branch_predictor_->conditional(static_cast<std::uint32_t>(pc), same == equal);
+      }
+    }
+  };
+  auto jump = [&cpu](std::int32_t pc, std::int32_t target) {
+    if constexpr (kModels) {
+      if (cpu.branch_predictor_) {
+        cpu.branch_predictor_->jump(static_cast<std::uint32_t>(pc),
+                                    static_cast<std::uint32_t>(target));
+      }
+    }
+  };
+
+  std::int32_t next_program_counter = block.end_address;
+  // Set once a syscall has retired the instructions before it.
+  bool retired = false;
+
+  // Memory operations and syscalls publish their PC first so that a fault
+  // leaves the machine pointing at the faulting instruction.
+  try {
+    for (const MicroOp& op : block.ops) {
+      std::int32_t pc = op.program_counter;
+      fetch(pc);
+      switch (op.kind) {
+        case opcodes::kNOR:
+          Semantics::execute<opcodes::kNOR>(cpu, op.first, pc);
+          break;
+        case opcodes::kADD:
+          Semantics::execute<opcodes::kADD>(cpu, op.first, pc);
+          break;
+        case opcodes::kXOR:
+          Semantics::execute<opcodes::kXOR>(cpu, op.first, pc);
+          break;
+        case opcodes::kCBIT:
+          Semantics::execute<opcodes::kCBIT>(cpu, op.first, pc);
+          break;
+        case opcodes::kSSAT:
+          Semantics::execute<opcodes::kSSAT>(cpu, op.first, pc);
+          break;
+        case opcodes::kCLZ:
+          Semantics::execute<opcodes::kCLZ>(cpu, op.first, pc);
+          break;
+        case opcodes::kBDEP:
+          Semantics::execute<opcodes::kBDEP>(cpu, op.first, pc);
+          break;
+        case opcodes::kLD: {
+          std::uint32_t data_address = address(op.first);
+          cpu.program_counter_ = pc;
+          Semantics::execute<opcodes::kLD, kAccess>(cpu, op.first, pc);
+          load(pc, data_address);
+          if (hit_watchpoint()) {
+            retire_until(cpu, block, pc + Cpu::kInstrucionSize);
+            return pc + Cpu::kInstrucionSize;
+          }
+          break;
+        }
+        case opcodes::kST: {
+          std::uint32_t data_address = address(op.first);
+          cpu.program_counter_ = pc;
+          Semantics::execute<opcodes::kST, kAccess>(cpu, op.first, pc);
+          store(pc, data_address);
+          if (cpu.block_cache_.flush_pending() || hit_watchpoint()) {
+            retire_until(cpu, block, pc + Cpu::kInstrucionSize);
+            return pc + Cpu::kInstrucionSize;
+          }
+          break;
+        }
+        case opcodes::kLDP: {
+          std::uint32_t data_address = address(op.first);
+          cpu.program_counter_ = pc;
+          Semantics::execute<opcodes::kLDP, kAccess>(cpu, op.first, pc);
+          load(pc, data_address);
+          load(pc, data_address + Cpu::kInstrucionSize);
+          if (hit_watchpoint()) {
+            retire_until(cpu, block, pc + Cpu::kInstrucionSize);
+            return pc + Cpu::kInstrucionSize;
+          }
+          break;
+        }
+        case opcodes::kBEQ:
+          conditional(pc, op.first, true);
+          next_program_counter = Semantics::execute<opcodes::kBEQ>(cpu, op.first, pc);
+          break;
+        case opcodes::kBNE:
+          conditional(pc, op.first, false);
+          next_program_counter = Semantics::execute<opcodes::kBNE>(cpu, op.first, pc);
+          break;
+        case opcodes::kJj:
+          next_program_counter = Semantics::execute<opcodes::kJj>(cpu, op.first, pc);
+          jump(pc, next_program_counter);
+          break;
+        case opcodes::kSYSCALL:
+          // The syscall ends the block and may read the instruction count,
+          // so everything before it is retired first.
+          cpu.program_counter_ = pc;
+          retire_until(cpu, block, pc);
+          retired = true;
+          next_program_counter = Semantics::execute<opcodes::kSYSCALL>(cpu, op.first, pc);
+          ++cpu.instruction_count_;
+          return next_program_counter;
+
+        case micro_ops::kAddAdd:
+          Semantics::execute<opcodes::kADD>(cpu, op.first, pc);
+          fetch(pc + Cpu::kInstrucionSize);
+          Semantics::execute<opcodes::kADD>(cpu, op.second, pc + Cpu::kInstrucionSize);
+          break;
+        case micro_ops::kAddBne:
+          Semantics::execute<opcodes::kADD>(cpu, op.first, pc);
+          fetch(pc + Cpu::kInstrucionSize);
+          conditional(pc + Cpu::kInstrucionSize, op.second, false);
+          next_program_counter = Semantics::execute<opcodes::kBNE>(
+              cpu, op.second, pc + Cpu::kInstrucionSize);
+          break;
+        case micro_ops::kLdAdd: {
+          std::uint32_t data_address = address(op.first);
+          cpu.program_counter_ = pc;
+          Semantics::execute<opcodes::kLD, kAccess>(cpu, op.first, pc);
+          load(pc, data_address);
+          if (hit_watchpoint()) {
+            retire_until(cpu, block, pc + Cpu::kInstrucionSize);
+            return pc + Cpu::kInstrucionSize;
+          }
+          fetch(pc + Cpu::kInstrucionSize);
+          Semantics::execute<opcodes::kADD>(cpu, op.second, pc + Cpu::kInstrucionSize);
+          break;
+        }
+        case micro_ops::kLdpLdp: {
+          std::uint32_t data_address = address(op.first);
+          cpu.program_counter_ = pc;
+          Semantics::execute<opcodes::kLDP, kAccess>(cpu, op.first, pc);
+          load(pc, data_address);
+          load(pc, data_address + Cpu::kInstrucionSize);
+          if (hit_watchpoint()) {
+            retire_until(cpu, block, pc + Cpu::kInstrucionSize);
+            return pc + Cpu::kInstrucionSize;
+          }
+          fetch(pc + Cpu::kInstrucionSize);
+          data_address = address(op.second);
+          cpu.program_counter_ = pc + Cpu::kInstrucionSize;
+          Semantics::execute<opcodes::kLDP, kAccess>(cpu, op.second, pc + Cpu::kInstrucionSize);
+          load(pc + Cpu::kInstrucionSize, data_address);
+          load(pc + Cpu::kInstrucionSize, data_address + Cpu::kInstrucionSize);
+          if (hit_watchpoint()) {
+            retire_until(cpu, block, pc + 2 * Cpu::kInstrucionSize);
+            return pc + 2 * Cpu::kInstrucionSize;
+          }
+          break;
+        }
+
+        default:
+          break;
+      }
+    }
+  } catch (...) {
+    if (!retired) {
+      retire_until(cpu, block, cpu.program_counter_);
+    }
+    throw;
+  }
+
+  cpu.instruction_count_ += block.instruction_count;
+  return next_program_counter;
+}
+
+} // namespace simulator
@@ -0,0 +1,242 @@
+#include "branch_predictor.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace simulator {
+
+namespace {
+
+constexpr std::uint32_t kMaxTableBits = 24;
+constexpr std::uint32_t kHistoryRegisterBits = 64;
+
+std::string hex(std::uint32_t value) {
+  std::ostringstream text;
+  text << "0x" << std::hex << std::setw(8) << std::setfill('0') << value;
+  return text.str();
+}
+
+std::string percent(std::uint64_t part, std::uint64_t total) {
+  std::ostringstream text;
+  text << std::fixed << std::setprecision(2)
+       << (total == 0 ? 0.0 : 100.0 * static_cast<double>(part)
+                                  / static_cast<double>(total))
+       << "%";
+  return text.str();
+}
+
+std::string describe(const PredictorConfig& config) {
+  std::ostringstream text;
+  switch (config.kind) {
+    case PredictorKind::kNotTaken:
+      text << "not-taken";
+      break;
+    case PredictorKind::kBimodal:
+      text << "bimodal, " << (1u << config.table_bits) << " counters";
+      break;
+    case PredictorKind::kGshare:
+      text << "gshare, " << (1u << config.table_bits) << " counters, "
+           << config.history_bits << " history bits";
+      break;
+    case PredictorKind::kTage:
+      text << "tage, " << (1u << config.table_bits) << " entries per table";
+      break;
+  }
+  text << ", " << config.btb_entries << " BTB entries";
+  return text.str();
+}
+
+const PredictorConfig& validate(const PredictorConfig& config) {
+  if (config.table_bits == 0 || config.table_bits > kMaxTableBits) {
+    throw std::runtime_error("Predictor table bits must be between 1 and "
+                             + std::to_string(kMaxTableBits));
+  }
+  if (config.history_bits > kHistoryRegisterBits) {
+    throw std::runtime_error("Predictor history must be at most "
+                             + std::to_string(kHistoryRegisterBits) + " bits");
+  }
+  if (!std::has_single_bit(config.btb_entries)) {
+    throw std::runtime_error("BTB entries must be a power of two");
+  }
+  return config;
+}
+
+} // namespace
+
+BranchPredictor::BranchPredictor(const PredictorConfig& config)
+  : config_(validate(config)),
+    table_mask_((std::size_t{1} << config.table_bits) - 1),
+    history_mask_(config.history_bits < kHistoryRegisterBits
+                      ? (std::uint64_t{1} << config.history_bits) - 1
+                      : ~std::uint64_t{0}),
+    counters_(table_mask_ + 1, kWeaklyNotTaken),
+    btb_pcs_(config.btb_entries, UINT32_MAX),
+    btb_targets_(config.btb_entries, 0) {
+  if (config_.kind == PredictorKind::kTage) {
+    for (std::size_t table = 0; table < kTageTables; ++table) {
+      tage_tables_[table].resize(table_mask_ + 1);
+      std::uint32_t length = kTageHistory[table];
+      auto folded = [length](std::uint32_t bits) {
+        return FoldedHistory{0, 1u << (length % bits), 1u << bits};
+      };
+      tage_histories_[table] = {length, folded(config_.table_bits), folded(kTagBits),
+                                folded(kTagBits - 1)};
+    }
+  }
+}
+
+// The provider is the matching entry with the longest history, the
+// alternate the next one or the base counter. A misprediction allocates
+// one entry with a longer history than the provider.
+bool BranchPredictor::tage(std::uint32_t program_counter, bool taken) {
+  std::uint32_t pc = program_counter >> 2;
+  std::array<std::size_t, kTageTables> indices;
+  std::array<std::uint16_t, kTageTables> tags;
+  std::size_t provider = kTageTables;
+  std::size_t alternate = kTageTables;
+  for (std::size_t table = kTageTables; table-- > 0;) {
+    const TageHistory& folded = tage_histories_[table];
+    indices[table] = (pc ^ (pc >> config_.table_bits) ^ folded.index.value) & table_mask_;
+    tags[table] = static_cast<std::uint16_t>(
+        (pc ^ folded.tag.value ^ (folded.tag_shifted.value << 1)) & ((1u << kTagBits) - 1));
+    if (tage_tables_[table][indices[table]].tag != tags[table]) {
+      continue;
+    }
+    if (provider == kTageTables) {
+      provider = table;
+    } else if (alternate == kTageTables) {
+      alternate = table;
+    }
+  }
+
+  std::uint8_t& base = counters_[pc & table_mask_];
+  bool predicted = base >= kWeaklyTaken;
+  if (provider == kTageTables) {
+    train(base, taken);
+  } else {
+    TageEntry& entry = tage_tables_[provider][indices[provider]];
+    bool alternate_prediction =
+        alternate != kTageTables
+            ? tage_tables_[alternate][indices[alternate]].counter >= 0
+            : predicted;
+    predicted = entry.counter >= 0;
+    if (predicted != alternate_prediction) {
+      if (predicted == taken && entry.useful < 3) {
+        ++entry.useful;
+      } else if (predicted != taken && entry.useful > 0) {
+        --entry.useful;
+      }
+    }
+    if (taken && entry.counter < 3) {
+      ++entry.counter;
+    } else if (!taken && entry.counter > -4) {
+      --entry.counter;
+    }
+  }
+  if (predicted == taken) {
+    return predicted;
+  }
+
+  // When no longer table has a free entry the candidates are aged instead,
+  // so a later misprediction can replace them.
+  std::size_t first = provider == kTageTables ? 0 : provider + 1;
+  for (std::size_t table = first; table < kTageTables; ++table) {
+    TageEntry& entry = tage_tables_[table][indices[table]];
+    if (entry.useful == 0) {
+      entry = {tags[table], static_cast<std::int8_t>(taken ? 0 : -1), 0};
+      return predicted;
+    }
+  }
+  for (std::size_t table = first; table < kTageTables; ++table) {
+    TageEntry& entry = tage_tables_[table][indices[table]];
+    if (entry.useful > 0) {
+      --entry.useful;
+    }
+  }
+  return predicted;
+}
+
+BranchPredictor::Page& BranchPredictor::get_page(std::uint32_t page_index) {
+  std::unique_ptr<Page>& page = pages_[page_index];
+  if (!page) {
+    page = std::make_unique<Page>();
+  }
+  return *page;
+}
+
+BranchPredictor::PcCounts BranchPredictor::pc_counts(std::uint32_t program_counter) const {
+  auto page = pages_.find(program_counter >> Memory::kPageShift);
+  if (page == pages_.end()) {
+    return {};
+  }
+  return (*page->second)[(program_counter & (Memory::kPageSize - 1))
+                         / kInstructionSize];
+}
+
+std::vector<std::pair<std::uint32_t, BranchPredictor::PcCounts>>
+BranchPredictor::mispredicted_branches() const {
+  std::vector<std::pair<std::uint32_t, PcCounts>> branches;
+  for (const auto& [page_index, page] : pages_) {
+    for (std::size_t i = 0; i < kEntriesPerPage; ++i) {
+      if ((*page)[i].mispredicted != 0) {
+        branches.emplace_back(
+            (page_index << Memory::kPageShift) + i * kInstructionSize,
+            (*page)[i]);
+      }
+    }
+  }
+  std::sort(branches.begin(), branches.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.second.mispredicted != rhs.second.mispredicted
+               ? lhs.second.mispredicted > rhs.second.mispredicted
+               : lhs.first < rhs.first;
+  });
+  return branches;
+}
+
+void BranchPredictor::write_report(std::ostream& output, std::uint64_t instructions,
+                                   std::size_t top) const {
+  std::ostringstream buffer;
+  buffer << "Predictor: " << describe(config_) << "\n"
+         << "Instructions: " << instructions << "\n"
+         << "Conditional: " << stats_.conditional << "  mispredicted "
+         << stats_.mispredicted << "  "
+         << percent(stats_.mispredicted, stats_.conditional) << "\n"
+         << "Jumps: " << stats_.jumps << "  BTB misses " << stats_.btb_misses << "\n"
+         << "MPKI: " << std::fixed << std::setprecision(3)
+         << stats_.mpki(instructions) << "\n";
+
+  auto branches = mispredicted_branches();
+  buffer << "\nMispredicted branches:\n";
+  for (std::size_t i = 0; i < branches.size() && i < top; ++i) {
+    const auto& [program_counter, counts] = branches[i];
+    buffer << "  " << hex(program_counter) << "  executed " << counts.executed
+           << "  taken " << counts.taken << "  mispredicted " << counts.mispredicted
+           << "  " << percent(counts.mispredicted, counts.executed) << "\n";
+  }
+  output << buffer.str();
+}
+
+void BranchPredictor::clear() {
+  history_ = 0;
+  std::fill(counters_.begin(), counters_.end(), kWeaklyNotTaken);
+  for (std::vector<TageEntry>& table : tage_tables_) {
+    std::fill(table.begin(), table.end(), TageEntry{});
+  }
+  for (TageHistory& folded : tage_histories_) {
+    folded.index.value = 0;
+    folded.tag.value = 0;
+    folded.tag_shifted.value = 0;
+  }
+  std::fill(btb_pcs_.begin(), btb_pcs_.end(), UINT32_MAX);
+  std::fill(btb_targets_.begin(), btb_targets_.end(), 0);
+  stats_ = {};
+  pages_.clear();
+  last_page_index_ = UINT32_MAX;
+  last_page_ = nullptr;
+}
+
+} // namespace simulator
@@ -0,0 +1,346 @@
+#include "cache_model.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SIMULATOR_SSE2_TAGS
+#include <emmintrin.h>
+#endif
+
+namespace simulator {
+
+namespace {
+
+constexpr std::uint32_t kMaxAssociativity = 64;
+constexpr std::uint32_t kWordSize = 4;
+
+std::string hex(std::uint32_t value) {
+  std::ostringstream text;
+  text << "0x" << std::hex << std::setw(8) << std::setfill('0') << value;
+  return text.str();
+}
+
+std::string percent(std::uint64_t part, std::uint64_t total) {
+  std::ostringstream text;
+  text << std::fixed << std::setprecision(2)
+       << (total == 0 ? 0.0 : 100.0 * static_cast<double>(part)
+                                  / static_cast<double>(total))
+       << "%";
+  return text.str();
+}
+
+std::string describe(const CacheConfig& config) {
+  std::ostringstream text;
+  text << config.size / 1024 << " KiB, " << config.associativity << "-way, "
+       << config.line_size << " B lines, ";
+  switch (config.replacement) {
+    case Replacement::kLru:
+      text << "LRU";
+      break;
+    case Replacement::kPseudoLru:
+      text << "PLRU";
+      break;
+    case Replacement::kRandom:
+      text << "random";
+      break;
+  }
+  text << (config.write_policy == WritePolicy::kWriteBack ? ", write-back" : ", write-through");
+  return text.str();
+}
+
+const CacheConfig& validate(const CacheConfig& config) {
+  if (!std::has_single_bit(config.size) || !std::has_single_bit(config.associativity)
+      || !std::has_single_bit(config.line_size)) {
+    throw std::runtime_error("Cache size, associativity and line size must be powers of two");
+  }
+  if (config.associativity > kMaxAssociativity) {
+    throw std::runtime_error("Cache associativity must be at most "
+                             + std::to_string(kMaxAssociativity));
+  }
+  if (config.line_size < kWordSize) {
+    throw std::runtime_error("Cache line must hold at least a word");
+  }
+  if (config.size / config.line_size < config.associativity) {
+    throw std::runtime_error("Cache is smaller than one set");
+  }
+  return config;
+}
+
+} // namespace
+
+Cache::Cache(const CacheConfig& config, std::uint64_t seed)
+  : config_(validate(config)),
+    line_shift_(static_cast<std::uint32_t>(std::countr_zero(config.line_size))),
+    set_mask_(config.size / config.line_size / config.associativity - 1),
+    stride_((config.associativity + kCompareWidth - 1) / kCompareWidth * kCompareWidth),
+    random_state_(seed != 0 ? seed : 1) {
+  std::size_t sets = std::size_t{set_mask_} + 1;
+  tags_.resize(sets * stride_);
+  dirty_.resize(sets * stride_);
+  ages_.resize(config_.replacement == Replacement::kPseudoLru ? sets : sets * stride_);
+  clear();
+}
+
+bool Cache::contains(std::uint32_t address) const {
+  std::uint32_t tag = address >> line_shift_;
+  return find(tag & set_mask_, tag) >= 0;
+}
+
+void Cache::clear() {
+  for (std::size_t index = 0; index < tags_.size(); ++index) {
+    tags_[index] = index % stride_ < config_.associativity ? kEmpty : kPadding;
+  }
+  std::fill(dirty_.begin(), dirty_.end(), 0);
+  std::fill(ages_.begin(), ages_.end(), 0);
+  clock_ = 0;
+  last_tag_ = kEmpty;
+  last_index_ = 0;
+  writeback_ = kEmpty;
+  stats_ = {};
+}
+
+bool Cache::access(std::uint32_t address, bool write) {
+  bool write_back = write && config_.write_policy == WritePolicy::kWriteBack;
+  std::uint32_t tag = address >> line_shift_;
+  if (tag == last_tag_) {
+    ++stats_.hits;
+    dirty_[last_index_] |= write_back ? 1 : 0;
+    return true;
+  }
+
+  std::uint32_t set = tag & set_mask_;
+  int found = find(set, tag);
+  if (found >= 0) {
+    std::uint32_t way = static_cast<std::uint32_t>(found);
+    std::size_t index = std::size_t{set} * stride_ + way;
+    ++stats_.hits;
+    dirty_[index] |= write_back ? 1 : 0;
+    touch(set, way);
+    last_tag_ = tag;
+    last_index_ = index;
+    return true;
+  }
+
+  ++stats_.misses;
+  writeback_ = kEmpty;
+  if (write && !write_back) {
+    return false;
+  }
+  std::uint32_t way = victim(set);
+  std::size_t index = std::size_t{set} * stride_ + way;
+  if (tags_[index] != kEmpty) {
+    ++stats_.evictions;
+    if (dirty_[index] != 0) {
+      ++stats_.writebacks;
+      writeback_ = tags_[index] << line_shift_;
+    }
+  }
+  tags_[index] = tag;
+  dirty_[index] = write_back ? 1 : 0;
+  touch(set, way);
+  last_tag_ = tag;
+  last_index_ = index;
+  return false;
+}
+
+int Cache::find(std::uint32_t set, std::uint32_t tag) const {
+  const std::uint32_t* ways = tags_.data() + std::size_t{set} * stride_;
+#ifdef SIMULATOR_SSE2_TAGS
+  // The whole set is compared without early exits, which mispredict as the
+  // way holding the line changes.
+  const __m128i needle = _mm_set1_epi32(static_cast<int>(tag));
+  std::uint64_t matches = 0;
+  for (std::uint32_t way = 0; way < stride_; way += kCompareWidth) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ways + way));
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(block, needle)));
+    matches |= static_cast<std::uint64_t>(mask) << way;
+  }
+  if (matches != 0) {
+    return std::countr_zero(matches);
+  }
+#else
+  for (std::uint32_t way = 0; way < config_.associativity; ++way) {
+    if (ways[way] == tag) {
+      return static_cast<int>(way);
+    }
+  }
+#endif
+  return -1;
+}
+
+// Empty ways are filled first, whatever the policy.
+std::uint32_t Cache::victim(std::uint32_t set) {
+  int empty = find(set, kEmpty);
+  if (empty >= 0) {
+    return static_cast<std::uint32_t>(empty);
+  }
+
+  switch (config_.replacement) {
+    case Replacement::kLru: {
+      const std::uint64_t* ages = ages_.data() + std::size_t{set} * stride_;
+      return static_cast<std::uint32_t>(
+          std::min_element(ages, ages + config_.associativity) - ages);
+    }
+    case Replacement::kPseudoLru: {
+      // Bit i of the tree holds node i, children of node i are 2i and 2i+1.
+      std::uint64_t tree = ages_[set];
+      std::uint32_t node = 1;
+      while (node < config_.associativity) {
+        node = 2 * node + static_cast<std::uint32_t>((tree >> node) & 1);
+      }
+      return node - config_.associativity;
+    }
+    case Replacement::kRandom:
+      random_state_ ^= random_state_ << 13;
+      random_state_ ^= random_state_ >> 7;
+      random_state_ ^= random_state_ << 17;
+      return static_cast<std::uint32_t>(random_state_) & (config_.associativity - 1);
+  }
+  return 0;
+}
+
+void Cache::touch(std::uint32_t set, std::uint32_t way) {
+  switch (config_.replacement) {
+    case Replacement::kLru:
+      ages_[std::size_t{set} * stride_ + way] = ++clock_;
+      break;
+    case Replacement::kPseudoLru: {
+      // Every node on the path to way points at the other subtree.
+      std::uint64_t& tree = ages_[set];
+      for (std::uint32_t node = way + config_.associativity; node > 1; node /= 2) {
+        std::uint64_t bit = std::uint64_t{1} << (node / 2);
+        tree = (node & 1) != 0 ? tree & ~bit : tree | bit;
+      }
+      break;
+    }
+    case Replacement::kRandom:
+      break;
+  }
+}
+
+CacheHierarchy::CacheHierarchy(const CacheHierarchyConfig& config)
+  : instruction_(config.instruction, 1),
+    data_(config.data, 2),
+    unified_(config.unified, 3) {}
+
+void CacheHierarchy::store(std::uint32_t program_counter, std::uint32_t address) {
+  PcCounts& entry = counts(program_counter);
+  ++entry.data_accesses;
+  bool hit = data_.write(address);
+  bool write_through = data_.get_config().write_policy == WritePolicy::kWriteThrough;
+  if (!hit) {
+    ++entry.data_misses;
+    if (!write_through) {
+      fill(entry, address, false);
+      write_back(entry);
+    }
+  }
+  if (write_through) {
+    l2_access(entry, address, true);
+  }
+}
+
+void CacheHierarchy::fill(PcCounts& entry, std::uint32_t address, bool fetch) {
+  entry.fetch_misses += fetch ? 1 : 0;
+  l2_access(entry, address, false);
+}
+
+void CacheHierarchy::write_back(PcCounts& entry) {
+  if (std::optional<std::uint32_t> line = data_.writeback()) {
+    l2_access(entry, *line, true);
+  }
+}
+
+void CacheHierarchy::l2_access(PcCounts& entry, std::uint32_t address, bool write) {
+  bool hit = write ? unified_.write(address) : unified_.read(address);
+  entry.l2_misses += hit ? 0 : 1;
+}
+
+CacheHierarchy::Page& CacheHierarchy::get_page(std::uint32_t page_index) {
+  std::unique_ptr<Page>& page = pages_[page_index];
+  if (!page) {
+    page = std::make_unique<Page>();
+  }
+  return *page;
+}
+
+CacheHierarchy::PcCounts CacheHierarchy::pc_counts(std::uint32_t program_counter) const {
+  auto page = pages_.find(program_counter >> Memory::kPageShift);
+  if (page == pages_.end()) {
+    return {};
+  }
+  return (*page->second)[(program_counter & (Memory::kPageSize - 1))
+                         / kInstructionSize];
+}
+
+std::vector<std::pair<std::uint32_t, CacheHierarchy::PcCounts>>
+CacheHierarchy::miss_hot_spots() const {
+  auto misses = [](const PcCounts& counts) {
+    return counts.fetch_misses + counts.data_misses + counts.l2_misses;
+  };
+  std::vector<std::pair<std::uint32_t, PcCounts>> spots;
+  for (const auto& [page_index, page] : pages_) {
+    for (std::size_t i = 0; i < kEntriesPerPage; ++i) {
+      if (misses((*page)[i]) != 0) {
+        spots.emplace_back(
+            (page_index << Memory::kPageShift) + i * kInstructionSize,
+            (*page)[i]);
+      }
+    }
+  }
+  std::sort(spots.begin(), spots.end(), [&misses](const auto& lhs, const auto& rhs) {
+    return misses(lhs.second) != misses(rhs.second)
+               ? misses(lhs.second) > misses(rhs.second)
+               : lhs.first < rhs.first;
+  });
+  return spots;
+}
+
+void CacheHierarchy::write_report(std::ostream& output, std::size_t top) const {
+  std::ostringstream buffer;
+  buffer << std::left << std::setw(6) << "Level" << std::right << std::setw(14)
+         << "Accesses" << std::setw(14) << "Misses" << std::setw(10) << "Rate"
+         << std::setw(14) << "Evictions" << std::setw(14) << "Write-backs" << "\n";
+  auto level = [&buffer](const char* name, const Cache& cache) {
+    const CacheStats& stats = cache.stats();
+    buffer << std::left << std::setw(6) << name << std::right << std::setw(14)
+           << stats.accesses() << std::setw(14) << stats.misses << std::setw(10)
+           << percent(stats.misses, stats.accesses()) << std::setw(14)
+           << stats.evictions << std::setw(14) << stats.writebacks << "\n";
+  };
+  level("L1I", instruction_);
+  level("L1D", data_);
+  level("L2", unified_);
+
+  buffer << "\nConfiguration:\n"
+         << "  L1I  " << describe(instruction_.get_config()) << "\n"
+         << "  L1D  " << describe(data_.get_config()) << "\n"
+         << "  L2   " << describe(unified_.get_config()) << "\n";
+
+  auto spots = miss_hot_spots();
+  buffer << "\nMisses by PC:\n";
+  for (std::size_t i = 0; i < spots.size() && i < top; ++i) {
+    const auto& [program_counter, counts] = spots[i];
+    buffer << "  " << hex(program_counter)
+           << "  fetch " << counts.fetch_misses
+           << "  data " << counts.data_misses << "/" << counts.data_accesses
+           << "  L2 " << counts.l2_misses << "\n";
+  }
+  output << buffer.str();
+}
+
+void CacheHierarchy::clear() {
+  instruction_.clear();
+  data_.clear();
+  unified_.clear();
+  pages_.clear();
+  last_page_index_ = UINT32_MAX;
+  last_page_ = nullptr;
+}
+
+} // namespace simulator
@@ -1,20 +1,58 @@
 #include "cpu.hpp"
 #include <sys/types.h>
+#include <algorithm>
 #include <cstdint>
 #include <ios>
 #include <iostream>
+#include <stdexcept>
 
+#include "alu_kernels.hpp"
 #include "instruction_formats.hpp"
-#include "instruction_parser.hpp"
 #include "opcodes.hpp"
 #include "bit_shifts.hpp"
 #include "syscalls.hpp"
+#include "block_engine.hpp"
+#include "threaded_engine.hpp"
 
 
 namespace simulator {
 
-Cpu::Cpu(Memory& memory) 
-  : memory_(memory) {}
+Cpu::Cpu(Memory& memory, ExecutionEngine engine) 
+  : memory_(memory),
+    decode_cache_(memory),
+    block_cache_(decode_cache_),
+    engine_(engine),
+    console_output_(&std::cout),
+    console_input_(&std::cin) {
+  memory_.set_code_write_listener(this);
+  memory_.set_watch_listener(this);
+}
+
+Cpu::~Cpu() {
+  memory_.set_code_write_listener(nullptr);
+  memory_.set_watch_listener(nullptr);
+}
+
+// Blocks are translated from decoded entries, so data sharing a page with
+// code leaves them alone.
+void Cpu::on_code_write(std::uint32_t address, std::size_t size) {
+  if (decode_cache_.invalidate(address, size)) {
+    block_cache_.request_flush();
+  }
+}
+
+void Cpu::on_watched_access(std::uint32_t address, std::size_t size, bool write) {
+  WatchAccess kind = write ? WatchAccess::kWrite : WatchAccess::kRead;
+  for (const auto& [watched, access] : watchpoints_) {
+    if (watched - address < size
+        && (static_cast<std::uint8_t>(access) & static_cast<std::uint8_t>(kind)) != 0) {
+      watchpoint_hit_ = {watched, static_cast<std::uint32_t>(program_counter_), write};
+      stop_reason_ = StopReason::kWatchpoint;
+      should_run_ = false;
+      return;
+    }
+  }
+}
 
 std::uint32_t Cpu::get_pc() const {
   return program_counter_;
@@ -33,35 +71,312 @@ void Cpu::set_register(std::uint8_t index, std::uint32_t data) {
   registers_[index] = data;
 }
 
+std::uint64_t Cpu::get_instruction_count() const {
+  return instruction_count_;
+}
+
+CpuState Cpu::get_state() const {
+  return {registers_, static_cast<std::uint32_t>(program_counter_),
+          instruction_count_};
+}
+
+void Cpu::set_state(const CpuState& state) {
+  registers_ = state.registers;
+  program_counter_ = static_cast<std::int32_t>(state.program_counter);
+  instruction_count_ = state.instruction_count;
+}
+
+
+StopReason Cpu::run_program() {
+  return run_program(UINT64_MAX);
+}
+
+StopReason Cpu::run_program(std::uint64_t max_instructions) {
+  start_run(max_instructions);
+  StopReason reason;
+  try {
+    reason = run_engine();
+  } catch (...) {
+    flush_console();
+    throw;
+  }
+  flush_console();
+  return reason;
+}
 
-void Cpu::run_program() {
-  should_run_ = true; 
+void Cpu::start_run(std::uint64_t max_instructions) {
+  should_run_ = true;
+  stop_reason_ = StopReason::kExited;
+  instruction_limit_ = max_instructions > UINT64_MAX - instruction_count_
+                           ? UINT64_MAX
+                           : instruction_count_ + max_instructions;
+}
 
-  while (should_run_) {
+StopReason Cpu::run_engine() {
+  bool observed = profiler_ || trace_ || !observers_.empty();
+  bool models = cache_ || branch_predictor_;
+  if (timing_ || (models && (observed || engine_ == ExecutionEngine::kStaged))) {
+    run_staged();
+    return should_run_ ? StopReason::kInstructionLimit : stop_reason_;
+  }
+  // The block engine feeds the cache model and the branch predictor itself.
+  if (models) {
+    BlockEngine::run(*this);
+    return should_run_ ? StopReason::kInstructionLimit : stop_reason_;
+  }
+  if (observed) {
+    ThreadedEngine::run(*this);
+    return should_run_ ? StopReason::kInstructionLimit : stop_reason_;
+  }
+
+  switch (engine_) {
+    case ExecutionEngine::kBlock:
+      BlockEngine::run(*this);
+      break;
+    case ExecutionEngine::kThreaded:
+      ThreadedEngine::run(*this);
+      break;
+    case ExecutionEngine::kStaged:
+      run_staged();
+      break;
+  }
+
+  return should_run_ ? StopReason::kInstructionLimit : stop_reason_;
+}
+
+void Cpu::run_staged() {
+  while (should_run_ && instruction_count_ < instruction_limit_) {
+    if (!breakpoints_.empty() && stop_at_breakpoint()) {
+      break;
+    }
     pipeline_cycle();
   }
 }
 
+bool Cpu::stop_at_breakpoint() {
+  auto breakpoint = breakpoints_.find(static_cast<std::uint32_t>(program_counter_));
+  if (breakpoint == breakpoints_.end()
+      || (instruction_count_ == resume_instruction_count_
+          && program_counter_ == resume_program_counter_)) {
+    return false;
+  }
+  const std::optional<BreakCondition>& condition = breakpoint->second;
+  if (condition && !condition->holds(registers_[condition->reg])) {
+    return false;
+  }
+
+  resume_instruction_count_ = instruction_count_;
+  resume_program_counter_ = program_counter_;
+  stop_reason_ = StopReason::kBreakpoint;
+  should_run_ = false;
+  return true;
+}
+
+MemoryAccess Cpu::run_memory_access() const {
+  return watchpoints_.empty() ? memory_access_ : MemoryAccess::kWatched;
+}
+
+// Blocks are flushed on every switch so none keeps native code from a
+// destroyed arena or a stale hotness counter.
+void Cpu::set_jit_enabled(bool enabled) {
+  if (enabled == is_jit_enabled()) {
+    return;
+  }
+  if (enabled && !JitCompiler::is_supported()) {
+    throw std::runtime_error("JIT is not supported on this host");
+  }
+
+  block_cache_.request_flush();
+  if (enabled) {
+    jit_ = std::make_unique<JitCompiler>(*this);
+  } else {
+    jit_.reset();
+  }
+}
+
+bool Cpu::is_jit_enabled() const {
+  return jit_ != nullptr;
+}
+
+void Cpu::set_memory_access(MemoryAccess access) {
+  memory_access_ = access;
+}
+
+MemoryAccess Cpu::get_memory_access() const {
+  return memory_access_;
+}
+
+void Cpu::set_profiling_enabled(bool enabled) {
+  if (enabled == is_profiling_enabled()) {
+    return;
+  }
+  if (enabled) {
+    profiler_ = std::make_unique<Profiler>();
+  } else {
+    profiler_.reset();
+  }
+}
+
+bool Cpu::is_profiling_enabled() const {
+  return profiler_ != nullptr;
+}
+
+const Profiler* Cpu::get_profiler() const {
+  return profiler_.get();
+}
+
+void Cpu::start_trace(const std::string& path) {
+  stop_trace();
+  trace_ = std::make_unique<TraceWriter>(path);
+}
+
+void Cpu::stop_trace() {
+  if (!trace_) {
+    return;
+  }
+  std::unique_ptr<TraceWriter> trace = std::move(trace_);
+  trace->close();
+}
+
+bool Cpu::is_tracing() const {
+  return trace_ != nullptr;
+}
+
+void Cpu::add_observer(DynamicObserver* observer) {
+  if (observer == nullptr) {
+    throw std::runtime_error("Observer must not be null");
+  }
+  observers_.push_back(observer);
+}
+
+void Cpu::remove_observer(DynamicObserver* observer) {
+  observers_.erase(std::remove(observers_.begin(), observers_.end(), observer),
+                   observers_.end());
+}
+
+void Cpu::set_timing_enabled(bool enabled, PipelineConfig config) {
+  if (enabled) {
+    timing_ = std::make_unique<PipelineModel>(config);
+  } else {
+    timing_.reset();
+  }
+}
+
+bool Cpu::is_timing_enabled() const {
+  return timing_ != nullptr;
+}
+
+const PipelineModel* Cpu::get_timing_model() const {
+  return timing_.get();
+}
+
+void Cpu::set_cache_enabled(bool enabled, const CacheHierarchyConfig& config) {
+  if (enabled) {
+    cache_ = std::make_unique<CacheHierarchy>(config);
+  } else {
+    cache_.reset();
+  }
+}
+
+bool Cpu::is_cache_enabled() const {
+  return cache_ != nullptr;
+}
+
+const CacheHierarchy* Cpu::get_cache_model() const {
+  return cache_.get();
+}
+
+void Cpu::set_branch_prediction_enabled(bool enabled, const PredictorConfig& config) {
+  if (enabled) {
+    branch_predictor_ = std::make_unique<BranchPredictor>(config);
+  } else {
+    branch_predictor_.reset();
+  }
+}
+
+bool Cpu::is_branch_prediction_enabled() const {
+  return branch_predictor_ != nullptr;
+}
+
+const BranchPredictor* Cpu::get_branch_predictor() const {
+  return branch_predictor_.get();
+}
+
+// Blocks are retranslated so each breakpoint starts one.
+void Cpu::set_breakpoint(std::uint32_t address,
+                         std::optional<BreakCondition> condition) {
+  if (condition && condition->reg >= kNumberOfRegirsters) {
+    throw std::out_of_range("Invalid register in breakpoint condition: "
+                            + std::to_string(condition->reg));
+  }
+  breakpoints_[address] = condition;
+  block_cache_.set_breakpoint(address, true);
+}
+
+void Cpu::remove_breakpoint(std::uint32_t address) {
+  breakpoints_.erase(address);
+  block_cache_.set_breakpoint(address, false);
+}
+
+void Cpu::set_watchpoint(std::uint32_t address, WatchAccess access) {
+  if (!memory_.is_valid_address(address)) {
+    throw std::range_error("Watchpoint outside memory: address="
+                           + std::to_string(address));
+  }
+  if (access == WatchAccess::kNone) {
+    remove_watchpoint(address);
+    return;
+  }
+  watchpoints_[address] = access;
+  update_watched_page(address);
+}
+
+void Cpu::remove_watchpoint(std::uint32_t address) {
+  if (watchpoints_.erase(address) != 0) {
+    update_watched_page(address);
+  }
+}
+
+const WatchpointHit& Cpu::get_watchpoint_hit() const {
+  return watchpoint_hit_;
+}
+
+void Cpu::update_watched_page(std::uint32_t address) {
+  std::uint32_t page = address >> Memory::kPageShift;
+  std::uint8_t access = 0;
+  for (const auto& [watched, watched_access] : watchpoints_) {
+    if (watched >> Memory::kPageShift == page) {
+      access |= static_cast<std::uint8_t>(watched_access);
+    }
+  }
+  memory_.watch_page(page, static_cast<WatchAccess>(access));
+}
+
+// Instructions come out of fetch() already decoded by the decode cache,
+// so there is no separate decode stage.
 void Cpu::pipeline_cycle() {
   fetch();
-  decode();
   execute();
   write_back();
+  if (timing_) {
+    timing_->retire(pipeline_data_.instruction,
+                    static_cast<std::uint32_t>(program_counter_),
+                    static_cast<std::uint32_t>(pipeline_data_.next_program_counter));
+  }
   advance();
 }
 
 void Cpu::fetch() {
-  std::uint32_t raw_instruction = memory_.read_word(program_counter_);
-  pipeline_data_.raw_instruction = raw_instruction;
+  pipeline_data_.instruction = decode_cache_.fetch(program_counter_);
+  pipeline_data_.raw_instruction = pipeline_data_.instruction.raw;
   pipeline_data_.next_program_counter = program_counter_ + kInstrucionSize;
-}
-
-void Cpu::decode() {
-  pipeline_data_.instruction = InstructionParser::parse(pipeline_data_.raw_instruction);
+  if (cache_) {
+    cache_->fetch(static_cast<std::uint32_t>(program_counter_));
+  }
 }
 
 void Cpu::execute() {
-  Instruction& instruction = pipeline_data_.instruction;
+  const DecodedInstruction& instruction = pipeline_data_.instruction;
 
   switch(instruction.opcode) {
     case opcodes::kNOR:
@@ -116,31 +431,19 @@ void Cpu::write_back() {
     return;
   }
 
-  Instruction& instruction = pipeline_data_.instruction;
+  const DecodedInstruction& instruction = pipeline_data_.instruction;
 
   std::uint8_t destination_register = 0;
   switch (instruction.opcode) {
     case opcodes::kNOR:
     case opcodes::kADD:
     case opcodes::kXOR:
-      destination_register = std::get<RFormat>(instruction.fields).rd;
-      break;
-
     case opcodes::kLD:
-      destination_register = std::get<MemBaseRtOffset16Format>(instruction.fields).rt;
-      break;
-
     case opcodes::kCBIT:
     case opcodes::kSSAT:
-      destination_register = std::get<RdRsImm5Format>(instruction.fields).rd;
-      break;
-
     case opcodes::kCLZ:
-      destination_register = std::get<ClzFormat>(instruction.fields).rd;
-      break;
-
     case opcodes::kBDEP:
-      destination_register = std::get<BdepFormat>(instruction.fields).rd;
+      destination_register = instruction.rd;
       break;
 
     default:
@@ -154,29 +457,23 @@ void Cpu::write_back() {
 
 void Cpu::advance() {
   program_counter_ = pipeline_data_.next_program_counter;
+  ++instruction_count_;
 }
 
 
 void Cpu::print_registers() const {
-  std::cout << "PC: 0x" << std::hex << program_counter_ << "\n";
-  for (std::size_t i = 0; i < kNumberOfRegirsters; ++i) {
-    std::cout << "R" << std::dec << i << ": 0x" << std::hex << registers_[i] << "\n";
-  }
-  std::cout << std::dec << std::endl;
+  print_registers(std::cout);
 }
 
-
-std::int32_t Cpu::sign_extend(std::uint16_t value) {
-  std::int16_t sign_value_16_bit = static_cast<std::int16_t>(value);
-  std::int32_t sign_value_32_bit = static_cast<std::int32_t>(sign_value_16_bit);
-  return sign_value_32_bit;
+void Cpu::print_registers(std::ostream& output) const {
+  output << "PC: 0x" << std::hex << program_counter_ << "\n";
+  for (std::size_t i = 0; i < kNumberOfRegirsters; ++i) {
+    output << "R" << std::dec << i << ": 0x" << std::hex << registers_[i] << "\n";
+  }
+  output << std::dec << "\n";
 }
 
 
-std::int32_t Cpu::calculate_branch_target(std::uint16_t offset) {
-  return sign_extend(offset) << 2;
-}
-
 std::uint32_t Cpu::clear_bit_field(std::uint32_t value, std::uint8_t index) {
   if (index >= kNumberOfBitsInWord) {
     return value;
@@ -203,38 +500,17 @@ std::uint32_t Cpu::saturate_signed(std::uint32_t value, std::uint8_t number) {
 }
 
 std::uint32_t Cpu::count_leading_zeros(std::uint32_t value) {
-  if (value == 0) {
-    return kNumberOfBitsInWord;
-  }
-
-  std::uint32_t count = 0;
-  for (std::uint32_t i = kNumberOfBitsInWord; i > 0; --i) {
-    if (((value >> (i - 1)) & 1) != 0) {
-      break;
-    }
-    ++count;
-  }
-  return count;
+  return alu::count_leading_zeros(value);
 }
 
 std::uint32_t Cpu::bit_deposit(std::uint32_t value, std::uint32_t mask) {
-  std::uint32_t result = 0;
-  std::uint32_t value_bit = 0;
-  for (std::uint32_t i = 0; i < kNumberOfBitsInWord; ++i) {
-    if (((mask >> i) & 1) != 0) {
-      if (((value >> value_bit) & 1) != 0) {
-        result |= (1U << i);
-      }
-      ++value_bit;
-    }
-  }
-  return result;
+  return alu::bit_deposit(value, mask);
 }
 
 std::uint32_t Cpu::execute_rformat() {
-  const auto& format = std::get<RFormat>(pipeline_data_.instruction.fields);
-  std::uint32_t rs_data = registers_[format.rs];
-  std::uint32_t rt_data = registers_[format.rt];
+  const DecodedInstruction& instruction = pipeline_data_.instruction;
+  std::uint32_t rs_data = registers_[instruction.rs];
+  std::uint32_t rt_data = registers_[instruction.rt];
   switch (pipeline_data_.instruction.opcode) {
     case opcodes::kNOR: 
       return ~(rs_data | rt_data);
@@ -247,16 +523,24 @@ std::uint32_t Cpu::execute_rformat() {
   }
 } 
 
+// The staged path always reports watched accesses; without watchpoints that
+// costs one page flag load per access.
 std::uint32_t Cpu::execute_memformat() {
-  const auto& format = std::get<MemBaseRtOffset16Format>(pipeline_data_.instruction.fields);
-  std::uint32_t address = registers_[format.base] + sign_extend(format.offset);
-  
+  const DecodedInstruction& instruction = pipeline_data_.instruction;
+  std::uint32_t address = registers_[instruction.rs] + instruction.imm;
+
   switch (pipeline_data_.instruction.opcode) {
     case opcodes::kLD:
-      pipeline_data_.memory_read_data = memory_.read_word(address);
+      pipeline_data_.memory_read_data = memory_.read_word<MemoryAccess::kWatched>(address);
+      if (cache_) {
+        cache_->load(static_cast<std::uint32_t>(program_counter_), address);
+      }
       return pipeline_data_.memory_read_data;
     case opcodes::kST:
-      memory_.write_word(address, registers_[format.rt]);
+      memory_.write_word<MemoryAccess::kWatched>(address, registers_[instruction.rt]);
+      if (cache_) {
+        cache_->store(static_cast<std::uint32_t>(program_counter_), address);
+      }
       return 0;
     default:
       return 0;
@@ -264,74 +548,182 @@ std::uint32_t Cpu::execute_memformat() {
 }
 
 void Cpu::execute_branch_format() {
-  const auto& format = std::get<BranchRsRtOffset16Format>(pipeline_data_.instruction.fields);
+  const DecodedInstruction& instruction = pipeline_data_.instruction;
   bool condition = false;
-  if (pipeline_data_.instruction.opcode == opcodes::kBNE) {
-    condition = (registers_[format.rs] != registers_[format.rt]);
-  } else if (pipeline_data_.instruction.opcode == opcodes::kBEQ) {
-    condition = (registers_[format.rs] == registers_[format.rt]);
+  if (instruction.opcode == opcodes::kBNE) {
+    condition = (registers_[instruction.rs] != registers_[instruction.rt]);
+  } else if (instruction.opcode == opcodes::kBEQ) {
+    condition = (registers_[instruction.rs] == registers_[instruction.rt]);
   }
 
   if (condition) {
-    std::int32_t target = calculate_branch_target(format.offset);
-    pipeline_data_.next_program_counter = program_counter_ + target;
+    pipeline_data_.next_program_counter = program_counter_ + instruction.imm;
+  }
+  if (branch_predictor_) {
+    branch_predictor_->conditional(static_cast<std::uint32_t>(program_counter_), condition);
   }
 
   pipeline_data_.raw_instruction = 0;
 }
 
 std::uint32_t Cpu::execute_rd_rs_imm5_format() {
-  const auto& format = std::get<RdRsImm5Format>(pipeline_data_.instruction.fields);
-  std::uint32_t rs_data = registers_[format.rs];
-  switch (pipeline_data_.instruction.opcode) {
+  const DecodedInstruction& instruction = pipeline_data_.instruction;
+  std::uint32_t rs_data = registers_[instruction.rs];
+  switch (instruction.opcode) {
     case opcodes::kCBIT:
-      return clear_bit_field(rs_data, format.imm5);
+      return clear_bit_field(rs_data, instruction.imm);
     case opcodes::kSSAT:
-      return saturate_signed(rs_data, format.imm5);
+      return saturate_signed(rs_data, instruction.imm);
     default:
       return 0;
   }
 }
 
 std::uint32_t Cpu::execute_clz_format() {
-  const auto& format = std::get<ClzFormat>(pipeline_data_.instruction.fields);
-  return count_leading_zeros(registers_[format.rs]);
+  return count_leading_zeros(registers_[pipeline_data_.instruction.rs]);
 }
 
 std::uint32_t Cpu::execute_bdep_format() {
-  const auto& format = std::get<BdepFormat>(pipeline_data_.instruction.fields);
-  return bit_deposit(registers_[format.rs1], registers_[format.rs2]);
+  const DecodedInstruction& instruction = pipeline_data_.instruction;
+  return bit_deposit(registers_[instruction.rs], registers_[instruction.rt]);
 }
 
 void Cpu::execute_ldp_format() {
-  const auto& format = std::get<LdpFormat>(pipeline_data_.instruction.fields);
-  std::uint32_t address = registers_[format.base] + sign_extend(format.offset);
-
-  registers_[format.rt1] = memory_.read_word(address);
-  registers_[format.rt2] = memory_.read_word(address + kInstrucionSize);
+  const DecodedInstruction& instruction = pipeline_data_.instruction;
+  std::uint32_t address = registers_[instruction.rs] + instruction.imm;
+
+  registers_[instruction.rd] = memory_.read_word<MemoryAccess::kWatched>(address);
+  registers_[instruction.rt] =
+      memory_.read_word<MemoryAccess::kWatched>(address + kInstrucionSize);
+  if (cache_) {
+    cache_->load(static_cast<std::uint32_t>(program_counter_), address);
+    cache_->load(static_cast<std::uint32_t>(program_counter_), address + kInstrucionSize);
+  }
 
   pipeline_data_.raw_instruction = 0;
 } 
 
 void Cpu::execute_j_format() {
-  const auto& format = std::get<JTarget26Format>(pipeline_data_.instruction.fields);
   std::uint32_t pc_upper_4_bits = program_counter_ & shifts::kFirst4BitsMask;
-  pipeline_data_.next_program_counter = pc_upper_4_bits | (format.target_index << 2);
+  pipeline_data_.next_program_counter = pc_upper_4_bits | pipeline_data_.instruction.imm;
+  if (branch_predictor_) {
+    branch_predictor_->jump(static_cast<std::uint32_t>(program_counter_),
+                            static_cast<std::uint32_t>(pipeline_data_.next_program_counter));
+  }
   pipeline_data_.raw_instruction = 0;
 }
 
+const std::array<Cpu::SyscallHandler, syscalls::kNumberOfSyscalls> Cpu::kSyscalls = {
+    &Cpu::syscall_exit,
+    &Cpu::syscall_write,
+    &Cpu::syscall_read,
+    &Cpu::syscall_get_time,
+    &Cpu::syscall_get_instruction_count,
+};
+
 void Cpu::execute_syscall_format() {
   std::uint32_t syscall_number = registers_[syscalls::kNumberRegister];
-  
-  std::uint32_t result = 0;
-  switch (syscall_number) {
-    case syscalls::EXIT:
-      should_run_ = false;
-      break;
+  if (syscall_number >= kSyscalls.size()) {
+    return;
   }
 
-  registers_[syscalls::kResult] = result;
+  std::uint32_t result = (this->*kSyscalls[syscall_number])();
+  if (syscall_number != syscalls::EXIT) {
+    registers_[syscalls::kResult] = result;
+  }
+}
+
+std::uint32_t Cpu::syscall_exit() {
+  should_run_ = false;
+  return 0;
+}
 
+// A repeated write already reached the console.
+std::uint32_t Cpu::syscall_write() {
+  std::uint32_t size = registers_[syscalls::kArgument1];
+  const std::uint8_t* data = memory_.read_block(registers_[syscalls::kArgument0], size);
+  std::uint32_t result = size;
+  if (const SyscallOutcome* outcome = repeated_syscall()) {
+    result = outcome->result;
+  } else {
+    if (!output_channel_) {
+      output_channel_ = std::make_unique<OutputChannel>(*console_output_);
+    }
+    output_channel_->write(data, size);
+    record_syscall(result);
+  }
+  if (!watchpoints_.empty()) {
+    on_watched_access(registers_[syscalls::kArgument0], size, false);
+  }
+  return result;
+}
+
+// Input is only consumed once it is stored, so a faulting read loses
+// nothing. A repeated read stores the bytes it read the first time.
+std::uint32_t Cpu::syscall_read() {
+  std::uint32_t address = registers_[syscalls::kArgument0];
+  std::uint32_t size = registers_[syscalls::kArgument1];
+  if (size == 0) {
+    return 0;
+  }
+  memory_.read_block(address, size);
+
+  std::size_t count = 0;
+  if (const SyscallOutcome* outcome = repeated_syscall()) {
+    count = outcome->input.size();
+    memory_.write_block(address, outcome->input.data(), count);
+  } else {
+    if (!input_buffer_) {
+      input_buffer_ = std::make_unique<InputBuffer>(*console_input_);
+    }
+    std::span<const std::uint8_t> available = input_buffer_->fill();
+    count = std::min<std::size_t>(size, available.size());
+    memory_.write_block(address, available.data(), count);
+    record_syscall(static_cast<std::uint32_t>(count), available.first(count));
+    input_buffer_->consume(count);
+  }
+  if (!watchpoints_.empty()) {
+    on_watched_access(address, count, true);
+  }
+  return static_cast<std::uint32_t>(count);
+}
+
+std::uint32_t Cpu::syscall_get_time() {
+  if (const SyscallOutcome* outcome = repeated_syscall()) {
+    return outcome->result;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start_time_;
+  auto time = static_cast<std::uint32_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+  record_syscall(time);
+  return time;
+}
+
+std::uint32_t Cpu::syscall_get_instruction_count() {
+  return static_cast<std::uint32_t>(instruction_count_);
+}
+
+const SyscallOutcome* Cpu::repeated_syscall() const {
+  return syscall_journal_ ? syscall_journal_->find(instruction_count_) : nullptr;
+}
+
+void Cpu::record_syscall(std::uint32_t result, std::span<const std::uint8_t> input) {
+  if (syscall_journal_) {
+    syscall_journal_->record({instruction_count_, result, {input.begin(), input.end()}});
+  }
+}
+
+void Cpu::set_console(std::ostream& output, std::istream& input) {
+  output_channel_.reset();
+  input_buffer_.reset();
+  console_output_ = &output;
+  console_input_ = &input;
+}
+
+void Cpu::flush_console() {
+  if (output_channel_) {
+    output_channel_->flush();
+  }
 }
 
 } // namespace simulator
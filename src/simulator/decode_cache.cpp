@@ -0,0 +1,60 @@
+#include "decode_cache.hpp"
+
+#include <algorithm>
+
+#include "instruction_parser.hpp"
+
+namespace simulator {
+
+DecodeCache::DecodeCache(Memory& memory)
+  : memory_(memory) {}
+
+const DecodedInstruction& DecodeCache::fetch_slow(std::uint32_t address) {
+  std::uint32_t raw_instruction = memory_.read_word(address);
+
+  std::uint32_t page_index = address >> Memory::kPageShift;
+  Page& page = get_page(page_index);
+  DecodedInstruction& entry = page[entry_index(address)];
+  entry = InstructionParser::decode(raw_instruction);
+  memory_.mark_code_page(address);
+
+  last_page_index_ = page_index;
+  last_page_ = &page;
+  return entry;
+}
+
+DecodeCache::Page& DecodeCache::get_page(std::uint32_t page_index) {
+  auto [it, inserted] = pages_.try_emplace(page_index);
+  if (inserted) {
+    it->second = std::make_unique<Page>();
+  }
+  return *it->second;
+}
+
+bool DecodeCache::invalidate(std::uint32_t address, std::size_t size) {
+  std::uint64_t current = address - address % kInstructionSize;
+  std::uint64_t end = static_cast<std::uint64_t>(address) + size;
+  bool invalidated = false;
+
+  while (current < end) {
+    std::uint64_t page_end = (current | (Memory::kPageSize - 1)) + 1;
+    auto it = pages_.find(static_cast<std::uint32_t>(current >> Memory::kPageShift));
+    if (it != pages_.end()) {
+      for (; current < std::min(end, page_end); current += kInstructionSize) {
+        std::uint8_t& opcode = (*it->second)[entry_index(static_cast<std::uint32_t>(current))].opcode;
+        invalidated |= opcode != DecodedInstruction::kUndecoded;
+        opcode = DecodedInstruction::kUndecoded;
+      }
+    }
+    current = page_end;
+  }
+  return invalidated;
+}
+
+void DecodeCache::clear() {
+  for (auto& [page_index, page] : pages_) {
+    std::fill(page->begin(), page->end(), DecodedInstruction{});
+  }
+}
+
+} // namespace simulator
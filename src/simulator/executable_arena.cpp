@@ -0,0 +1,46 @@
+#include "executable_arena.hpp"
+
+#include <sys/mman.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace simulator {
+
+ExecutableArena::ExecutableArena(std::size_t capacity)
+  : capacity_(capacity) {
+  void* region = mmap(nullptr, capacity_, PROT_READ | PROT_EXEC,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED) {
+    throw std::runtime_error("Cannot map executable arena");
+  }
+  base_ = static_cast<std::uint8_t*>(region);
+}
+
+ExecutableArena::~ExecutableArena() {
+  munmap(base_, capacity_);
+}
+
+const void* ExecutableArena::add(const std::vector<std::uint8_t>& code) {
+  std::size_t start = (used_ + kCodeAlignment - 1) & ~(kCodeAlignment - 1);
+  if (start + code.size() > capacity_) {
+    return nullptr;
+  }
+
+  if (mprotect(base_, capacity_, PROT_READ | PROT_WRITE) != 0) {
+    throw std::runtime_error("Cannot make executable arena writable");
+  }
+  std::memcpy(base_ + start, code.data(), code.size());
+  if (mprotect(base_, capacity_, PROT_READ | PROT_EXEC) != 0) {
+    throw std::runtime_error("Cannot make executable arena executable");
+  }
+
+  used_ = start + code.size();
+  return base_ + start;
+}
+
+void ExecutableArena::reset() {
+  used_ = 0;
+}
+
+} // namespace simulator
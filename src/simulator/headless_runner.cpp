@@ -0,0 +1,328 @@
+#include "headless_runner.hpp"
+
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+#include "simulator.hpp"
+
+namespace simulator {
+
+namespace {
+
+std::int64_t parse_number(const std::string& text, const std::string& option) {
+  try {
+    std::size_t parsed = 0;
+    long long value = std::stoll(text, &parsed, 0);
+    if (parsed != text.size()) {
+      throw std::invalid_argument(text);
+    }
+    return value;
+  } catch (const std::logic_error&) {
+    throw std::runtime_error("Invalid value '" + text + "' for " + option);
+  }
+}
+
+// The target must lie in [0, target_limit]; the value may be negative to
+// spell out two's complement words.
+std::pair<std::uint32_t, std::uint32_t> parse_assignment(const std::string& text,
+                                                         const std::string& option,
+                                                         std::int64_t target_limit,
+                                                         const std::string& target_name) {
+  std::size_t equals = text.find('=');
+  if (equals == std::string::npos) {
+    throw std::runtime_error("Expected <target>=<value> for " + option);
+  }
+  std::string target_text = text.substr(0, equals);
+  std::int64_t target = parse_number(target_text, option);
+  if (target < 0 || target > target_limit) {
+    throw std::runtime_error("Invalid " + target_name + ": " + target_text);
+  }
+  std::int64_t value = parse_number(text.substr(equals + 1), option);
+  if (value < std::numeric_limits<std::int32_t>::min() ||
+      value > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::runtime_error("Invalid value for " + option);
+  }
+  return {static_cast<std::uint32_t>(target), static_cast<std::uint32_t>(value)};
+}
+
+SamplingConfig parse_sampling(const std::string& text, const std::string& option) {
+  SamplingConfig config;
+  std::size_t first = text.find(',');
+  std::size_t second = first == std::string::npos ? first : text.find(',', first + 1);
+  if (second == std::string::npos) {
+    throw std::runtime_error("Expected <period>,<warmup>,<window> for " + option);
+  }
+  std::uint64_t* fields[] = {&config.period, &config.warmup, &config.window};
+  std::string values[] = {text.substr(0, first),
+                          text.substr(first + 1, second - first - 1),
+                          text.substr(second + 1)};
+  for (std::size_t i = 0; i < 3; ++i) {
+    std::int64_t value = parse_number(values[i], option);
+    if (value < 0) {
+      throw std::runtime_error("Invalid value for " + option);
+    }
+    *fields[i] = static_cast<std::uint64_t>(value);
+  }
+  return config;
+}
+
+// <level>=<size>,<ways>,<line>[,lru|plru|random][,wb|wt]
+void parse_cache_level(const std::string& text, const std::string& option,
+                       CacheHierarchyConfig& caches) {
+  std::size_t equals = text.find('=');
+  if (equals == std::string::npos) {
+    throw std::runtime_error("Expected <level>=<size>,<ways>,<line> for " + option);
+  }
+  std::string level = text.substr(0, equals);
+  CacheConfig* config = level == "l1i"  ? &caches.instruction
+                        : level == "l1d" ? &caches.data
+                        : level == "l2"  ? &caches.unified
+                                         : nullptr;
+  if (config == nullptr) {
+    throw std::runtime_error("Unknown cache level '" + level + "' for " + option);
+  }
+
+  std::vector<std::string> fields;
+  for (std::size_t start = equals + 1;;) {
+    std::size_t comma = text.find(',', start);
+    fields.push_back(text.substr(start, comma - start));
+    if (comma == std::string::npos) {
+      break;
+    }
+    start = comma + 1;
+  }
+  if (fields.size() < 3) {
+    throw std::runtime_error("Expected <level>=<size>,<ways>,<line> for " + option);
+  }
+  std::uint32_t* sizes[] = {&config->size, &config->associativity, &config->line_size};
+  for (std::size_t i = 0; i < 3; ++i) {
+    std::int64_t value = parse_number(fields[i], option);
+    if (value <= 0 || value > UINT32_MAX) {
+      throw std::runtime_error("Invalid value for " + option);
+    }
+    *sizes[i] = static_cast<std::uint32_t>(value);
+  }
+  for (std::size_t i = 3; i < fields.size(); ++i) {
+    if (fields[i] == "lru") {
+      config->replacement = Replacement::kLru;
+    } else if (fields[i] == "plru") {
+      config->replacement = Replacement::kPseudoLru;
+    } else if (fields[i] == "random") {
+      config->replacement = Replacement::kRandom;
+    } else if (fields[i] == "wb") {
+      config->write_policy = WritePolicy::kWriteBack;
+    } else if (fields[i] == "wt") {
+      config->write_policy = WritePolicy::kWriteThrough;
+    } else {
+      throw std::runtime_error("Unknown cache policy '" + fields[i] + "' for " + option);
+    }
+  }
+}
+
+ExecutionEngine parse_engine(const std::string& name) {
+  if (name == "staged") {
+    return ExecutionEngine::kStaged;
+  }
+  if (name == "threaded") {
+    return ExecutionEngine::kThreaded;
+  }
+  if (name == "block") {
+    return ExecutionEngine::kBlock;
+  }
+  throw std::runtime_error("Unknown engine: " + name);
+}
+
+PredictorKind parse_predictor(const std::string& name) {
+  if (name == "not-taken") {
+    return PredictorKind::kNotTaken;
+  }
+  if (name == "bimodal") {
+    return PredictorKind::kBimodal;
+  }
+  if (name == "gshare") {
+    return PredictorKind::kGshare;
+  }
+  if (name == "tage") {
+    return PredictorKind::kTage;
+  }
+  throw std::runtime_error("Unknown predictor: " + name);
+}
+
+void write_profile(const Profiler& profiler, const RunOptions& options) {
+  if (!options.profile_path.empty()) {
+    std::ofstream report(options.profile_path);
+    if (!report) {
+      throw std::runtime_error("Cannot open file: " + options.profile_path);
+    }
+    profiler.write_report(report);
+  }
+  if (!options.folded_path.empty()) {
+    std::ofstream folded(options.folded_path);
+    if (!folded) {
+      throw std::runtime_error("Cannot open file: " + options.folded_path);
+    }
+    profiler.write_folded(folded);
+  }
+}
+
+} // namespace
+
+RunOptions parse_run_options(const std::vector<std::string>& arguments) {
+  RunOptions options;
+  for (std::size_t i = 0; i < arguments.size(); ++i) {
+    const std::string& argument = arguments[i];
+    auto value = [&arguments, &i, &argument]() -> const std::string& {
+      if (i + 1 >= arguments.size()) {
+        throw std::runtime_error("Missing value for " + argument);
+      }
+      return arguments[++i];
+    };
+
+    if (argument == "--reg") {
+      auto [index, data] = parse_assignment(value(), argument,
+                                            StateReport::kNumberOfRegisters - 1, "register");
+      options.initial_state.registers.emplace_back(static_cast<std::uint8_t>(index), data);
+    } else if (argument == "--mem") {
+      options.initial_state.memory_words.push_back(parse_assignment(
+          value(), argument, std::numeric_limits<std::uint32_t>::max(), "address"));
+    } else if (argument == "--pc") {
+      options.initial_state.program_counter =
+          static_cast<std::uint32_t>(parse_number(value(), argument));
+    } else if (argument == "--max-insns") {
+      std::int64_t limit = parse_number(value(), argument);
+      if (limit < 0) {
+        throw std::runtime_error("Invalid value for " + argument);
+      }
+      options.max_instructions = static_cast<std::uint64_t>(limit);
+    } else if (argument == "--engine") {
+      options.engine = parse_engine(value());
+    } else if (argument == "--jit") {
+      options.jit = true;
+    } else if (argument == "--trapping") {
+      options.memory_access = MemoryAccess::kTrapping;
+    } else if (argument == "--unchecked") {
+      options.memory_access = MemoryAccess::kUnchecked;
+    } else if (argument == "--json") {
+      options.format = ReportFormat::kJson;
+    } else if (argument == "--csv") {
+      options.format = ReportFormat::kCsv;
+    } else if (argument == "--profile") {
+      options.profile_path = value();
+    } else if (argument == "--folded") {
+      options.folded_path = value();
+    } else if (argument == "--trace") {
+      options.trace_path = value();
+    } else if (argument == "--timing") {
+      options.timing_path = value();
+    } else if (argument == "--cache") {
+      options.cache_path = value();
+    } else if (argument == "--cache-level") {
+      parse_cache_level(value(), argument, options.caches);
+    } else if (argument == "--predictor") {
+      options.predictor.kind = parse_predictor(value());
+      options.predicted = true;
+    } else if (argument == "--branches") {
+      options.branches_path = value();
+      options.predicted = true;
+    } else if (argument == "--no-forwarding") {
+      options.pipeline.forwarding = false;
+    } else if (argument == "--sample") {
+      SamplingConfig sampling = parse_sampling(value(), argument);
+      options.sampled = true;
+      options.sampling.period = sampling.period;
+      options.sampling.warmup = sampling.warmup;
+      options.sampling.window = sampling.window;
+    } else if (argument == "--sample-seed") {
+      options.sampling.randomized = true;
+      options.sampling.seed = static_cast<std::uint64_t>(parse_number(value(), argument));
+    } else if (argument.starts_with("--") || !options.program_path.empty()) {
+      throw std::runtime_error("Unexpected argument: " + argument);
+    } else {
+      options.program_path = argument;
+    }
+  }
+
+  if (options.program_path.empty()) {
+    throw std::runtime_error("Missing program file");
+  }
+  if (options.sampled && options.timing_path.empty()) {
+    throw std::runtime_error("--sample needs --timing <file> for the estimate");
+  }
+  options.sampling.pipeline = options.pipeline;
+  return options;
+}
+
+StateReport run_headless(const std::vector<std::uint8_t>& program,
+                         const RunOptions& options, std::size_t memory_size) {
+  auto simulator = std::make_unique<Simulator>(memory_size, options.engine);
+  Cpu& cpu = simulator->get_cpu();
+  cpu.set_jit_enabled(options.jit);
+  cpu.set_memory_access(options.memory_access);
+  cpu.set_profiling_enabled(!options.profile_path.empty()
+                            || !options.folded_path.empty());
+  if (!options.trace_path.empty()) {
+    cpu.start_trace(options.trace_path);
+  }
+  cpu.set_timing_enabled(!options.timing_path.empty() && !options.sampled,
+                         options.pipeline);
+  cpu.set_cache_enabled(!options.cache_path.empty(), options.caches);
+  cpu.set_branch_prediction_enabled(options.predicted, options.predictor);
+  SampledEstimate estimate;
+
+  StateReport report;
+  try {
+    simulator->load_program(program);
+    for (const auto& [address, word] : options.initial_state.memory_words) {
+      simulator->get_memory().write_word(address, word);
+    }
+    for (const auto& [index, value] : options.initial_state.registers) {
+      cpu.set_register(index, value);
+    }
+    cpu.set_pc(options.initial_state.program_counter);
+
+    StopReason reason =
+        options.sampled
+            ? run_sampled(cpu, options.sampling, estimate, options.max_instructions)
+            : cpu.run_program(options.max_instructions);
+    report = StateReport::capture(
+        cpu, reason == StopReason::kExited ? "exited" : "limit");
+  } catch (const std::exception& error) {
+    report = StateReport::capture(cpu, "faulted", error.what());
+  }
+
+  if (cpu.is_profiling_enabled()) {
+    write_profile(*cpu.get_profiler(), options);
+  }
+  cpu.stop_trace();
+  if (!options.timing_path.empty()) {
+    std::ofstream timing(options.timing_path);
+    if (!timing) {
+      throw std::runtime_error("Cannot open file: " + options.timing_path);
+    }
+    if (options.sampled) {
+      write_sampling_report(timing, estimate);
+    } else {
+      cpu.get_timing_model()->write_report(timing);
+    }
+  }
+  if (!options.cache_path.empty()) {
+    std::ofstream caches(options.cache_path);
+    if (!caches) {
+      throw std::runtime_error("Cannot open file: " + options.cache_path);
+    }
+    cpu.get_cache_model()->write_report(caches);
+  }
+  if (!options.branches_path.empty()) {
+    std::ofstream branches(options.branches_path);
+    if (!branches) {
+      throw std::runtime_error("Cannot open file: " + options.branches_path);
+    }
+    cpu.get_branch_predictor()->write_report(branches, cpu.get_instruction_count());
+  }
+  return report;
+}
+
+} // namespace simulator
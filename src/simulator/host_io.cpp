@@ -0,0 +1,109 @@
+#include "host_io.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace simulator {
+
+OutputChannel::OutputChannel(std::ostream& output, std::size_t capacity)
+  : output_(output),
+    buffer_(std::bit_ceil(std::max<std::size_t>(capacity, 1))),
+    mask_(buffer_.size() - 1),
+    writer_([this] { drain(); }) {}
+
+OutputChannel::~OutputChannel() {
+  stopping_.store(true, std::memory_order_release);
+  signal_.fetch_add(1, std::memory_order_release);
+  signal_.notify_one();
+  writer_.join();
+}
+
+void OutputChannel::write(const std::uint8_t* data, std::size_t size) {
+  std::uint64_t head = head_.load(std::memory_order_relaxed);
+  while (size > 0) {
+    std::uint64_t tail = tail_.load(std::memory_order_acquire);
+    std::size_t space = buffer_.size() - static_cast<std::size_t>(head - tail);
+    if (space == 0) {
+      tail_.wait(tail, std::memory_order_acquire);
+      continue;
+    }
+
+    std::size_t offset = static_cast<std::size_t>(head) & mask_;
+    std::size_t count = std::min({size, space, buffer_.size() - offset});
+    std::copy(data, data + count, buffer_.data() + offset);
+    data += count;
+    size -= count;
+    head += count;
+
+    head_.store(head, std::memory_order_release);
+    signal_.fetch_add(1, std::memory_order_release);
+    signal_.notify_one();
+  }
+}
+
+void OutputChannel::flush() {
+  std::uint64_t target = head_.load(std::memory_order_relaxed);
+  std::uint64_t flushed = flushed_.load(std::memory_order_acquire);
+  while (flushed < target) {
+    flushed_.wait(flushed, std::memory_order_acquire);
+    flushed = flushed_.load(std::memory_order_acquire);
+  }
+}
+
+// The signal is read before head_, so a publish after the check changes it
+// and the wait returns.
+void OutputChannel::drain() {
+  std::uint64_t tail = 0;
+  while (true) {
+    std::uint32_t signal = signal_.load(std::memory_order_acquire);
+    std::uint64_t head = head_.load(std::memory_order_acquire);
+    if (head == tail) {
+      output_.flush();
+      flushed_.store(tail, std::memory_order_release);
+      flushed_.notify_all();
+      if (stopping_.load(std::memory_order_acquire)) {
+        // Writes made before shutdown are visible now.
+        if (head_.load(std::memory_order_acquire) == tail) {
+          return;
+        }
+        continue;
+      }
+      signal_.wait(signal, std::memory_order_acquire);
+      continue;
+    }
+
+    while (tail != head) {
+      std::size_t offset = static_cast<std::size_t>(tail) & mask_;
+      std::size_t count = std::min(static_cast<std::size_t>(head - tail),
+                                   buffer_.size() - offset);
+      output_.write(reinterpret_cast<const char*>(buffer_.data() + offset),
+                    static_cast<std::streamsize>(count));
+      tail += count;
+    }
+    tail_.store(tail, std::memory_order_release);
+    tail_.notify_one();
+  }
+}
+
+InputBuffer::InputBuffer(std::istream& input, std::size_t chunk)
+  : input_(input),
+    buffer_(std::max<std::size_t>(chunk, 1)) {}
+
+std::span<const std::uint8_t> InputBuffer::fill() {
+  if (begin_ == end_) {
+    begin_ = 0;
+    end_ = 0;
+    char* destination = reinterpret_cast<char*>(buffer_.data());
+    if (input_.read(destination, 1)) {
+      end_ = 1 + static_cast<std::size_t>(input_.readsome(
+          destination + 1, static_cast<std::streamsize>(buffer_.size() - 1)));
+    }
+  }
+  return {buffer_.data() + begin_, end_ - begin_};
+}
+
+void InputBuffer::consume(std::size_t size) {
+  begin_ += std::min(size, end_ - begin_);
+}
+
+} // namespace simulator
@@ -117,4 +117,81 @@ Instruction InstructionParser::parse(std::uint32_t raw_instruction) {
   return instruction;
 }
 
+DecodedInstruction InstructionParser::decode(std::uint32_t raw_instruction) {
+  using namespace shifts;
+
+  DecodedInstruction decoded;
+  decoded.raw = raw_instruction;
+  decoded.opcode = get_opcode(raw_instruction);
+
+  std::uint8_t field_21 = (raw_instruction >> k21BitShift) & k5BitMask;
+  std::uint8_t field_16 = (raw_instruction >> k16BitShift) & k5BitMask;
+  std::uint8_t field_11 = (raw_instruction >> k11BitShift) & k5BitMask;
+  std::int32_t offset_16 = static_cast<std::int16_t>(raw_instruction & k16BitMask);
+
+  decoded.rd = 0;
+  decoded.rs = 0;
+  decoded.rt = 0;
+  decoded.imm = 0;
+
+  switch (decoded.opcode) {
+    case opcodes::kNOR:
+    case opcodes::kADD:
+    case opcodes::kXOR:
+      decoded.rd = field_11;
+      decoded.rs = field_21;
+      decoded.rt = field_16;
+      break;
+    case opcodes::kBDEP:
+      decoded.rd = field_21;
+      decoded.rs = field_16;
+      decoded.rt = field_11;
+      break;
+    case opcodes::kCLZ:
+      decoded.rd = field_21;
+      decoded.rs = field_16;
+      break;
+    case opcodes::kCBIT:
+    case opcodes::kSSAT:
+      decoded.rd = field_21;
+      decoded.rs = field_16;
+      decoded.imm = field_11;
+      break;
+    case opcodes::kLD:
+      decoded.rd = field_16;
+      decoded.rs = field_21;
+      decoded.imm = offset_16;
+      break;
+    case opcodes::kST:
+      decoded.rs = field_21;
+      decoded.rt = field_16;
+      decoded.imm = offset_16;
+      break;
+    case opcodes::kBNE:
+    case opcodes::kBEQ:
+      decoded.rs = field_21;
+      decoded.rt = field_16;
+      decoded.imm = offset_16 * 4;
+      break;
+    case opcodes::kLDP:
+      decoded.rd = field_16;
+      decoded.rs = field_21;
+      decoded.rt = field_11;
+      decoded.imm = static_cast<std::int32_t>(raw_instruction & k11BitMask);
+      break;
+    case opcodes::kJj:
+      decoded.imm = static_cast<std::int32_t>((raw_instruction & k26BitMask) << 2);
+      break;
+    case opcodes::kSYSCALL:
+      decoded.imm = static_cast<std::int32_t>((raw_instruction >> k6BitShift) & k20BitMask);
+      break;
+    case 0:
+      break;
+    default:
+      throw std::runtime_error("Unknown opcode: " + std::to_string(decoded.opcode));
+  }
+
+  return decoded;
+}
+
 } // namespace simulator
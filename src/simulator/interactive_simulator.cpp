@@ -1,83 +1,398 @@
 #include "interactive_simulator.hpp"
 
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 #include <string>
+#include <utility>
 
 namespace simulator {
-InteractiveSimulator::InteractiveSimulator(std::size_t memory_size) : simulator_(memory_size) {}
+
+namespace {
+
+BreakCondition::Compare parse_compare(const std::string& text) {
+  using Compare = BreakCondition::Compare;
+  if (text == "==") {
+    return Compare::kEqual;
+  }
+  if (text == "!=") {
+    return Compare::kNotEqual;
+  }
+  if (text == "<") {
+    return Compare::kLess;
+  }
+  if (text == "<=") {
+    return Compare::kLessOrEqual;
+  }
+  if (text == ">") {
+    return Compare::kGreater;
+  }
+  if (text == ">=") {
+    return Compare::kGreaterOrEqual;
+  }
+  throw std::runtime_error("Unknown comparison: " + text);
+}
+
+WatchAccess parse_watch_access(const std::string& text) {
+  if (text == "r") {
+    return WatchAccess::kRead;
+  }
+  if (text == "w") {
+    return WatchAccess::kWrite;
+  }
+  if (text == "rw") {
+    return WatchAccess::kReadWrite;
+  }
+  throw std::runtime_error("Unknown watch access, expected r, w or rw: " + text);
+}
+
+} // namespace
+
+InteractiveSimulator::InteractiveSimulator(std::size_t memory_size)
+  : simulator_(memory_size),
+    input_(std::cin),
+    output_(std::cout),
+    interactive_(true) {}
+
+InteractiveSimulator::InteractiveSimulator(std::size_t memory_size,
+                                           std::istream& input,
+                                           std::ostream& output)
+  : simulator_(memory_size),
+    input_(input),
+    output_(output),
+    interactive_(false) {}
+
+void InteractiveSimulator::check_arguments(const std::string& command) {
+  if (!input_) {
+    // The next command starts on the next line.
+    input_.clear();
+    input_.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    throw std::runtime_error("Invalid arguments for " + command);
+  }
+}
+
+std::ostream& InteractiveSimulator::acknowledge() {
+  return interactive_ ? output_ : discarded_;
+}
 
 void InteractiveSimulator::start() {
-  std::cout << "Simulator started. Type 'help' for commands.\n";
+  acknowledge() << "Simulator started. Type 'help' for commands.\n";
 
   std::string line;
   while (running_) {
-    std::cout << "> ";
-    std::getline(std::cin, line);
-
-    if (line == "sr" || line == "set_register") {
-      int reg;
-      int value;
-      std::cin >> reg >> value;
-      std::cin.ignore(); 
-      simulator_.get_cpu().set_register(reg, value);
-      std::cout << "R" << reg << " = " << value << "\n";
-    }
-    else if (line == "run_cycle") {
-      simulator_.get_cpu().pipeline_cycle();
-      std::cout << "Cycle executed. PC = " << simulator_.get_cpu().get_pc() << "\n";
+    if (interactive_) {
+      output_ << "> " << std::flush;
     }
-    else if (line == "run_program") {
-      simulator_.get_cpu().run_program();
-      std::cout << "Program executed.\n";
+    if (!std::getline(input_, line)) {
+      break;
     }
-    else if (line == "print_reg") {
-      simulator_.get_cpu().print_registers();
+
+    if (!interactive_) {
+      execute_command(line);
+      continue;
     }
-    else if (line == "load") {
-      std::string filename;
-      std::cin >> filename;
-      std::cin.ignore(); 
-      load_program(filename);
+    try {
+      execute_command(line);
+    } catch (const std::exception& error) {
+      output_ << error.what() << "\n";
     }
-    else if (line == "reset") {
-      for (int i = 0; i < 32; i++) {
-        simulator_.get_cpu().set_register(i, 0);
-      }
-      simulator_.get_cpu().set_pc(0);
-      std::cout << "All registers and PC reset to 0\n";
+  }
+}
+
+void InteractiveSimulator::execute_command(const std::string& line) {
+  if (line == "sr" || line == "set_register") {
+    int reg;
+    int value;
+    input_ >> reg >> value;
+    input_.ignore();
+    check_arguments(line);
+    simulator_.get_cpu().set_register(reg, value);
+    time_travel_.state_changed();
+    acknowledge() << "R" << reg << " = " << value << "\n";
+  }
+  else if (line == "run_cycle") {
+    time_travel_.step();
+    acknowledge() << "Cycle executed. PC = " << simulator_.get_cpu().get_pc() << "\n";
+  }
+  else if (line == "run_program") {
+    report_stop(time_travel_.run());
+  }
+  else if (line == "reverse_step") {
+    time_travel_.step_back();
+    acknowledge() << "Stepped back. PC = " << simulator_.get_cpu().get_pc() << "\n";
+  }
+  else if (line == "reverse_continue") {
+    time_travel_.rewind();
+    acknowledge() << "Rewound to instruction "
+                  << simulator_.get_cpu().get_instruction_count()
+                  << ". PC = " << simulator_.get_cpu().get_pc() << "\n";
+  }
+  else if (line == "goto") {
+    std::uint64_t instruction;
+    input_ >> instruction;
+    input_.ignore();
+    check_arguments(line);
+    time_travel_.seek(instruction);
+    acknowledge() << "At instruction "
+                  << simulator_.get_cpu().get_instruction_count()
+                  << ". PC = " << simulator_.get_cpu().get_pc() << "\n";
+  }
+  else if (line == "break" || line == "delete_break") {
+    std::uint32_t address;
+    input_ >> address;
+    input_.ignore();
+    check_arguments(line);
+    if (line == "break") {
+      simulator_.get_cpu().set_breakpoint(address);
+      acknowledge() << "Breakpoint at PC = " << address << "\n";
+    } else {
+      simulator_.get_cpu().remove_breakpoint(address);
+      acknowledge() << "Breakpoint at PC = " << address << " deleted\n";
     }
-    else if (line == "set_pc" || line == "sp") {
-      int pc_value;
-      std::cin >> pc_value;
-      std::cin.ignore();
-      simulator_.get_cpu().set_pc(pc_value);
-      std::cout << "PC = " << pc_value << "\n";
+  }
+  else if (line == "break_if") {
+    std::uint32_t address;
+    int reg;
+    std::string compare;
+    std::uint32_t value;
+    input_ >> address >> reg >> compare >> value;
+    input_.ignore();
+    check_arguments(line);
+    if (reg < 0 || reg >= static_cast<int>(CpuState::kNumberOfRegisters)) {
+      throw std::runtime_error("Invalid register: " + std::to_string(reg));
     }
-    else if (line == "help") {
-      std::cout << "Commands:\n";
-      std::cout << "set_register(sr) - set register (then enter reg number and value)\n";
-      std::cout << "set_pc(sp) - set program counter\n";
-      std::cout << "run_cycle - execute one cycle\n";
-      std::cout << "run_program - run program to completion\n";
-      std::cout << "print_reg - show registers\n";
-      std::cout << "load - load program from file\n";
-      std::cout << "reset - reset all registers and PC to 0\n";
-      std::cout << "exit - quit\n";
+    simulator_.get_cpu().set_breakpoint(
+        address, BreakCondition {static_cast<std::uint8_t>(reg), parse_compare(compare), value});
+    acknowledge() << "Breakpoint at PC = " << address << " if R" << reg << " "
+                  << compare << " " << value << "\n";
+  }
+  else if (line == "watch") {
+    std::uint32_t address;
+    std::string access;
+    input_ >> address >> access;
+    input_.ignore();
+    check_arguments(line);
+    simulator_.get_cpu().set_watchpoint(address, parse_watch_access(access));
+    acknowledge() << "Watchpoint at address " << address << "\n";
+  }
+  else if (line == "delete_watch") {
+    std::uint32_t address;
+    input_ >> address;
+    input_.ignore();
+    check_arguments(line);
+    simulator_.get_cpu().remove_watchpoint(address);
+    acknowledge() << "Watchpoint at address " << address << " deleted\n";
+  }
+  else if (line == "jit") {
+    Cpu& cpu = simulator_.get_cpu();
+    cpu.set_jit_enabled(!cpu.is_jit_enabled());
+    acknowledge() << "JIT " << (cpu.is_jit_enabled() ? "enabled" : "disabled") << "\n";
+  }
+  else if (line == "profile") {
+    Cpu& cpu = simulator_.get_cpu();
+    cpu.set_profiling_enabled(!cpu.is_profiling_enabled());
+    acknowledge() << "Profiling " << (cpu.is_profiling_enabled() ? "enabled" : "disabled") << "\n";
+  }
+  else if (line == "profile_report") {
+    profiler().write_report(output_);
+  }
+  else if (line == "profile_dump") {
+    std::string filename;
+    input_ >> filename;
+    input_.ignore();
+    check_arguments(line);
+    std::ofstream file(filename);
+    if (!file) {
+      throw std::runtime_error("Cannot open file: " + filename);
     }
-    else if (line == "exit") {
-      running_ = false;
+    profiler().write_folded(file);
+    acknowledge() << "Folded stacks written to " << filename << "\n";
+  }
+  else if (line == "timing") {
+    Cpu& cpu = simulator_.get_cpu();
+    cpu.set_timing_enabled(!cpu.is_timing_enabled());
+    acknowledge() << "Pipeline timing " << (cpu.is_timing_enabled() ? "enabled" : "disabled") << "\n";
+  }
+  else if (line == "timing_report") {
+    timing_model().write_report(output_);
+  }
+  else if (line == "cache") {
+    Cpu& cpu = simulator_.get_cpu();
+    cpu.set_cache_enabled(!cpu.is_cache_enabled());
+    acknowledge() << "Cache model " << (cpu.is_cache_enabled() ? "enabled" : "disabled") << "\n";
+  }
+  else if (line == "cache_report") {
+    cache_model().write_report(output_);
+  }
+  else if (line == "predictor") {
+    Cpu& cpu = simulator_.get_cpu();
+    cpu.set_branch_prediction_enabled(!cpu.is_branch_prediction_enabled());
+    acknowledge() << "Branch prediction "
+                  << (cpu.is_branch_prediction_enabled() ? "enabled" : "disabled") << "\n";
+  }
+  else if (line == "predictor_report") {
+    branch_predictor().write_report(output_, simulator_.get_cpu().get_instruction_count());
+  }
+  else if (line == "trace") {
+    std::string filename;
+    input_ >> filename;
+    input_.ignore();
+    check_arguments(line);
+    simulator_.get_cpu().start_trace(filename);
+    acknowledge() << "Tracing run_program to " << filename << "\n";
+  }
+  else if (line == "trace_stop") {
+    simulator_.get_cpu().stop_trace();
+    acknowledge() << "Trace closed\n";
+  }
+  else if (line == "print_reg") {
+    simulator_.get_cpu().print_registers(output_);
+  }
+  else if (line == "load") {
+    std::string filename;
+    input_ >> filename;
+    input_.ignore();
+    check_arguments(line);
+    load_program(filename);
+  }
+  else if (line == "symbols") {
+    for (const Symbol& symbol : symbols_) {
+      output_ << symbol.name << " = " << symbol.address << "\n";
     }
-    else {
-      std::cout << "Unknown command. Type 'help'.\n";
+  }
+  else if (line == "reset") {
+    for (int i = 0; i < 32; i++) {
+      simulator_.get_cpu().set_register(i, 0);
     }
+    simulator_.get_cpu().set_pc(0);
+    time_travel_.state_changed();
+    acknowledge() << "All registers and PC reset to 0\n";
+  }
+  else if (line == "set_pc" || line == "sp") {
+    int pc_value;
+    input_ >> pc_value;
+    input_.ignore();
+    check_arguments(line);
+    simulator_.get_cpu().set_pc(pc_value);
+    time_travel_.state_changed();
+    acknowledge() << "PC = " << pc_value << "\n";
+  }
+  else if (line == "help") {
+    output_ << "Commands:\n";
+    output_ << "set_register(sr) - set register (then enter reg number and value)\n";
+    output_ << "set_pc(sp) - set program counter\n";
+    output_ << "run_cycle - execute one cycle\n";
+    output_ << "run_program - run program to completion or the next breakpoint\n";
+    output_ << "break - stop run_program before the instruction at a PC\n";
+    output_ << "break_if - break only if a register compares (==, !=, <, <=, >, >=) to a value\n";
+    output_ << "delete_break - remove the breakpoint at a PC\n";
+    output_ << "watch - stop run_program after an access (r, w or rw) to an address\n";
+    output_ << "delete_watch - remove the watchpoint at an address\n";
+    output_ << "reverse_step - undo the last instruction\n";
+    output_ << "reverse_continue - go back to the start of the run\n";
+    output_ << "goto - move to the state after the given number of instructions\n";
+    output_ << "jit - toggle native compilation of hot blocks\n";
+    output_ << "profile - toggle instruction profiling of run_program\n";
+    output_ << "profile_report - show hot spots, branches, loops and memory regions\n";
+    output_ << "profile_dump - write folded stacks for flamegraph.pl to a file\n";
+    output_ << "timing - toggle the five stage pipeline timing model\n";
+    output_ << "timing_report - show cycles, CPI and stall cycles per cause\n";
+    output_ << "cache - toggle the L1I/L1D/L2 cache model\n";
+    output_ << "cache_report - show hits, misses and evictions per level and PC\n";
+    output_ << "predictor - toggle the gshare branch predictor\n";
+    output_ << "predictor_report - show mispredictions, MPKI and the worst branches\n";
+    output_ << "trace - write a binary trace of run_program to a file\n";
+    output_ << "trace_stop - finish the trace file\n";
+    output_ << "print_reg - show registers\n";
+    output_ << "load - load program from file, .s files are assembled\n";
+    output_ << "symbols - show the labels of the assembled program\n";
+    output_ << "reset - reset all registers and PC to 0\n";
+    output_ << "exit - quit\n";
+  }
+  else if (line == "exit") {
+    running_ = false;
+  }
+  else if (!interactive_ && (line.empty() || line[0] == '#')) {
+    return;
+  }
+  else if (interactive_) {
+    output_ << "Unknown command. Type 'help'.\n";
+  }
+  else {
+    throw std::runtime_error("Unknown command: " + line);
+  }
+}
+
+void InteractiveSimulator::report_stop(StopReason reason) {
+  const Cpu& cpu = simulator_.get_cpu();
+  if (reason == StopReason::kBreakpoint) {
+    acknowledge() << "Breakpoint at PC = " << cpu.get_pc() << location(cpu.get_pc()) << "\n";
+  } else if (reason == StopReason::kWatchpoint) {
+    const WatchpointHit& hit = cpu.get_watchpoint_hit();
+    acknowledge() << "Watchpoint at address " << hit.address
+                  << (hit.write ? " written" : " read")
+                  << " by PC = " << hit.program_counter << location(hit.program_counter)
+                  << ". PC = " << cpu.get_pc() << "\n";
+  } else {
+    acknowledge() << "Program executed.\n";
+  }
+}
+
+std::string InteractiveSimulator::location(std::uint32_t program_counter) const {
+  return symbols_.empty() ? "" : " (" + symbolize(symbols_, program_counter) + ")";
+}
+
+const Profiler& InteractiveSimulator::profiler() {
+  const Profiler* profiler = simulator_.get_cpu().get_profiler();
+  if (profiler == nullptr) {
+    throw std::runtime_error("Profiling is disabled, enable it with 'profile'");
+  }
+  return *profiler;
+}
+
+const PipelineModel& InteractiveSimulator::timing_model() {
+  const PipelineModel* model = simulator_.get_cpu().get_timing_model();
+  if (model == nullptr) {
+    throw std::runtime_error("Pipeline timing is disabled, enable it with 'timing'");
+  }
+  return *model;
+}
+
+const CacheHierarchy& InteractiveSimulator::cache_model() {
+  const CacheHierarchy* model = simulator_.get_cpu().get_cache_model();
+  if (model == nullptr) {
+    throw std::runtime_error("Cache model is disabled, enable it with 'cache'");
+  }
+  return *model;
+}
+
+const BranchPredictor& InteractiveSimulator::branch_predictor() {
+  const BranchPredictor* predictor = simulator_.get_cpu().get_branch_predictor();
+  if (predictor == nullptr) {
+    throw std::runtime_error("Branch prediction is disabled, enable it with 'predictor'");
   }
+  return *predictor;
 }
 
 void InteractiveSimulator::load_program(const std::string& filename) {
+  if (is_assembly_file(filename)) {
+    AssembledProgram program = assemble_file(filename);
+    simulator_.load_program(program.image);
+    symbols_ = std::move(program.symbols);
+    time_travel_.state_changed();
+    acknowledge() << "Program assembled: " << program.image.size() << " bytes, "
+                  << symbols_.size() << " labels\n";
+    return;
+  }
+
   std::ifstream file(filename, std::ios::binary);
   if (!file) {
-    std::cout << "Cannot open file: " << filename << "\n";
+    if (!interactive_) {
+      throw std::runtime_error("Cannot open file: " + filename);
+    }
+    output_ << "Cannot open file: " << filename << "\n";
     return;
   }
 
@@ -87,6 +402,8 @@ void InteractiveSimulator::load_program(const std::string& filename) {
   );
 
   simulator_.load_program(program);
-  std::cout << "Program loaded: " << program.size() << " bytes\n";
-} 
+  symbols_.clear();
+  time_travel_.state_changed();
+  acknowledge() << "Program loaded: " << program.size() << " bytes\n";
+}
 } // namespace simulator
@@ -0,0 +1,391 @@
+#include "jit_compiler.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <numeric>
+
+#include "alu_kernels.hpp"
+#include "bit_shifts.hpp"
+#include "cpu.hpp"
+#include "opcodes.hpp"
+
+namespace simulator {
+
+namespace {
+  using x86::Register;
+
+  constexpr std::array<Register, 4> kPinnedHostRegisters = {
+      x86::kRbx, x86::kRbp, x86::kR12, x86::kR13};
+  constexpr std::array<Register, 6> kCalleeSavedRegisters = {
+      x86::kRbx, x86::kRbp, x86::kR12, x86::kR13, x86::kR14, x86::kR15};
+
+  constexpr Register kContextRegister = x86::kR14;
+  constexpr Register kRegistersBase = x86::kR15;
+
+  // Keeps the stack 16-byte aligned at helper calls after six pushes.
+  constexpr std::int8_t kStackAdjustment = 8;
+
+  constexpr std::int8_t kNotPinned = -1;
+  constexpr std::uint32_t kInstructionSize = 4;
+  constexpr std::uint32_t kBitsInWord = 32;
+  constexpr std::int8_t kHighestBitIndex = 31;
+
+  std::int8_t register_offset(std::uint8_t guest) {
+    return static_cast<std::int8_t>(guest * sizeof(std::uint32_t));
+  }
+
+  std::int8_t context_offset(std::size_t offset) {
+    return static_cast<std::int8_t>(offset);
+  }
+} // namespace
+
+JitCompiler::JitCompiler(Cpu& cpu)
+  : context_{cpu.registers_.data(), &cpu.memory_, &cpu.block_cache_, {0, 0}, 0, 0},
+    arena_(kArenaSize),
+    arena_flush_count_(cpu.block_cache_.flush_count()) {}
+
+bool JitCompiler::is_supported() {
+#if defined(__x86_64__) && !defined(_WIN32)
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool JitCompiler::prepare(BasicBlock& block) {
+  if (block.native_code != nullptr) {
+    return true;
+  }
+  if (++block.execution_count != kHotThreshold) {
+    return false;
+  }
+
+  block.native_code = compile(block);
+  return block.native_code != nullptr;
+}
+
+NativeBlock JitCompiler::compile(const BasicBlock& block) {
+  // Every block holding native code was discarded by the last flush, so
+  // the whole arena can be reused.
+  if (context_.block_cache->flush_count() != arena_flush_count_) {
+    arena_.reset();
+    arena_flush_count_ = context_.block_cache->flush_count();
+  }
+
+  std::vector<GuestInstruction> instructions = flatten(block);
+  if (instructions.front().second.opcode == opcodes::kSYSCALL) {
+    return nullptr;
+  }
+
+  emitter_ = x86::Emitter();
+  epilogue_jumps_.clear();
+  pin_registers(instructions);
+  emit_prologue();
+  block_start_ = block.start_address;
+  loop_head_ = emitter_.size();
+
+  bool terminated = false;
+  for (std::uint32_t i = 0; i < instructions.size() && !terminated; ++i) {
+    terminated = emit_instruction(instructions[i], i);
+  }
+  if (!terminated) {
+    emit_exit(block.end_address, instructions.size());
+  }
+
+  for (x86::Fixup fixup : epilogue_jumps_) {
+    emitter_.bind(fixup);
+  }
+  emitter_.add_rsp(kStackAdjustment);
+  for (auto it = kCalleeSavedRegisters.rbegin(); it != kCalleeSavedRegisters.rend(); ++it) {
+    emitter_.pop(*it);
+  }
+  emitter_.ret();
+
+  const void* code = arena_.add(emitter_.code());
+  if (code == nullptr) {
+    context_.block_cache->request_flush();
+    return nullptr;
+  }
+  return reinterpret_cast<NativeBlock>(const_cast<void*>(code));
+}
+
+std::vector<JitCompiler::GuestInstruction> JitCompiler::flatten(const BasicBlock& block) {
+  std::vector<GuestInstruction> instructions;
+  for (const MicroOp& op : block.ops) {
+    instructions.emplace_back(op.program_counter, op.first);
+    if (op.kind >= micro_ops::kAddAdd) {
+      instructions.emplace_back(op.program_counter + kInstructionSize, op.second);
+    }
+  }
+  return instructions;
+}
+
+void JitCompiler::pin_registers(const std::vector<GuestInstruction>& instructions) {
+  std::array<std::uint32_t, kNumberOfGuestRegisters> uses = {};
+  for (const auto& [program_counter, instruction] : instructions) {
+    ++uses[instruction.rd];
+    ++uses[instruction.rs];
+    ++uses[instruction.rt];
+  }
+
+  std::array<std::uint8_t, kNumberOfGuestRegisters> order;
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&uses](std::uint8_t lhs, std::uint8_t rhs) {
+                     return uses[lhs] > uses[rhs];
+                   });
+
+  pinned_.fill(kNotPinned);
+  for (std::size_t i = 0; i < kNumberOfPinnedRegisters; ++i) {
+    if (uses[order[i]] < 2) {
+      break;
+    }
+    pinned_[order[i]] = static_cast<std::int8_t>(i);
+  }
+}
+
+void JitCompiler::emit_prologue() {
+  for (Register reg : kCalleeSavedRegisters) {
+    emitter_.push(reg);
+  }
+  emitter_.sub_rsp(kStackAdjustment);
+
+  emitter_.mov64(kContextRegister, x86::kRdi);
+  emitter_.mov64(kRegistersBase, kContextRegister,
+                 context_offset(offsetof(JitContext, registers)));
+
+  for (std::uint8_t guest = 0; guest < kNumberOfGuestRegisters; ++guest) {
+    if (pinned_[guest] != kNotPinned) {
+      emitter_.mov(kPinnedHostRegisters[pinned_[guest]], kRegistersBase,
+                   register_offset(guest));
+    }
+  }
+}
+
+// Jumps back to the top of the block while the loop budget lasts, falls
+// through once it is exhausted.
+void JitCompiler::emit_loop_back(std::uint32_t retired) {
+  emitter_.add64(kContextRegister, context_offset(offsetof(JitContext, retired)),
+                 static_cast<std::int8_t>(retired));
+  emitter_.sub(kContextRegister, context_offset(offsetof(JitContext, loop_budget)), 1);
+  emitter_.bind(emitter_.jcc(x86::kNotEqual), loop_head_);
+  emitter_.add64(kContextRegister, context_offset(offsetof(JitContext, retired)),
+                 static_cast<std::int8_t>(-static_cast<std::int32_t>(retired)));
+}
+
+void JitCompiler::emit_exit(std::uint32_t next_program_counter,
+                            std::uint32_t retired) {
+  for (std::uint8_t guest = 0; guest < kNumberOfGuestRegisters; ++guest) {
+    if (pinned_[guest] != kNotPinned) {
+      emitter_.mov(kRegistersBase, register_offset(guest),
+                   kPinnedHostRegisters[pinned_[guest]]);
+    }
+  }
+  emitter_.mov64(x86::kRax,
+                 (static_cast<std::uint64_t>(retired) << kBitsInWord) | next_program_counter);
+  epilogue_jumps_.push_back(emitter_.jmp());
+}
+
+void JitCompiler::emit_load_guest(Register dst, std::uint8_t guest) {
+  if (pinned_[guest] != kNotPinned) {
+    emitter_.mov(dst, kPinnedHostRegisters[pinned_[guest]]);
+  } else {
+    emitter_.mov(dst, kRegistersBase, register_offset(guest));
+  }
+}
+
+void JitCompiler::emit_store_guest(std::uint8_t guest, Register src) {
+  if (pinned_[guest] != kNotPinned) {
+    emitter_.mov(kPinnedHostRegisters[pinned_[guest]], src);
+  } else {
+    emitter_.mov(kRegistersBase, register_offset(guest), src);
+  }
+}
+
+void JitCompiler::emit_call(const void* function) {
+  emitter_.mov64(x86::kRax, reinterpret_cast<std::uint64_t>(function));
+  emitter_.call(x86::kRax);
+}
+
+// Returns true when the instruction ends the native block.
+bool JitCompiler::emit_instruction(const GuestInstruction& guest_instruction,
+                                   std::uint32_t index) {
+  const auto& [program_counter, instruction] = guest_instruction;
+  std::uint32_t pc = static_cast<std::uint32_t>(program_counter);
+  std::uint32_t next_pc = pc + kInstructionSize;
+
+  auto write_result = [this, &instruction](Register src) {
+    if (instruction.rd != 0) {
+      emit_store_guest(instruction.rd, src);
+    }
+  };
+
+  auto emit_fault_check = [this, pc, index]() {
+    emitter_.test(x86::kRax, x86::kRax);
+    x86::Fixup ok = emitter_.jcc(x86::kEqual);
+    emit_exit(pc, index);
+    emitter_.bind(ok);
+  };
+
+  auto emit_address = [this, &instruction]() {
+    emitter_.mov64(x86::kRdi, kContextRegister);
+    emit_load_guest(x86::kRsi, instruction.rs);
+    emitter_.add(x86::kRsi, static_cast<std::uint32_t>(instruction.imm));
+  };
+
+  switch (instruction.opcode) {
+    case opcodes::kNOR:
+    case opcodes::kADD:
+    case opcodes::kXOR:
+      emit_load_guest(x86::kRax, instruction.rs);
+      emit_load_guest(x86::kRcx, instruction.rt);
+      if (instruction.opcode == opcodes::kADD) {
+        emitter_.add(x86::kRax, x86::kRcx);
+      } else if (instruction.opcode == opcodes::kXOR) {
+        emitter_.xor_(x86::kRax, x86::kRcx);
+      } else {
+        emitter_.or_(x86::kRax, x86::kRcx);
+        emitter_.not_(x86::kRax);
+      }
+      write_result(x86::kRax);
+      return false;
+
+    case opcodes::kCBIT:
+      emit_load_guest(x86::kRax, instruction.rs);
+      emitter_.and_(x86::kRax, ~(1U << instruction.imm));
+      write_result(x86::kRax);
+      return false;
+
+    case opcodes::kSSAT:
+      emit_load_guest(x86::kRdi, instruction.rs);
+      emitter_.mov(x86::kRsi, static_cast<std::uint32_t>(instruction.imm));
+      emit_call(reinterpret_cast<const void*>(&JitCompiler::saturate_signed));
+      write_result(x86::kRax);
+      return false;
+
+    case opcodes::kCLZ: {
+      emit_load_guest(x86::kRcx, instruction.rs);
+      emitter_.test(x86::kRcx, x86::kRcx);
+      emitter_.mov(x86::kRax, kBitsInWord);
+      x86::Fixup zero = emitter_.jcc(x86::kEqual);
+      emitter_.bsr(x86::kRax, x86::kRcx);
+      emitter_.xor_(x86::kRax, kHighestBitIndex);
+      emitter_.bind(zero);
+      write_result(x86::kRax);
+      return false;
+    }
+
+    case opcodes::kBDEP:
+      emit_load_guest(x86::kRdi, instruction.rs);
+      emit_load_guest(x86::kRsi, instruction.rt);
+      emit_call(reinterpret_cast<const void*>(alu::bit_deposit_kernel()));
+      write_result(x86::kRax);
+      return false;
+
+    case opcodes::kLD:
+      emit_address();
+      emit_call(reinterpret_cast<const void*>(&JitCompiler::load));
+      emit_fault_check();
+      emitter_.mov(x86::kRax, kContextRegister,
+                   context_offset(offsetof(JitContext, load_values)));
+      write_result(x86::kRax);
+      return false;
+
+    case opcodes::kLDP:
+      emit_address();
+      emit_call(reinterpret_cast<const void*>(&JitCompiler::load_pair));
+      emit_fault_check();
+      emitter_.mov(x86::kRax, kContextRegister,
+                   context_offset(offsetof(JitContext, load_values)));
+      emitter_.mov(x86::kRcx, kContextRegister,
+                   context_offset(offsetof(JitContext, load_values) + sizeof(std::uint32_t)));
+      emit_store_guest(instruction.rd, x86::kRax);
+      emit_store_guest(instruction.rt, x86::kRcx);
+      return false;
+
+    case opcodes::kST: {
+      emit_load_guest(x86::kRdx, instruction.rt);
+      emit_address();
+      emit_call(reinterpret_cast<const void*>(&JitCompiler::store));
+      emitter_.test(x86::kRax, x86::kRax);
+      x86::Fixup ok = emitter_.jcc(x86::kEqual);
+      emitter_.cmp(x86::kRax, static_cast<std::int8_t>(kFault));
+      x86::Fixup code_modified = emitter_.jcc(x86::kNotEqual);
+      emit_exit(pc, index);
+      emitter_.bind(code_modified);
+      emit_exit(next_pc, index + 1);
+      emitter_.bind(ok);
+      return false;
+    }
+
+    case opcodes::kBEQ:
+    case opcodes::kBNE: {
+      emit_load_guest(x86::kRax, instruction.rs);
+      emit_load_guest(x86::kRcx, instruction.rt);
+      emitter_.cmp(x86::kRax, x86::kRcx);
+      x86::Condition taken_condition =
+          instruction.opcode == opcodes::kBEQ ? x86::kEqual : x86::kNotEqual;
+      x86::Fixup taken = emitter_.jcc(taken_condition);
+      emit_exit(next_pc, index + 1);
+      emitter_.bind(taken);
+      std::uint32_t target = pc + instruction.imm;
+      if (target == block_start_) {
+        emit_loop_back(index + 1);
+      }
+      emit_exit(target, index + 1);
+      return true;
+    }
+
+    case opcodes::kJj: {
+      std::uint32_t target = (pc & shifts::kFirst4BitsMask) | instruction.imm;
+      if (target == block_start_) {
+        emit_loop_back(index + 1);
+      }
+      emit_exit(target, index + 1);
+      return true;
+    }
+
+    case opcodes::kSYSCALL:
+      emit_exit(pc, index);
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+std::uint32_t JitCompiler::load(JitContext* context, std::uint32_t address) {
+  try {
+    context->load_values[0] = context->memory->read_word(address);
+  } catch (const std::exception&) {
+    return kFault;
+  }
+  return kOk;
+}
+
+std::uint32_t JitCompiler::load_pair(JitContext* context, std::uint32_t address) {
+  try {
+    context->load_values[0] = context->memory->read_word(address);
+    context->load_values[1] = context->memory->read_word(address + kInstructionSize);
+  } catch (const std::exception&) {
+    return kFault;
+  }
+  return kOk;
+}
+
+std::uint32_t JitCompiler::store(JitContext* context, std::uint32_t address,
+                                 std::uint32_t value) {
+  try {
+    context->memory->write_word(address, value);
+  } catch (const std::exception&) {
+    return kFault;
+  }
+  return context->block_cache->flush_pending() ? kCodeModified : kOk;
+}
+
+std::uint32_t JitCompiler::saturate_signed(std::uint32_t value, std::uint32_t number) {
+  return Cpu::saturate_signed(value, number);
+}
+
+} // namespace simulator
@@ -0,0 +1,364 @@
+#include "job_farm.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "simulator.hpp"
+
+namespace simulator {
+
+namespace {
+
+class WorkQueue {
+ public:
+  void push(std::size_t job) {
+    jobs_.push_back(job);
+  }
+
+  std::optional<std::size_t> pop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (jobs_.empty()) {
+      return std::nullopt;
+    }
+    std::size_t job = jobs_.front();
+    jobs_.pop_front();
+    return job;
+  }
+
+  std::optional<std::size_t> steal() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (jobs_.empty()) {
+      return std::nullopt;
+    }
+    std::size_t job = jobs_.back();
+    jobs_.pop_back();
+    return job;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::deque<std::size_t> jobs_;
+};
+
+// Jobs are never added once workers start, so a full pass over the other
+// queues that finds nothing means the farm is drained.
+std::optional<std::size_t> next_job(std::vector<WorkQueue>& queues,
+                                    std::size_t worker) {
+  if (auto job = queues[worker].pop()) {
+    return job;
+  }
+  for (std::size_t i = 1; i < queues.size(); ++i) {
+    if (auto job = queues[(worker + i) % queues.size()].steal()) {
+      return job;
+    }
+  }
+  return std::nullopt;
+}
+
+std::int64_t parse_number(const std::string& text, const std::string& line) {
+  try {
+    std::size_t parsed = 0;
+    long long value = std::stoll(text, &parsed, 0);
+    if (parsed != text.size()) {
+      throw std::invalid_argument(text);
+    }
+    return value;
+  } catch (const std::logic_error&) {
+    throw std::runtime_error("Invalid value '" + text + "' in job: " + line);
+  }
+}
+
+std::uint32_t parse_value(const std::string& text, const std::string& line) {
+  return static_cast<std::uint32_t>(parse_number(text, line));
+}
+
+enum class Target {
+  kRegister,
+  kMemory,
+  kProgramCounter,
+};
+
+struct Assignment {
+  Target kind;
+  std::uint32_t target;
+  std::uint32_t first;
+  std::uint32_t last;
+};
+
+Assignment parse_assignment(const std::string& token, const std::string& line) {
+  std::size_t equals = token.find('=');
+  if (equals == std::string::npos || equals == 0) {
+    throw std::runtime_error("Expected <target>=<value> in job: " + line);
+  }
+  std::string target = token.substr(0, equals);
+  std::string value = token.substr(equals + 1);
+
+  Assignment assignment {};
+  if (target == "PC" || target == "pc") {
+    assignment.kind = Target::kProgramCounter;
+  } else if (target[0] == 'R' || target[0] == 'r') {
+    assignment.kind = Target::kRegister;
+    assignment.target = parse_value(target.substr(1), line);
+    if (assignment.target >= JobResult::kNumberOfRegisters) {
+      throw std::runtime_error("Invalid register '" + target + "' in job: " + line);
+    }
+  } else if (target[0] == 'M' || target[0] == 'm') {
+    assignment.kind = Target::kMemory;
+    assignment.target = parse_value(target.substr(1), line);
+  } else {
+    throw std::runtime_error("Unknown target '" + target + "' in job: " + line);
+  }
+
+  std::size_t range = value.find("..");
+  if (range == std::string::npos) {
+    assignment.first = parse_value(value, line);
+    assignment.last = assignment.first;
+  } else {
+    std::int64_t first = parse_number(value.substr(0, range), line);
+    std::int64_t last = parse_number(value.substr(range + 2), line);
+    if (last < first) {
+      throw std::runtime_error("Empty range '" + value + "' in job: " + line);
+    }
+    assignment.first = static_cast<std::uint32_t>(first);
+    assignment.last = static_cast<std::uint32_t>(last);
+  }
+  return assignment;
+}
+
+void apply(JobConfig& config, const Assignment& assignment, std::uint32_t value) {
+  switch (assignment.kind) {
+    case Target::kRegister:
+      config.registers.emplace_back(assignment.target, value);
+      break;
+    case Target::kMemory:
+      config.memory_words.emplace_back(assignment.target, value);
+      break;
+    case Target::kProgramCounter:
+      config.program_counter = value;
+      break;
+  }
+}
+
+// Odometer over the ranges; the last assignment varies fastest.
+void expand(const std::vector<Assignment>& assignments,
+            std::vector<JobConfig>& jobs) {
+  std::vector<std::uint32_t> values;
+  for (const Assignment& assignment : assignments) {
+    values.push_back(assignment.first);
+  }
+
+  while (true) {
+    JobConfig config;
+    for (std::size_t i = 0; i < assignments.size(); ++i) {
+      apply(config, assignments[i], values[i]);
+    }
+    jobs.push_back(std::move(config));
+
+    std::size_t i = assignments.size();
+    while (i > 0 && values[i - 1] == assignments[i - 1].last) {
+      values[i - 1] = assignments[i - 1].first;
+      --i;
+    }
+    if (i == 0) {
+      return;
+    }
+    ++values[i - 1];
+  }
+}
+
+const char* to_string(JobStatus status) {
+  switch (status) {
+    case JobStatus::kExited:
+      return "exited";
+    case JobStatus::kFaulted:
+      return "faulted";
+    case JobStatus::kLimit:
+      return "limit";
+  }
+  return "unknown";
+}
+
+} // namespace
+
+JobFarm::JobFarm(std::vector<std::uint8_t> program, std::size_t memory_size,
+                 std::size_t threads, std::uint64_t max_instructions)
+  : program_(std::move(program)),
+    memory_size_(memory_size),
+    threads_(threads != 0 ? threads
+                          : std::max(1U, std::thread::hardware_concurrency())),
+    max_instructions_(max_instructions) {
+  if (memory_size_ > Memory::kAddressSpaceSize) {
+    throw std::range_error("Memory size exceeds the address space: "
+                           + std::to_string(memory_size_));
+  }
+}
+
+JobResult JobFarm::run_job(std::size_t index, const JobConfig& config) const {
+  auto simulator = std::make_unique<Simulator>(memory_size_);
+  return run_job(*simulator, nullptr, index, config);
+}
+
+JobResult JobFarm::run_job(Simulator& simulator,
+                           const std::shared_ptr<const Snapshot>& loaded,
+                           std::size_t index, const JobConfig& config) const {
+  Cpu& cpu = simulator.get_cpu();
+
+  JobResult result {};
+  result.job = index;
+  result.status = JobStatus::kExited;
+  try {
+    if (loaded) {
+      simulator.restore(loaded);
+    } else {
+      simulator.load_program(program_);
+    }
+    for (const auto& [address, word] : config.memory_words) {
+      simulator.get_memory().write_word(address, word);
+    }
+    for (const auto& [reg, value] : config.registers) {
+      cpu.set_register(reg, value);
+    }
+    cpu.set_pc(config.program_counter);
+    if (cpu.run_program(max_instructions_) != StopReason::kExited) {
+      result.status = JobStatus::kLimit;
+    }
+  } catch (const std::exception& error) {
+    result.status = JobStatus::kFaulted;
+    result.fault = error.what();
+  }
+
+  result.program_counter = cpu.get_pc();
+  result.instruction_count = cpu.get_instruction_count();
+  for (std::size_t i = 0; i < JobResult::kNumberOfRegisters; ++i) {
+    result.registers[i] = cpu.get_register(static_cast<std::uint8_t>(i));
+  }
+  return result;
+}
+
+void JobFarm::run(const std::vector<JobConfig>& jobs,
+                  const ResultSink& sink) const {
+  std::size_t workers = std::min(threads_, jobs.size());
+  if (workers == 0) {
+    return;
+  }
+
+  std::vector<WorkQueue> queues(workers);
+  for (std::size_t job = 0; job < jobs.size(); ++job) {
+    queues[job * workers / jobs.size()].push(job);
+  }
+
+  // The first exception of any worker, reported once every thread is joined.
+  std::mutex sink_mutex;
+  std::exception_ptr error;
+  auto work = [&](std::size_t worker) {
+    std::unique_ptr<Simulator> simulator;
+    try {
+      simulator = std::make_unique<Simulator>(memory_size_);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(sink_mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      return;
+    }
+    std::shared_ptr<const Snapshot> loaded;
+    try {
+      simulator->load_program(program_);
+      loaded = simulator->checkpoint();
+    } catch (const std::exception&) {
+      // Every job reports the failure when it loads the program itself.
+    }
+
+    while (auto job = next_job(queues, worker)) {
+      JobResult result = run_job(*simulator, loaded, *job, jobs[*job]);
+
+      std::lock_guard<std::mutex> lock(sink_mutex);
+      if (error) {
+        return;
+      }
+      try {
+        sink(result);
+      } catch (...) {
+        error = std::current_exception();
+        return;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  // Joins on every exit, so a failed thread start never leaves a joinable
+  // thread behind.
+  struct JoinGuard {
+    std::vector<std::thread>& threads;
+    ~JoinGuard() {
+      for (std::thread& thread : threads) {
+        thread.join();
+      }
+    }
+  };
+  {
+    JoinGuard guard {threads};
+    for (std::size_t worker = 1; worker < workers; ++worker) {
+      threads.emplace_back(work, worker);
+    }
+    work(0);
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void JobFarm::run(const std::vector<JobConfig>& jobs,
+                  std::ostream& output) const {
+  run(jobs, [&output](const JobResult& result) {
+    write_job_result(output, result);
+  });
+  output.flush();
+}
+
+std::vector<JobConfig> parse_jobs(std::istream& input) {
+  std::vector<JobConfig> jobs;
+  std::string line;
+  while (std::getline(input, line)) {
+    std::istringstream tokens(line);
+    std::string token;
+    std::vector<Assignment> assignments;
+    while (tokens >> token) {
+      if (assignments.empty() && token[0] == '#') {
+        break;
+      }
+      assignments.push_back(parse_assignment(token, line));
+    }
+    if (!assignments.empty()) {
+      expand(assignments, jobs);
+    }
+  }
+  return jobs;
+}
+
+void write_job_result(std::ostream& output, const JobResult& result) {
+  std::ostringstream line;
+  line << "job=" << result.job
+       << " status=" << to_string(result.status)
+       << " pc=0x" << std::hex << result.program_counter << std::dec
+       << " instructions=" << result.instruction_count;
+  for (std::size_t i = 0; i < JobResult::kNumberOfRegisters; ++i) {
+    line << " r" << i << "=0x" << std::hex << result.registers[i] << std::dec;
+  }
+  if (result.status == JobStatus::kFaulted) {
+    line << " fault=\"" << result.fault << "\"";
+  }
+  line << "\n";
+  output << line.str();
+}
+
+} // namespace simulator
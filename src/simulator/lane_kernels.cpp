@@ -0,0 +1,126 @@
+#include "lane_kernels.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+#define SIMULATOR_LANE_KERNEL \
+  __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define SIMULATOR_LANE_KERNEL
+#endif
+
+namespace simulator::lanes {
+
+// Destination registers may alias sources lane for lane, so only masks and
+// program counters are declared __restrict.
+namespace {
+
+  inline std::uint32_t blend(std::uint32_t result, std::uint32_t old,
+                             std::uint32_t mask) {
+    return (result & mask) | (old & ~mask);
+  }
+} // namespace
+
+SIMULATOR_LANE_KERNEL
+void add(std::uint32_t* dst, const std::uint32_t* lhs,
+         const std::uint32_t* rhs, const std::uint32_t* __restrict mask,
+         std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    dst[i] = blend(lhs[i] + rhs[i], dst[i], mask[i]);
+  }
+}
+
+SIMULATOR_LANE_KERNEL
+void bitwise_xor(std::uint32_t* dst, const std::uint32_t* lhs,
+                 const std::uint32_t* rhs, const std::uint32_t* __restrict mask,
+                 std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    dst[i] = blend(lhs[i] ^ rhs[i], dst[i], mask[i]);
+  }
+}
+
+SIMULATOR_LANE_KERNEL
+void bitwise_nor(std::uint32_t* dst, const std::uint32_t* lhs,
+                 const std::uint32_t* rhs, const std::uint32_t* __restrict mask,
+                 std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    dst[i] = blend(~(lhs[i] | rhs[i]), dst[i], mask[i]);
+  }
+}
+
+SIMULATOR_LANE_KERNEL
+void bitwise_and(std::uint32_t* dst, const std::uint32_t* src,
+                 std::uint32_t value, const std::uint32_t* __restrict mask,
+                 std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    dst[i] = blend(src[i] & value, dst[i], mask[i]);
+  }
+}
+
+SIMULATOR_LANE_KERNEL
+void count_leading_zeros(std::uint32_t* dst, const std::uint32_t* src,
+                         const std::uint32_t* __restrict mask,
+                         std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    std::uint32_t zeros = static_cast<std::uint32_t>(std::countl_zero(src[i]));
+    dst[i] = blend(zeros, dst[i], mask[i]);
+  }
+}
+
+SIMULATOR_LANE_KERNEL
+std::uint32_t masked_min(const std::uint32_t* __restrict values,
+                         const std::uint32_t* __restrict mask,
+                         std::size_t count) {
+  std::uint32_t result = UINT32_MAX;
+  for (std::size_t i = 0; i < count; ++i) {
+    result = std::min(result, values[i] | ~mask[i]);
+  }
+  return result;
+}
+
+SIMULATOR_LANE_KERNEL
+std::size_t select_equal(std::uint32_t* __restrict mask,
+                         const std::uint32_t* __restrict values,
+                         std::uint32_t value,
+                         const std::uint32_t* __restrict enabled,
+                         std::size_t count) {
+  std::size_t selected = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    std::uint32_t equal = values[i] == value ? UINT32_MAX : 0;
+    mask[i] = equal & enabled[i];
+    selected += mask[i] & 1;
+  }
+  return selected;
+}
+
+SIMULATOR_LANE_KERNEL
+void branch(std::uint32_t* __restrict program_counters, const std::uint32_t* lhs,
+            const std::uint32_t* rhs, bool branch_if_equal,
+            std::uint32_t taken_target, std::uint32_t fallthrough,
+            const std::uint32_t* __restrict mask, std::size_t count) {
+  std::uint32_t on_equal = branch_if_equal ? taken_target : fallthrough;
+  std::uint32_t on_not_equal = branch_if_equal ? fallthrough : taken_target;
+  for (std::size_t i = 0; i < count; ++i) {
+    std::uint32_t target = lhs[i] == rhs[i] ? on_equal : on_not_equal;
+    program_counters[i] = blend(target, program_counters[i], mask[i]);
+  }
+}
+
+SIMULATOR_LANE_KERNEL
+void assign(std::uint32_t* dst, std::uint32_t value,
+            const std::uint32_t* __restrict mask, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    dst[i] = blend(value, dst[i], mask[i]);
+  }
+}
+
+SIMULATOR_LANE_KERNEL
+void increment(std::uint64_t* __restrict counters,
+               const std::uint32_t* __restrict mask, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    counters[i] += mask[i] & 1;
+  }
+}
+
+} // namespace simulator::lanes
@@ -1,10 +1,284 @@
+#include <algorithm>
 #include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "aot_translator.hpp"
+#include "assembler.hpp"
+#include "headless_runner.hpp"
 #include "interactive_simulator.hpp"
+#include "job_farm.hpp"
+#include "memory.hpp"
+#include "state_report.hpp"
+#include "trace_reader.hpp"
 
-constexpr std::size_t kInitialMemSize = 2048;
+// The whole 32-bit address space; pages are only backed once touched.
+constexpr std::size_t kInitialMemSize = simulator::Memory::kAddressSpaceSize;
+
+namespace {
+
+// Assembles .s files, other files are program images.
+bool read_file(const char* path, std::vector<std::uint8_t>& bytes) {
+  if (simulator::is_assembly_file(path)) {
+    try {
+      bytes = simulator::assemble_file(path).image;
+      return true;
+    } catch (const std::exception& error) {
+      std::cerr << error.what() << "\n";
+      return false;
+    }
+  }
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cerr << "Cannot open file: " << path << "\n";
+    return false;
+  }
+  bytes.assign(std::istreambuf_iterator<char>(file),
+               std::istreambuf_iterator<char>());
+  return true;
+}
+
+int run_headless(int argc, char* argv[]) {
+  simulator::RunOptions options;
+  try {
+    options = simulator::parse_run_options({argv + 2, argv + argc});
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << "\n"
+              << "Usage: " << argv[0] << " run <program.bin> [--reg <n>=<value>]..."
+              << " [--mem <addr>=<value>]... [--pc <value>] [--max-insns <n>]"
+              << " [--engine staged|threaded|block] [--jit]"
+              << " [--trapping|--unchecked] [--json|--csv]"
+              << " [--profile <report.txt>] [--folded <stacks.folded>]"
+              << " [--trace <file>] [--timing <report.txt>] [--no-forwarding]"
+              << " [--sample <period>,<warmup>,<window>] [--sample-seed <n>]"
+              << " [--cache <report.txt>]"
+              << " [--cache-level l1i|l1d|l2=<size>,<ways>,<line>[,lru|plru|random][,wb|wt]]..."
+              << " [--predictor not-taken|bimodal|gshare|tage] [--branches <report.txt>]\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::uint8_t> program;
+  if (!read_file(options.program_path.c_str(), program)) {
+    return EXIT_FAILURE;
+  }
+
+  try {
+    simulator::StateReport report =
+        simulator::run_headless(program, options, kInitialMemSize);
+    simulator::write_report(std::cout, report, options.format);
+    return report.status == "faulted" ? EXIT_FAILURE : EXIT_SUCCESS;
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << "\n";
+    return EXIT_FAILURE;
+  }
+}
+
+int run_script(int argc, char* argv[]) {
+  simulator::ReportFormat format = simulator::ReportFormat::kText;
+  if (argc == 4 && std::string(argv[3]) == "--json") {
+    format = simulator::ReportFormat::kJson;
+  } else if (argc == 4 && std::string(argv[3]) == "--csv") {
+    format = simulator::ReportFormat::kCsv;
+  } else if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " script <commands.txt> [--json|--csv]\n";
+    return EXIT_FAILURE;
+  }
+
+  std::ifstream commands(argv[2]);
+  if (!commands) {
+    std::cerr << "Cannot open file: " << argv[2] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  simulator::InteractiveSimulator replay(kInitialMemSize, commands, std::cout);
+  const simulator::Cpu& cpu = replay.get_simulator().get_cpu();
+  try {
+    replay.start();
+  } catch (const std::exception& error) {
+    simulator::write_report(std::cout,
+        simulator::StateReport::capture(cpu, "faulted", error.what()), format);
+    return EXIT_FAILURE;
+  }
+  simulator::write_report(std::cout,
+      simulator::StateReport::capture(cpu, "completed"), format);
+  return EXIT_SUCCESS;
+}
+
+int run_farm(int argc, char* argv[]) {
+  if (argc < 5 || argc > 7) {
+    std::cerr << "Usage: " << argv[0]
+              << " farm <program.bin> <jobs.txt> <results.txt> [threads] [max-insns]\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::uint8_t> program;
+  if (!read_file(argv[2], program)) {
+    return EXIT_FAILURE;
+  }
+
+  std::ifstream jobs_file(argv[3]);
+  if (!jobs_file) {
+    std::cerr << "Cannot open file: " << argv[3] << "\n";
+    return EXIT_FAILURE;
+  }
+  std::ofstream results_file(argv[4]);
+  if (!results_file) {
+    std::cerr << "Cannot open file: " << argv[4] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    std::size_t threads = argc >= 6 ? std::stoul(argv[5]) : 0;
+    std::uint64_t max_instructions = argc == 7 ? std::stoull(argv[6]) : UINT64_MAX;
+    std::vector<simulator::JobConfig> jobs = simulator::parse_jobs(jobs_file);
+    simulator::JobFarm farm(std::move(program), kInitialMemSize, threads,
+                            max_instructions);
+    farm.run(jobs, results_file);
+    std::cerr << "Ran " << jobs.size() << " jobs on " << farm.threads()
+              << " threads\n";
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << "\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+int run_translate(int argc, char* argv[]) {
+  if (argc < 4 || argc > 5) {
+    std::cerr << "Usage: " << argv[0]
+              << " translate <program.bin> <output.cpp> [symbol]\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::uint8_t> program;
+  if (!read_file(argv[2], program)) {
+    return EXIT_FAILURE;
+  }
+
+  try {
+    std::string source = simulator::translate_program(
+        program, argc == 5 ? argv[4] : "run_translated");
+    std::ofstream output(argv[3]);
+    if (!output) {
+      std::cerr << "Cannot open file: " << argv[3] << "\n";
+      return EXIT_FAILURE;
+    }
+    output << source;
+    if (!output.flush()) {
+      std::cerr << "Cannot write file: " << argv[3] << "\n";
+      return EXIT_FAILURE;
+    }
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << "\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+std::uint64_t parse_index(const std::string& text) {
+  std::size_t parsed = 0;
+  unsigned long long value = std::stoull(text, &parsed, 0);
+  if (parsed != text.size()) {
+    throw std::invalid_argument(text);
+  }
+  return value;
+}
+
+int run_trace(int argc, char* argv[]) {
+  std::string command = argc > 2 ? argv[2] : "";
+  std::vector<std::string> arguments(argv + std::min(argc, 3), argv + argc);
+  try {
+    if (command == "show" && !arguments.empty()) {
+      simulator::TraceFilter filter;
+      for (std::size_t i = 1; i + 1 < arguments.size(); i += 2) {
+        const std::string& value = arguments[i + 1];
+        if (arguments[i] == "--from") {
+          filter.first_index = parse_index(value);
+        } else if (arguments[i] == "--to") {
+          filter.last_index = parse_index(value);
+        } else if (arguments[i] == "--pc" && value.find("..") != std::string::npos) {
+          filter.first_address = static_cast<std::uint32_t>(
+              parse_index(value.substr(0, value.find(".."))));
+          filter.last_address = static_cast<std::uint32_t>(
+              parse_index(value.substr(value.find("..") + 2)));
+        } else {
+          throw std::invalid_argument(arguments[i]);
+        }
+      }
+      if (arguments.size() % 2 == 0) {
+        throw std::invalid_argument(arguments.back());
+      }
+      simulator::TraceReader reader(arguments[0]);
+      simulator::write_trace(std::cout, reader, filter);
+      return EXIT_SUCCESS;
+    }
+    if (command == "state" && (arguments.size() == 2 || arguments.size() == 3)) {
+      simulator::ReportFormat format = simulator::ReportFormat::kText;
+      if (arguments.size() == 3 && arguments[2] == "--json") {
+        format = simulator::ReportFormat::kJson;
+      } else if (arguments.size() == 3 && arguments[2] == "--csv") {
+        format = simulator::ReportFormat::kCsv;
+      } else if (arguments.size() == 3) {
+        throw std::invalid_argument(arguments[2]);
+      }
+      simulator::TraceReader reader(arguments[0]);
+      reader.seek(parse_index(arguments[1]));
+
+      simulator::StateReport report;
+      report.status = "traced";
+      report.program_counter = reader.get_pc();
+      report.instruction_count = reader.instruction_count();
+      for (std::size_t i = 0; i < simulator::StateReport::kNumberOfRegisters; ++i) {
+        report.registers[i] = reader.get_register(static_cast<std::uint8_t>(i));
+      }
+      simulator::write_report(std::cout, report, format);
+      return EXIT_SUCCESS;
+    }
+    if (command == "diff" && arguments.size() == 2) {
+      simulator::TraceReader lhs(arguments[0]);
+      simulator::TraceReader rhs(arguments[1]);
+      return simulator::diff_traces(std::cout, lhs, rhs) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  } catch (const std::logic_error& error) {
+    std::cerr << "Invalid argument: " << error.what() << "\n";
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  std::cerr << "Usage: " << argv[0] << " trace show <trace> [--from <n>] [--to <n>]"
+            << " [--pc <first>..<last>]\n"
+            << "       " << argv[0] << " trace state <trace> <index> [--json|--csv]\n"
+            << "       " << argv[0] << " trace diff <trace> <trace>\n";
+  return EXIT_FAILURE;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  std::string mode = argc > 1 ? argv[1] : "";
+  if (mode == "run") {
+    return run_headless(argc, argv);
+  }
+  if (mode == "script") {
+    return run_script(argc, argv);
+  }
+  if (mode == "farm") {
+    return run_farm(argc, argv);
+  }
+  if (mode == "trace") {
+    return run_trace(argc, argv);
+  }
+  if (mode == "translate") {
+    return run_translate(argc, argv);
+  }
 
-int main() {
   simulator::InteractiveSimulator simulator(kInitialMemSize);
   simulator.start();
   return 0;
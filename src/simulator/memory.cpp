@@ -1,4 +1,5 @@
 #include "memory.hpp"
+#include <sys/mman.h>
 #include <algorithm>
 #include <cstdint>
 #include <cstring>
@@ -8,7 +9,52 @@
 namespace simulator {
 
 Memory::Memory(std::size_t memory_size)
-    : memory_size_(memory_size), data_(memory_size, 0) {}
+    : memory_size_(memory_size),
+      code_pages_size_((memory_size + kPageSize - 1) >> kPageShift) {
+  if (memory_size_ > kAddressSpaceSize) {
+    throw std::range_error("Memory size exceeds the address space: "
+                           + std::to_string(memory_size_));
+  }
+  data_ = map_zeroed(memory_size_);
+  try {
+    code_pages_ = map_zeroed(code_pages_size_);
+    dirty_pages_map_ = map_zeroed(code_pages_size_);
+    watched_pages_ = map_zeroed(code_pages_size_);
+  } catch (...) {
+    unmap(dirty_pages_map_, code_pages_size_);
+    unmap(code_pages_, code_pages_size_);
+    unmap(data_, memory_size_);
+    throw;
+  }
+}
+
+Memory::~Memory() {
+  unmap(watched_pages_, code_pages_size_);
+  unmap(dirty_pages_map_, code_pages_size_);
+  unmap(code_pages_, code_pages_size_);
+  unmap(data_, memory_size_);
+}
+
+// MAP_NORESERVE keeps large reservations from being refused up front;
+// untouched pages read as zero and take no resident memory.
+std::uint8_t* Memory::map_zeroed(std::size_t size) {
+  if (size == 0) {
+    return nullptr;
+  }
+  void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (region == MAP_FAILED) {
+    throw std::runtime_error("Cannot reserve guest memory: size="
+                             + std::to_string(size));
+  }
+  return static_cast<std::uint8_t*>(region);
+}
+
+void Memory::unmap(std::uint8_t* region, std::size_t size) {
+  if (region != nullptr) {
+    munmap(region, size);
+  }
+}
 
 std::uint8_t Memory::read_byte(std::uint32_t address) const {
   check_address_range(address, kByteAccessSize);
@@ -18,32 +64,20 @@ std::uint8_t Memory::read_byte(std::uint32_t address) const {
 void Memory::write_byte(std::uint32_t address, std::uint8_t byte) {
   check_address_range(address, kByteAccessSize);
   data_[address] = byte;
-}
-
-std::uint32_t Memory::read_word(std::uint32_t address) const {
-  check_address_range(address, kWordAccessSize);
-  check_allignment(address, kWordAccessSize);
-
-  std::uint32_t value;
-  std::memcpy(&value, data_.data() + address, kWordAccessSize);
-  return value;
-}
-
-void Memory::write_word(std::uint32_t address, std::uint32_t word) {
-  check_address_range(address, kWordAccessSize);
-  check_allignment(address, kWordAccessSize);
-
-  std::memcpy(data_.data() + address, &word, kWordAccessSize);
+  mark_dirty(address);
+  notify_code_write(address, kByteAccessSize);
 }
 
 const std::uint8_t* Memory::read_block(std::uint32_t address, std::size_t size) const {
   check_address_range(address, size);
-  return data_.data() + address;
+  return data_ + address;
 }
 
 void Memory::write_block(std::uint32_t address, const std::uint8_t* block, std::size_t size) {
   check_address_range(address, size);
-  std::copy(block, block + size, data_.data() + address);
+  std::copy(block, block + size, data_ + address);
+  mark_dirty(address, size);
+  notify_code_write(address, size);
 }
 
 std::size_t Memory::size() const {
@@ -55,11 +89,97 @@ bool Memory::is_valid_address(std::uint32_t address) const {
 }
 
 std::uint8_t* simulator::Memory::get_row_pointer() {
-  return data_.data();
+  return data_;
 }
 
 const std::uint8_t* simulator::Memory::get_row_pointer() const {
-  return data_.data();
+  return data_;
+}
+
+void Memory::set_code_write_listener(CodeWriteListener* listener) {
+  code_write_listener_ = listener;
+}
+
+void Memory::mark_code_page(std::uint32_t address) {
+  code_pages_[address >> kPageShift] = 1;
+}
+
+void Memory::set_watch_listener(WatchListener* listener) {
+  watch_listener_ = listener;
+}
+
+void Memory::watch_page(std::uint32_t page, WatchAccess access) {
+  if (page >= code_pages_size_) {
+    throw std::range_error("Page out of range: " + std::to_string(page));
+  }
+  watched_pages_[page] = static_cast<std::uint8_t>(access);
+}
+
+const std::vector<std::uint32_t>& Memory::dirty_pages() const {
+  return dirty_pages_;
+}
+
+void Memory::clear_dirty_pages() {
+  for (std::uint32_t page : dirty_pages_) {
+    dirty_pages_map_[page] = 0;
+  }
+  dirty_pages_.clear();
+}
+
+void Memory::mark_dirty(std::uint32_t address, std::size_t size) {
+  if (size == 0) {
+    return;
+  }
+  std::size_t last_page = (address + size - 1) >> kPageShift;
+  for (std::size_t page = address >> kPageShift; page <= last_page; ++page) {
+    if (dirty_pages_map_[page] == 0) {
+      add_dirty_page(static_cast<std::uint32_t>(page));
+    }
+  }
+}
+
+void Memory::add_dirty_page(std::uint32_t page) {
+  dirty_pages_map_[page] = 1;
+  dirty_pages_.push_back(page);
+}
+
+std::size_t Memory::page_bytes(std::uint32_t page) const {
+  std::size_t start = std::size_t{page} << kPageShift;
+  if (start >= memory_size_) {
+    throw std::range_error("Page out of range: " + std::to_string(page));
+  }
+  return std::min(kPageSize, memory_size_ - start);
+}
+
+void Memory::save_page(std::uint32_t page, std::uint8_t* destination) const {
+  std::memcpy(destination, data_ + (std::size_t{page} << kPageShift),
+              page_bytes(page));
+}
+
+void Memory::restore_page(std::uint32_t page, const std::uint8_t* source) {
+  std::size_t size = page_bytes(page);
+  std::uint8_t* target = data_ + (std::size_t{page} << kPageShift);
+  if (source != nullptr) {
+    std::memcpy(target, source, size);
+  } else {
+    std::memset(target, 0, size);
+  }
+  notify_code_write(page << kPageShift, size);
+}
+
+void Memory::notify_code_write(std::uint32_t address, std::size_t size) {
+  if (code_write_listener_ == nullptr || size == 0) {
+    return;
+  }
+
+  std::size_t first_page = address >> kPageShift;
+  std::size_t last_page = (address + size - 1) >> kPageShift;
+  for (std::size_t page = first_page; page <= last_page; ++page) {
+    if (code_pages_[page] != 0) {
+      code_write_listener_->on_code_write(address, size);
+      return;
+    }
+  }
 }
 
 void Memory::check_allignment(std::uint32_t address,
@@ -70,6 +190,13 @@ void Memory::check_allignment(std::uint32_t address,
   }
 }
 
+void Memory::trap_word_access(std::uint32_t address) const {
+  check_address_range(address, kWordAccessSize);
+  check_allignment(address, kWordAccessSize);
+  throw std::logic_error("Trapped a valid word access at address: "
+                         + std::to_string(address));
+}
+
 void Memory::check_address_range(std::uint32_t address,
                                             std::size_t access_size) const {
   if (address + access_size > memory_size_
@@ -0,0 +1,205 @@
+#include "pipeline_model.hpp"
+
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "opcodes.hpp"
+#include "syscalls.hpp"
+
+namespace simulator {
+
+namespace {
+
+constexpr std::uint32_t kInstructionSize = 4;
+
+std::string percent(std::uint64_t part, std::uint64_t total) {
+  std::ostringstream text;
+  text << std::fixed << std::setprecision(2)
+       << (total == 0 ? 0.0 : 100.0 * static_cast<double>(part)
+                                  / static_cast<double>(total))
+       << "%";
+  return text.str();
+}
+
+} // namespace
+
+PipelineModel::PipelineModel(PipelineConfig config) : config_(config) {}
+
+void PipelineModel::retire(const DecodedInstruction& instruction,
+                           std::uint32_t program_counter,
+                           std::uint32_t next_program_counter) {
+  Latch latch = make_latch(instruction, program_counter, next_program_counter);
+  while (!step(&latch)) {
+  }
+}
+
+PipelineStats PipelineModel::stats() const {
+  PipelineModel drained = *this;
+  while (!drained.drained()) {
+    drained.step(nullptr);
+  }
+  PipelineStats stats = drained.stats_;
+  if (drained.stages_[kWriteBack].valid) {
+    ++stats.instructions;
+  }
+  return stats;
+}
+
+void PipelineModel::write_report(std::ostream& output) const {
+  PipelineStats totals = stats();
+  std::uint64_t fill = totals.instructions != 0 ? kNumberOfStages - 1 : 0;
+
+  std::ostringstream buffer;
+  buffer << "Cycles: " << totals.cycles << "\n"
+         << "Instructions: " << totals.instructions << "\n"
+         << "CPI: " << std::fixed << std::setprecision(3) << totals.cpi() << "\n"
+         << "Forwarding: " << (config_.forwarding ? "on" : "off") << "\n"
+         << "\nStall cycles:\n";
+  auto line = [&buffer, &totals](const char* cause, std::uint64_t cycles) {
+    buffer << "  " << std::left << std::setw(14) << cause << std::right
+           << std::setw(14) << cycles << "  " << percent(cycles, totals.cycles)
+           << "\n";
+  };
+  line(config_.forwarding ? "load-use" : "data hazard", totals.data_stalls);
+  line("taken branch", totals.branch_stalls);
+  line("jump", totals.jump_stalls);
+  line("pipeline fill", fill);
+  output << buffer.str();
+}
+
+void PipelineModel::clear() {
+  stages_ = {};
+  stats_ = {};
+}
+
+// Register fields are normalized by the decoder, see DecodedInstruction.
+PipelineModel::Latch PipelineModel::make_latch(
+    const DecodedInstruction& instruction, std::uint32_t program_counter,
+    std::uint32_t next_program_counter) {
+  Latch latch;
+  latch.valid = true;
+  switch (instruction.opcode) {
+    case opcodes::kNOR:
+    case opcodes::kADD:
+    case opcodes::kXOR:
+    case opcodes::kBDEP:
+      latch.destinations = {instruction.rd, kNoRegister};
+      latch.sources = {instruction.rs, instruction.rt};
+      break;
+
+    case opcodes::kCBIT:
+    case opcodes::kSSAT:
+    case opcodes::kCLZ:
+      latch.destinations = {instruction.rd, kNoRegister};
+      latch.sources = {instruction.rs, kNoRegister};
+      break;
+
+    case opcodes::kLD:
+      latch.load = true;
+      latch.destinations = {instruction.rd, kNoRegister};
+      latch.sources = {instruction.rs, kNoRegister};
+      break;
+
+    case opcodes::kLDP:
+      latch.load = true;
+      latch.destinations = {instruction.rd, instruction.rt};
+      latch.sources = {instruction.rs, kNoRegister};
+      break;
+
+    case opcodes::kST:
+      latch.sources = {instruction.rs, kNoRegister};
+      latch.store_source = instruction.rt;
+      break;
+
+    case opcodes::kBEQ:
+    case opcodes::kBNE:
+      latch.sources = {instruction.rs, instruction.rt};
+      if (next_program_counter != program_counter + kInstructionSize) {
+        latch.redirect = Redirect::kBranch;
+      }
+      break;
+
+    case opcodes::kJj:
+      latch.redirect = Redirect::kJump;
+      break;
+
+    case opcodes::kSYSCALL:
+      latch.sources = {syscalls::kNumberRegister, kNoRegister};
+      break;
+
+    default:
+      break;
+  }
+  return latch;
+}
+
+// Hazards are checked against the stages before they advance: a consumer
+// leaving ID now executes next cycle, when a producer now in EX is in MEM.
+bool PipelineModel::has_data_hazard(const Latch& consumer) const {
+  auto writes = [](const Latch& producer, std::uint8_t index) {
+    return index != kNoRegister && producer.valid
+           && (producer.destinations[0] == index
+               || producer.destinations[1] == index);
+  };
+  auto reads_from = [&consumer, &writes](const Latch& producer,
+                                         bool store_data) {
+    return writes(producer, consumer.sources[0])
+           || writes(producer, consumer.sources[1])
+           || (store_data && writes(producer, consumer.store_source));
+  };
+
+  const Latch& execute = stages_[kExecute];
+  if (config_.forwarding) {
+    // Store data is needed one stage later and reaches MEM in time.
+    return execute.load && reads_from(execute, false);
+  }
+  return reads_from(execute, true) || reads_from(stages_[kMemory], true);
+}
+
+bool PipelineModel::drained() const {
+  for (std::size_t stage = kFetch; stage < kWriteBack; ++stage) {
+    if (stages_[stage].valid) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PipelineModel::step(const Latch* next) {
+  bool stall = stages_[kDecode].valid && has_data_hazard(stages_[kDecode]);
+
+  ++stats_.cycles;
+  if (stages_[kWriteBack].valid) {
+    ++stats_.instructions;
+  }
+  stages_[kWriteBack] = stages_[kMemory];
+  stages_[kMemory] = stages_[kExecute];
+  if (stall) {
+    ++stats_.data_stalls;
+    stages_[kExecute] = Latch{};
+    return false;
+  }
+  stages_[kExecute] = stages_[kDecode];
+  stages_[kDecode] = stages_[kFetch];
+  stages_[kFetch] = Latch{};
+
+  if (next == nullptr) {
+    return false;
+  }
+  // Until the redirect resolves the fetched instructions are from the
+  // wrong path and get flushed, so the slot is lost.
+  if (stages_[kDecode].redirect == Redirect::kJump) {
+    ++stats_.jump_stalls;
+    return false;
+  }
+  if (stages_[kDecode].redirect == Redirect::kBranch
+      || stages_[kExecute].redirect == Redirect::kBranch) {
+    ++stats_.branch_stalls;
+    return false;
+  }
+  stages_[kFetch] = *next;
+  return true;
+}
+
+} // namespace simulator
@@ -0,0 +1,216 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "opcodes.hpp"
+
+namespace simulator {
+
+namespace {
+
+std::string hex(std::uint32_t value) {
+  std::ostringstream text;
+  text << "0x" << std::hex << std::setw(8) << std::setfill('0') << value;
+  return text.str();
+}
+
+std::string name_of(std::uint8_t opcode) {
+  const char* name = opcodes::mnemonic(opcode);
+  return name != nullptr ? name : "???";
+}
+
+std::string percent(std::uint64_t part, std::uint64_t total) {
+  std::ostringstream text;
+  text << std::fixed << std::setprecision(2)
+       << (total == 0 ? 0.0 : 100.0 * static_cast<double>(part)
+                                  / static_cast<double>(total))
+       << "%";
+  return text.str();
+}
+
+bool is_conditional_branch(std::uint8_t opcode) {
+  return opcode == opcodes::kBEQ || opcode == opcodes::kBNE;
+}
+
+} // namespace
+
+Profiler::Page& Profiler::get_page(std::uint32_t page_index) {
+  std::unique_ptr<Page>& page = pages_[page_index];
+  if (!page) {
+    page = std::make_unique<Page>();
+  }
+  return *page;
+}
+
+void Profiler::clear() {
+  pages_.clear();
+  last_page_index_ = UINT32_MAX;
+  last_page_ = nullptr;
+  opcode_counts_.fill(0);
+  memory_counts_.clear();
+  total_instructions_ = 0;
+}
+
+Profiler::PcCounts Profiler::pc_counts(std::uint32_t program_counter) const {
+  auto page = pages_.find(program_counter >> Memory::kPageShift);
+  if (page == pages_.end()) {
+    return {};
+  }
+  return (*page->second)[(program_counter & (Memory::kPageSize - 1))
+                         / kInstructionSize];
+}
+
+Profiler::MemoryCounts Profiler::page_counts(std::uint32_t page) const {
+  auto counts = memory_counts_.find(page);
+  return counts == memory_counts_.end() ? MemoryCounts{} : counts->second;
+}
+
+std::vector<std::pair<std::uint32_t, Profiler::PcCounts>>
+Profiler::hot_spots() const {
+  std::vector<std::pair<std::uint32_t, PcCounts>> spots;
+  for (const auto& [page_index, page] : pages_) {
+    for (std::size_t i = 0; i < kEntriesPerPage; ++i) {
+      if ((*page)[i].executed != 0) {
+        spots.emplace_back(
+            (page_index << Memory::kPageShift) + i * kInstructionSize,
+            (*page)[i]);
+      }
+    }
+  }
+  std::sort(spots.begin(), spots.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.second.executed != rhs.second.executed
+               ? lhs.second.executed > rhs.second.executed
+               : lhs.first < rhs.first;
+  });
+  return spots;
+}
+
+std::vector<Profiler::Loop> Profiler::hot_loops() const {
+  auto spots = hot_spots();
+  std::vector<Loop> loops;
+  for (const auto& [program_counter, counts] : spots) {
+    if (counts.taken == 0 || counts.branch_target > program_counter) {
+      continue;
+    }
+    Loop loop{counts.branch_target, program_counter, counts.taken, 0};
+    for (const auto& [address, body] : spots) {
+      if (loop.head <= address && address <= loop.branch) {
+        loop.instructions += body.executed;
+      }
+    }
+    loops.push_back(loop);
+  }
+  std::sort(loops.begin(), loops.end(), [](const Loop& lhs, const Loop& rhs) {
+    return lhs.instructions != rhs.instructions
+               ? lhs.instructions > rhs.instructions
+               : lhs.head < rhs.head;
+  });
+  return loops;
+}
+
+void Profiler::write_report(std::ostream& output, std::size_t top) const {
+  std::ostringstream buffer;
+  buffer << "Instructions: " << total_instructions_ << "\n";
+
+  std::vector<std::uint8_t> opcodes;
+  for (std::size_t opcode = 0; opcode < kNumberOfOpcodes; ++opcode) {
+    if (opcode_counts_[opcode] != 0) {
+      opcodes.push_back(static_cast<std::uint8_t>(opcode));
+    }
+  }
+  std::sort(opcodes.begin(), opcodes.end(), [this](auto lhs, auto rhs) {
+    return opcode_counts_[lhs] > opcode_counts_[rhs];
+  });
+  buffer << "\nOpcodes:\n";
+  for (std::uint8_t opcode : opcodes) {
+    buffer << "  " << std::left << std::setw(8) << name_of(opcode) << std::right
+           << std::setw(14) << opcode_counts_[opcode] << "  "
+           << percent(opcode_counts_[opcode], total_instructions_) << "\n";
+  }
+
+  auto spots = hot_spots();
+  buffer << "\nHot spots:\n";
+  for (std::size_t i = 0; i < spots.size() && i < top; ++i) {
+    const auto& [program_counter, counts] = spots[i];
+    buffer << "  " << hex(program_counter) << "  " << std::left << std::setw(8)
+           << name_of(counts.opcode) << std::right << std::setw(14)
+           << counts.executed << "  "
+           << percent(counts.executed, total_instructions_) << "\n";
+  }
+
+  buffer << "\nBranches:\n";
+  std::size_t branches = 0;
+  for (const auto& [program_counter, counts] : spots) {
+    if (branches == top) {
+      break;
+    }
+    if (!is_conditional_branch(counts.opcode)) {
+      continue;
+    }
+    buffer << "  " << hex(program_counter) << "  " << std::left << std::setw(8)
+           << name_of(counts.opcode) << std::right
+           << "taken " << counts.taken
+           << " not-taken " << counts.executed - counts.taken << "\n";
+    ++branches;
+  }
+
+  auto loops = hot_loops();
+  buffer << "\nLoops:\n";
+  for (std::size_t i = 0; i < loops.size() && i < top; ++i) {
+    buffer << "  " << hex(loops[i].head) << "-" << hex(loops[i].branch)
+           << "  iterations " << loops[i].iterations
+           << "  instructions " << loops[i].instructions << "  "
+           << percent(loops[i].instructions, total_instructions_) << "\n";
+  }
+
+  std::vector<std::pair<std::uint32_t, MemoryCounts>> regions(
+      memory_counts_.begin(), memory_counts_.end());
+  std::sort(regions.begin(), regions.end(), [](const auto& lhs, const auto& rhs) {
+    std::uint64_t lhs_total = lhs.second.loads + lhs.second.stores;
+    std::uint64_t rhs_total = rhs.second.loads + rhs.second.stores;
+    return lhs_total != rhs_total ? lhs_total > rhs_total : lhs.first < rhs.first;
+  });
+  buffer << "\nMemory:\n";
+  for (std::size_t i = 0; i < regions.size() && i < top; ++i) {
+    std::uint32_t start = regions[i].first << Memory::kPageShift;
+    buffer << "  " << hex(start) << "-"
+           << hex(start + static_cast<std::uint32_t>(Memory::kPageSize - 1))
+           << "  loads " << regions[i].second.loads
+           << "  stores " << regions[i].second.stores << "\n";
+  }
+
+  output << buffer.str();
+}
+
+// Loops become frames ordered from the outermost, so nested loops show up
+// as stacked bars.
+void Profiler::write_folded(std::ostream& output) const {
+  auto loops = hot_loops();
+  std::sort(loops.begin(), loops.end(), [](const Loop& lhs, const Loop& rhs) {
+    return lhs.branch - lhs.head != rhs.branch - rhs.head
+               ? lhs.branch - lhs.head > rhs.branch - rhs.head
+               : lhs.head < rhs.head;
+  });
+
+  auto spots = hot_spots();
+  std::sort(spots.begin(), spots.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.first < rhs.first;
+  });
+
+  std::ostringstream buffer;
+  for (const auto& [program_counter, counts] : spots) {
+    buffer << "program";
+    for (const Loop& loop : loops) {
+      if (loop.head <= program_counter && program_counter <= loop.branch) {
+        buffer << ";loop_" << hex(loop.head) << "-" << hex(loop.branch);
+      }
+    }
+    buffer << ";" << hex(program_counter) << "_" << name_of(counts.opcode)
+           << " " << counts.executed << "\n";
+  }
+  output << buffer.str();
+}
+
+} // namespace simulator
@@ -0,0 +1,137 @@
+#include "sampling.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace simulator {
+
+namespace {
+
+// Normal approximation; tight once there are a few dozen windows.
+constexpr double kConfidenceZ = 1.96;
+
+void add_window(SampledEstimate& estimate, const PipelineStats& before,
+                const PipelineStats& after) {
+  PipelineStats window;
+  window.cycles = after.cycles - before.cycles;
+  window.instructions = after.instructions - before.instructions;
+  window.data_stalls = after.data_stalls - before.data_stalls;
+  window.branch_stalls = after.branch_stalls - before.branch_stalls;
+  window.jump_stalls = after.jump_stalls - before.jump_stalls;
+  if (window.instructions == 0) {
+    return;
+  }
+
+  estimate.measured.cycles += window.cycles;
+  estimate.measured.instructions += window.instructions;
+  estimate.measured.data_stalls += window.data_stalls;
+  estimate.measured.branch_stalls += window.branch_stalls;
+  estimate.measured.jump_stalls += window.jump_stalls;
+  estimate.window_cpi.push_back(window.cpi());
+}
+
+void extrapolate(SampledEstimate& estimate) {
+  estimate.cpi = estimate.measured.cpi();
+  estimate.cpi_margin = 0.0;
+
+  std::size_t windows = estimate.window_cpi.size();
+  if (windows >= 2) {
+    double mean = 0.0;
+    for (double cpi : estimate.window_cpi) {
+      mean += cpi;
+    }
+    mean /= static_cast<double>(windows);
+    double variance = 0.0;
+    for (double cpi : estimate.window_cpi) {
+      variance += (cpi - mean) * (cpi - mean);
+    }
+    variance /= static_cast<double>(windows - 1);
+    estimate.cpi_margin =
+        kConfidenceZ * std::sqrt(variance / static_cast<double>(windows));
+  }
+
+  double instructions = static_cast<double>(estimate.instructions);
+  estimate.cycles = estimate.cpi * instructions;
+  estimate.cycles_margin = estimate.cpi_margin * instructions;
+}
+
+} // namespace
+
+StopReason run_sampled(Cpu& cpu, const SamplingConfig& config,
+                       SampledEstimate& estimate,
+                       std::uint64_t max_instructions) {
+  if (config.window == 0 || config.period < config.warmup
+      || config.period - config.warmup < config.window) {
+    throw std::runtime_error("Sampling period must hold warm-up and a non-empty window");
+  }
+
+  estimate = {};
+  std::uint64_t start = cpu.get_instruction_count();
+  std::uint64_t stop = max_instructions > UINT64_MAX - start
+                           ? UINT64_MAX
+                           : start + max_instructions;
+  StopReason reason = StopReason::kInstructionLimit;
+  // Returns whether the program can continue.
+  auto advance = [&](std::uint64_t instructions) {
+    reason = cpu.run_program(
+        std::min(instructions, stop - cpu.get_instruction_count()));
+    estimate.instructions = cpu.get_instruction_count() - start;
+    return reason == StopReason::kInstructionLimit
+           && cpu.get_instruction_count() < stop;
+  };
+
+  std::uint64_t slack = config.period - config.warmup - config.window;
+  std::mt19937_64 random(config.seed);
+  std::uniform_int_distribution<std::uint64_t> offsets(0, slack);
+  try {
+    while (true) {
+      std::uint64_t offset = config.randomized ? offsets(random) : slack;
+      if (!advance(offset)) {
+        break;
+      }
+
+      cpu.set_timing_enabled(true, config.pipeline);
+      bool running = advance(config.warmup);
+      if (running) {
+        PipelineStats before = cpu.get_timing_model()->stats();
+        running = advance(config.window);
+        add_window(estimate, before, cpu.get_timing_model()->stats());
+      }
+      cpu.set_timing_enabled(false);
+
+      if (!running || !advance(slack - offset)) {
+        break;
+      }
+    }
+  } catch (...) {
+    cpu.set_timing_enabled(false);
+    extrapolate(estimate);
+    throw;
+  }
+
+  extrapolate(estimate);
+  return reason;
+}
+
+void write_sampling_report(std::ostream& output, const SampledEstimate& estimate) {
+  std::ostringstream buffer;
+  buffer << std::fixed << std::setprecision(3)
+         << "Instructions: " << estimate.instructions << "\n"
+         << "Windows: " << estimate.window_cpi.size() << "\n"
+         << "Measured instructions: " << estimate.measured.instructions << "\n"
+         << "Measured cycles: " << estimate.measured.cycles << "\n"
+         << "CPI: " << estimate.cpi << " +- " << estimate.cpi_margin << "\n"
+         << std::setprecision(0)
+         << "Cycles: " << estimate.cycles << " +- " << estimate.cycles_margin << "\n"
+         << "\nMeasured stall cycles:\n"
+         << "  data hazard   " << std::setw(14) << estimate.measured.data_stalls << "\n"
+         << "  taken branch  " << std::setw(14) << estimate.measured.branch_stalls << "\n"
+         << "  jump          " << std::setw(14) << estimate.measured.jump_stalls << "\n";
+  output << buffer.str();
+}
+
+} // namespace simulator
@@ -0,0 +1,132 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+namespace simulator {
+
+Scheduler::Scheduler(std::uint64_t quantum)
+  : quantum_(quantum) {
+  if (quantum_ == 0) {
+    throw std::runtime_error("Scheduler quantum must be positive");
+  }
+}
+
+std::size_t Scheduler::add(std::unique_ptr<Simulator> simulator,
+                           std::uint64_t budget) {
+  if (!simulator) {
+    throw std::runtime_error("Cannot schedule a null simulator");
+  }
+  std::size_t index = contexts_.size();
+  Context& added = contexts_.emplace_back();
+  added.simulator = std::move(simulator);
+  added.budget = budget;
+  if (budget == 0) {
+    added.status = ContextStatus::kBudgetExhausted;
+  } else {
+    run_queue_.push_back(index);
+  }
+  return index;
+}
+
+void Scheduler::resume(std::size_t index, std::uint64_t budget) {
+  Context& resumed = context(index);
+  if (resumed.status == ContextStatus::kExited || resumed.status == ContextStatus::kFaulted) {
+    throw std::runtime_error("Context " + std::to_string(index)
+                             + " has finished and cannot be resumed");
+  }
+  bool queued = resumed.status == ContextStatus::kRunnable;
+  resumed.budget = budget;
+  resumed.status = ContextStatus::kRunnable;
+  if (budget == 0) {
+    // Left in the queue it finishes on its next turn.
+    if (!queued) {
+      resumed.status = ContextStatus::kBudgetExhausted;
+    }
+    return;
+  }
+  if (!queued) {
+    run_queue_.push_back(index);
+  }
+}
+
+bool Scheduler::step() {
+  if (run_queue_.empty()) {
+    return false;
+  }
+  std::size_t index = run_queue_.front();
+  run_queue_.pop_front();
+  Context& current = contexts_[index];
+  Cpu& cpu = current.simulator->get_cpu();
+
+  std::uint64_t start = cpu.get_instruction_count();
+  StopReason reason = StopReason::kInstructionLimit;
+  try {
+    reason = cpu.run_program(std::min(quantum_, current.budget));
+  } catch (const std::exception& error) {
+    current.status = ContextStatus::kFaulted;
+    current.fault = error.what();
+  }
+  std::uint64_t retired = cpu.get_instruction_count() - start;
+  current.budget -= retired;
+  current.retired += retired;
+
+  if (current.status == ContextStatus::kFaulted) {
+    return !run_queue_.empty();
+  }
+  switch (reason) {
+    case StopReason::kExited:
+      current.status = ContextStatus::kExited;
+      break;
+    case StopReason::kBreakpoint:
+      current.status = ContextStatus::kBreakpoint;
+      break;
+    case StopReason::kWatchpoint:
+      current.status = ContextStatus::kWatchpoint;
+      break;
+    case StopReason::kInstructionLimit:
+      if (current.budget == 0) {
+        current.status = ContextStatus::kBudgetExhausted;
+      } else {
+        run_queue_.push_back(index);
+      }
+      break;
+  }
+  return !run_queue_.empty();
+}
+
+void Scheduler::run() {
+  while (step()) {
+  }
+}
+
+Simulator& Scheduler::get_simulator(std::size_t index) {
+  return *context(index).simulator;
+}
+
+ContextStatus Scheduler::get_status(std::size_t index) const {
+  return context(index).status;
+}
+
+const std::string& Scheduler::get_fault(std::size_t index) const {
+  return context(index).fault;
+}
+
+std::uint64_t Scheduler::get_retired(std::size_t index) const {
+  return context(index).retired;
+}
+
+Scheduler::Context& Scheduler::context(std::size_t index) {
+  if (index >= contexts_.size()) {
+    throw std::out_of_range("No scheduled context " + std::to_string(index));
+  }
+  return contexts_[index];
+}
+
+const Scheduler::Context& Scheduler::context(std::size_t index) const {
+  return const_cast<Scheduler*>(this)->context(index);
+}
+
+} // namespace simulator
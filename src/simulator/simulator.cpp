@@ -1,10 +1,12 @@
 #include "simulator.hpp"
+#include <algorithm>
 #include <cstdint>
+#include <stdexcept>
 
 namespace simulator {
 
-Simulator::Simulator(std::size_t memory_size)
-  : memory_(Memory(memory_size)), cpu_(Cpu(memory_)) {}
+Simulator::Simulator(std::size_t memory_size, ExecutionEngine engine)
+  : memory_(Memory(memory_size)), cpu_(Cpu(memory_, engine)) {}
 
 
 void Simulator::load_program(const std::vector<std::uint8_t>& program) {
@@ -15,5 +17,77 @@ void Simulator::load_program(const std::uint8_t* program, std::size_t size) {
   memory_.write_block(0, program, size);
 }
 
-} // namespace simulator
+std::shared_ptr<const Snapshot> Simulator::take_snapshot() const {
+  std::vector<std::uint32_t> pages = diverged_pages(nullptr);
+  pages.insert(pages.end(), memory_.dirty_pages().begin(),
+               memory_.dirty_pages().end());
+
+  auto snapshot = std::make_shared<Snapshot>();
+  snapshot->cpu_state_ = cpu_.get_state();
+  for (std::uint32_t page : pages) {
+    Snapshot::Page& copy = snapshot->pages_[page];
+    if (!copy) {
+      copy = std::make_shared_for_overwrite<std::uint8_t[]>(Memory::kPageSize);
+      memory_.save_page(page, copy.get());
+    }
+  }
+  return snapshot;
+}
+
+std::shared_ptr<const Snapshot> Simulator::checkpoint() {
+  auto snapshot = std::make_shared<Snapshot>();
+  snapshot->cpu_state_ = cpu_.get_state();
+  snapshot->parent_ = current_;
+  snapshot->depth_ = current_ ? current_->depth_ + 1 : 0;
+  for (std::uint32_t page : memory_.dirty_pages()) {
+    Snapshot::Page& copy = snapshot->pages_[page];
+    copy = std::make_shared_for_overwrite<std::uint8_t[]>(Memory::kPageSize);
+    memory_.save_page(page, copy.get());
+  }
+
+  memory_.clear_dirty_pages();
+  current_ = snapshot;
+  return snapshot;
+}
+
+void Simulator::restore(const std::shared_ptr<const Snapshot>& snapshot) {
+  if (!snapshot) {
+    throw std::runtime_error("Cannot restore an empty snapshot");
+  }
 
+  std::vector<std::uint32_t> pages = diverged_pages(snapshot.get());
+  pages.insert(pages.end(), memory_.dirty_pages().begin(),
+               memory_.dirty_pages().end());
+  std::sort(pages.begin(), pages.end());
+  pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+  for (std::uint32_t page : pages) {
+    memory_.restore_page(page, snapshot->find_page(page));
+  }
+
+  memory_.clear_dirty_pages();
+  cpu_.set_state(snapshot->cpu_state_);
+  current_ = snapshot;
+}
+
+// Walks both parent chains up to their common ancestor; only the snapshots
+// passed on the way can hold pages that differ.
+std::vector<std::uint32_t> Simulator::diverged_pages(
+    const Snapshot* snapshot) const {
+  auto chain_length = [](const Snapshot* node) {
+    return node != nullptr ? node->depth_ + 1 : 0;
+  };
+
+  std::vector<std::uint32_t> pages;
+  const Snapshot* current = current_.get();
+  while (current != snapshot) {
+    const Snapshot*& deeper =
+        chain_length(current) >= chain_length(snapshot) ? current : snapshot;
+    for (const auto& [page, contents] : deeper->pages_) {
+      pages.push_back(page);
+    }
+    deeper = deeper->parent_.get();
+  }
+  return pages;
+}
+
+} // namespace simulator
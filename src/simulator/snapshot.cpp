@@ -0,0 +1,32 @@
+#include "snapshot.hpp"
+
+namespace simulator {
+
+const std::uint8_t* Snapshot::find_page(std::uint32_t page) const {
+  for (const Snapshot* snapshot = this; snapshot != nullptr;
+       snapshot = snapshot->parent_.get()) {
+    auto found = snapshot->pages_.find(page);
+    if (found != snapshot->pages_.end()) {
+      return found->second.get();
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<const Snapshot> Snapshot::rebase(
+    const Snapshot& snapshot, const Snapshot* ancestor,
+    std::shared_ptr<const Snapshot> parent) {
+  auto rebased = std::make_shared<Snapshot>();
+  rebased->cpu_state_ = snapshot.cpu_state_;
+  rebased->depth_ = parent ? parent->depth_ + 1 : 0;
+  rebased->parent_ = std::move(parent);
+  for (const Snapshot* node = &snapshot; node != nullptr && node != ancestor;
+       node = node->parent_.get()) {
+    for (const auto& [page, contents] : node->pages_) {
+      rebased->pages_.emplace(page, contents);
+    }
+  }
+  return rebased;
+}
+
+} // namespace simulator
@@ -0,0 +1,141 @@
+#include "state_report.hpp"
+
+#include <iomanip>
+#include <ios>
+#include <sstream>
+#include <utility>
+
+namespace simulator {
+
+namespace {
+
+std::string escape_json(const std::string& text) {
+  std::string escaped;
+  for (char symbol : text) {
+    switch (symbol) {
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\\':
+        escaped += "\\\\";
+        break;
+      case '\n':
+        escaped += "\\n";
+        break;
+      default:
+        escaped += symbol;
+        break;
+    }
+  }
+  return escaped;
+}
+
+std::string escape_csv(const std::string& text) {
+  std::string escaped = "\"";
+  for (char symbol : text) {
+    if (symbol == '"') {
+      escaped += '"';
+    }
+    escaped += symbol;
+  }
+  return escaped + "\"";
+}
+
+void write_text(std::ostream& output, const StateReport& report) {
+  output << "Status: " << report.status << "\n";
+  if (!report.fault.empty()) {
+    output << "Fault: " << report.fault << "\n";
+  }
+  output << "Instructions: " << std::dec << report.instruction_count << "\n";
+  if (report.branches) {
+    output << "Branches: " << report.branches->branches() << "\n"
+           << "Mispredictions: " << report.branches->mispredictions() << "\n"
+           << "MPKI: " << std::fixed << std::setprecision(3)
+           << report.branches->mpki(report.instruction_count) << "\n";
+  }
+  output << "PC: 0x" << std::hex << report.program_counter << "\n";
+  for (std::size_t i = 0; i < StateReport::kNumberOfRegisters; ++i) {
+    output << "R" << std::dec << i << ": 0x" << std::hex << report.registers[i] << "\n";
+  }
+  output << std::dec;
+}
+
+void write_json(std::ostream& output, const StateReport& report) {
+  output << "{\"status\":\"" << report.status << "\""
+         << ",\"pc\":" << report.program_counter
+         << ",\"instructions\":" << report.instruction_count
+         << ",\"registers\":[";
+  for (std::size_t i = 0; i < StateReport::kNumberOfRegisters; ++i) {
+    output << (i == 0 ? "" : ",") << report.registers[i];
+  }
+  output << "]";
+  if (report.branches) {
+    output << ",\"branches\":" << report.branches->branches()
+           << ",\"mispredictions\":" << report.branches->mispredictions()
+           << ",\"mpki\":" << std::fixed << std::setprecision(3)
+           << report.branches->mpki(report.instruction_count);
+  }
+  if (!report.fault.empty()) {
+    output << ",\"fault\":\"" << escape_json(report.fault) << "\"";
+  }
+  output << "}\n";
+}
+
+void write_csv(std::ostream& output, const StateReport& report) {
+  output << "status,pc,instructions";
+  for (std::size_t i = 0; i < StateReport::kNumberOfRegisters; ++i) {
+    output << ",r" << i;
+  }
+  output << (report.branches ? ",branches,mispredictions,mpki" : "") << ",fault\n";
+
+  output << report.status << "," << report.program_counter << ","
+         << report.instruction_count;
+  for (std::size_t i = 0; i < StateReport::kNumberOfRegisters; ++i) {
+    output << "," << report.registers[i];
+  }
+  if (report.branches) {
+    output << "," << report.branches->branches() << ","
+           << report.branches->mispredictions() << "," << std::fixed
+           << std::setprecision(3) << report.branches->mpki(report.instruction_count);
+  }
+  output << "," << (report.fault.empty() ? "" : escape_csv(report.fault)) << "\n";
+}
+
+} // namespace
+
+StateReport StateReport::capture(const Cpu& cpu, std::string status,
+                                 std::string fault) {
+  StateReport report;
+  report.status = std::move(status);
+  report.fault = std::move(fault);
+  report.program_counter = cpu.get_pc();
+  report.instruction_count = cpu.get_instruction_count();
+  for (std::size_t i = 0; i < kNumberOfRegisters; ++i) {
+    report.registers[i] = cpu.get_register(static_cast<std::uint8_t>(i));
+  }
+  if (const BranchPredictor* predictor = cpu.get_branch_predictor()) {
+    report.branches = predictor->stats();
+  }
+  return report;
+}
+
+// Formatted into a buffer first so the report reaches the stream in one
+// write.
+void write_report(std::ostream& output, const StateReport& report,
+                  ReportFormat format) {
+  std::ostringstream buffer;
+  switch (format) {
+    case ReportFormat::kText:
+      write_text(buffer, report);
+      break;
+    case ReportFormat::kJson:
+      write_json(buffer, report);
+      break;
+    case ReportFormat::kCsv:
+      write_csv(buffer, report);
+      break;
+  }
+  output << buffer.str();
+}
+
+} // namespace simulator
@@ -0,0 +1,43 @@
+#include "threaded_engine.hpp"
+
+namespace simulator {
+
+ThreadedEngine::AttachedObservers::AttachedObservers(Cpu& cpu) {
+  if (cpu.observers_.empty()) {
+    return;
+  }
+  if (cpu.profiler_) {
+    profile_.emplace(ProfileObserver(*cpu.profiler_));
+    observers_.push_back(&*profile_);
+  }
+  if (cpu.trace_) {
+    trace_.emplace(TraceObserver(*cpu.trace_, cpu.registers_));
+    observers_.push_back(&*trace_);
+  }
+  observers_.insert(observers_.end(), cpu.observers_.begin(), cpu.observers_.end());
+}
+
+// Dynamic observers take the profiler and the trace along, so only their
+// static combinations get their own handlers.
+void ThreadedEngine::run(Cpu& cpu) {
+  if (!cpu.observers_.empty()) {
+    NullObserver none;
+    run(cpu, none);
+  } else if (cpu.profiler_ && cpu.trace_) {
+    ProfileObserver profile(*cpu.profiler_);
+    TraceObserver trace(*cpu.trace_, cpu.registers_);
+    ObserverGroup<ProfileObserver, TraceObserver> group(profile, trace);
+    run_traced(cpu, group);
+  } else if (cpu.profiler_) {
+    ProfileObserver profile(*cpu.profiler_);
+    select_access(cpu, profile);
+  } else if (cpu.trace_) {
+    TraceObserver trace(*cpu.trace_, cpu.registers_);
+    run_traced(cpu, trace);
+  } else {
+    NullObserver none;
+    select_access(cpu, none);
+  }
+}
+
+} // namespace simulator
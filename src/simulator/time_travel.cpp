@@ -0,0 +1,176 @@
+#include "time_travel.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace simulator {
+
+TimeTravel::TimeTravel(Simulator& simulator, std::uint64_t interval,
+                       std::size_t max_checkpoints)
+  : simulator_(simulator),
+    interval_(std::max<std::uint64_t>(interval, 1)),
+    max_checkpoints_(std::max<std::size_t>(max_checkpoints, 2)) {
+  simulator_.get_cpu().set_syscall_journal(&syscall_journal_);
+}
+
+TimeTravel::~TimeTravel() {
+  simulator_.get_cpu().set_syscall_journal(nullptr);
+}
+
+StopReason TimeTravel::run(std::uint64_t max_instructions) {
+  record();
+  Cpu& cpu = simulator_.get_cpu();
+  std::uint64_t count = cpu.get_instruction_count();
+  std::uint64_t stop = max_instructions > UINT64_MAX - count
+                           ? UINT64_MAX
+                           : count + max_instructions;
+
+  while (count < stop) {
+    std::uint64_t last = instruction_count(checkpoints_.back());
+    if (count >= last && count - last >= interval_) {
+      add_checkpoint(false);
+      continue;
+    }
+
+    // Inside the history execution only repeats it, so it runs from one
+    // existing checkpoint to the next.
+    std::uint64_t next = last + interval_;
+    std::shared_ptr<const Snapshot> rejoined;
+    if (count < last) {
+      auto later = std::upper_bound(
+          checkpoints_.begin(), checkpoints_.end(), count,
+          [](std::uint64_t value, const Checkpoint& checkpoint) {
+            return value < instruction_count(checkpoint);
+          });
+      rejoined = later->snapshot;
+      next = instruction_count(*later);
+    }
+
+    StopReason reason = cpu.run_program(std::min(stop, next) - count);
+    if (reason != StopReason::kInstructionLimit) {
+      return reason;
+    }
+    count = cpu.get_instruction_count();
+
+    // A checkpoint taken after the state was changed holds the change, and
+    // rejoining the last one keeps it the parent of the next.
+    if (rejoined && count == next) {
+      simulator_.restore(rejoined);
+    }
+  }
+  return StopReason::kInstructionLimit;
+}
+
+void TimeTravel::step() {
+  record();
+  simulator_.get_cpu().pipeline_cycle();
+}
+
+void TimeTravel::seek(std::uint64_t target) {
+  record();
+  if (target < first_instruction()) {
+    throw std::runtime_error("Instruction " + std::to_string(target)
+                             + " is before the history, which starts at "
+                             + std::to_string(first_instruction()));
+  }
+
+  std::uint64_t count = simulator_.get_cpu().get_instruction_count();
+  auto nearest = std::prev(std::upper_bound(
+      checkpoints_.begin(), checkpoints_.end(), target,
+      [](std::uint64_t value, const Checkpoint& checkpoint) {
+        return value < instruction_count(checkpoint);
+      }));
+  if (target < count || instruction_count(*nearest) > count) {
+    simulator_.restore(nearest->snapshot);
+  }
+
+  // Breakpoints and watchpoints on the way are passed.
+  Cpu& cpu = simulator_.get_cpu();
+  StopReason reason;
+  do {
+    reason = run(target - cpu.get_instruction_count());
+  } while (reason == StopReason::kBreakpoint || reason == StopReason::kWatchpoint);
+}
+
+void TimeTravel::step_back() {
+  record();
+  std::uint64_t count = simulator_.get_cpu().get_instruction_count();
+  if (count == first_instruction()) {
+    throw std::runtime_error("Already at the start of the history");
+  }
+  seek(count - 1);
+}
+
+void TimeTravel::rewind() {
+  record();
+  seek(first_instruction());
+}
+
+std::uint64_t TimeTravel::first_instruction() const {
+  if (checkpoints_.empty()) {
+    return simulator_.get_cpu().get_instruction_count();
+  }
+  return instruction_count(checkpoints_.front());
+}
+
+void TimeTravel::record() {
+  if (!changed_) {
+    return;
+  }
+  changed_ = false;
+
+  std::uint64_t count = simulator_.get_cpu().get_instruction_count();
+  while (!checkpoints_.empty() && instruction_count(checkpoints_.back()) >= count) {
+    pages_ -= checkpoints_.back().snapshot->page_count();
+    checkpoints_.pop_back();
+  }
+  syscall_journal_.forget(count);
+  add_checkpoint(true);
+}
+
+void TimeTravel::add_checkpoint(bool changed) {
+  checkpoints_.push_back({simulator_.checkpoint(), changed});
+  pages_ += checkpoints_.back().snapshot->page_count();
+  if (checkpoints_.size() > max_checkpoints_ || checkpoint_bytes() > kMemoryBudget) {
+    thin();
+  }
+}
+
+// Called right after a checkpoint, so the machine still matches the last
+// one and can be moved onto its merged copy.
+void TimeTravel::thin() {
+  while (checkpoints_.size() > 2
+         && (checkpoints_.size() > max_checkpoints_
+             || checkpoint_bytes() > kMemoryBudget)) {
+    std::vector<Checkpoint> thinned = {checkpoints_.front()};
+    pages_ = checkpoints_.front().snapshot->page_count();
+    std::size_t previous = 0;
+    bool merge = true;
+    for (std::size_t i = 1; i < checkpoints_.size(); ++i) {
+      const Checkpoint& checkpoint = checkpoints_[i];
+      if (merge && !checkpoint.changed && i + 1 != checkpoints_.size()) {
+        merge = false;
+        continue;
+      }
+      thinned.push_back({Snapshot::rebase(*checkpoint.snapshot,
+                                          checkpoints_[previous].snapshot.get(),
+                                          thinned.back().snapshot),
+                         checkpoint.changed});
+      pages_ += thinned.back().snapshot->page_count();
+      previous = i;
+      merge = true;
+    }
+
+    bool merged = thinned.size() != checkpoints_.size();
+    checkpoints_ = std::move(thinned);
+    if (!merged) {
+      break;
+    }
+    interval_ *= 2;
+  }
+  simulator_.restore(checkpoints_.back().snapshot);
+}
+
+} // namespace simulator
@@ -0,0 +1,255 @@
+#include "trace_reader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <ios>
+#include <stdexcept>
+
+#include "instruction_parser.hpp"
+#include "opcodes.hpp"
+
+namespace simulator {
+
+TraceReader::TraceReader(const std::string& path) {
+  int file = ::open(path.c_str(), O_RDONLY);
+  if (file < 0) {
+    throw std::runtime_error("Cannot open file: " + path);
+  }
+  struct stat status;
+  if (fstat(file, &status) != 0) {
+    ::close(file);
+    throw std::runtime_error("Cannot open file: " + path);
+  }
+  size_ = static_cast<std::size_t>(status.st_size);
+  if (size_ != 0) {
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (mapping == MAP_FAILED) {
+      throw std::runtime_error("Cannot map file: " + path);
+    }
+    data_ = static_cast<const std::uint8_t*>(mapping);
+    madvise(mapping, size_, MADV_SEQUENTIAL);
+  } else {
+    ::close(file);
+  }
+
+  if (size_ < trace_format::kMagic.size()
+      || !std::equal(trace_format::kMagic.begin(), trace_format::kMagic.end(),
+                     data_)) {
+    if (data_ != nullptr) {
+      munmap(const_cast<std::uint8_t*>(data_), size_);
+    }
+    throw std::runtime_error("Not a trace file: " + path);
+  }
+  end_ = data_ + size_;
+  rewind();
+}
+
+TraceReader::~TraceReader() {
+  munmap(const_cast<std::uint8_t*>(data_), size_);
+}
+
+std::uint8_t TraceReader::read_byte() {
+  if (cursor_ == end_) {
+    throw std::runtime_error("Truncated trace");
+  }
+  return *cursor_++;
+}
+
+std::uint32_t TraceReader::read_varint() {
+  std::uint32_t value = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    std::uint8_t byte = read_byte();
+    value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+  }
+  throw std::runtime_error("Corrupted trace");
+}
+
+void TraceReader::rewind() {
+  cursor_ = data_ + trace_format::kMagic.size();
+  registers_ = {};
+  raw_cache_ = {};
+  stored_words_.clear();
+  program_counter_ = 0;
+  last_address_ = 0;
+  instruction_count_ = 0;
+  apply_syncs();
+}
+
+void TraceReader::apply_syncs() {
+  while (cursor_ != end_ && *cursor_ == trace_format::kSync) {
+    ++cursor_;
+    program_counter_ = read_varint();
+    std::uint8_t count = read_byte();
+    for (std::uint8_t i = 0; i < count; ++i) {
+      std::uint8_t index = read_byte();
+      if (index >= kNumberOfRegisters) {
+        throw std::runtime_error("Corrupted trace");
+      }
+      registers_[index] = read_varint();
+    }
+  }
+}
+
+bool TraceReader::next(TraceEvent& event) {
+  using namespace trace_format;
+  if (cursor_ == end_) {
+    return false;
+  }
+
+  std::uint8_t tag = read_byte();
+  event = TraceEvent{};
+  event.index = instruction_count_;
+  event.program_counter = program_counter_;
+  if (tag & kJumped) {
+    event.program_counter += static_cast<std::uint32_t>(unzigzag(read_varint()));
+  }
+
+  std::uint32_t& cached_raw = raw_cache_[raw_cache_slot(event.program_counter)];
+  if (tag & kRawInstruction) {
+    cached_raw = 0;
+    for (int i = 0; i < 4; ++i) {
+      cached_raw |= static_cast<std::uint32_t>(read_byte()) << (8 * i);
+    }
+  }
+  event.raw = cached_raw;
+
+  for (std::uint8_t flag : {kRegister, kSecondRegister}) {
+    if (tag & flag) {
+      std::uint8_t index = read_byte();
+      if (index >= kNumberOfRegisters) {
+        throw std::runtime_error("Corrupted trace");
+      }
+      registers_[index] += static_cast<std::uint32_t>(unzigzag(read_varint()));
+      event.register_indices[event.register_count] = index;
+      event.register_values[event.register_count] = registers_[index];
+      ++event.register_count;
+    }
+  }
+
+  if (tag & kMemoryAddress) {
+    last_address_ += static_cast<std::uint32_t>(unzigzag(read_varint()));
+    event.accesses_memory = true;
+    event.address = last_address_;
+  }
+  if (tag & kStoreValue) {
+    event.stores = true;
+    event.store_value = read_varint();
+    stored_words_[event.address] = event.store_value;
+  }
+
+  program_counter_ = event.program_counter + 4;
+  ++instruction_count_;
+  apply_syncs();
+  return true;
+}
+
+void TraceReader::seek(std::uint64_t index) {
+  if (index < instruction_count_) {
+    rewind();
+  }
+  TraceEvent event;
+  while (instruction_count_ < index) {
+    if (!next(event)) {
+      throw std::runtime_error("Trace has only "
+                               + std::to_string(instruction_count_)
+                               + " instructions");
+    }
+  }
+
+  // The PC of the following instruction is only known from its record.
+  if (cursor_ != end_ && (*cursor_ & trace_format::kJumped)) {
+    const std::uint8_t* cursor = cursor_;
+    ++cursor_;
+    program_counter_ += static_cast<std::uint32_t>(
+        trace_format::unzigzag(read_varint()));
+    cursor_ = cursor;
+  }
+}
+
+void write_trace_event(std::ostream& output, const TraceEvent& event) {
+  const char* mnemonic =
+      opcodes::mnemonic(InstructionParser::get_opcode(event.raw));
+  output << std::dec << event.index << std::hex
+         << " pc=0x" << event.program_counter
+         << " raw=0x" << event.raw
+         << " " << (mnemonic != nullptr ? mnemonic : "???");
+  for (std::uint8_t i = 0; i < event.register_count; ++i) {
+    output << " r" << std::dec << static_cast<int>(event.register_indices[i])
+           << "=0x" << std::hex << event.register_values[i];
+  }
+  if (event.accesses_memory) {
+    output << " [0x" << event.address << "]";
+    if (event.stores) {
+      output << "=0x" << event.store_value;
+    }
+  }
+  output << std::dec << "\n";
+}
+
+void write_trace(std::ostream& output, TraceReader& reader,
+                 const TraceFilter& filter) {
+  TraceEvent event;
+  while (reader.instruction_count() <= filter.last_index && reader.next(event)) {
+    if (event.index >= filter.first_index
+        && event.program_counter >= filter.first_address
+        && event.program_counter <= filter.last_address) {
+      write_trace_event(output, event);
+    }
+  }
+}
+
+namespace {
+
+bool same_event(const TraceEvent& lhs, const TraceEvent& rhs) {
+  if (lhs.program_counter != rhs.program_counter || lhs.raw != rhs.raw
+      || lhs.register_count != rhs.register_count
+      || lhs.accesses_memory != rhs.accesses_memory || lhs.stores != rhs.stores
+      || lhs.address != rhs.address || lhs.store_value != rhs.store_value) {
+    return false;
+  }
+  for (std::uint8_t i = 0; i < lhs.register_count; ++i) {
+    if (lhs.register_indices[i] != rhs.register_indices[i]
+        || lhs.register_values[i] != rhs.register_values[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+bool diff_traces(std::ostream& output, TraceReader& lhs, TraceReader& rhs) {
+  TraceEvent lhs_event;
+  TraceEvent rhs_event;
+  while (true) {
+    bool lhs_read = lhs.next(lhs_event);
+    bool rhs_read = rhs.next(rhs_event);
+    if (!lhs_read && !rhs_read) {
+      output << "Traces are identical: " << lhs.instruction_count()
+             << " instructions\n";
+      return true;
+    }
+    if (lhs_read != rhs_read) {
+      const TraceReader& shorter = lhs_read ? rhs : lhs;
+      output << "Traces diverge at " << shorter.instruction_count() << ": "
+             << (lhs_read ? "second" : "first") << " trace ends\n";
+      return false;
+    }
+    if (!same_event(lhs_event, rhs_event)) {
+      output << "Traces diverge at " << lhs_event.index << ":\n< ";
+      write_trace_event(output, lhs_event);
+      output << "> ";
+      write_trace_event(output, rhs_event);
+      return false;
+    }
+  }
+}
+
+} // namespace simulator
@@ -0,0 +1,105 @@
+#include "trace_writer.hpp"
+
+#include <stdexcept>
+
+namespace simulator {
+
+TraceWriter::TraceWriter(const std::string& path)
+    : file_(std::fopen(path.c_str(), "wb")) {
+  if (file_ == nullptr) {
+    throw std::runtime_error("Cannot open file: " + path);
+  }
+  for (auto& buffer : buffers_) {
+    buffer.resize(kBufferSize);
+  }
+  cursor_ = buffers_[active_].data();
+  end_ = cursor_ + kBufferSize;
+  for (char symbol : trace_format::kMagic) {
+    *cursor_++ = static_cast<std::uint8_t>(symbol);
+  }
+  writer_ = std::thread(&TraceWriter::write_loop, this);
+}
+
+TraceWriter::~TraceWriter() {
+  try {
+    close();
+  } catch (const std::exception&) {
+  }
+}
+
+void TraceWriter::sync(
+    std::uint32_t program_counter,
+    const std::array<std::uint32_t, kNumberOfRegisters>& registers) {
+  if (static_cast<std::size_t>(end_ - cursor_)
+      < 1 + 5 + 1 + kNumberOfRegisters * (1 + 5)) {
+    swap_buffers();
+  }
+  *cursor_++ = trace_format::kSync;
+  put_varint(program_counter);
+  std::uint8_t* count = cursor_++;
+  *count = 0;
+  for (std::size_t i = 0; i < kNumberOfRegisters; ++i) {
+    if (registers_[i] != registers[i]) {
+      registers_[i] = registers[i];
+      *cursor_++ = static_cast<std::uint8_t>(i);
+      put_varint(registers[i]);
+      ++*count;
+    }
+  }
+  expected_program_counter_ = program_counter;
+}
+
+void TraceWriter::swap_buffers() {
+  std::size_t size = static_cast<std::size_t>(cursor_ - buffers_[active_].data());
+  {
+    std::unique_lock lock(mutex_);
+    condition_.wait(lock, [this] { return !pending_; });
+    pending_ = true;
+    pending_buffer_ = active_;
+    pending_size_ = size;
+  }
+  condition_.notify_all();
+
+  active_ ^= 1;
+  cursor_ = buffers_[active_].data();
+  end_ = cursor_ + kBufferSize;
+}
+
+void TraceWriter::write_loop() {
+  std::unique_lock lock(mutex_);
+  while (true) {
+    condition_.wait(lock, [this] { return pending_ || closing_; });
+    if (!pending_) {
+      return;
+    }
+    const std::vector<std::uint8_t>& buffer = buffers_[pending_buffer_];
+    std::size_t size = pending_size_;
+    lock.unlock();
+    bool written = std::fwrite(buffer.data(), 1, size, file_) == size;
+    lock.lock();
+    failed_ = failed_ || !written;
+    pending_ = false;
+    condition_.notify_all();
+  }
+}
+
+void TraceWriter::close() {
+  if (file_ == nullptr) {
+    return;
+  }
+  swap_buffers();
+  {
+    std::lock_guard lock(mutex_);
+    closing_ = true;
+  }
+  condition_.notify_all();
+  writer_.join();
+
+  bool failed = failed_ || std::fclose(file_) != 0;
+  file_ = nullptr;
+  if (failed) {
+    throw std::runtime_error("Cannot write trace");
+  }
+}
+
+} // namespace simulator
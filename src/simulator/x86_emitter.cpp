@@ -0,0 +1,226 @@
+#include "x86_emitter.hpp"
+
+namespace simulator::x86 {
+
+namespace {
+  constexpr std::uint8_t kRexBase = 0x40;
+  constexpr std::uint8_t kRexW = 0x08;
+  constexpr std::uint8_t kRexR = 0x04;
+  constexpr std::uint8_t kRexB = 0x01;
+
+  constexpr std::uint8_t kModDirect = 0xC0;
+  constexpr std::uint8_t kModDisp8 = 0x40;
+
+  constexpr std::uint8_t kLow3Bits = 0x7;
+} // namespace
+
+void Emitter::emit32(std::uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    emit(static_cast<std::uint8_t>(value >> (i * 8)));
+  }
+}
+
+void Emitter::emit64(std::uint64_t value) {
+  emit32(static_cast<std::uint32_t>(value));
+  emit32(static_cast<std::uint32_t>(value >> 32));
+}
+
+void Emitter::rex(bool wide, std::uint8_t reg, std::uint8_t rm) {
+  std::uint8_t prefix = kRexBase;
+  if (wide) {
+    prefix |= kRexW;
+  }
+  if (reg > kLow3Bits) {
+    prefix |= kRexR;
+  }
+  if (rm > kLow3Bits) {
+    prefix |= kRexB;
+  }
+  if (prefix != kRexBase) {
+    emit(prefix);
+  }
+}
+
+void Emitter::modrm_reg(std::uint8_t opcode, std::uint8_t reg, Register rm, bool wide) {
+  rex(wide, reg, rm);
+  emit(opcode);
+  emit(kModDirect | ((reg & kLow3Bits) << 3) | (rm & kLow3Bits));
+}
+
+// Bases with low bits 100 (rsp, r12) would need a SIB byte and are not
+// used as memory bases by the JIT.
+void Emitter::modrm_mem(std::uint8_t opcode, std::uint8_t reg, Register base,
+                        std::int8_t disp, bool wide) {
+  rex(wide, reg, base);
+  emit(opcode);
+  emit(kModDisp8 | ((reg & kLow3Bits) << 3) | (base & kLow3Bits));
+  emit(static_cast<std::uint8_t>(disp));
+}
+
+void Emitter::push(Register reg) {
+  rex(false, 0, reg);
+  emit(0x50 + (reg & kLow3Bits));
+}
+
+void Emitter::pop(Register reg) {
+  rex(false, 0, reg);
+  emit(0x58 + (reg & kLow3Bits));
+}
+
+void Emitter::ret() {
+  emit(0xC3);
+}
+
+void Emitter::call(Register reg) {
+  rex(false, 0, reg);
+  emit(0xFF);
+  emit(kModDirect | (2 << 3) | (reg & kLow3Bits));
+}
+
+void Emitter::add_rsp(std::int8_t value) {
+  emit(kRexBase | kRexW);
+  emit(0x83);
+  emit(kModDirect | (0 << 3) | kRsp);
+  emit(static_cast<std::uint8_t>(value));
+}
+
+void Emitter::sub_rsp(std::int8_t value) {
+  emit(kRexBase | kRexW);
+  emit(0x83);
+  emit(kModDirect | (5 << 3) | kRsp);
+  emit(static_cast<std::uint8_t>(value));
+}
+
+void Emitter::mov64(Register dst, Register src) {
+  modrm_reg(0x89, src, dst, true);
+}
+
+void Emitter::mov64(Register dst, Register base, std::int8_t disp) {
+  modrm_mem(0x8B, dst, base, disp, true);
+}
+
+void Emitter::mov64(Register dst, std::uint64_t imm) {
+  rex(true, 0, dst);
+  emit(0xB8 + (dst & kLow3Bits));
+  emit64(imm);
+}
+
+void Emitter::mov(Register dst, Register src) {
+  modrm_reg(0x89, src, dst);
+}
+
+void Emitter::mov(Register dst, std::uint32_t imm) {
+  rex(false, 0, dst);
+  emit(0xB8 + (dst & kLow3Bits));
+  emit32(imm);
+}
+
+void Emitter::mov(Register dst, Register base, std::int8_t disp) {
+  modrm_mem(0x8B, dst, base, disp);
+}
+
+void Emitter::mov(Register base, std::int8_t disp, Register src) {
+  modrm_mem(0x89, src, base, disp);
+}
+
+void Emitter::add(Register dst, Register src) {
+  modrm_reg(0x01, src, dst);
+}
+
+void Emitter::add(Register dst, std::uint32_t imm) {
+  rex(false, 0, dst);
+  emit(0x81);
+  emit(kModDirect | (0 << 3) | (dst & kLow3Bits));
+  emit32(imm);
+}
+
+void Emitter::add64(Register base, std::int8_t disp, std::int8_t imm) {
+  modrm_mem(0x83, 0, base, disp, true);
+  emit(static_cast<std::uint8_t>(imm));
+}
+
+void Emitter::sub(Register base, std::int8_t disp, std::int8_t imm) {
+  modrm_mem(0x83, 5, base, disp);
+  emit(static_cast<std::uint8_t>(imm));
+}
+
+void Emitter::or_(Register dst, Register src) {
+  modrm_reg(0x09, src, dst);
+}
+
+void Emitter::xor_(Register dst, Register src) {
+  modrm_reg(0x31, src, dst);
+}
+
+void Emitter::and_(Register dst, std::uint32_t imm) {
+  rex(false, 0, dst);
+  emit(0x81);
+  emit(kModDirect | (4 << 3) | (dst & kLow3Bits));
+  emit32(imm);
+}
+
+void Emitter::xor_(Register dst, std::int8_t imm) {
+  rex(false, 0, dst);
+  emit(0x83);
+  emit(kModDirect | (6 << 3) | (dst & kLow3Bits));
+  emit(static_cast<std::uint8_t>(imm));
+}
+
+void Emitter::not_(Register reg) {
+  rex(false, 0, reg);
+  emit(0xF7);
+  emit(kModDirect | (2 << 3) | (reg & kLow3Bits));
+}
+
+void Emitter::cmp(Register lhs, Register rhs) {
+  modrm_reg(0x39, rhs, lhs);
+}
+
+void Emitter::cmp(Register lhs, std::int8_t imm) {
+  rex(false, 0, lhs);
+  emit(0x83);
+  emit(kModDirect | (7 << 3) | (lhs & kLow3Bits));
+  emit(static_cast<std::uint8_t>(imm));
+}
+
+void Emitter::test(Register lhs, Register rhs) {
+  modrm_reg(0x85, rhs, lhs);
+}
+
+void Emitter::bsr(Register dst, Register src) {
+  rex(false, dst, src);
+  emit(0x0F);
+  emit(0xBD);
+  emit(kModDirect | ((dst & kLow3Bits) << 3) | (src & kLow3Bits));
+}
+
+Fixup Emitter::rel32() {
+  Fixup fixup = {code_.size()};
+  emit32(0);
+  return fixup;
+}
+
+Fixup Emitter::jcc(Condition condition) {
+  emit(0x0F);
+  emit(0x80 | condition);
+  return rel32();
+}
+
+Fixup Emitter::jmp() {
+  emit(0xE9);
+  return rel32();
+}
+
+void Emitter::bind(Fixup fixup) {
+  bind(fixup, code_.size());
+}
+
+void Emitter::bind(Fixup fixup, std::size_t target) {
+  std::uint32_t displacement =
+      static_cast<std::uint32_t>(target - (fixup.position + 4));
+  for (std::size_t i = 0; i < 4; ++i) {
+    code_[fixup.position + i] = static_cast<std::uint8_t>(displacement >> (i * 8));
+  }
+}
+
+} // namespace simulator::x86
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "alu_kernels.hpp"
+#include "cpu.hpp"
+
+namespace {
+
+namespace alu = simulator::alu;
+
+// Every kernel the host can run, the selected one included.
+std::vector<alu::BitDepositKernel> bit_deposit_kernels() {
+  std::vector<alu::BitDepositKernel> kernels = {&alu::portable_bit_deposit,
+                                                &alu::bit_deposit};
+  if (alu::hardware_bit_deposit() != nullptr) {
+    kernels.push_back(alu::hardware_bit_deposit());
+  }
+  return kernels;
+}
+
+} // namespace
+
+TEST(AluKernelsTest, CountLeadingZerosMatchesReference) {
+  // Every value below 2^20, shifted so the leading one visits each position.
+  for (std::uint32_t value = 0; value < (1U << 20); ++value) {
+    for (std::uint32_t shift : {0U, 7U, 12U}) {
+      std::uint32_t word = value << shift;
+      ASSERT_EQ(alu::count_leading_zeros(word), alu::reference_count_leading_zeros(word))
+          << std::hex << word;
+      ASSERT_EQ(alu::count_leading_zeros(~word), alu::reference_count_leading_zeros(~word))
+          << std::hex << ~word;
+    }
+  }
+  EXPECT_EQ(alu::count_leading_zeros(0), 32);
+  EXPECT_EQ(simulator::Cpu::count_leading_zeros(1), 31);
+}
+
+TEST(AluKernelsTest, BitDepositMatchesReferenceOnSmallOperands) {
+  // Every 8-bit value under every 8-bit mask, placed at each byte.
+  for (alu::BitDepositKernel kernel : bit_deposit_kernels()) {
+    for (std::uint32_t mask = 0; mask < 256; ++mask) {
+      for (std::uint32_t value = 0; value < 256; ++value) {
+        for (std::uint32_t shift = 0; shift < 32; shift += 8) {
+          std::uint32_t shifted_mask = mask << shift;
+          ASSERT_EQ(kernel(value, shifted_mask), alu::reference_bit_deposit(value, shifted_mask))
+              << std::hex << value << " " << shifted_mask;
+        }
+      }
+    }
+  }
+}
+
+TEST(AluKernelsTest, BitDepositMatchesReferenceOnRandomOperands) {
+  std::mt19937 generator(17);
+  for (alu::BitDepositKernel kernel : bit_deposit_kernels()) {
+    for (int i = 0; i < 300000; ++i) {
+      std::uint32_t value = generator();
+      std::uint32_t mask = generator();
+      // Sparse and dense masks as well as uniform ones.
+      if (i % 3 == 1) {
+        mask &= generator();
+      } else if (i % 3 == 2) {
+        mask |= generator();
+      }
+      ASSERT_EQ(kernel(value, mask), alu::reference_bit_deposit(value, mask))
+          << std::hex << value << " " << mask;
+    }
+    EXPECT_EQ(kernel(0xFFFFFFFF, 0xFFFFFFFF), 0xFFFFFFFF);
+    EXPECT_EQ(kernel(0xFFFFFFFF, 0), 0);
+  }
+}
+
+TEST(AluKernelsTest, SelectsKernelOnce) {
+  alu::BitDepositKernel kernel = alu::bit_deposit_kernel();
+  EXPECT_EQ(alu::bit_deposit_kernel(), kernel);
+  std::string name = alu::bit_deposit_kernel_name();
+  if (alu::hardware_bit_deposit() == nullptr) {
+    EXPECT_EQ(name, "portable");
+  } else {
+    EXPECT_TRUE(name == "pdep" || name == "portable") << name;
+  }
+  EXPECT_EQ(simulator::Cpu::bit_deposit(0b101, 0xF0F0), 0x50);
+}
@@ -0,0 +1,100 @@
+// Generated by `simulator translate`, do not edit.
+// 6 instructions in 2 blocks of a 24 byte image.
+#include <cstdint>
+
+#include "alu_kernels.hpp"
+#include "aot_runtime.hpp"
+#include "cpu.hpp"
+
+simulator::StopReason aot_fib(simulator::Cpu& cpu, std::uint64_t max_instructions);
+
+simulator::StopReason aot_fib(simulator::Cpu& cpu, std::uint64_t max_instructions) {
+  using simulator::AotRuntime;
+  using simulator::StopReason;
+  constexpr std::uint32_t kImageEnd = 0x18;
+
+  if (!AotRuntime::can_run(cpu)) {
+    return cpu.run_program(max_instructions);
+  }
+  std::uint32_t* registers = AotRuntime::registers(cpu);
+  const std::uint64_t limit = AotRuntime::limit(cpu, max_instructions);
+  std::uint64_t count = cpu.get_instruction_count();
+  std::uint32_t pc = cpu.get_pc();
+  // Start of the running block, a fault retires the instructions
+  // from it up to pc.
+  std::uint32_t block = pc;
+  std::uint32_t r0 = registers[0];
+  std::uint32_t r1 = registers[1];
+  std::uint32_t r2 = registers[2];
+  std::uint32_t r3 = registers[3];
+  std::uint32_t r4 = registers[4];
+  std::uint32_t r5 = registers[5];
+
+  try {
+    switch (pc) {
+      case 0x0: goto block_00000000;
+      case 0x14: goto block_00000014;
+      default: goto interpret;
+    }
+
+block_00000000:
+    if (limit - count < 5) {
+      pc = 0x0;
+      goto interpret;
+    }
+    r4 = r1 + r2;
+    r1 = r2 + r0;
+    r2 = r4 + r0;
+    r3 = r3 + r5;
+    count += 5;
+    if (r3 != r0) {
+      goto block_00000000;
+    }
+
+block_00000014:
+    if (limit - count < 1) {
+      pc = 0x14;
+      goto interpret;
+    }
+    pc = 0x14;
+    block = pc;
+    registers[0] = r0;
+    registers[1] = r1;
+    registers[2] = r2;
+    registers[3] = r3;
+    registers[4] = r4;
+    registers[5] = r5;
+    {
+      AotRuntime::SyscallResult result =
+          AotRuntime::syscall(cpu, 0x14, count, kImageEnd);
+      ++count;
+      if (result == AotRuntime::SyscallResult::kExited) {
+        return AotRuntime::finish(cpu, 0x18, count, StopReason::kExited);
+      }
+      if (result == AotRuntime::SyscallResult::kInterpret) {
+        pc = 0x18;
+        goto interpret;
+      }
+    }
+    pc = 0x18;
+    goto interpret;
+  } catch (...) {
+    registers[0] = r0;
+    registers[1] = r1;
+    registers[2] = r2;
+    registers[3] = r3;
+    registers[4] = r4;
+    registers[5] = r5;
+    AotRuntime::fault(cpu, pc, count + (pc - block) / 4);
+    throw;
+  }
+
+interpret:
+  registers[0] = r0;
+  registers[1] = r1;
+  registers[2] = r2;
+  registers[3] = r3;
+  registers[4] = r4;
+  registers[5] = r5;
+  return AotRuntime::interpret(cpu, pc, count, limit);
+}
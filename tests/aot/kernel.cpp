@@ -0,0 +1,237 @@
+// Generated by `simulator translate`, do not edit.
+// 20 instructions in 5 blocks of a 80 byte image.
+#include <cstdint>
+
+#include "alu_kernels.hpp"
+#include "aot_runtime.hpp"
+#include "cpu.hpp"
+
+simulator::StopReason aot_kernel(simulator::Cpu& cpu, std::uint64_t max_instructions);
+
+simulator::StopReason aot_kernel(simulator::Cpu& cpu, std::uint64_t max_instructions) {
+  using simulator::AotRuntime;
+  using simulator::StopReason;
+  constexpr std::uint32_t kImageEnd = 0x50;
+
+  if (!AotRuntime::can_run(cpu)) {
+    return cpu.run_program(max_instructions);
+  }
+  std::uint32_t* registers = AotRuntime::registers(cpu);
+  simulator::Memory& memory = AotRuntime::memory(cpu);
+  const std::uint64_t limit = AotRuntime::limit(cpu, max_instructions);
+  std::uint64_t count = cpu.get_instruction_count();
+  std::uint32_t pc = cpu.get_pc();
+  // Start of the running block, a fault retires the instructions
+  // from it up to pc.
+  std::uint32_t block = pc;
+  std::uint32_t r0 = registers[0];
+  std::uint32_t r1 = registers[1];
+  std::uint32_t r2 = registers[2];
+  std::uint32_t r3 = registers[3];
+  std::uint32_t r4 = registers[4];
+  std::uint32_t r5 = registers[5];
+  std::uint32_t r6 = registers[6];
+  std::uint32_t r7 = registers[7];
+  std::uint32_t r8 = registers[8];
+  std::uint32_t r9 = registers[9];
+  std::uint32_t r11 = registers[11];
+  std::uint32_t r12 = registers[12];
+  std::uint32_t r13 = registers[13];
+  std::uint32_t r14 = registers[14];
+  std::uint32_t r20 = registers[20];
+  std::uint32_t r21 = registers[21];
+  std::uint32_t r22 = registers[22];
+  std::uint32_t r23 = registers[23];
+
+  try {
+    switch (pc) {
+      case 0x0: goto block_00000000;
+      case 0x34: goto block_00000034;
+      case 0x38: goto block_00000038;
+      case 0x3c: goto block_0000003c;
+      case 0x44: goto block_00000044;
+      default: goto interpret;
+    }
+
+block_00000000:
+    if (limit - count < 13) {
+      pc = 0x0;
+      goto interpret;
+    }
+    block = 0x0;
+    pc = 0x0;
+    {
+      std::uint32_t address = r20 + 0x0u;
+      r1 = memory.read_word(address);
+      r2 = memory.read_word(address + 4);
+    }
+    r3 = r1 + r2;
+    r4 = r3 ^ r1;
+    r5 = simulator::alu::bit_deposit(r4, r2);
+    r6 = ~(r5 | r3);
+    r7 = simulator::alu::count_leading_zeros(r6);
+    r11 = simulator::Cpu::clear_bit_field(r6, 5);
+    pc = 0x1c;
+    {
+      std::uint32_t address = r20 + 0x8u;
+      memory.write_word(address, r11);
+      if (address < kImageEnd) {
+        count += 8;
+        pc = 0x20;
+        goto interpret;
+      }
+    }
+    pc = 0x20;
+    r12 = memory.read_word(r20 + 0x8u);
+    r13 = r13 + r12;
+    r13 = r13 + r7;
+    r21 = r21 + r22;
+    count += 13;
+    if (r21 != r0) {
+      goto block_00000000;
+    }
+
+block_00000034:
+    if (limit - count < 1) {
+      pc = 0x34;
+      goto interpret;
+    }
+    count += 1;
+    goto block_0000003c;
+
+block_00000038:
+    if (limit - count < 1) {
+      pc = 0x38;
+      goto interpret;
+    }
+    r13 = r0 + r0;
+    count += 1;
+
+block_0000003c:
+    if (limit - count < 2) {
+      pc = 0x3c;
+      goto interpret;
+    }
+    r8 = r23 + r0;
+    count += 1;
+    pc = 0x40;
+    block = pc;
+    registers[0] = r0;
+    registers[1] = r1;
+    registers[2] = r2;
+    registers[3] = r3;
+    registers[4] = r4;
+    registers[5] = r5;
+    registers[6] = r6;
+    registers[7] = r7;
+    registers[8] = r8;
+    registers[9] = r9;
+    registers[11] = r11;
+    registers[12] = r12;
+    registers[13] = r13;
+    registers[14] = r14;
+    registers[20] = r20;
+    registers[21] = r21;
+    registers[22] = r22;
+    registers[23] = r23;
+    {
+      AotRuntime::SyscallResult result =
+          AotRuntime::syscall(cpu, 0x40, count, kImageEnd);
+      ++count;
+      r9 = registers[9];
+      if (result == AotRuntime::SyscallResult::kExited) {
+        return AotRuntime::finish(cpu, 0x44, count, StopReason::kExited);
+      }
+      if (result == AotRuntime::SyscallResult::kInterpret) {
+        pc = 0x44;
+        goto interpret;
+      }
+    }
+
+block_00000044:
+    if (limit - count < 3) {
+      pc = 0x44;
+      goto interpret;
+    }
+    r14 = r9 + r0;
+    r8 = r0 + r0;
+    count += 2;
+    pc = 0x4c;
+    block = pc;
+    registers[0] = r0;
+    registers[1] = r1;
+    registers[2] = r2;
+    registers[3] = r3;
+    registers[4] = r4;
+    registers[5] = r5;
+    registers[6] = r6;
+    registers[7] = r7;
+    registers[8] = r8;
+    registers[9] = r9;
+    registers[11] = r11;
+    registers[12] = r12;
+    registers[13] = r13;
+    registers[14] = r14;
+    registers[20] = r20;
+    registers[21] = r21;
+    registers[22] = r22;
+    registers[23] = r23;
+    {
+      AotRuntime::SyscallResult result =
+          AotRuntime::syscall(cpu, 0x4c, count, kImageEnd);
+      ++count;
+      r9 = registers[9];
+      if (result == AotRuntime::SyscallResult::kExited) {
+        return AotRuntime::finish(cpu, 0x50, count, StopReason::kExited);
+      }
+      if (result == AotRuntime::SyscallResult::kInterpret) {
+        pc = 0x50;
+        goto interpret;
+      }
+    }
+    pc = 0x50;
+    goto interpret;
+  } catch (...) {
+    registers[0] = r0;
+    registers[1] = r1;
+    registers[2] = r2;
+    registers[3] = r3;
+    registers[4] = r4;
+    registers[5] = r5;
+    registers[6] = r6;
+    registers[7] = r7;
+    registers[8] = r8;
+    registers[9] = r9;
+    registers[11] = r11;
+    registers[12] = r12;
+    registers[13] = r13;
+    registers[14] = r14;
+    registers[20] = r20;
+    registers[21] = r21;
+    registers[22] = r22;
+    registers[23] = r23;
+    AotRuntime::fault(cpu, pc, count + (pc - block) / 4);
+    throw;
+  }
+
+interpret:
+  registers[0] = r0;
+  registers[1] = r1;
+  registers[2] = r2;
+  registers[3] = r3;
+  registers[4] = r4;
+  registers[5] = r5;
+  registers[6] = r6;
+  registers[7] = r7;
+  registers[8] = r8;
+  registers[9] = r9;
+  registers[11] = r11;
+  registers[12] = r12;
+  registers[13] = r13;
+  registers[14] = r14;
+  registers[20] = r20;
+  registers[21] = r21;
+  registers[22] = r22;
+  registers[23] = r23;
+  return AotRuntime::interpret(cpu, pc, count, limit);
+}
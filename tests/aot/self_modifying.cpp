@@ -0,0 +1,133 @@
+// Generated by `simulator translate`, do not edit.
+// 6 instructions in 4 blocks of a 24 byte image.
+#include <cstdint>
+
+#include "alu_kernels.hpp"
+#include "aot_runtime.hpp"
+#include "cpu.hpp"
+
+simulator::StopReason aot_self_modifying(simulator::Cpu& cpu, std::uint64_t max_instructions);
+
+simulator::StopReason aot_self_modifying(simulator::Cpu& cpu, std::uint64_t max_instructions) {
+  using simulator::AotRuntime;
+  using simulator::StopReason;
+  constexpr std::uint32_t kImageEnd = 0x18;
+
+  if (!AotRuntime::can_run(cpu)) {
+    return cpu.run_program(max_instructions);
+  }
+  std::uint32_t* registers = AotRuntime::registers(cpu);
+  simulator::Memory& memory = AotRuntime::memory(cpu);
+  const std::uint64_t limit = AotRuntime::limit(cpu, max_instructions);
+  std::uint64_t count = cpu.get_instruction_count();
+  std::uint32_t pc = cpu.get_pc();
+  // Start of the running block, a fault retires the instructions
+  // from it up to pc.
+  std::uint32_t block = pc;
+  std::uint32_t r0 = registers[0];
+  std::uint32_t r1 = registers[1];
+  std::uint32_t r2 = registers[2];
+  std::uint32_t r3 = registers[3];
+  std::uint32_t r4 = registers[4];
+  std::uint32_t r21 = registers[21];
+  std::uint32_t r22 = registers[22];
+
+  try {
+    switch (pc) {
+      case 0x0: goto block_00000000;
+      case 0x8: goto block_00000008;
+      case 0xc: goto block_0000000c;
+      case 0x14: goto block_00000014;
+      default: goto interpret;
+    }
+
+block_00000000:
+    if (limit - count < 2) {
+      pc = 0x0;
+      goto interpret;
+    }
+    r1 = r1 + r2;
+    count += 2;
+    if (r21 != r3) {
+      goto block_0000000c;
+    }
+
+block_00000008:
+    if (limit - count < 1) {
+      pc = 0x8;
+      goto interpret;
+    }
+    block = 0x8;
+    pc = 0x8;
+    {
+      std::uint32_t address = r0 + 0x0u;
+      memory.write_word(address, r4);
+      if (address < kImageEnd) {
+        count += 1;
+        pc = 0xc;
+        goto interpret;
+      }
+    }
+    count += 1;
+
+block_0000000c:
+    if (limit - count < 2) {
+      pc = 0xc;
+      goto interpret;
+    }
+    r21 = r21 + r22;
+    count += 2;
+    if (r21 != r0) {
+      goto block_00000000;
+    }
+
+block_00000014:
+    if (limit - count < 1) {
+      pc = 0x14;
+      goto interpret;
+    }
+    pc = 0x14;
+    block = pc;
+    registers[0] = r0;
+    registers[1] = r1;
+    registers[2] = r2;
+    registers[3] = r3;
+    registers[4] = r4;
+    registers[21] = r21;
+    registers[22] = r22;
+    {
+      AotRuntime::SyscallResult result =
+          AotRuntime::syscall(cpu, 0x14, count, kImageEnd);
+      ++count;
+      if (result == AotRuntime::SyscallResult::kExited) {
+        return AotRuntime::finish(cpu, 0x18, count, StopReason::kExited);
+      }
+      if (result == AotRuntime::SyscallResult::kInterpret) {
+        pc = 0x18;
+        goto interpret;
+      }
+    }
+    pc = 0x18;
+    goto interpret;
+  } catch (...) {
+    registers[0] = r0;
+    registers[1] = r1;
+    registers[2] = r2;
+    registers[3] = r3;
+    registers[4] = r4;
+    registers[21] = r21;
+    registers[22] = r22;
+    AotRuntime::fault(cpu, pc, count + (pc - block) / 4);
+    throw;
+  }
+
+interpret:
+  registers[0] = r0;
+  registers[1] = r1;
+  registers[2] = r2;
+  registers[3] = r3;
+  registers[4] = r4;
+  registers[21] = r21;
+  registers[22] = r22;
+  return AotRuntime::interpret(cpu, pc, count, limit);
+}
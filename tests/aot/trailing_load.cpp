@@ -0,0 +1,137 @@
+// Generated by `simulator translate`, do not edit.
+// 8 instructions in 5 blocks of a 32 byte image.
+#include <cstdint>
+
+#include "alu_kernels.hpp"
+#include "aot_runtime.hpp"
+#include "cpu.hpp"
+
+simulator::StopReason aot_trailing_load(simulator::Cpu& cpu, std::uint64_t max_instructions);
+
+simulator::StopReason aot_trailing_load(simulator::Cpu& cpu, std::uint64_t max_instructions) {
+  using simulator::AotRuntime;
+  using simulator::StopReason;
+  constexpr std::uint32_t kImageEnd = 0x20;
+
+  if (!AotRuntime::can_run(cpu)) {
+    return cpu.run_program(max_instructions);
+  }
+  std::uint32_t* registers = AotRuntime::registers(cpu);
+  simulator::Memory& memory = AotRuntime::memory(cpu);
+  const std::uint64_t limit = AotRuntime::limit(cpu, max_instructions);
+  std::uint64_t count = cpu.get_instruction_count();
+  std::uint32_t pc = cpu.get_pc();
+  // Start of the running block, a fault retires the instructions
+  // from it up to pc.
+  std::uint32_t block = pc;
+  std::uint32_t r0 = registers[0];
+  std::uint32_t r2 = registers[2];
+  std::uint32_t r3 = registers[3];
+  std::uint32_t r6 = registers[6];
+  std::uint32_t r7 = registers[7];
+  std::uint32_t r21 = registers[21];
+  std::uint32_t r22 = registers[22];
+
+  try {
+    switch (pc) {
+      case 0x0: goto block_00000000;
+      case 0x8: goto block_00000008;
+      case 0xc: goto block_0000000c;
+      case 0x18: goto block_00000018;
+      case 0x1c: goto block_0000001c;
+      default: goto interpret;
+    }
+
+block_00000000:
+    if (limit - count < 2) {
+      pc = 0x0;
+      goto interpret;
+    }
+    block = 0x0;
+    pc = 0x0;
+    r6 = memory.read_word(r0 + 0x0u);
+    r7 = r0 + r0;
+    count += 2;
+
+block_00000008:
+    if (limit - count < 1) {
+      pc = 0x8;
+      goto interpret;
+    }
+    block = 0x8;
+    pc = 0x8;
+    r2 = memory.read_word(r3 + 0x0u);
+    count += 1;
+
+block_0000000c:
+    if (limit - count < 3) {
+      pc = 0xc;
+      goto interpret;
+    }
+    r7 = r7 + r2;
+    r21 = r21 + r22;
+    count += 3;
+    if (r21 != r0) {
+      goto block_0000000c;
+    }
+
+block_00000018:
+    if (limit - count < 1) {
+      pc = 0x18;
+      goto interpret;
+    }
+    count += 1;
+    if (r21 == r22) {
+      goto block_00000008;
+    }
+
+block_0000001c:
+    if (limit - count < 1) {
+      pc = 0x1c;
+      goto interpret;
+    }
+    pc = 0x1c;
+    block = pc;
+    registers[0] = r0;
+    registers[2] = r2;
+    registers[3] = r3;
+    registers[6] = r6;
+    registers[7] = r7;
+    registers[21] = r21;
+    registers[22] = r22;
+    {
+      AotRuntime::SyscallResult result =
+          AotRuntime::syscall(cpu, 0x1c, count, kImageEnd);
+      ++count;
+      if (result == AotRuntime::SyscallResult::kExited) {
+        return AotRuntime::finish(cpu, 0x20, count, StopReason::kExited);
+      }
+      if (result == AotRuntime::SyscallResult::kInterpret) {
+        pc = 0x20;
+        goto interpret;
+      }
+    }
+    pc = 0x20;
+    goto interpret;
+  } catch (...) {
+    registers[0] = r0;
+    registers[2] = r2;
+    registers[3] = r3;
+    registers[6] = r6;
+    registers[7] = r7;
+    registers[21] = r21;
+    registers[22] = r22;
+    AotRuntime::fault(cpu, pc, count + (pc - block) / 4);
+    throw;
+  }
+
+interpret:
+  registers[0] = r0;
+  registers[2] = r2;
+  registers[3] = r3;
+  registers[6] = r6;
+  registers[7] = r7;
+  registers[21] = r21;
+  registers[22] = r22;
+  return AotRuntime::interpret(cpu, pc, count, limit);
+}
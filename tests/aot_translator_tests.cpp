@@ -0,0 +1,305 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "aot_runtime.hpp"
+#include "aot_translator.hpp"
+#include "cpu.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "test_encoding.hpp"
+
+// Translations of the programs below, checked in under tests/aot and
+// regenerated with `simulator translate <program.bin> tests/aot/<name>.cpp aot_<name>`.
+simulator::StopReason aot_fib(simulator::Cpu& cpu, std::uint64_t max_instructions);
+simulator::StopReason aot_kernel(simulator::Cpu& cpu, std::uint64_t max_instructions);
+simulator::StopReason aot_self_modifying(simulator::Cpu& cpu, std::uint64_t max_instructions);
+simulator::StopReason aot_trailing_load(simulator::Cpu& cpu, std::uint64_t max_instructions);
+
+namespace {
+
+namespace opcodes = simulator::opcodes;
+using simulator::test::create_rformat;
+using simulator::test::create_two_reg;
+using simulator::test::create_imm5;
+using simulator::test::create_memory_format;
+using simulator::test::create_ldp;
+using simulator::test::create_branch;
+using simulator::test::create_jump;
+
+constexpr std::uint32_t kSyscall = 0x00000038;
+constexpr std::uint8_t kDataBase = 20;
+constexpr std::uint8_t kLoopCounter = 21;
+constexpr std::uint8_t kMinusOne = 22;
+constexpr std::uint8_t kCountSyscall = 23;
+constexpr std::uint32_t kDataAddress = 0x200;
+constexpr std::size_t kMemorySize = 0x1000;
+
+// examples/fib.rb
+const std::vector<std::uint32_t> kFibProgram = {
+    0x0022201a,  // add r4, r1, r2
+    0x0040081a,  // add r1, r2, r0
+    0x0080101a,  // add r2, r4, r0
+    0x0065181a,  // add r3, r3, r5
+    0x1860fffc,  // bne r3, r0, loop
+    kSyscall,
+};
+
+// A loop over every instruction kind, a jump over dead code, then the
+// instruction count into r14 and exit.
+const std::vector<std::uint32_t> kKernelProgram = {
+    create_ldp(1, 2, 0, kDataBase),                            // loop:
+    create_rformat(opcodes::kADD, 3, 1, 2),
+    create_rformat(opcodes::kXOR, 4, 3, 1),
+    create_two_reg(opcodes::kBDEP, 5, 4, 2),
+    create_rformat(opcodes::kNOR, 6, 5, 3),
+    create_two_reg(opcodes::kCLZ, 7, 6, 0),
+    create_imm5(opcodes::kCBIT, 11, 6, 5),
+    create_memory_format(opcodes::kST, 11, 8, kDataBase),
+    create_memory_format(opcodes::kLD, 12, 8, kDataBase),
+    create_rformat(opcodes::kADD, 13, 13, 12),
+    create_rformat(opcodes::kADD, 13, 13, 7),
+    create_rformat(opcodes::kADD, kLoopCounter, kLoopCounter, kMinusOne),
+    create_branch(opcodes::kBNE, kLoopCounter, 0, -12),         // bne loop
+    create_jump(0x3c),                                          // j done
+    create_rformat(opcodes::kADD, 13, 0, 0),
+    create_rformat(opcodes::kADD, 8, kCountSyscall, 0),         // done:
+    kSyscall,
+    create_rformat(opcodes::kADD, 14, 9, 0),
+    create_rformat(opcodes::kADD, 8, 0, 0),
+    kSyscall,
+};
+
+// Once the counter reaches r3 the loop rewrites its own ADD into XOR.
+const std::vector<std::uint32_t> kSelfModifyingProgram = {
+    create_rformat(opcodes::kADD, 1, 1, 2),
+    create_branch(opcodes::kBNE, kLoopCounter, 3, 2),
+    create_memory_format(opcodes::kST, 4, 0, 0),
+    create_rformat(opcodes::kADD, kLoopCounter, kLoopCounter, kMinusOne),
+    create_branch(opcodes::kBNE, kLoopCounter, 0, -4),
+    kSyscall,
+};
+
+// The load at second is the only memory access of its block and ends it,
+// since the loop starts right after it. The branch back to second is never
+// taken and only makes it a leader.
+const std::vector<std::uint32_t> kTrailingLoadProgram = {
+    create_memory_format(opcodes::kLD, 6, 0, 0),
+    create_rformat(opcodes::kADD, 7, 0, 0),
+    create_memory_format(opcodes::kLD, 2, 0, 3),                // second:
+    create_rformat(opcodes::kADD, 7, 7, 2),                     // loop:
+    create_rformat(opcodes::kADD, kLoopCounter, kLoopCounter, kMinusOne),
+    create_branch(opcodes::kBNE, kLoopCounter, 0, -2),          // bne loop
+    create_branch(opcodes::kBEQ, kLoopCounter, kMinusOne, -4),  // beq second
+    kSyscall,
+};
+
+std::vector<std::uint8_t> image_of(const std::vector<std::uint32_t>& program) {
+  std::vector<std::uint8_t> image;
+  for (std::uint32_t word : program) {
+    for (int i = 0; i < 4; ++i) {
+      image.push_back(static_cast<std::uint8_t>(word >> (8 * i)));
+    }
+  }
+  return image;
+}
+
+struct Machine {
+  simulator::Memory memory {kMemorySize};
+  simulator::Cpu cpu {memory};
+
+  explicit Machine(const std::vector<std::uint32_t>& program) {
+    for (std::size_t i = 0; i < program.size(); ++i) {
+      memory.write_word(i * 4, program[i]);
+    }
+    for (std::uint32_t i = 0; i < 16; ++i) {
+      memory.write_word(kDataAddress + i * 4, 0x9E3779B9u * (i + 1));
+    }
+    cpu.set_register(kDataBase, kDataAddress);
+    cpu.set_register(kMinusOne, static_cast<std::uint32_t>(-1));
+    cpu.set_register(kCountSyscall, 4);
+  }
+};
+
+void expect_same_state(const Machine& expected, const Machine& actual) {
+  EXPECT_EQ(expected.cpu.get_pc(), actual.cpu.get_pc());
+  EXPECT_EQ(expected.cpu.get_instruction_count(), actual.cpu.get_instruction_count());
+  for (std::uint8_t i = 0; i < 32; ++i) {
+    EXPECT_EQ(expected.cpu.get_register(i), actual.cpu.get_register(i)) << "R" << int(i);
+  }
+  for (std::uint32_t address = 0; address < kDataAddress + 0x40; address += 4) {
+    EXPECT_EQ(expected.memory.read_word(address), actual.memory.read_word(address))
+        << "address " << address;
+  }
+}
+
+void set_fib_registers(Machine& machine, std::uint32_t n) {
+  machine.cpu.set_register(1, 0);
+  machine.cpu.set_register(2, 1);
+  machine.cpu.set_register(3, n);
+  machine.cpu.set_register(5, static_cast<std::uint32_t>(-1));
+}
+
+std::string read_text(const std::filesystem::path& path) {
+  std::ifstream file(path);
+  std::ostringstream text;
+  text << file.rdbuf();
+  return text.str();
+}
+
+} // namespace
+
+TEST(AotTranslatorTest, RecoversBlocks) {
+  std::vector<simulator::ImageBlock> blocks = simulator::recover_blocks(image_of(kKernelProgram));
+
+  ASSERT_EQ(blocks.size(), 5);
+  EXPECT_EQ(blocks[0].start, 0x00);
+  EXPECT_EQ(blocks[0].end, 0x34);
+  EXPECT_EQ(blocks[0].successors, (std::vector<std::uint32_t>{0x00, 0x34}));
+  EXPECT_EQ(blocks[1].start, 0x34);
+  EXPECT_EQ(blocks[1].successors, (std::vector<std::uint32_t>{0x3c}));
+  EXPECT_EQ(blocks[2].start, 0x38);
+  EXPECT_EQ(blocks[2].end, 0x3c);
+  EXPECT_EQ(blocks[2].successors, (std::vector<std::uint32_t>{0x3c}));
+  EXPECT_EQ(blocks[3].start, 0x3c);
+  EXPECT_EQ(blocks[3].end, 0x44);
+  EXPECT_EQ(blocks[4].end, 0x50);
+  EXPECT_EQ(blocks[4].successors, (std::vector<std::uint32_t>{0x50}));
+}
+
+TEST(AotTranslatorTest, UndecodableWordEndsBlock) {
+  std::vector<std::uint32_t> program = {
+      create_rformat(opcodes::kADD, 1, 1, 2),
+      0xFFFFFFFF,
+      create_rformat(opcodes::kADD, 1, 1, 2),
+      kSyscall,
+  };
+  std::vector<simulator::ImageBlock> blocks = simulator::recover_blocks(image_of(program));
+
+  ASSERT_EQ(blocks.size(), 1);
+  EXPECT_EQ(blocks[0].end, 0x04);
+  EXPECT_EQ(blocks[0].successors, (std::vector<std::uint32_t>{0x04}));
+}
+
+TEST(AotTranslatorTest, CheckedInTranslationsAreCurrent) {
+  std::filesystem::path directory = std::filesystem::path(__FILE__).parent_path() / "aot";
+  EXPECT_EQ(simulator::translate_program(image_of(kFibProgram), "aot_fib"),
+            read_text(directory / "fib.cpp"));
+  EXPECT_EQ(simulator::translate_program(image_of(kKernelProgram), "aot_kernel"),
+            read_text(directory / "kernel.cpp"));
+  EXPECT_EQ(simulator::translate_program(image_of(kSelfModifyingProgram), "aot_self_modifying"),
+            read_text(directory / "self_modifying.cpp"));
+  EXPECT_EQ(simulator::translate_program(image_of(kTrailingLoadProgram), "aot_trailing_load"),
+            read_text(directory / "trailing_load.cpp"));
+}
+
+TEST(AotTranslatorTest, RejectsInvalidSymbol) {
+  EXPECT_THROW(simulator::translate_program(image_of(kFibProgram), "1fib"), std::runtime_error);
+  EXPECT_THROW(simulator::translate_program(image_of(kFibProgram), "fib()"), std::runtime_error);
+}
+
+TEST(AotTranslatorTest, KernelMatchesInterpreter) {
+  Machine interpreted(kKernelProgram);
+  Machine translated(kKernelProgram);
+  for (Machine* machine : {&interpreted, &translated}) {
+    machine->cpu.set_register(kLoopCounter, 1000);
+  }
+
+  EXPECT_EQ(interpreted.cpu.run_program(), simulator::StopReason::kExited);
+  EXPECT_EQ(aot_kernel(translated.cpu, UINT64_MAX), simulator::StopReason::kExited);
+
+  EXPECT_EQ(translated.cpu.get_register(14), 1000 * 13 + 2);
+  expect_same_state(interpreted, translated);
+}
+
+TEST(AotTranslatorTest, StopsAtEveryLimit) {
+  Machine full(kFibProgram);
+  set_fib_registers(full, 6);
+  full.cpu.run_program();
+  std::uint64_t total = full.cpu.get_instruction_count();
+
+  for (std::uint64_t limit = 0; limit <= total; ++limit) {
+    Machine interpreted(kFibProgram);
+    Machine translated(kFibProgram);
+    set_fib_registers(interpreted, 6);
+    set_fib_registers(translated, 6);
+
+    simulator::StopReason expected = interpreted.cpu.run_program(limit);
+    EXPECT_EQ(aot_fib(translated.cpu, limit), expected);
+    SCOPED_TRACE(limit);
+    expect_same_state(interpreted, translated);
+
+    // The second half enters wherever the first one stopped.
+    if (expected == simulator::StopReason::kInstructionLimit) {
+      interpreted.cpu.run_program();
+      aot_fib(translated.cpu, UINT64_MAX);
+      expect_same_state(interpreted, translated);
+    }
+  }
+}
+
+TEST(AotTranslatorTest, FaultMatchesInterpreter) {
+  Machine interpreted(kKernelProgram);
+  Machine translated(kKernelProgram);
+  for (Machine* machine : {&interpreted, &translated}) {
+    machine->cpu.set_register(kLoopCounter, 10);
+    // LDP reads the last two words, the ST after it faults.
+    machine->cpu.set_register(kDataBase, kMemorySize - 8);
+  }
+
+  EXPECT_THROW(interpreted.cpu.run_program(), std::range_error);
+  EXPECT_THROW(aot_kernel(translated.cpu, UINT64_MAX), std::range_error);
+
+  EXPECT_EQ(translated.cpu.get_pc(), 0x1c);
+  EXPECT_EQ(translated.cpu.get_instruction_count(), 7);
+  expect_same_state(interpreted, translated);
+}
+
+TEST(AotTranslatorTest, FaultAtEndOfBlockMatchesInterpreter) {
+  Machine interpreted(kTrailingLoadProgram);
+  Machine translated(kTrailingLoadProgram);
+  for (Machine* machine : {&interpreted, &translated}) {
+    machine->cpu.set_register(3, kMemorySize);
+    machine->cpu.set_register(kLoopCounter, 10);
+  }
+
+  EXPECT_THROW(interpreted.cpu.run_program(), std::range_error);
+  EXPECT_THROW(aot_trailing_load(translated.cpu, UINT64_MAX), std::range_error);
+
+  EXPECT_EQ(translated.cpu.get_pc(), 0x08);
+  EXPECT_EQ(translated.cpu.get_instruction_count(), 2);
+  expect_same_state(interpreted, translated);
+}
+
+TEST(AotTranslatorTest, StoreIntoImageIsSeen) {
+  Machine interpreted(kSelfModifyingProgram);
+  Machine translated(kSelfModifyingProgram);
+  for (Machine* machine : {&interpreted, &translated}) {
+    machine->cpu.set_register(2, 3);
+    machine->cpu.set_register(3, 100);
+    machine->cpu.set_register(4, create_rformat(opcodes::kXOR, 1, 1, 2));
+    machine->cpu.set_register(kLoopCounter, 300);
+  }
+
+  interpreted.cpu.run_program();
+  aot_self_modifying(translated.cpu, UINT64_MAX);
+
+  expect_same_state(interpreted, translated);
+}
+
+TEST(AotTranslatorTest, BreakpointsRunInInterpreter) {
+  Machine interpreted(kFibProgram);
+  Machine translated(kFibProgram);
+  for (Machine* machine : {&interpreted, &translated}) {
+    set_fib_registers(*machine, 10);
+    machine->cpu.set_breakpoint(0x0c);
+  }
+
+  EXPECT_EQ(interpreted.cpu.run_program(), simulator::StopReason::kBreakpoint);
+  EXPECT_EQ(aot_fib(translated.cpu, UINT64_MAX), simulator::StopReason::kBreakpoint);
+  expect_same_state(interpreted, translated);
+}
@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "assembler.hpp"
+#include "cpu.hpp"
+#include "instruction_parser.hpp"
+#include "interactive_simulator.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+
+namespace {
+
+namespace opcodes = simulator::opcodes;
+
+constexpr std::size_t kMemorySize = 0x1000;
+
+const char* const kFibSource =
+    "# Fibonacci numbers\n"
+    "loop:\n"
+    "  add r4, r1, r2\n"
+    "  add r1, r2, r0\n"
+    "  add r2, r4, r0\n"
+    "  add r3, r3, r5\n"
+    "  bne r3, r0, loop\n"
+    "  syscall\n";
+
+std::vector<std::uint32_t> words(const simulator::AssembledProgram& program) {
+  std::vector<std::uint32_t> result(program.image.size() / 4);
+  for (std::size_t i = 0; i < result.size(); ++i) {
+    for (std::size_t byte = 0; byte < 4; ++byte) {
+      result[i] |= static_cast<std::uint32_t>(program.image[i * 4 + byte]) << (8 * byte);
+    }
+  }
+  return result;
+}
+
+std::string error_of(const std::string& source) {
+  try {
+    simulator::assemble(source, "prog.s");
+  } catch (const std::runtime_error& error) {
+    return error.what();
+  }
+  return {};
+}
+
+} // namespace
+
+TEST(AssemblerTest, EncodesEveryOpcode) {
+  std::vector<std::uint32_t> program = words(simulator::assemble(
+      "nor r1, r2, r3\n"
+      "add r1, r2, r3\n"
+      "xor r1, r2, r3\n"
+      "bdep r1, r2, r3\n"
+      "clz r1, r2\n"
+      "cbit r1, r2, 31\n"
+      "ssat r1, r2, 7\n"
+      "ld r1, -8(r2)\n"
+      "st r1, 0x10(r2)\n"
+      "ldp r1, r3, 2047(r2)\n"
+      "beq r1, r2, 0\n"
+      "bne r1, r2, 0x40\n"
+      "j 0x40\n"
+      "syscall 5\n"));
+  ASSERT_EQ(program.size(), 14);
+
+  std::vector<simulator::DecodedInstruction> decoded;
+  for (std::uint32_t word : program) {
+    decoded.push_back(simulator::InstructionParser::decode(word));
+  }
+  const std::uint8_t expected[] = {
+      opcodes::kNOR, opcodes::kADD, opcodes::kXOR, opcodes::kBDEP, opcodes::kCLZ,
+      opcodes::kCBIT, opcodes::kSSAT, opcodes::kLD, opcodes::kST, opcodes::kLDP,
+      opcodes::kBEQ, opcodes::kBNE, opcodes::kJj, opcodes::kSYSCALL};
+  for (std::size_t i = 0; i < program.size(); ++i) {
+    EXPECT_EQ(decoded[i].opcode, expected[i]) << i;
+  }
+
+  EXPECT_EQ(program[1], (2u << 21) | (3u << 16) | (1u << 11) | opcodes::kADD);
+  EXPECT_EQ(decoded[3].rd, 1);
+  EXPECT_EQ(decoded[3].rs, 2);
+  EXPECT_EQ(decoded[3].rt, 3);
+  EXPECT_EQ(decoded[4].rs, 2);
+  EXPECT_EQ(decoded[5].imm, 31);
+  EXPECT_EQ(decoded[7].rd, 1);
+  EXPECT_EQ(decoded[7].rs, 2);
+  EXPECT_EQ(decoded[7].imm, -8);
+  EXPECT_EQ(decoded[8].imm, 0x10);
+  EXPECT_EQ(decoded[9].rt, 3);
+  EXPECT_EQ(decoded[9].imm, 2047);
+  // Branches are relative to their own address.
+  EXPECT_EQ(decoded[10].imm, -40);
+  EXPECT_EQ(decoded[11].imm, 0x40 - 44);
+  EXPECT_EQ(decoded[12].imm, 0x40);
+  EXPECT_EQ(decoded[13].imm, 5);
+}
+
+TEST(AssemblerTest, ResolvesLabels) {
+  simulator::AssembledProgram program = simulator::assemble(
+      "start: J skip   ; forward\n"
+      "\n"
+      "back:\n"
+      "  ADD r1, r1, r2\n"
+      "skip: done:\n"
+      "  BEQ r1, r0, back\n"
+      "  Bne r1, r0, end\n"
+      "end: .word 0xdeadbeef, -1, back\n");
+
+  std::vector<std::uint32_t> program_words = words(program);
+  ASSERT_EQ(program_words.size(), 7);
+  EXPECT_EQ(simulator::InstructionParser::decode(program_words[0]).imm, 8);
+  EXPECT_EQ(simulator::InstructionParser::decode(program_words[2]).imm, -4);
+  EXPECT_EQ(simulator::InstructionParser::decode(program_words[3]).imm, 4);
+  EXPECT_EQ(program_words[4], 0xdeadbeef);
+  EXPECT_EQ(program_words[5], 0xffffffff);
+  EXPECT_EQ(program_words[6], 4);
+
+  ASSERT_EQ(program.symbols.size(), 5);
+  EXPECT_EQ(program.symbols[0].name, "start");
+  EXPECT_EQ(program.symbols[2].name, "skip");
+  EXPECT_EQ(program.symbols[3].name, "done");
+  EXPECT_EQ(program.find_symbol("end"), 16);
+  EXPECT_FALSE(program.find_symbol("missing").has_value());
+
+  EXPECT_EQ(simulator::symbolize(program.symbols, 4), "back");
+  EXPECT_EQ(simulator::symbolize(program.symbols, 0x18), "end+0x8");
+  EXPECT_EQ(simulator::symbolize({}, 0x18), "0x00000018");
+}
+
+TEST(AssemblerTest, ReportsErrorsWithLines) {
+  EXPECT_EQ(error_of("add r1, r2, r3\nmul r1, r2, r3\n"), "prog.s:2: Unknown mnemonic: mul");
+  EXPECT_EQ(error_of("add r1, r2, r32\n"), "prog.s:1: Invalid register: r32");
+  EXPECT_EQ(error_of("add r1, r2\n"), "prog.s:1: ADD takes 3 operands");
+  EXPECT_EQ(error_of("add r1, r2, r3, r4\n"), "prog.s:1: Too many operands");
+  EXPECT_EQ(error_of("\n\nbne r1, r0, nowhere\n"), "prog.s:3: Undefined label: nowhere");
+  EXPECT_EQ(error_of("a:\na:\n"), "prog.s:2: Duplicate label: a");
+  EXPECT_EQ(error_of("1a: add r1, r2, r3\n"), "prog.s:1: Invalid label: 1a");
+  EXPECT_EQ(error_of("cbit r1, r2, 32\n"), "prog.s:1: Value out of range: 32");
+  EXPECT_EQ(error_of("ld r1, 40000(r2)\n"), "prog.s:1: Value out of range: 40000");
+  EXPECT_EQ(error_of("ldp r1, r2, -4(r3)\n"), "prog.s:1: Value out of range: -4");
+  EXPECT_EQ(error_of("st r1, r2\n"), "prog.s:1: Expected offset(base): r2");
+  EXPECT_EQ(error_of("j 6\n"), "prog.s:1: Unaligned target: 6");
+  EXPECT_EQ(error_of("beq r1, r2, 0x40000\n"), "prog.s:1: Branch target out of range: 0x40000");
+  EXPECT_EQ(error_of("j 0x10000000\n"), "prog.s:1: Jump target out of range: 0x10000000");
+  EXPECT_EQ(error_of("syscall 0x1g\n"), "prog.s:1: Invalid number: 0x1g");
+}
+
+TEST(AssemblerTest, AssembledProgramRuns) {
+  simulator::AssembledProgram program = simulator::assemble(kFibSource);
+  simulator::Memory memory(kMemorySize);
+  simulator::Cpu cpu(memory);
+  memory.write_block(0, program.image.data(), program.image.size());
+  cpu.set_register(2, 1);
+  cpu.set_register(3, 10);
+  cpu.set_register(5, static_cast<std::uint32_t>(-1));
+
+  EXPECT_EQ(cpu.run_program(), simulator::StopReason::kExited);
+  EXPECT_EQ(cpu.get_register(2), 89);
+}
+
+TEST(AssemblerTest, LoadAssemblesSourceFiles) {
+  std::filesystem::path path = std::filesystem::temp_directory_path()
+                               / ("simulator_assembler_"
+                                  + std::to_string(::testing::UnitTest::GetInstance()->random_seed())
+                                  + ".s");
+  {
+    std::ofstream source(path);
+    source << kFibSource;
+  }
+  std::istringstream commands(
+      "load\n" + path.string() + "\n"
+      "symbols\n"
+      "sr\n2 1\n"
+      "sr\n3 10\n"
+      "sr\n5 -1\n"
+      "run_program\n");
+  std::ostringstream output;
+  simulator::InteractiveSimulator replay(kMemorySize, commands, output);
+
+  replay.start();
+  std::filesystem::remove(path);
+
+  EXPECT_EQ(output.str(), "loop = 0\n");
+  EXPECT_EQ(replay.get_simulator().get_cpu().get_register(2), 89);
+  EXPECT_TRUE(simulator::is_assembly_file(path.string()));
+  EXPECT_FALSE(simulator::is_assembly_file("fib.bin"));
+  EXPECT_THROW(simulator::assemble_file(path.string()), std::runtime_error);
+}
@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "batch_cpu.hpp"
+#include "cpu.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "test_encoding.hpp"
+
+namespace {
+
+namespace opcodes = simulator::opcodes;
+using simulator::test::create_rformat;
+using simulator::test::create_two_reg;
+using simulator::test::create_imm5;
+using simulator::test::create_memory_format;
+using simulator::test::create_branch;
+
+constexpr std::uint32_t kSyscall = 0x00000038;
+constexpr std::uint8_t kDataBase = 20;
+constexpr std::uint8_t kLoopCounter = 21;
+constexpr std::uint8_t kMinusOne = 22;
+constexpr std::uint32_t kDataAddress = 0x200;
+constexpr std::size_t kMemorySize = 4096;
+constexpr std::size_t kLanes = 37;
+
+std::vector<std::uint8_t> to_bytes(const std::vector<std::uint32_t>& program) {
+  std::vector<std::uint8_t> bytes;
+  for (std::uint32_t word : program) {
+    for (int i = 0; i < 4; ++i) {
+      bytes.push_back(static_cast<std::uint8_t>(word >> (8 * i)));
+    }
+  }
+  return bytes;
+}
+
+// Loop body with a data dependent forward branch so lanes diverge and
+// reconverge on every iteration.
+std::vector<std::uint32_t> generate_program(std::mt19937& random) {
+  std::uniform_int_distribution<int> kind(0, 10);
+  std::uniform_int_distribution<int> reg(0, 7);
+  std::uniform_int_distribution<int> imm(0, 31);
+  std::uniform_int_distribution<int> slot(0, 30);
+
+  std::vector<std::uint32_t> program;
+  for (int i = 0; i < 24; ++i) {
+    std::uint8_t rd = reg(random);
+    std::uint8_t rs = reg(random);
+    std::uint8_t rt = reg(random);
+    std::uint16_t offset = slot(random) * 4;
+    switch (kind(random)) {
+      case 0: program.push_back(create_rformat(opcodes::kADD, rd, rs, rt)); break;
+      case 1: program.push_back(create_rformat(opcodes::kXOR, rd, rs, rt)); break;
+      case 2: program.push_back(create_rformat(opcodes::kNOR, rd, rs, rt)); break;
+      case 3: program.push_back(create_imm5(opcodes::kCBIT, rd, rs, imm(random))); break;
+      case 4: program.push_back(create_two_reg(opcodes::kCLZ, rd, rs, 0)); break;
+      case 5: program.push_back(create_two_reg(opcodes::kBDEP, rd, rs, rt)); break;
+      case 6: program.push_back(create_imm5(opcodes::kSSAT, rd, rs, imm(random))); break;
+      case 7: program.push_back(create_memory_format(opcodes::kLD, rd, offset, kDataBase)); break;
+      case 8: program.push_back(create_memory_format(opcodes::kST, rt, offset, kDataBase)); break;
+      case 9: program.push_back(create_branch(opcodes::kBEQ, rs, rt, 2)); break;
+      default: program.push_back(create_branch(opcodes::kBNE, rs, rt, 2)); break;
+    }
+  }
+  // A branch in the last slot must not skip the loop counter update.
+  program.push_back(create_rformat(opcodes::kADD, 0, 0, 0));
+  program.push_back(create_rformat(opcodes::kADD, kLoopCounter, kLoopCounter, kMinusOne));
+  program.push_back(create_branch(opcodes::kBNE, kLoopCounter, 0,
+                                  -static_cast<std::int16_t>(program.size())));
+  program.push_back(kSyscall);
+  return program;
+}
+
+struct LaneState {
+  std::vector<std::uint32_t> registers;
+  std::vector<std::uint32_t> data;
+};
+
+LaneState initial_state(std::uint32_t seed) {
+  std::mt19937 random(seed);
+  LaneState state {std::vector<std::uint32_t>(32, 0), {}};
+  for (std::uint8_t i = 1; i < 8; ++i) {
+    state.registers[i] = random() % 4 == 0 ? 0 : random();
+  }
+  for (std::uint32_t i = 0; i < 32; ++i) {
+    state.data.push_back(random());
+  }
+  state.registers[kDataBase] = kDataAddress;
+  state.registers[kLoopCounter] = 20 + seed % 13;
+  state.registers[kMinusOne] = static_cast<std::uint32_t>(-1);
+  return state;
+}
+
+void load_lane(simulator::BatchCpu& batch, std::size_t lane, const LaneState& state) {
+  for (std::uint8_t i = 0; i < 32; ++i) {
+    batch.set_register(lane, i, state.registers[i]);
+  }
+  for (std::uint32_t i = 0; i < state.data.size(); ++i) {
+    batch.get_memory(lane).write_word(kDataAddress + i * 4, state.data[i]);
+  }
+}
+
+void expect_lane_matches_cpu(simulator::BatchCpu& batch, std::size_t lane,
+                             const std::vector<std::uint32_t>& program,
+                             const LaneState& state) {
+  simulator::Memory memory(kMemorySize);
+  simulator::Cpu cpu(memory, simulator::ExecutionEngine::kStaged);
+  for (std::size_t i = 0; i < program.size(); ++i) {
+    memory.write_word(i * 4, program[i]);
+  }
+  for (std::uint8_t i = 0; i < 32; ++i) {
+    cpu.set_register(i, state.registers[i]);
+  }
+  for (std::uint32_t i = 0; i < state.data.size(); ++i) {
+    memory.write_word(kDataAddress + i * 4, state.data[i]);
+  }
+
+  bool faulted = false;
+  try {
+    cpu.run_program();
+  } catch (const std::exception&) {
+    faulted = true;
+  }
+
+  SCOPED_TRACE(lane);
+  EXPECT_EQ(batch.get_status(lane),
+            faulted ? simulator::LaneStatus::kFaulted : simulator::LaneStatus::kExited);
+  EXPECT_EQ(static_cast<std::int32_t>(batch.get_pc(lane)), cpu.get_pc());
+  EXPECT_EQ(batch.get_instruction_count(lane), cpu.get_instruction_count());
+  for (std::uint8_t i = 0; i < 32; ++i) {
+    EXPECT_EQ(batch.get_register(lane, i), cpu.get_register(i)) << "R" << int(i);
+  }
+  for (std::uint32_t i = 0; i < kMemorySize; i += 4) {
+    EXPECT_EQ(batch.get_memory(lane).read_word(i), memory.read_word(i));
+  }
+}
+
+} // namespace
+
+TEST(BatchCpuTest, RandomDivergentProgramsMatchCpu) {
+  std::mt19937 random(7);
+  for (std::uint32_t round = 0; round < 20; ++round) {
+    std::vector<std::uint32_t> program = generate_program(random);
+    simulator::BatchCpu batch(kLanes, kMemorySize);
+    batch.load_program(to_bytes(program));
+
+    std::vector<LaneState> states;
+    for (std::size_t lane = 0; lane < kLanes; ++lane) {
+      states.push_back(initial_state(round * 1000 + lane));
+      load_lane(batch, lane, states.back());
+    }
+
+    batch.run_program();
+
+    SCOPED_TRACE(round);
+    for (std::size_t lane = 0; lane < kLanes; ++lane) {
+      expect_lane_matches_cpu(batch, lane, program, states[lane]);
+    }
+  }
+}
+
+TEST(BatchCpuTest, FaultStopsOnlyThatLane) {
+  std::vector<std::uint32_t> program = {
+      create_memory_format(opcodes::kLD, 3, 0, 1),
+      create_rformat(opcodes::kADD, 4, 3, 3),
+      kSyscall,
+  };
+  simulator::BatchCpu batch(4, kMemorySize);
+  batch.load_program(to_bytes(program));
+  batch.set_register(2, 1, 2);
+  batch.set_register(3, 1, kMemorySize);
+
+  batch.run_program();
+
+  EXPECT_EQ(batch.get_status(0), simulator::LaneStatus::kExited);
+  EXPECT_EQ(batch.get_status(1), simulator::LaneStatus::kExited);
+  EXPECT_EQ(batch.get_status(2), simulator::LaneStatus::kFaulted);
+  EXPECT_EQ(batch.get_status(3), simulator::LaneStatus::kFaulted);
+  EXPECT_FALSE(batch.get_fault(2).empty());
+  EXPECT_EQ(batch.get_pc(2), 0);
+  EXPECT_EQ(batch.get_instruction_count(2), 0);
+  EXPECT_EQ(batch.get_pc(0), 12);
+  EXPECT_EQ(batch.get_register(0, 4), 2 * program[0]);
+}
+
+TEST(BatchCpuTest, LaneRewritingItsCodeRunsAlone) {
+  // Lane 1 overwrites the ADD at address 8 with an XOR before reaching it.
+  std::vector<std::uint32_t> program = {
+      create_branch(opcodes::kBEQ, 5, 0, 2),
+      create_memory_format(opcodes::kST, 4, 8, 0),
+      create_rformat(opcodes::kADD, 1, 1, 2),
+      kSyscall,
+  };
+  simulator::BatchCpu batch(3, kMemorySize);
+  batch.load_program(to_bytes(program));
+  for (std::size_t lane = 0; lane < 3; ++lane) {
+    batch.set_register(lane, 1, 6);
+    batch.set_register(lane, 2, 3);
+    batch.set_register(lane, 4, create_rformat(opcodes::kXOR, 1, 1, 2));
+  }
+  batch.set_register(1, 5, 1);
+
+  batch.run_program();
+
+  EXPECT_EQ(batch.get_register(0, 1), 9);
+  EXPECT_EQ(batch.get_register(1, 1), 5);
+  EXPECT_EQ(batch.get_register(2, 1), 9);
+  EXPECT_EQ(batch.get_instruction_count(0), 3);
+  EXPECT_EQ(batch.get_instruction_count(1), 4);
+}
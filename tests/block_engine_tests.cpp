@@ -0,0 +1,238 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+#include "cpu.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "test_encoding.hpp"
+
+namespace {
+
+using simulator::test::create_rformat;
+using simulator::test::create_memory_format;
+using simulator::test::create_ldp;
+
+constexpr std::uint32_t kSyscall = 0x00000038;
+// Two pages, so stores can miss the page holding the code.
+constexpr std::size_t kMemorySize = 0x2000;
+
+void load(simulator::Memory& memory, const std::vector<std::uint32_t>& program) {
+  for (std::size_t i = 0; i < program.size(); ++i) {
+    memory.write_word(i * 4, program[i]);
+  }
+}
+
+class BlockEngineTest : public ::testing::Test {
+ protected:
+  simulator::Memory block_memory_ {kMemorySize};
+  simulator::Memory staged_memory_ {kMemorySize};
+  simulator::Cpu block_ {block_memory_, simulator::ExecutionEngine::kBlock};
+  simulator::Cpu staged_ {staged_memory_, simulator::ExecutionEngine::kStaged};
+
+  void load_both(const std::vector<std::uint32_t>& program) {
+    load(block_memory_, program);
+    load(staged_memory_, program);
+  }
+
+  void set_register_both(std::uint8_t index, std::uint32_t value) {
+    block_.set_register(index, value);
+    staged_.set_register(index, value);
+  }
+
+  void write_word_both(std::uint32_t address, std::uint32_t value) {
+    block_memory_.write_word(address, value);
+    staged_memory_.write_word(address, value);
+  }
+
+  void run_and_compare() {
+    block_.run_program();
+    staged_.run_program();
+
+    EXPECT_EQ(block_.get_pc(), staged_.get_pc());
+    EXPECT_EQ(block_.get_instruction_count(), staged_.get_instruction_count());
+    for (std::uint8_t i = 0; i < 32; ++i) {
+      EXPECT_EQ(block_.get_register(i), staged_.get_register(i)) << "R" << int(i);
+    }
+  }
+};
+
+} // namespace
+
+TEST_F(BlockEngineTest, FibonacciLoop) {
+  using simulator::opcodes::kADD;
+  load_both({
+      create_rformat(kADD, 4, 1, 2),
+      create_rformat(kADD, 1, 2, 0),
+      create_rformat(kADD, 2, 4, 0),
+      create_rformat(kADD, 3, 3, 5),
+      0x1860fffc,  // bne r3, r0, -4
+      kSyscall,
+  });
+  set_register_both(2, 1);
+  set_register_both(3, 40);
+  set_register_both(5, static_cast<std::uint32_t>(-1));
+
+  run_and_compare();
+
+  EXPECT_EQ(block_.get_register(1), 102334155);
+  EXPECT_EQ(block_.get_instruction_count(), 201);
+}
+
+TEST_F(BlockEngineTest, FusedLoads) {
+  using simulator::opcodes::kADD;
+  using simulator::opcodes::kLD;
+  load_both({
+      create_ldp(1, 2, 0, 10),
+      create_ldp(3, 4, 8, 10),
+      create_memory_format(kLD, 5, 16, 10),
+      create_rformat(kADD, 6, 5, 1),
+      kSyscall,
+  });
+  for (std::uint32_t i = 0; i < 5; ++i) {
+    write_word_both(0x100 + i * 4, 0x11 * (i + 1));
+  }
+  set_register_both(10, 0x100);
+
+  run_and_compare();
+
+  EXPECT_EQ(block_.get_register(4), 0x44);
+  EXPECT_EQ(block_.get_register(6), 0x55 + 0x11);
+}
+
+TEST_F(BlockEngineTest, StoreIntoCurrentBlockIsExecuted) {
+  using simulator::opcodes::kADD;
+  using simulator::opcodes::kST;
+  using simulator::opcodes::kXOR;
+  load_both({
+      create_memory_format(kST, 1, 8, 0),
+      create_rformat(kADD, 2, 2, 3),
+      create_rformat(kXOR, 4, 2, 3),
+      kSyscall,
+  });
+  set_register_both(1, create_rformat(kADD, 4, 2, 3));
+  set_register_both(2, 5);
+  set_register_both(3, 7);
+
+  run_and_compare();
+
+  EXPECT_EQ(block_.get_register(4), 19);
+}
+
+TEST_F(BlockEngineTest, StoreEndingBlockIntoLinkedSuccessorIsExecuted) {
+  using simulator::opcodes::kADD;
+  using simulator::opcodes::kBNE;
+  using simulator::opcodes::kST;
+  using simulator::opcodes::kXOR;
+  // The store ends a full block of 64 instructions. The first pass
+  // writes the data page and links the successor, the second rewrites
+  // the successor's first instruction.
+  std::vector<std::uint32_t> program(63, create_rformat(kADD, 7, 7, 0));
+  program.push_back(create_memory_format(kST, 1, 0, 2));
+  program.push_back(create_rformat(kADD, 3, 3, 6));
+  program.push_back(create_rformat(kXOR, 2, 2, 11));
+  program.push_back(create_rformat(kADD, 4, 4, 5));
+  program.push_back(create_memory_format(kBNE, 0, static_cast<std::uint16_t>(-67), 4));
+  program.push_back(kSyscall);
+  load_both(program);
+  set_register_both(1, create_rformat(kADD, 3, 3, 10));
+  set_register_both(2, 0x1000);
+  set_register_both(11, 0x1000 ^ 0x100);
+  set_register_both(4, 2);
+  set_register_both(5, static_cast<std::uint32_t>(-1));
+  set_register_both(6, 1);
+  set_register_both(10, 100);
+
+  run_and_compare();
+
+  EXPECT_EQ(block_.get_register(3), 101);
+}
+
+TEST_F(BlockEngineTest, FaultInsideBlockReportsFaultingInstruction) {
+  using simulator::opcodes::kADD;
+  using simulator::opcodes::kLD;
+  load(block_memory_, {
+      create_rformat(kADD, 1, 1, 2),
+      create_rformat(kADD, 1, 1, 2),
+      create_memory_format(kLD, 3, 0, 4),
+      kSyscall,
+  });
+  block_.set_register(2, 1);
+  block_.set_register(4, 0x10000);
+
+  EXPECT_THROW(block_.run_program(), std::range_error);
+  EXPECT_EQ(block_.get_pc(), 8);
+  EXPECT_EQ(block_.get_instruction_count(), 2);
+  EXPECT_EQ(block_.get_register(1), 2);
+}
+
+TEST_F(BlockEngineTest, UncheckedStoreIntoCurrentBlockIsExecuted) {
+  using simulator::opcodes::kADD;
+  using simulator::opcodes::kST;
+  using simulator::opcodes::kXOR;
+  load_both({
+      create_memory_format(kST, 1, 8, 0),
+      create_rformat(kADD, 2, 2, 3),
+      create_rformat(kXOR, 4, 2, 3),
+      kSyscall,
+  });
+  set_register_both(1, create_rformat(kADD, 4, 2, 3));
+  set_register_both(2, 5);
+  set_register_both(3, 7);
+  block_.set_memory_access(simulator::MemoryAccess::kUnchecked);
+
+  run_and_compare();
+
+  EXPECT_EQ(block_.get_register(4), 19);
+}
+
+TEST_F(BlockEngineTest, TrappingAccessFaultsLikeChecked) {
+  using simulator::opcodes::kADD;
+  using simulator::opcodes::kLD;
+  load(block_memory_, {
+      create_rformat(kADD, 1, 1, 2),
+      create_memory_format(kLD, 3, 0, 4),
+      kSyscall,
+  });
+  block_.set_memory_access(simulator::MemoryAccess::kTrapping);
+
+  block_.set_register(4, kMemorySize - 2);
+  EXPECT_THROW(block_.run_program(), std::range_error);
+  EXPECT_EQ(block_.get_pc(), 4);
+
+  block_.set_pc(0);
+  block_.set_register(4, 0x102);
+  EXPECT_THROW(block_.run_program(), std::runtime_error);
+  EXPECT_EQ(block_.get_pc(), 4);
+
+  block_.set_pc(0);
+  block_.set_register(4, 0x100);
+  block_memory_.write_word(0x100, 0x1234);
+  block_.run_program();
+  EXPECT_EQ(block_.get_register(3), 0x1234);
+}
+
+TEST_F(BlockEngineTest, InstructionLimitIsExact) {
+  using simulator::opcodes::kADD;
+  std::vector<std::uint32_t> program = {
+      create_rformat(kADD, 1, 1, 2),
+      create_rformat(kADD, 3, 3, 2),
+      0x1860fffe,  // bne r3, r0, -2
+      kSyscall,
+  };
+  load_both(program);
+  set_register_both(2, 1);
+  set_register_both(3, static_cast<std::uint32_t>(-10000));
+  block_.set_jit_enabled(simulator::JitCompiler::is_supported());
+
+  for (std::uint64_t limit : {1, 2, 3, 100, 1000, 10001}) {
+    EXPECT_EQ(block_.run_program(limit), simulator::StopReason::kInstructionLimit);
+    EXPECT_EQ(staged_.run_program(limit), simulator::StopReason::kInstructionLimit);
+    EXPECT_EQ(block_.get_instruction_count(), staged_.get_instruction_count());
+    EXPECT_EQ(block_.get_pc(), staged_.get_pc());
+    EXPECT_EQ(block_.get_register(3), staged_.get_register(3));
+  }
+  EXPECT_EQ(block_.run_program(UINT64_MAX), simulator::StopReason::kExited);
+  EXPECT_EQ(staged_.run_program(UINT64_MAX), simulator::StopReason::kExited);
+  EXPECT_EQ(block_.get_instruction_count(), staged_.get_instruction_count());
+  EXPECT_EQ(block_.get_register(1), staged_.get_register(1));
+}
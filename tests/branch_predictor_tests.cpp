@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "branch_predictor.hpp"
+#include "cpu.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "state_report.hpp"
+#include "test_encoding.hpp"
+#include "threaded_engine.hpp"
+
+namespace {
+
+namespace opcodes = simulator::opcodes;
+using simulator::test::create_rformat;
+using simulator::test::create_branch;
+using simulator::test::create_jump;
+using simulator::BranchPredictor;
+using simulator::PredictorConfig;
+using simulator::PredictorKind;
+
+constexpr std::uint32_t kSyscall = 0x00000038;
+constexpr std::uint32_t kBranch = 0x100;
+constexpr std::uint32_t kIterations = 32;
+
+// Counts r3 down to zero, jumping over an add on every iteration.
+const std::vector<std::uint32_t> kLoopProgram = {
+    create_rformat(opcodes::kADD, 3, 3, 5),            // loop:
+    create_jump(0xc),                                  // j test
+    create_rformat(opcodes::kADD, 4, 4, 6),
+    create_branch(opcodes::kBNE, 3, 0, -3),            // test: bne loop
+    kSyscall,
+};
+
+// Counts r3 down to zero, the add and the branch fuse in the block engine.
+const std::vector<std::uint32_t> kCountdownProgram = {
+    create_rformat(opcodes::kADD, 3, 3, 5),            // loop:
+    create_branch(opcodes::kBNE, 3, 0, -1),            // bne loop
+    kSyscall,
+};
+
+void load_loop_program(simulator::Memory& memory, simulator::Cpu& cpu,
+                       const std::vector<std::uint32_t>& program = kLoopProgram) {
+  for (std::size_t i = 0; i < program.size(); ++i) {
+    memory.write_word(i * 4, program[i]);
+  }
+  cpu.set_register(3, kIterations);
+  cpu.set_register(5, static_cast<std::uint32_t>(-1));
+  cpu.set_register(6, 1);
+}
+
+// Runs a loop branch of trip count iterations, periods times.
+std::uint64_t loop_mispredictions(PredictorKind kind, std::uint32_t trip_count,
+                                  std::uint32_t periods) {
+  BranchPredictor predictor({kind});
+  for (std::uint32_t period = 0; period < periods; ++period) {
+    for (std::uint32_t i = 1; i <= trip_count; ++i) {
+      predictor.conditional(kBranch, i != trip_count);
+    }
+  }
+  return predictor.stats().mispredicted;
+}
+
+} // namespace
+
+TEST(BranchPredictorTest, RejectsInvalidConfig) {
+  EXPECT_THROW(BranchPredictor({PredictorKind::kBimodal, 0}), std::runtime_error);
+  EXPECT_THROW(BranchPredictor({PredictorKind::kBimodal, 25}), std::runtime_error);
+  EXPECT_THROW(BranchPredictor({PredictorKind::kGshare, 12, 65}), std::runtime_error);
+  EXPECT_THROW(BranchPredictor({PredictorKind::kGshare, 12, 12, 3}), std::runtime_error);
+}
+
+TEST(BranchPredictorTest, NotTakenMissesEveryTakenBranch) {
+  BranchPredictor predictor({PredictorKind::kNotTaken});
+  EXPECT_FALSE(predictor.conditional(kBranch, true));
+  EXPECT_TRUE(predictor.conditional(kBranch, false));
+  EXPECT_FALSE(predictor.conditional(kBranch, true));
+
+  EXPECT_EQ(predictor.stats().conditional, 3);
+  EXPECT_EQ(predictor.stats().mispredicted, 2);
+  EXPECT_EQ(predictor.pc_counts(kBranch).taken, 2);
+  EXPECT_EQ(predictor.pc_counts(kBranch).mispredicted, 2);
+  EXPECT_EQ(predictor.pc_counts(kBranch + 4).executed, 0);
+}
+
+TEST(BranchPredictorTest, BimodalMissesOnlyLoopExits) {
+  // The first taken branch and every exit.
+  EXPECT_EQ(loop_mispredictions(PredictorKind::kBimodal, 8, 100), 1 + 100);
+  EXPECT_EQ(loop_mispredictions(PredictorKind::kNotTaken, 8, 100), 7 * 100);
+}
+
+TEST(BranchPredictorTest, GshareLearnsAlternatingBranches) {
+  BranchPredictor bimodal({PredictorKind::kBimodal});
+  BranchPredictor gshare({PredictorKind::kGshare});
+  for (int i = 0; i < 1000; ++i) {
+    bimodal.conditional(kBranch, i % 2 == 0);
+    gshare.conditional(kBranch, i % 2 == 0);
+  }
+
+  EXPECT_EQ(bimodal.stats().mispredicted, 1000);
+  EXPECT_LT(gshare.stats().mispredicted, 20);
+}
+
+TEST(BranchPredictorTest, TageLearnsExitsBeyondGshareHistory) {
+  // 24 iterations do not fit in 12 bits of history, but do in 32.
+  std::uint64_t gshare = loop_mispredictions(PredictorKind::kGshare, 24, 200);
+  std::uint64_t tage = loop_mispredictions(PredictorKind::kTage, 24, 200);
+
+  EXPECT_GE(gshare, 200);
+  EXPECT_LT(tage, gshare / 4);
+}
+
+TEST(BranchPredictorTest, TargetBufferPredictsRepeatedJumps) {
+  PredictorConfig config;
+  config.btb_entries = 2;
+  BranchPredictor predictor(config);
+  EXPECT_FALSE(predictor.jump(0x0, 0x40));
+  EXPECT_TRUE(predictor.jump(0x0, 0x40));
+  // 0x8 maps to the same entry as 0x0.
+  EXPECT_FALSE(predictor.jump(0x8, 0x80));
+  EXPECT_FALSE(predictor.jump(0x0, 0x40));
+  EXPECT_TRUE(predictor.jump(0x0, 0x40));
+
+  EXPECT_EQ(predictor.stats().jumps, 5);
+  EXPECT_EQ(predictor.stats().btb_misses, 3);
+  EXPECT_EQ(predictor.mispredicted_branches().front().first, 0x0);
+
+  predictor.clear();
+  EXPECT_EQ(predictor.stats().branches(), 0);
+  EXPECT_FALSE(predictor.jump(0x0, 0x40));
+}
+
+TEST(BranchPredictorTest, PredictedRunCountsBranchesAndJumps) {
+  simulator::Memory memory(0x1000);
+  simulator::Cpu cpu(memory, simulator::ExecutionEngine::kBlock);
+  load_loop_program(memory, cpu);
+  cpu.set_branch_prediction_enabled(true, {PredictorKind::kBimodal});
+
+  EXPECT_EQ(cpu.run_program(), simulator::StopReason::kExited);
+  EXPECT_EQ(cpu.get_register(4), 0);
+
+  const simulator::BranchStats& stats = cpu.get_branch_predictor()->stats();
+  EXPECT_EQ(stats.conditional, kIterations);
+  EXPECT_EQ(stats.mispredicted, 2);
+  EXPECT_EQ(stats.jumps, kIterations);
+  EXPECT_EQ(stats.btb_misses, 1);
+  EXPECT_DOUBLE_EQ(stats.mpki(cpu.get_instruction_count()),
+                   3000.0 / static_cast<double>(cpu.get_instruction_count()));
+
+  simulator::StateReport report = simulator::StateReport::capture(cpu, "exited");
+  ASSERT_TRUE(report.branches.has_value());
+  std::ostringstream text;
+  simulator::write_report(text, report, simulator::ReportFormat::kJson);
+  EXPECT_NE(text.str().find("\"mispredictions\":3"), std::string::npos);
+
+  std::ostringstream branches;
+  cpu.get_branch_predictor()->write_report(branches, cpu.get_instruction_count());
+  EXPECT_NE(branches.str().find("MPKI:"), std::string::npos);
+  EXPECT_NE(branches.str().find("0x0000000c"), std::string::npos);
+
+  cpu.set_branch_prediction_enabled(false);
+  EXPECT_EQ(cpu.get_branch_predictor(), nullptr);
+  EXPECT_FALSE(simulator::StateReport::capture(cpu, "exited").branches.has_value());
+}
+
+TEST(BranchPredictorTest, BlockEngineMatchesStagedRun) {
+  for (const std::vector<std::uint32_t>* program : {&kLoopProgram, &kCountdownProgram}) {
+    for (PredictorKind kind : {PredictorKind::kBimodal, PredictorKind::kTage}) {
+      simulator::Memory staged_memory(0x1000);
+      simulator::Cpu staged(staged_memory, simulator::ExecutionEngine::kStaged);
+      load_loop_program(staged_memory, staged, *program);
+      staged.set_branch_prediction_enabled(true, {kind});
+      staged.run_program();
+
+      simulator::Memory memory(0x1000);
+      simulator::Cpu cpu(memory, simulator::ExecutionEngine::kBlock);
+      load_loop_program(memory, cpu, *program);
+      cpu.set_branch_prediction_enabled(true, {kind});
+      cpu.set_cache_enabled(true);
+      // One of the limits splits a block of two in each program, the
+      // staged path retires its first instruction.
+      EXPECT_EQ(cpu.run_program(10), simulator::StopReason::kInstructionLimit);
+      EXPECT_EQ(cpu.run_program(5), simulator::StopReason::kInstructionLimit);
+      EXPECT_EQ(cpu.run_program(), simulator::StopReason::kExited);
+
+      const simulator::BranchStats& expected = staged.get_branch_predictor()->stats();
+      const simulator::BranchStats& stats = cpu.get_branch_predictor()->stats();
+      EXPECT_EQ(stats.conditional, expected.conditional);
+      EXPECT_EQ(stats.mispredicted, expected.mispredicted);
+      EXPECT_EQ(stats.jumps, expected.jumps);
+      EXPECT_EQ(stats.btb_misses, expected.btb_misses);
+      EXPECT_EQ(cpu.get_instruction_count(), staged.get_instruction_count());
+    }
+  }
+}
+
+TEST(BranchPredictorTest, ObserverMatchesStagedRun) {
+  simulator::Memory staged_memory(0x1000);
+  simulator::Cpu staged(staged_memory);
+  load_loop_program(staged_memory, staged);
+  staged.set_branch_prediction_enabled(true, {PredictorKind::kTage});
+  staged.run_program();
+
+  simulator::Memory memory(0x1000);
+  simulator::Cpu cpu(memory, simulator::ExecutionEngine::kThreaded);
+  load_loop_program(memory, cpu);
+  BranchPredictor predictor({PredictorKind::kTage});
+  simulator::PredictorObserver observer(predictor);
+  cpu.run_observed(observer);
+
+  const simulator::BranchStats& expected = staged.get_branch_predictor()->stats();
+  EXPECT_EQ(predictor.stats().conditional, expected.conditional);
+  EXPECT_EQ(predictor.stats().mispredicted, expected.mispredicted);
+  EXPECT_EQ(predictor.stats().jumps, expected.jumps);
+  EXPECT_EQ(predictor.stats().btb_misses, expected.btb_misses);
+}
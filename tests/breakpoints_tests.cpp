@@ -0,0 +1,229 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "cpu.hpp"
+#include "jit_compiler.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "simulator.hpp"
+#include "syscalls.hpp"
+#include "test_encoding.hpp"
+#include "time_travel.hpp"
+
+namespace {
+
+namespace syscalls = simulator::syscalls;
+using simulator::test::create_memory_format;
+using simulator::StopReason;
+using simulator::WatchAccess;
+
+constexpr std::uint32_t kSyscall = 0x00000038;
+
+// Fibonacci of r3 that stores every value to 0x200 and loads the last one
+// into r6.
+const std::vector<std::uint32_t> kProgram = {
+    0x0022201a,  // add r4, r1, r2
+    0x0040081a,  // add r1, r2, r0
+    0x0080101a,  // add r2, r4, r0
+    create_memory_format(simulator::opcodes::kST, 1, 0x200, 0),
+    0x0065181a,  // add r3, r3, r5
+    0x1860fffb,  // bne r3, r0, loop
+    create_memory_format(simulator::opcodes::kLD, 6, 0x200, 0),
+    0x00000038,  // syscall
+};
+constexpr std::uint32_t kStore = 0x0c;
+constexpr std::uint32_t kDecrement = 0x10;
+constexpr std::uint32_t kAfterLoop = 0x18;
+constexpr std::uint64_t kLoopLength = 6;
+
+void load(simulator::Memory& memory) {
+  for (std::size_t i = 0; i < kProgram.size(); ++i) {
+    memory.write_word(i * 4, kProgram[i]);
+  }
+}
+
+void prepare(simulator::Cpu& cpu, std::uint32_t iterations) {
+  cpu.set_register(2, 1);
+  cpu.set_register(3, iterations);
+  cpu.set_register(5, 0xFFFFFFFF);
+}
+
+class BreakpointsTest : public ::testing::TestWithParam<simulator::ExecutionEngine> {
+ protected:
+  simulator::Memory memory_ {0x1000};
+  simulator::Cpu cpu_ {memory_, GetParam()};
+
+  void SetUp() override {
+    load(memory_);
+    prepare(cpu_, 10);
+  }
+};
+
+} // namespace
+
+TEST_P(BreakpointsTest, StopsBeforeBreakpointAndResumes) {
+  cpu_.set_breakpoint(kStore);
+
+  EXPECT_EQ(cpu_.run_program(), StopReason::kBreakpoint);
+  EXPECT_EQ(cpu_.get_pc(), kStore);
+  EXPECT_EQ(cpu_.get_instruction_count(), 3);
+  EXPECT_EQ(memory_.read_word(0x200), 0);
+
+  EXPECT_EQ(cpu_.run_program(), StopReason::kBreakpoint);
+  EXPECT_EQ(cpu_.get_pc(), kStore);
+  EXPECT_EQ(cpu_.get_instruction_count(), 3 + kLoopLength);
+  EXPECT_EQ(memory_.read_word(0x200), 1);
+
+  // The instruction limit is reached first.
+  EXPECT_EQ(cpu_.run_program(kLoopLength), StopReason::kInstructionLimit);
+  EXPECT_EQ(cpu_.run_program(0), StopReason::kInstructionLimit);
+  EXPECT_EQ(cpu_.run_program(), StopReason::kBreakpoint);
+  EXPECT_EQ(cpu_.get_instruction_count(), 3 + 2 * kLoopLength);
+
+  cpu_.remove_breakpoint(kStore);
+  EXPECT_EQ(cpu_.run_program(), StopReason::kExited);
+  EXPECT_EQ(cpu_.get_register(6), 55);
+}
+
+TEST_P(BreakpointsTest, ConditionalBreakpointChecksRegister) {
+  cpu_.set_breakpoint(kDecrement, simulator::BreakCondition {
+      3, simulator::BreakCondition::Compare::kEqual, 4});
+  EXPECT_EQ(cpu_.run_program(), StopReason::kBreakpoint);
+  EXPECT_EQ(cpu_.get_pc(), kDecrement);
+  EXPECT_EQ(cpu_.get_register(3), 4);
+  EXPECT_EQ(cpu_.get_instruction_count(), 4 + 6 * kLoopLength);
+
+  cpu_.set_breakpoint(kDecrement, simulator::BreakCondition {
+      3, simulator::BreakCondition::Compare::kGreater, 4});
+  EXPECT_EQ(cpu_.run_program(), StopReason::kExited);
+  EXPECT_THROW(cpu_.set_breakpoint(0, simulator::BreakCondition {
+                   32, simulator::BreakCondition::Compare::kEqual, 0}),
+               std::out_of_range);
+}
+
+TEST_P(BreakpointsTest, WatchpointsStopAfterAccess) {
+  cpu_.set_watchpoint(0x202, WatchAccess::kWrite);
+  cpu_.set_watchpoint(0x300, WatchAccess::kReadWrite);
+
+  EXPECT_EQ(cpu_.run_program(), StopReason::kWatchpoint);
+  EXPECT_EQ(cpu_.get_pc(), kDecrement);
+  EXPECT_EQ(cpu_.get_instruction_count(), 4);
+  EXPECT_EQ(memory_.read_word(0x200), 1);
+  EXPECT_EQ(cpu_.get_watchpoint_hit().address, 0x202);
+  EXPECT_EQ(cpu_.get_watchpoint_hit().program_counter, kStore);
+  EXPECT_TRUE(cpu_.get_watchpoint_hit().write);
+
+  EXPECT_EQ(cpu_.run_program(), StopReason::kWatchpoint);
+  EXPECT_EQ(cpu_.get_instruction_count(), 4 + kLoopLength);
+
+  // Loads are only reported to read watchpoints.
+  cpu_.set_watchpoint(0x202, WatchAccess::kRead);
+  EXPECT_EQ(cpu_.run_program(), StopReason::kWatchpoint);
+  EXPECT_EQ(cpu_.get_pc(), kAfterLoop + 4);
+  EXPECT_EQ(cpu_.get_register(6), 55);
+  EXPECT_FALSE(cpu_.get_watchpoint_hit().write);
+
+  cpu_.remove_watchpoint(0x202);
+  EXPECT_EQ(cpu_.run_program(), StopReason::kExited);
+  EXPECT_THROW(cpu_.set_watchpoint(0x1000, WatchAccess::kWrite), std::range_error);
+}
+
+TEST_P(BreakpointsTest, WatchpointsSeeSyscallBuffers) {
+  std::istringstream input("abcd");
+  std::ostringstream output;
+  simulator::Memory memory(0x1000);
+  simulator::Cpu cpu(memory, GetParam());
+  cpu.set_console(output, input);
+  memory.write_word(0, kSyscall);
+  memory.write_word(4, kSyscall);
+  cpu.set_register(syscalls::kNumberRegister, syscalls::READ);
+  cpu.set_register(syscalls::kArgument0, 0x300);
+  cpu.set_register(syscalls::kArgument1, 4);
+  cpu.set_watchpoint(0x302, WatchAccess::kWrite);
+
+  EXPECT_EQ(cpu.run_program(), StopReason::kWatchpoint);
+  EXPECT_EQ(cpu.get_pc(), 4);
+  EXPECT_EQ(memory.read_byte(0x302), 'c');
+  EXPECT_EQ(cpu.get_watchpoint_hit().program_counter, 0);
+  EXPECT_TRUE(cpu.get_watchpoint_hit().write);
+
+  cpu.set_watchpoint(0x302, WatchAccess::kRead);
+  cpu.set_register(syscalls::kNumberRegister, syscalls::WRITE);
+  cpu.set_register(syscalls::kArgument0, 0x300);
+  EXPECT_EQ(cpu.run_program(), StopReason::kWatchpoint);
+  EXPECT_EQ(output.str(), "abcd");
+  EXPECT_EQ(cpu.get_watchpoint_hit().program_counter, 4);
+  EXPECT_FALSE(cpu.get_watchpoint_hit().write);
+}
+
+TEST_P(BreakpointsTest, InstrumentedAndTimedRunsStop) {
+  cpu_.set_profiling_enabled(true);
+  cpu_.set_breakpoint(kStore);
+  EXPECT_EQ(cpu_.run_program(), StopReason::kBreakpoint);
+  EXPECT_EQ(cpu_.get_instruction_count(), 3);
+  cpu_.set_profiling_enabled(false);
+
+  cpu_.set_timing_enabled(true);
+  cpu_.set_watchpoint(0x200, WatchAccess::kWrite);
+  EXPECT_EQ(cpu_.run_program(), StopReason::kWatchpoint);
+  EXPECT_EQ(cpu_.get_instruction_count(), 4);
+  EXPECT_EQ(cpu_.run_program(), StopReason::kBreakpoint);
+  EXPECT_EQ(cpu_.get_instruction_count(), 3 + kLoopLength);
+}
+
+INSTANTIATE_TEST_SUITE_P(Engines, BreakpointsTest,
+                         ::testing::Values(simulator::ExecutionEngine::kStaged,
+                                           simulator::ExecutionEngine::kThreaded,
+                                           simulator::ExecutionEngine::kBlock));
+
+TEST(BreakpointsJitTest, BreakpointInHotLoopStopsNativeCode) {
+  if (!simulator::JitCompiler::is_supported()) {
+    GTEST_SKIP() << "JIT is not supported on this host";
+  }
+  simulator::Memory memory(0x1000);
+  simulator::Cpu cpu(memory);
+  load(memory);
+  prepare(cpu, 100000);
+  cpu.set_jit_enabled(true);
+
+  cpu.set_breakpoint(kAfterLoop);
+  EXPECT_EQ(cpu.run_program(), StopReason::kBreakpoint);
+  EXPECT_EQ(cpu.get_instruction_count(), 100000 * kLoopLength);
+
+  // Rerun the now compiled loop with a breakpoint inside it.
+  cpu.set_register(3, 50000);
+  cpu.set_pc(0);
+  cpu.set_breakpoint(kDecrement, simulator::BreakCondition {
+      3, simulator::BreakCondition::Compare::kEqual, 7});
+  EXPECT_EQ(cpu.run_program(), StopReason::kBreakpoint);
+  EXPECT_EQ(cpu.get_pc(), kDecrement);
+  EXPECT_EQ(cpu.get_register(3), 7);
+  EXPECT_EQ(cpu.get_instruction_count(),
+            100000 * kLoopLength + (50000 - 7) * kLoopLength + 4);
+}
+
+TEST(BreakpointsTimeTravelTest, SeekPassesBreakpoints) {
+  simulator::Simulator machine(0x1000);
+  load(machine.get_memory());
+  prepare(machine.get_cpu(), 10);
+  simulator::TimeTravel time_travel(machine, 8);
+  simulator::Cpu& cpu = machine.get_cpu();
+  cpu.set_breakpoint(kStore);
+  cpu.set_watchpoint(0x200, WatchAccess::kWrite);
+
+  EXPECT_EQ(time_travel.run(), StopReason::kBreakpoint);
+  EXPECT_EQ(time_travel.run(), StopReason::kWatchpoint);
+  EXPECT_EQ(time_travel.run(), StopReason::kBreakpoint);
+  EXPECT_EQ(cpu.get_instruction_count(), 3 + kLoopLength);
+
+  time_travel.seek(40);
+  EXPECT_EQ(cpu.get_instruction_count(), 40);
+  time_travel.step_back();
+  EXPECT_EQ(cpu.get_instruction_count(), 39);
+  time_travel.rewind();
+  EXPECT_EQ(cpu.get_instruction_count(), 0);
+  EXPECT_EQ(time_travel.run(), StopReason::kBreakpoint);
+  EXPECT_EQ(cpu.get_instruction_count(), 3);
+}
@@ -0,0 +1,289 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "cache_model.hpp"
+#include "cpu.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "test_encoding.hpp"
+#include "threaded_engine.hpp"
+
+namespace {
+
+namespace opcodes = simulator::opcodes;
+using simulator::test::create_rformat;
+using simulator::test::create_memory_format;
+using simulator::test::create_ldp;
+using simulator::test::create_branch;
+using simulator::Cache;
+using simulator::CacheConfig;
+using simulator::Replacement;
+using simulator::WritePolicy;
+
+constexpr std::uint32_t kSyscall = 0x00000038;
+constexpr std::uint32_t kLine = 16;
+constexpr std::uint32_t kSource = 0x1000;
+constexpr std::uint32_t kDestination = 0x2000;
+constexpr std::uint32_t kIterations = 64;
+
+// Copies a word from r1 to r2 and loads a pair from r1 on every iteration.
+const std::vector<std::uint32_t> kCopyProgram = {
+    create_memory_format(opcodes::kLD, 4, 0, 1),       // loop:
+    create_memory_format(opcodes::kST, 4, 0, 2),
+    create_ldp(11, 12, 0, 1),
+    create_rformat(opcodes::kADD, 1, 1, 6),
+    create_rformat(opcodes::kADD, 2, 2, 6),
+    create_rformat(opcodes::kADD, 3, 3, 5),
+    create_branch(opcodes::kBNE, 3, 0, -6),            // bne loop
+    kSyscall,
+};
+
+// A single set of associativity ways with 16 byte lines.
+CacheConfig one_set(std::uint32_t associativity, Replacement replacement = Replacement::kLru) {
+  return {associativity * kLine, associativity, kLine, replacement, WritePolicy::kWriteBack};
+}
+
+void load_copy_program(simulator::Memory& memory, simulator::Cpu& cpu) {
+  for (std::size_t i = 0; i < kCopyProgram.size(); ++i) {
+    memory.write_word(i * 4, kCopyProgram[i]);
+  }
+  cpu.set_register(1, kSource);
+  cpu.set_register(2, kDestination);
+  cpu.set_register(3, kIterations);
+  cpu.set_register(5, static_cast<std::uint32_t>(-1));
+  cpu.set_register(6, 4);
+}
+
+void expect_same_stats(const simulator::CacheStats& lhs, const simulator::CacheStats& rhs) {
+  EXPECT_EQ(lhs.hits, rhs.hits);
+  EXPECT_EQ(lhs.misses, rhs.misses);
+  EXPECT_EQ(lhs.evictions, rhs.evictions);
+  EXPECT_EQ(lhs.writebacks, rhs.writebacks);
+}
+
+} // namespace
+
+TEST(CacheModelTest, RejectsInvalidConfig) {
+  EXPECT_THROW(Cache({3000, 2, 16}), std::runtime_error);
+  EXPECT_THROW(Cache({1 << 20, 128, 16}), std::runtime_error);
+  EXPECT_THROW(Cache({1024, 2, 2}), std::runtime_error);
+  EXPECT_THROW(Cache({64, 4, 64}), std::runtime_error);
+  EXPECT_NO_THROW(Cache({64, 1, 64}));
+}
+
+TEST(CacheModelTest, DirectMappedLinesConflict) {
+  Cache cache({256, 1, kLine});
+
+  EXPECT_FALSE(cache.read(0));
+  EXPECT_TRUE(cache.read(12));
+  EXPECT_FALSE(cache.read(256));
+  EXPECT_FALSE(cache.read(0));
+  EXPECT_FALSE(cache.read(16));
+
+  EXPECT_EQ(cache.stats().hits, 1);
+  EXPECT_EQ(cache.stats().misses, 4);
+  EXPECT_EQ(cache.stats().evictions, 2);
+  EXPECT_TRUE(cache.contains(0));
+  EXPECT_FALSE(cache.contains(256));
+}
+
+TEST(CacheModelTest, EveryWayOfPaddedSetsIsFound) {
+  for (std::uint32_t associativity : {1u, 2u, 4u, 8u, 16u, 64u}) {
+    Cache cache(one_set(associativity));
+    for (std::uint32_t way = 0; way < associativity; ++way) {
+      cache.read(way * kLine);
+    }
+    for (std::uint32_t way = 0; way < associativity; ++way) {
+      EXPECT_TRUE(cache.read(way * kLine)) << associativity << "-way, way " << way;
+    }
+    EXPECT_EQ(cache.stats().evictions, 0);
+    EXPECT_FALSE(cache.read(associativity * kLine));
+    EXPECT_EQ(cache.stats().evictions, 1);
+  }
+}
+
+TEST(CacheModelTest, LruAndPseudoLruPickDifferentVictims) {
+  Cache lru(one_set(4, Replacement::kLru));
+  Cache plru(one_set(4, Replacement::kPseudoLru));
+  for (std::uint32_t line : {0u, 1u, 2u, 3u, 0u, 4u}) {
+    lru.read(line * kLine);
+    plru.read(line * kLine);
+  }
+
+  // LRU drops the oldest line, the tree only remembers that line 0 was used
+  // after the pair of lines 2 and 3.
+  EXPECT_FALSE(lru.contains(1 * kLine));
+  EXPECT_TRUE(lru.contains(2 * kLine));
+  EXPECT_TRUE(plru.contains(1 * kLine));
+  EXPECT_FALSE(plru.contains(2 * kLine));
+
+  plru.read(2 * kLine);
+  EXPECT_FALSE(plru.contains(1 * kLine));
+  EXPECT_TRUE(plru.contains(0));
+}
+
+TEST(CacheModelTest, RandomReplacementIsSeeded) {
+  Cache first(one_set(4, Replacement::kRandom), 7);
+  Cache second(one_set(4, Replacement::kRandom), 7);
+  for (int round = 0; round < 100; ++round) {
+    for (std::uint32_t line = 0; line < 8; ++line) {
+      EXPECT_EQ(first.read(line * kLine), second.read(line * kLine));
+    }
+  }
+
+  EXPECT_EQ(first.stats().accesses(), 800);
+  EXPECT_GT(first.stats().hits, 0);
+  EXPECT_EQ(first.stats().evictions, first.stats().misses - 4);
+}
+
+TEST(CacheModelTest, WriteBackEvictsDirtyLines) {
+  Cache cache({256, 1, kLine});
+
+  EXPECT_FALSE(cache.write(4));
+  EXPECT_TRUE(cache.contains(0));
+  EXPECT_FALSE(cache.read(256));
+  ASSERT_TRUE(cache.writeback().has_value());
+  EXPECT_EQ(*cache.writeback(), 0);
+  cache.read(512);
+  EXPECT_FALSE(cache.writeback().has_value());
+
+  EXPECT_EQ(cache.stats().evictions, 2);
+  EXPECT_EQ(cache.stats().writebacks, 1);
+}
+
+TEST(CacheModelTest, WriteThroughDoesNotAllocate) {
+  Cache cache({256, 1, kLine, Replacement::kLru, WritePolicy::kWriteThrough});
+
+  EXPECT_FALSE(cache.write(0));
+  EXPECT_FALSE(cache.contains(0));
+  cache.read(0);
+  EXPECT_TRUE(cache.write(0));
+  cache.read(256);
+  EXPECT_FALSE(cache.writeback().has_value());
+
+  EXPECT_EQ(cache.stats().writebacks, 0);
+}
+
+TEST(CacheModelTest, HierarchyFillsFromL2AndCountsPerPc) {
+  simulator::CacheHierarchyConfig config;
+  config.data = {256, 1, kLine};
+  simulator::CacheHierarchy caches(config);
+
+  caches.load(0x40, 0);
+  caches.load(0x40, 256);
+  caches.load(0x40, 0);
+  caches.store(0x44, 512);
+
+  EXPECT_EQ(caches.data_cache().stats().misses, 4);
+  // Fills of lines 0, 256, 0 and 512, line 512 stays dirty in L1D.
+  EXPECT_EQ(caches.unified_cache().stats().accesses(), 4);
+  EXPECT_EQ(caches.unified_cache().stats().misses, 3);
+
+  simulator::CacheHierarchy::PcCounts load = caches.pc_counts(0x40);
+  EXPECT_EQ(load.data_accesses, 3);
+  EXPECT_EQ(load.data_misses, 3);
+  EXPECT_EQ(load.l2_misses, 2);
+  EXPECT_EQ(caches.pc_counts(0x44).data_misses, 1);
+  EXPECT_EQ(caches.pc_counts(0x48).data_accesses, 0);
+
+  caches.load(0x48, 0);
+  EXPECT_EQ(caches.unified_cache().stats().accesses(), 6);
+  EXPECT_EQ(caches.data_cache().stats().writebacks, 1);
+  auto spots = caches.miss_hot_spots();
+  ASSERT_EQ(spots.size(), 3);
+  EXPECT_EQ(spots[0].first, 0x40);
+}
+
+TEST(CacheModelTest, WriteThroughStoresReachL2) {
+  simulator::CacheHierarchyConfig config;
+  config.data = {256, 1, kLine, Replacement::kLru, WritePolicy::kWriteThrough};
+  simulator::CacheHierarchy caches(config);
+
+  caches.store(0, 0x100);
+  caches.store(0, 0x104);
+
+  EXPECT_EQ(caches.data_cache().stats().misses, 2);
+  EXPECT_EQ(caches.unified_cache().stats().accesses(), 2);
+  EXPECT_EQ(caches.unified_cache().stats().misses, 1);
+  EXPECT_EQ(caches.data_cache().stats().writebacks, 0);
+}
+
+TEST(CacheModelTest, CachedRunFeedsFetchesAndDataAccesses) {
+  simulator::Memory memory(0x4000);
+  simulator::Cpu cpu(memory, simulator::ExecutionEngine::kBlock);
+  load_copy_program(memory, cpu);
+  cpu.set_cache_enabled(true);
+
+  EXPECT_EQ(cpu.run_program(), simulator::StopReason::kExited);
+
+  const simulator::CacheHierarchy& caches = *cpu.get_cache_model();
+  EXPECT_EQ(caches.instruction_cache().stats().accesses(), cpu.get_instruction_count());
+  EXPECT_EQ(caches.instruction_cache().stats().misses, 1);
+  EXPECT_EQ(caches.data_cache().stats().accesses(), 4 * kIterations);
+  // 64 byte lines. The second word of a pair touches each next source line
+  // first, the last pair reaches into a fifth one.
+  EXPECT_EQ(caches.data_cache().stats().misses, 5 + 4);
+  EXPECT_EQ(caches.pc_counts(0).data_misses, 1);
+  EXPECT_EQ(caches.pc_counts(4).data_misses, 4);
+  EXPECT_EQ(caches.pc_counts(8).data_misses, 4);
+
+  std::ostringstream report;
+  caches.write_report(report);
+  EXPECT_NE(report.str().find("L1D"), std::string::npos);
+  EXPECT_NE(report.str().find("0x00000004"), std::string::npos);
+
+  cpu.set_cache_enabled(false);
+  EXPECT_EQ(cpu.get_cache_model(), nullptr);
+}
+
+TEST(CacheModelTest, BlockEngineMatchesStagedRun) {
+  simulator::Memory staged_memory(0x4000);
+  simulator::Cpu staged(staged_memory, simulator::ExecutionEngine::kStaged);
+  load_copy_program(staged_memory, staged);
+  staged.set_cache_enabled(true);
+  staged.run_program();
+
+  simulator::Memory memory(0x4000);
+  simulator::Cpu cpu(memory, simulator::ExecutionEngine::kBlock);
+  load_copy_program(memory, cpu);
+  cpu.set_cache_enabled(true);
+  cpu.set_jit_enabled(simulator::JitCompiler::is_supported());
+  // Seven instructions per iteration, the limit splits the fused adds of
+  // the fourth and the staged path retires the first of them.
+  EXPECT_EQ(cpu.run_program(7 * 3 + 4),
+            simulator::StopReason::kInstructionLimit);
+  EXPECT_EQ(cpu.run_program(), simulator::StopReason::kExited);
+
+  const simulator::CacheHierarchy& caches = *cpu.get_cache_model();
+  const simulator::CacheHierarchy& expected = *staged.get_cache_model();
+  expect_same_stats(caches.instruction_cache().stats(), expected.instruction_cache().stats());
+  expect_same_stats(caches.data_cache().stats(), expected.data_cache().stats());
+  expect_same_stats(caches.unified_cache().stats(), expected.unified_cache().stats());
+  for (std::uint32_t pc = 0; pc < kCopyProgram.size() * 4; pc += 4) {
+    EXPECT_EQ(caches.pc_counts(pc).data_accesses, expected.pc_counts(pc).data_accesses) << pc;
+    EXPECT_EQ(caches.pc_counts(pc).data_misses, expected.pc_counts(pc).data_misses) << pc;
+  }
+}
+
+TEST(CacheModelTest, ObserverMatchesStagedRun) {
+  simulator::Memory staged_memory(0x4000);
+  simulator::Cpu staged(staged_memory);
+  load_copy_program(staged_memory, staged);
+  staged.set_cache_enabled(true);
+  staged.run_program();
+
+  simulator::Memory memory(0x4000);
+  simulator::Cpu cpu(memory, simulator::ExecutionEngine::kThreaded);
+  load_copy_program(memory, cpu);
+  simulator::CacheHierarchy caches;
+  simulator::CacheObserver observer(caches);
+  cpu.run_observed(observer);
+
+  const simulator::CacheHierarchy& expected = *staged.get_cache_model();
+  expect_same_stats(caches.instruction_cache().stats(), expected.instruction_cache().stats());
+  expect_same_stats(caches.data_cache().stats(), expected.data_cache().stats());
+  expect_same_stats(caches.unified_cache().stats(), expected.unified_cache().stats());
+  EXPECT_EQ(caches.pc_counts(8).data_accesses, kIterations * 2);
+}
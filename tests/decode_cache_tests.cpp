@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include "cpu.hpp"
+#include "decode_cache.hpp"
+#include "instruction_parser.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "test_encoding.hpp"
+
+namespace {
+
+using simulator::test::create_rformat;
+
+} // namespace
+
+class DecodeCacheTest : public ::testing::Test {
+ protected:
+  simulator::Memory memory_ {1024};
+  std::unique_ptr<simulator::Cpu> cpu_;
+
+  void SetUp() override {
+    cpu_ = std::make_unique<simulator::Cpu>(memory_);
+    cpu_->set_pc(0);
+
+    cpu_->set_register(1, 0x000000FF);
+    cpu_->set_register(2, 0x00000001);
+  }
+};
+
+TEST(InstructionDecodeTest, LDP_MatchesParse) {
+  constexpr std::uint32_t kRawInstruction = 0xF0221923;
+
+  simulator::Instruction instruction = simulator::InstructionParser::parse(kRawInstruction);
+  simulator::DecodedInstruction decoded = simulator::InstructionParser::decode(kRawInstruction);
+  const auto& ldp_format = get<simulator::LdpFormat>(instruction.fields);
+
+  EXPECT_EQ(decoded.opcode, instruction.opcode);
+  EXPECT_EQ(decoded.rs, ldp_format.base);
+  EXPECT_EQ(decoded.rd, ldp_format.rt1);
+  EXPECT_EQ(decoded.rt, ldp_format.rt2);
+  EXPECT_EQ(decoded.imm, ldp_format.offset);
+}
+
+TEST(InstructionDecodeTest, BNE_NegativeOffsetInBytes) {
+  // BNE r3, r0, -4 instructions
+  constexpr std::uint32_t kRawInstruction = 0x1860FFFC;
+
+  simulator::DecodedInstruction decoded = simulator::InstructionParser::decode(kRawInstruction);
+
+  EXPECT_EQ(decoded.opcode, simulator::opcodes::kBNE);
+  EXPECT_EQ(decoded.rs, 3);
+  EXPECT_EQ(decoded.rt, 0);
+  EXPECT_EQ(decoded.imm, -16);
+}
+
+TEST_F(DecodeCacheTest, FetchReturnsCachedEntry) {
+  simulator::DecodeCache cache(memory_);
+  memory_.write_word(0, create_rformat(simulator::opcodes::kADD, 3, 1, 2));
+
+  const simulator::DecodedInstruction& first = cache.fetch(0);
+  const simulator::DecodedInstruction& second = cache.fetch(0);
+
+  EXPECT_EQ(&first, &second);
+  EXPECT_EQ(second.opcode, simulator::opcodes::kADD);
+}
+
+TEST_F(DecodeCacheTest, UnalignedFetchThrows) {
+  simulator::DecodeCache cache(memory_);
+  cache.fetch(0);
+
+  EXPECT_THROW(cache.fetch(2), std::runtime_error);
+}
+
+TEST_F(DecodeCacheTest, CodeWriteInvalidatesDecodedInstruction) {
+  memory_.write_word(0, create_rformat(simulator::opcodes::kADD, 3, 1, 2));
+  cpu_->pipeline_cycle();
+  ASSERT_EQ(cpu_->get_register(3), 0x00000100);
+
+  memory_.write_word(0, create_rformat(simulator::opcodes::kXOR, 3, 1, 2));
+  cpu_->set_pc(0);
+  cpu_->pipeline_cycle();
+
+  ASSERT_EQ(cpu_->get_register(3), 0x000000FE);
+}
+
+TEST_F(DecodeCacheTest, BlockWriteInvalidatesDecodedInstruction) {
+  memory_.write_word(4, create_rformat(simulator::opcodes::kADD, 3, 1, 2));
+  cpu_->set_pc(4);
+  cpu_->pipeline_cycle();
+
+  std::uint32_t nor = create_rformat(simulator::opcodes::kNOR, 3, 1, 2);
+  memory_.write_block(4, reinterpret_cast<const std::uint8_t*>(&nor), sizeof(nor));
+  cpu_->set_pc(4);
+  cpu_->pipeline_cycle();
+
+  ASSERT_EQ(cpu_->get_register(3), 0xFFFFFF00);
+}
+
+TEST_F(DecodeCacheTest, InvalidateReportsDecodedEntries) {
+  simulator::DecodeCache cache(memory_);
+  memory_.write_word(8, create_rformat(simulator::opcodes::kADD, 3, 1, 2));
+  cache.fetch(8);
+
+  EXPECT_FALSE(cache.invalidate(0, 8));
+  EXPECT_FALSE(cache.invalidate(0x100, 4));
+  EXPECT_TRUE(cache.invalidate(10, 1));
+  EXPECT_FALSE(cache.invalidate(8, 4));
+}
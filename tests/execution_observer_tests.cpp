@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cpu.hpp"
+#include "execution_observer.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "test_encoding.hpp"
+#include "threaded_engine.hpp"
+
+namespace {
+
+namespace opcodes = simulator::opcodes;
+using simulator::test::create_rformat;
+using simulator::test::create_memory_format;
+using simulator::test::create_ldp;
+using simulator::test::create_branch;
+using simulator::test::create_jump;
+
+constexpr std::uint32_t kSyscall = 0x00000038;
+constexpr std::uint8_t kDataBase = 20;
+constexpr std::uint8_t kLoopCounter = 21;
+constexpr std::uint8_t kMinusOne = 22;
+constexpr std::uint32_t kDataAddress = 0x200;
+
+// Three iterations of a loop with every kind of event, a jump over one
+// instruction and exit.
+const std::vector<std::uint32_t> kProgram = {
+    create_ldp(1, 2, 0, kDataBase),                                       // loop:
+    create_memory_format(opcodes::kST, 1, 8, kDataBase),
+    create_memory_format(opcodes::kLD, 3, 8, kDataBase),
+    create_rformat(opcodes::kADD, kLoopCounter, kLoopCounter, kMinusOne),
+    create_branch(opcodes::kBNE, kLoopCounter, 0, -4),                    // bne loop
+    create_jump(0x1c),                                                    // j done
+    create_rformat(opcodes::kADD, 13, 0, 0),
+    kSyscall,                                                             // done:
+};
+constexpr std::uint64_t kRetired = 3 * 5 + 2;
+
+// Counts events, the static way.
+class CountingObserver final : public simulator::ExecutionObserver<CountingObserver> {
+ public:
+  void on_fetch(std::uint32_t /*program_counter*/,
+                const simulator::DecodedInstruction& /*instruction*/) {
+    ++fetched;
+  }
+  void on_retire(std::uint32_t /*program_counter*/,
+                 const simulator::DecodedInstruction& /*instruction*/,
+                 std::uint32_t /*next_program_counter*/) {
+    ++retired;
+  }
+  void on_mem_read(std::uint32_t /*program_counter*/, std::uint32_t /*address*/,
+                   std::uint32_t /*value*/) {
+    ++reads;
+  }
+  void on_mem_write(std::uint32_t /*program_counter*/, std::uint32_t /*address*/,
+                    std::uint32_t /*value*/) {
+    ++writes;
+  }
+  void on_branch(std::uint32_t /*program_counter*/, std::uint32_t /*target*/, bool taken) {
+    ++branches;
+    taken_branches += taken ? 1 : 0;
+  }
+  void on_syscall(std::uint32_t /*program_counter*/, std::uint32_t /*number*/) {
+    ++syscalls;
+  }
+
+  std::uint64_t fetched = 0;
+  std::uint64_t retired = 0;
+  std::uint64_t reads = 0;
+  std::uint64_t writes = 0;
+  std::uint64_t branches = 0;
+  std::uint64_t taken_branches = 0;
+  std::uint64_t syscalls = 0;
+};
+
+class RetireCounter final : public simulator::ExecutionObserver<RetireCounter> {
+ public:
+  void on_retire(std::uint32_t /*program_counter*/,
+                 const simulator::DecodedInstruction& /*instruction*/,
+                 std::uint32_t /*next_program_counter*/) {
+    ++retired;
+  }
+
+  std::uint64_t retired = 0;
+};
+
+static_assert(!simulator::NullObserver::observes_memory());
+static_assert(!RetireCounter::observes_memory());
+static_assert(CountingObserver::observes_memory());
+static_assert(simulator::ObserverGroup<RetireCounter, CountingObserver>::observes_memory());
+
+// Writes every event into a log, to compare runs.
+class LoggingObserver final : public simulator::ExecutionObserver<LoggingObserver> {
+ public:
+  explicit LoggingObserver(std::vector<std::string>& log) : log_(log) {}
+
+  void on_fetch(std::uint32_t program_counter,
+                const simulator::DecodedInstruction& /*instruction*/) {
+    add("fetch", program_counter);
+  }
+  void on_retire(std::uint32_t program_counter,
+                 const simulator::DecodedInstruction& /*instruction*/,
+                 std::uint32_t next_program_counter) {
+    add("retire", program_counter, next_program_counter);
+  }
+  void on_mem_read(std::uint32_t program_counter, std::uint32_t address, std::uint32_t value) {
+    add("read", program_counter, address, value);
+  }
+  void on_mem_write(std::uint32_t program_counter, std::uint32_t address, std::uint32_t value) {
+    add("write", program_counter, address, value);
+  }
+  void on_branch(std::uint32_t program_counter, std::uint32_t target, bool taken) {
+    add("branch", program_counter, target, taken ? 1 : 0);
+  }
+  void on_syscall(std::uint32_t program_counter, std::uint32_t number) {
+    add("syscall", program_counter, number);
+  }
+
+ private:
+  void add(const std::string& event, std::uint32_t program_counter,
+           std::uint32_t first = 0, std::uint32_t second = 0) {
+    log_.push_back(event + " " + std::to_string(program_counter) + " "
+                   + std::to_string(first) + " " + std::to_string(second));
+  }
+
+  std::vector<std::string>& log_;
+};
+
+class ExecutionObserverTest : public ::testing::Test {
+ protected:
+  simulator::Memory memory_ {0x1000};
+  simulator::Cpu cpu_ {memory_};
+
+  void SetUp() override {
+    for (std::size_t i = 0; i < kProgram.size(); ++i) {
+      memory_.write_word(i * 4, kProgram[i]);
+    }
+    memory_.write_word(kDataAddress, 11);
+    memory_.write_word(kDataAddress + 4, 22);
+    cpu_.set_register(kDataBase, kDataAddress);
+    cpu_.set_register(kLoopCounter, 3);
+    cpu_.set_register(kMinusOne, static_cast<std::uint32_t>(-1));
+  }
+};
+
+} // namespace
+
+TEST_F(ExecutionObserverTest, StaticObserverSeesEveryEvent) {
+  CountingObserver observer;
+
+  EXPECT_EQ(cpu_.run_observed(observer), simulator::StopReason::kExited);
+
+  EXPECT_EQ(cpu_.get_instruction_count(), kRetired);
+  EXPECT_EQ(observer.fetched, kRetired);
+  EXPECT_EQ(observer.retired, kRetired);
+  EXPECT_EQ(observer.reads, 3 * 3);
+  EXPECT_EQ(observer.writes, 3);
+  EXPECT_EQ(observer.branches, 4);
+  EXPECT_EQ(observer.taken_branches, 3);
+  EXPECT_EQ(observer.syscalls, 1);
+}
+
+TEST_F(ExecutionObserverTest, EventsOfOneInstructionComeInOrder) {
+  std::vector<std::string> log;
+  LoggingObserver observer(log);
+
+  cpu_.run_observed(observer, 5);
+
+  std::vector<std::string> expected = {
+      "fetch 0 0 0",   "read 0 512 11",    "read 0 516 22",   "retire 0 4 0",
+      "fetch 4 0 0",   "write 4 520 11",   "retire 4 8 0",
+      "fetch 8 0 0",   "read 8 520 11",    "retire 8 12 0",
+      "fetch 12 0 0",  "retire 12 16 0",
+      "fetch 16 0 0",  "branch 16 0 1",    "retire 16 0 0",
+  };
+  EXPECT_EQ(log, expected);
+}
+
+TEST_F(ExecutionObserverTest, DynamicObserverMatchesStatic) {
+  std::vector<std::string> expected;
+  LoggingObserver observer(expected);
+  simulator::Memory memory(0x1000);
+  simulator::Cpu cpu(memory);
+  for (std::size_t i = 0; i < 0x210; i += 4) {
+    memory.write_word(static_cast<std::uint32_t>(i), memory_.read_word(static_cast<std::uint32_t>(i)));
+  }
+  cpu.set_state(cpu_.get_state());
+  cpu.run_observed(observer);
+
+  std::vector<std::string> log;
+  simulator::DynamicObserverFor<LoggingObserver> dynamic{LoggingObserver(log)};
+  cpu_.add_observer(&dynamic);
+  EXPECT_EQ(cpu_.run_program(), simulator::StopReason::kExited);
+
+  EXPECT_EQ(log, expected);
+  EXPECT_EQ(cpu_.get_state().registers, cpu.get_state().registers);
+}
+
+TEST_F(ExecutionObserverTest, FaultingInstructionIsFetchedNotRetired) {
+  CountingObserver observer;
+  cpu_.set_register(kDataBase, 0xFFC);
+
+  EXPECT_THROW(cpu_.run_observed(observer), std::range_error);
+
+  EXPECT_EQ(cpu_.get_pc(), 0);
+  EXPECT_EQ(observer.fetched, 1);
+  EXPECT_EQ(observer.retired, 0);
+  EXPECT_EQ(observer.reads, 0);
+}
+
+TEST_F(ExecutionObserverTest, ProfilerAndObserversShareRun) {
+  cpu_.set_profiling_enabled(true);
+  std::vector<std::string> log;
+  simulator::DynamicObserverFor<LoggingObserver> dynamic{LoggingObserver(log)};
+  cpu_.add_observer(&dynamic);
+  RetireCounter observer;
+
+  cpu_.run_observed(observer, 10);
+  EXPECT_EQ(observer.retired, 10);
+  EXPECT_EQ(log.size(), 10 * 2 + 2 * 4 + 2);
+  EXPECT_EQ(cpu_.get_profiler()->total_instructions(), 10);
+  EXPECT_EQ(cpu_.get_profiler()->pc_counts(16).taken, 2);
+
+  cpu_.remove_observer(&dynamic);
+  cpu_.run_program();
+  EXPECT_EQ(log.size(), 10 * 2 + 2 * 4 + 2);
+  EXPECT_EQ(cpu_.get_profiler()->total_instructions(), kRetired);
+  EXPECT_EQ(cpu_.get_profiler()->page_counts(0).loads, 3 * 3);
+}
+
+TEST_F(ExecutionObserverTest, RejectsNullObserver) {
+  EXPECT_THROW(cpu_.add_observer(nullptr), std::runtime_error);
+}
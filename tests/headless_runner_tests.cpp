@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "headless_runner.hpp"
+#include "interactive_simulator.hpp"
+#include "state_report.hpp"
+
+namespace {
+
+// examples/fib.rb
+constexpr std::array<std::uint32_t, 6> kFibProgram = {
+    0x0022201a,  // add r4, r1, r2
+    0x0040081a,  // add r1, r2, r0
+    0x0080101a,  // add r2, r4, r0
+    0x0065181a,  // add r3, r3, r5
+    0x1860fffc,  // bne r3, r0, loop
+    0x00000038,  // syscall
+};
+
+constexpr std::size_t kMemorySize = 1024;
+
+std::vector<std::uint8_t> fib_image() {
+  std::vector<std::uint8_t> bytes;
+  for (std::uint32_t word : kFibProgram) {
+    for (int i = 0; i < 4; ++i) {
+      bytes.push_back(static_cast<std::uint8_t>(word >> (8 * i)));
+    }
+  }
+  return bytes;
+}
+
+simulator::RunOptions fib_options(const std::string& n) {
+  return simulator::parse_run_options(
+      {"fib.bin", "--reg", "2=1", "--reg", "3=" + n, "--reg", "5=-1"});
+}
+
+} // namespace
+
+TEST(HeadlessRunnerTest, ParsesOptions) {
+  simulator::RunOptions options = simulator::parse_run_options(
+      {"prog.bin", "--reg", "3=0x10", "--mem", "0x100=-1", "--pc", "8",
+       "--max-insns", "100", "--engine", "threaded", "--unchecked", "--json"});
+
+  EXPECT_EQ(options.program_path, "prog.bin");
+  ASSERT_EQ(options.initial_state.registers.size(), 1);
+  EXPECT_EQ(options.initial_state.registers[0].first, 3);
+  EXPECT_EQ(options.initial_state.registers[0].second, 0x10);
+  EXPECT_EQ(options.initial_state.memory_words[0].first, 0x100);
+  EXPECT_EQ(options.initial_state.memory_words[0].second, 0xFFFFFFFF);
+  EXPECT_EQ(options.initial_state.program_counter, 8);
+  EXPECT_EQ(options.max_instructions, 100);
+  EXPECT_EQ(options.engine, simulator::ExecutionEngine::kThreaded);
+  EXPECT_EQ(options.memory_access, simulator::MemoryAccess::kUnchecked);
+  EXPECT_EQ(options.format, simulator::ReportFormat::kJson);
+}
+
+TEST(HeadlessRunnerTest, RejectsMalformedOptions) {
+  EXPECT_THROW(simulator::parse_run_options({}), std::runtime_error);
+  EXPECT_THROW(simulator::parse_run_options({"a.bin", "--reg"}), std::runtime_error);
+  EXPECT_THROW(simulator::parse_run_options({"a.bin", "--reg", "32=1"}), std::runtime_error);
+  EXPECT_THROW(simulator::parse_run_options({"a.bin", "--reg", "-1=1"}), std::runtime_error);
+  EXPECT_THROW(simulator::parse_run_options({"a.bin", "--reg", "4294967297=5"}), std::runtime_error);
+  EXPECT_THROW(simulator::parse_run_options({"a.bin", "--reg", "1=4294967296"}), std::runtime_error);
+  EXPECT_THROW(simulator::parse_run_options({"a.bin", "--mem", "0x100000000=1"}), std::runtime_error);
+  EXPECT_THROW(simulator::parse_run_options({"a.bin", "--engine", "fast"}), std::runtime_error);
+  EXPECT_THROW(simulator::parse_run_options({"a.bin", "b.bin"}), std::runtime_error);
+}
+
+TEST(HeadlessRunnerTest, RunsToExitAndToLimit) {
+  simulator::StateReport exited =
+      simulator::run_headless(fib_image(), fib_options("5"), kMemorySize);
+  EXPECT_EQ(exited.status, "exited");
+  EXPECT_EQ(exited.program_counter, 0x18);
+  EXPECT_EQ(exited.registers[1], 5);
+
+  simulator::RunOptions limited = fib_options("5");
+  limited.max_instructions = 7;
+  simulator::StateReport stopped =
+      simulator::run_headless(fib_image(), limited, kMemorySize);
+  EXPECT_EQ(stopped.status, "limit");
+  EXPECT_EQ(stopped.instruction_count, 7);
+  EXPECT_EQ(stopped.program_counter, 8);
+}
+
+TEST(HeadlessRunnerTest, ReportsFaults) {
+  simulator::RunOptions options = fib_options("5");
+  options.initial_state.program_counter = 2;
+
+  simulator::StateReport report =
+      simulator::run_headless(fib_image(), options, kMemorySize);
+
+  EXPECT_EQ(report.status, "faulted");
+  EXPECT_FALSE(report.fault.empty());
+}
+
+TEST(HeadlessRunnerTest, WritesJsonAndCsv) {
+  simulator::StateReport report =
+      simulator::run_headless(fib_image(), fib_options("5"), kMemorySize);
+
+  std::ostringstream json;
+  simulator::write_report(json, report, simulator::ReportFormat::kJson);
+  EXPECT_EQ(json.str().rfind("{\"status\":\"exited\",\"pc\":24,\"instructions\":26,"
+                             "\"registers\":[0,5,8,0,8,4294967295,", 0), 0);
+
+  std::ostringstream csv;
+  simulator::write_report(csv, report, simulator::ReportFormat::kCsv);
+  std::string header;
+  std::string row;
+  std::istringstream lines(csv.str());
+  std::getline(lines, header);
+  std::getline(lines, row);
+  EXPECT_EQ(header.rfind("status,pc,instructions,r0,r1,", 0), 0);
+  EXPECT_EQ(row.rfind("exited,24,26,0,5,8,", 0), 0);
+}
+
+TEST(HeadlessRunnerTest, ScriptReplaysCommandsWithoutPrompts) {
+  std::istringstream commands(
+      "# comment\n"
+      "sr\n"
+      "7 42\n"
+      "sp\n"
+      "8\n"
+      "print_reg\n");
+  std::ostringstream output;
+  simulator::InteractiveSimulator replay(kMemorySize, commands, output);
+
+  replay.start();
+
+  EXPECT_EQ(replay.get_simulator().get_cpu().get_register(7), 42);
+  EXPECT_EQ(output.str().rfind("PC: 0x8\nR0: 0x0\n", 0), 0);
+  EXPECT_EQ(output.str().find("> "), std::string::npos);
+}
+
+TEST(HeadlessRunnerTest, ScriptStopsOnUnknownCommand) {
+  std::istringstream commands("frobnicate\n");
+  std::ostringstream output;
+  simulator::InteractiveSimulator replay(kMemorySize, commands, output);
+
+  EXPECT_THROW(replay.start(), std::runtime_error);
+}
+
+TEST(HeadlessRunnerTest, InvalidArgumentsSkipTheirLine) {
+  std::istringstream commands(
+      "sr\n"
+      "abc 1\n"
+      "sr\n"
+      "7 42\n");
+  std::ostringstream output;
+  simulator::InteractiveSimulator replay(kMemorySize, commands, output);
+
+  EXPECT_THROW(replay.start(), std::runtime_error);
+  replay.start();
+
+  EXPECT_EQ(replay.get_simulator().get_cpu().get_register(7), 42);
+}
+
+TEST(HeadlessRunnerTest, ParsesCacheLevels) {
+  simulator::RunOptions options = simulator::parse_run_options(
+      {"prog.bin", "--cache", "caches.txt", "--cache-level", "l1d=4096,2,32,plru,wt",
+       "--cache-level", "l2=0x10000,16,64"});
+
+  EXPECT_EQ(options.cache_path, "caches.txt");
+  EXPECT_EQ(options.caches.data.size, 4096);
+  EXPECT_EQ(options.caches.data.associativity, 2);
+  EXPECT_EQ(options.caches.data.line_size, 32);
+  EXPECT_EQ(options.caches.data.replacement, simulator::Replacement::kPseudoLru);
+  EXPECT_EQ(options.caches.data.write_policy, simulator::WritePolicy::kWriteThrough);
+  EXPECT_EQ(options.caches.unified.size, 0x10000);
+  EXPECT_EQ(options.caches.unified.associativity, 16);
+  EXPECT_EQ(options.caches.instruction.size, simulator::CacheConfig{}.size);
+
+  EXPECT_THROW(simulator::parse_run_options({"a.bin", "--cache-level", "l3=1,1,4"}),
+               std::runtime_error);
+  EXPECT_THROW(simulator::parse_run_options({"a.bin", "--cache-level", "l1i=1024,2"}),
+               std::runtime_error);
+  EXPECT_THROW(simulator::parse_run_options({"a.bin", "--cache-level", "l1i=1024,2,16,fifo"}),
+               std::runtime_error);
+}
+
+TEST(HeadlessRunnerTest, ParsesPredictors) {
+  simulator::RunOptions options = simulator::parse_run_options(
+      {"prog.bin", "--predictor", "tage"});
+  EXPECT_TRUE(options.predicted);
+  EXPECT_EQ(options.predictor.kind, simulator::PredictorKind::kTage);
+  EXPECT_TRUE(options.branches_path.empty());
+
+  options = simulator::parse_run_options({"prog.bin", "--branches", "branches.txt"});
+  EXPECT_TRUE(options.predicted);
+  EXPECT_EQ(options.predictor.kind, simulator::PredictorKind::kGshare);
+  EXPECT_EQ(options.branches_path, "branches.txt");
+
+  EXPECT_FALSE(simulator::parse_run_options({"prog.bin"}).predicted);
+  EXPECT_THROW(simulator::parse_run_options({"a.bin", "--predictor", "perceptron"}),
+               std::runtime_error);
+}
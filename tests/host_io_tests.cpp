@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cpu.hpp"
+#include "host_io.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "syscalls.hpp"
+#include "test_encoding.hpp"
+
+namespace {
+
+namespace opcodes = simulator::opcodes;
+using simulator::test::create_rformat;
+
+constexpr std::uint32_t kSyscall = 0x00000038;
+constexpr std::uint8_t kZero = 0;
+constexpr std::uint8_t kReadSyscall = 16;
+constexpr std::uint8_t kWriteSyscall = 17;
+constexpr std::uint8_t kCountSyscall = 18;
+constexpr std::uint8_t kBuffer = 19;
+constexpr std::uint8_t kSize = 20;
+constexpr std::uint8_t kCount = 21;
+constexpr std::uint32_t kBufferAddress = 0x200;
+
+// Copies the console input to the output in reads of up to r20 bytes,
+// then stores the instruction count at that point in r21.
+const std::vector<std::uint32_t> kEchoProgram = {
+    create_rformat(opcodes::kADD, 8, kReadSyscall, kZero),   // loop: r8 = READ
+    create_rformat(opcodes::kADD, 9, kBuffer, kZero),        // r9 = buffer
+    create_rformat(opcodes::kADD, 10, kSize, kZero),         // r10 = size
+    kSyscall,
+    0x79200006,                                              // beq r9, r0, done
+    create_rformat(opcodes::kADD, 10, 9, kZero),             // r10 = bytes read
+    create_rformat(opcodes::kADD, 8, kWriteSyscall, kZero),  // r8 = WRITE
+    create_rformat(opcodes::kADD, 9, kBuffer, kZero),        // r9 = buffer
+    kSyscall,
+    0x7800fff7,                                              // beq r0, r0, loop
+    create_rformat(opcodes::kADD, 8, kCountSyscall, kZero),  // done: r8 = GET_INSTRUCTION_COUNT
+    kSyscall,
+    create_rformat(opcodes::kADD, kCount, 9, kZero),         // r21 = count
+    create_rformat(opcodes::kADD, 8, kZero, kZero),          // r8 = EXIT
+    kSyscall,
+};
+
+class HostIoTest : public ::testing::TestWithParam<simulator::ExecutionEngine> {
+ protected:
+  // The console has to outlive the cpu.
+  std::istringstream input_;
+  std::ostringstream output_;
+  simulator::Memory memory_ {0x1000};
+  simulator::Cpu cpu_ {memory_, GetParam()};
+
+  void SetUp() override {
+    cpu_.set_console(output_, input_);
+    for (std::size_t i = 0; i < kEchoProgram.size(); ++i) {
+      memory_.write_word(i * 4, kEchoProgram[i]);
+    }
+    cpu_.set_register(kReadSyscall, simulator::syscalls::READ);
+    cpu_.set_register(kWriteSyscall, simulator::syscalls::WRITE);
+    cpu_.set_register(kCountSyscall, simulator::syscalls::GET_INSTRUCTION_COUNT);
+    cpu_.set_register(kBuffer, kBufferAddress);
+    cpu_.set_register(kSize, 7);
+  }
+};
+
+} // namespace
+
+TEST_P(HostIoTest, GuestEchoesInput) {
+  std::string text;
+  for (int i = 0; i < 1000; ++i) {
+    text += "line " + std::to_string(i) + "\n";
+  }
+  input_.str(text);
+
+  EXPECT_EQ(cpu_.run_program(), simulator::StopReason::kExited);
+  EXPECT_EQ(output_.str(), text);
+  // Every read but the one at the end of input fills the buffer, the
+  // count excludes its own syscall.
+  std::uint64_t reads = (text.size() + 6) / 7 + 1;
+  std::uint64_t count = reads * 5 + (reads - 1) * 5 + 1;
+  EXPECT_EQ(cpu_.get_register(kCount), count);
+  EXPECT_EQ(cpu_.get_instruction_count(), count + 4);
+}
+
+TEST_P(HostIoTest, FaultingSyscallConsumesNothing) {
+  input_.str("abc");
+  cpu_.set_register(kBuffer, 0xFFE);
+
+  EXPECT_THROW(cpu_.run_program(), std::range_error);
+  EXPECT_EQ(cpu_.get_pc(), 0x0c);
+  EXPECT_EQ(cpu_.get_instruction_count(), 3);
+  EXPECT_EQ(output_.str(), "");
+
+  cpu_.set_register(kBuffer, kBufferAddress);
+  cpu_.set_pc(0);
+  EXPECT_EQ(cpu_.run_program(), simulator::StopReason::kExited);
+  EXPECT_EQ(output_.str(), "abc");
+}
+
+INSTANTIATE_TEST_SUITE_P(Engines, HostIoTest,
+                         ::testing::Values(simulator::ExecutionEngine::kStaged,
+                                           simulator::ExecutionEngine::kThreaded,
+                                           simulator::ExecutionEngine::kBlock));
+
+TEST(HostIoSyscallTest, ExitAndUnknownSyscallsKeepResultRegister) {
+  for (simulator::ExecutionEngine engine : {simulator::ExecutionEngine::kStaged,
+                                            simulator::ExecutionEngine::kThreaded,
+                                            simulator::ExecutionEngine::kBlock}) {
+    simulator::Memory memory(0x100);
+    simulator::Cpu cpu(memory, engine);
+    memory.write_word(0, kSyscall);
+    memory.write_word(4, create_rformat(opcodes::kADD, 8, kZero, kZero));
+    memory.write_word(8, kSyscall);
+    cpu.set_register(9, 5);
+    cpu.set_register(8, 1000);
+
+    EXPECT_EQ(cpu.run_program(), simulator::StopReason::kExited);
+    EXPECT_EQ(cpu.get_register(9), 5);
+    EXPECT_EQ(cpu.get_instruction_count(), 3);
+  }
+}
+
+TEST(OutputChannelTest, PreservesOrderAcrossWraparound) {
+  std::ostringstream output;
+  std::string expected;
+  {
+    simulator::OutputChannel channel(output, 10);
+    EXPECT_EQ(channel.capacity(), 16);
+    for (int i = 0; i < 20000; ++i) {
+      std::string chunk = std::to_string(i) + (i % 7 == 0 ? std::string(40, '.') : ",");
+      expected += chunk;
+      channel.write(reinterpret_cast<const std::uint8_t*>(chunk.data()), chunk.size());
+      if (i % 5000 == 0) {
+        channel.flush();
+        EXPECT_EQ(output.str(), expected);
+      }
+    }
+  }
+  EXPECT_EQ(output.str(), expected);
+}
+
+TEST(InputBufferTest, ReadsInChunks) {
+  std::istringstream input("0123456789");
+  simulator::InputBuffer buffer(input, 4);
+
+  std::span<const std::uint8_t> available = buffer.fill();
+  ASSERT_EQ(available.size(), 4);
+  EXPECT_EQ(available[0], '0');
+  buffer.consume(3);
+  EXPECT_EQ(buffer.fill().size(), 1);
+  EXPECT_EQ(buffer.fill()[0], '3');
+  buffer.consume(1);
+
+  std::string rest;
+  for (available = buffer.fill(); !available.empty(); available = buffer.fill()) {
+    rest.append(available.begin(), available.end());
+    buffer.consume(available.size());
+  }
+  EXPECT_EQ(rest, "456789");
+  EXPECT_TRUE(buffer.fill().empty());
+}
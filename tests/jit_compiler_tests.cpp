@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "cpu.hpp"
+#include "jit_compiler.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "test_encoding.hpp"
+
+namespace {
+
+namespace opcodes = simulator::opcodes;
+using simulator::test::create_rformat;
+using simulator::test::create_two_reg;
+using simulator::test::create_imm5;
+using simulator::test::create_memory_format;
+using simulator::test::create_ldp;
+using simulator::test::create_branch;
+
+constexpr std::uint32_t kSyscall = 0x00000038;
+constexpr std::uint8_t kDataBase = 20;
+constexpr std::uint8_t kLoopCounter = 21;
+constexpr std::uint8_t kMinusOne = 22;
+constexpr std::uint32_t kDataAddress = 0x200;
+
+// Random loop body using every instruction the JIT compiles, repeated
+// often enough to become hot.
+std::vector<std::uint32_t> generate_program(std::mt19937& random) {
+  std::uniform_int_distribution<int> kind(0, 8);
+  std::uniform_int_distribution<int> reg(1, 7);
+  std::uniform_int_distribution<int> imm(0, 31);
+  std::uniform_int_distribution<int> slot(0, 30);
+
+  std::vector<std::uint32_t> program;
+  for (int i = 0; i < 24; ++i) {
+    std::uint8_t rd = reg(random);
+    std::uint8_t rs = reg(random);
+    std::uint8_t rt = reg(random);
+    std::uint16_t offset = slot(random) * 4;
+    switch (kind(random)) {
+      case 0: program.push_back(create_rformat(opcodes::kADD, rd, rs, rt)); break;
+      case 1: program.push_back(create_rformat(opcodes::kXOR, rd, rs, rt)); break;
+      case 2: program.push_back(create_rformat(opcodes::kNOR, rd, rs, rt)); break;
+      case 3: program.push_back(create_imm5(opcodes::kCBIT, rd, rs, imm(random))); break;
+      case 4: program.push_back(create_two_reg(opcodes::kCLZ, rd, rs, 0)); break;
+      case 5: program.push_back(create_two_reg(opcodes::kBDEP, rd, rs, rt)); break;
+      case 6: program.push_back(create_memory_format(opcodes::kLD, rd, offset, kDataBase)); break;
+      case 7: program.push_back(create_memory_format(opcodes::kST, rt, offset, kDataBase)); break;
+      default: program.push_back(create_ldp(rd, rt, offset, kDataBase)); break;
+    }
+  }
+  program.push_back(create_rformat(opcodes::kADD, kLoopCounter, kLoopCounter, kMinusOne));
+  program.push_back(create_branch(opcodes::kBNE, kLoopCounter, 0,
+                                  -static_cast<std::int16_t>(program.size())));
+  program.push_back(kSyscall);
+  return program;
+}
+
+struct Machine {
+  simulator::Memory memory {4096};
+  simulator::Cpu cpu;
+
+  Machine(const std::vector<std::uint32_t>& program,
+          simulator::ExecutionEngine engine, std::uint32_t seed)
+      : cpu(memory, engine) {
+    for (std::size_t i = 0; i < program.size(); ++i) {
+      memory.write_word(i * 4, program[i]);
+    }
+    std::mt19937 random(seed);
+    for (std::uint8_t i = 1; i < 8; ++i) {
+      cpu.set_register(i, random());
+    }
+    for (std::uint32_t i = 0; i < 32; ++i) {
+      memory.write_word(kDataAddress + i * 4, random());
+    }
+    cpu.set_register(kDataBase, kDataAddress);
+    cpu.set_register(kLoopCounter, 300);
+    cpu.set_register(kMinusOne, static_cast<std::uint32_t>(-1));
+  }
+};
+
+void expect_same_state(const Machine& expected, const Machine& actual) {
+  EXPECT_EQ(expected.cpu.get_pc(), actual.cpu.get_pc());
+  EXPECT_EQ(expected.cpu.get_instruction_count(), actual.cpu.get_instruction_count());
+  for (std::uint8_t i = 0; i < 32; ++i) {
+    EXPECT_EQ(expected.cpu.get_register(i), actual.cpu.get_register(i)) << "R" << int(i);
+  }
+  for (std::uint32_t i = 0; i < 32; ++i) {
+    EXPECT_EQ(expected.memory.read_word(kDataAddress + i * 4),
+              actual.memory.read_word(kDataAddress + i * 4));
+  }
+}
+
+} // namespace
+
+TEST(JitCompilerTest, RandomLoopsMatchStagedPipeline) {
+  if (!simulator::JitCompiler::is_supported()) {
+    GTEST_SKIP() << "JIT is not supported on this host";
+  }
+
+  std::mt19937 random(2024);
+  for (std::uint32_t seed = 0; seed < 50; ++seed) {
+    std::vector<std::uint32_t> program = generate_program(random);
+    Machine staged(program, simulator::ExecutionEngine::kStaged, seed);
+    Machine jit(program, simulator::ExecutionEngine::kBlock, seed);
+    jit.cpu.set_jit_enabled(true);
+
+    staged.cpu.run_program();
+    jit.cpu.run_program();
+
+    SCOPED_TRACE(seed);
+    expect_same_state(staged, jit);
+  }
+}
+
+TEST(JitCompilerTest, FaultFallsBackToInterpreter) {
+  if (!simulator::JitCompiler::is_supported()) {
+    GTEST_SKIP() << "JIT is not supported on this host";
+  }
+
+  std::vector<std::uint32_t> program = {
+      create_rformat(opcodes::kADD, 1, 1, 2),
+      create_memory_format(opcodes::kLD, 3, 0, 1),
+      create_rformat(opcodes::kADD, kLoopCounter, kLoopCounter, kMinusOne),
+      create_branch(opcodes::kBNE, kLoopCounter, 0, -3),
+      kSyscall,
+  };
+  Machine staged(program, simulator::ExecutionEngine::kStaged, 0);
+  Machine jit(program, simulator::ExecutionEngine::kBlock, 0);
+  jit.cpu.set_jit_enabled(true);
+  for (Machine* machine : {&staged, &jit}) {
+    machine->cpu.set_register(1, 0);
+    machine->cpu.set_register(2, 16);
+  }
+
+  EXPECT_THROW(staged.cpu.run_program(), std::range_error);
+  EXPECT_THROW(jit.cpu.run_program(), std::range_error);
+
+  EXPECT_EQ(jit.cpu.get_pc(), 4);
+  expect_same_state(staged, jit);
+}
+
+TEST(JitCompilerTest, StoreIntoCompiledLoopIsSeen) {
+  if (!simulator::JitCompiler::is_supported()) {
+    GTEST_SKIP() << "JIT is not supported on this host";
+  }
+
+  // Once the counter reaches 100 the loop rewrites its own ADD into XOR.
+  std::vector<std::uint32_t> program = {
+      create_rformat(opcodes::kADD, 1, 1, 2),
+      create_branch(opcodes::kBNE, kLoopCounter, 3, 2),
+      create_memory_format(opcodes::kST, 4, 0, 0),
+      create_rformat(opcodes::kADD, kLoopCounter, kLoopCounter, kMinusOne),
+      create_branch(opcodes::kBNE, kLoopCounter, 0, -4),
+      kSyscall,
+  };
+  Machine staged(program, simulator::ExecutionEngine::kStaged, 0);
+  Machine jit(program, simulator::ExecutionEngine::kBlock, 0);
+  jit.cpu.set_jit_enabled(true);
+  for (Machine* machine : {&staged, &jit}) {
+    machine->cpu.set_register(2, 3);
+    machine->cpu.set_register(3, 100);
+    machine->cpu.set_register(4, create_rformat(opcodes::kXOR, 1, 1, 2));
+  }
+
+  staged.cpu.run_program();
+  jit.cpu.run_program();
+
+  expect_same_state(staged, jit);
+}
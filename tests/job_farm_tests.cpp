@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <cstdint>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "job_farm.hpp"
+
+namespace {
+
+// examples/fib.rb
+constexpr std::array<std::uint32_t, 6> kFibProgram = {
+    0x0022201a,  // add r4, r1, r2
+    0x0040081a,  // add r1, r2, r0
+    0x0080101a,  // add r2, r4, r0
+    0x0065181a,  // add r3, r3, r5
+    0x1860fffc,  // bne r3, r0, loop
+    0x00000038,  // syscall
+};
+
+constexpr std::size_t kMemorySize = 1024;
+
+std::vector<std::uint8_t> fib_image() {
+  std::vector<std::uint8_t> bytes;
+  for (std::uint32_t word : kFibProgram) {
+    for (int i = 0; i < 4; ++i) {
+      bytes.push_back(static_cast<std::uint8_t>(word >> (8 * i)));
+    }
+  }
+  return bytes;
+}
+
+std::uint32_t fibonacci(std::uint32_t n) {
+  std::uint32_t previous = 0;
+  std::uint32_t current = 1;
+  for (std::uint32_t i = 0; i < n; ++i) {
+    std::uint32_t next = previous + current;
+    previous = current;
+    current = next;
+  }
+  return previous;
+}
+
+} // namespace
+
+TEST(JobFarmTest, ParsesRangesAsCartesianProduct) {
+  std::istringstream input(
+      "# sweep\n"
+      "R2=1 R3=1..3 R5=-1\n"
+      "\n"
+      "R1=0x10 M0x100=7 PC=4 R4=0..1\n");
+
+  std::vector<simulator::JobConfig> jobs = simulator::parse_jobs(input);
+
+  ASSERT_EQ(jobs.size(), 5);
+  EXPECT_EQ(jobs[0].registers[1].second, 1);
+  EXPECT_EQ(jobs[2].registers[1].second, 3);
+  EXPECT_EQ(jobs[2].registers[2].second, 0xFFFFFFFF);
+  EXPECT_EQ(jobs[3].registers[0].second, 0x10);
+  EXPECT_EQ(jobs[3].memory_words[0].first, 0x100);
+  EXPECT_EQ(jobs[3].memory_words[0].second, 7);
+  EXPECT_EQ(jobs[3].program_counter, 4);
+  EXPECT_EQ(jobs[4].registers[1].second, 1);
+}
+
+TEST(JobFarmTest, RejectsMalformedJobs) {
+  std::istringstream bad_register("R32=1\n");
+  std::istringstream bad_value("R1=abc\n");
+  std::istringstream empty_range("R1=5..4\n");
+
+  EXPECT_THROW(simulator::parse_jobs(bad_register), std::runtime_error);
+  EXPECT_THROW(simulator::parse_jobs(bad_value), std::runtime_error);
+  EXPECT_THROW(simulator::parse_jobs(empty_range), std::runtime_error);
+}
+
+TEST(JobFarmTest, SweepMatchesSerialRuns) {
+  std::vector<simulator::JobConfig> jobs;
+  for (std::uint32_t n = 1; n <= 200; ++n) {
+    jobs.push_back({{{2, 1}, {3, n}, {5, static_cast<std::uint32_t>(-1)}}, {}, 0});
+  }
+  simulator::JobFarm farm(fib_image(), kMemorySize, 4);
+
+  std::vector<simulator::JobResult> results;
+  farm.run(jobs, [&results](const simulator::JobResult& result) {
+    results.push_back(result);
+  });
+
+  ASSERT_EQ(results.size(), jobs.size());
+  std::set<std::size_t> seen;
+  for (const simulator::JobResult& result : results) {
+    seen.insert(result.job);
+    std::uint32_t n = result.job + 1;
+    EXPECT_EQ(result.status, simulator::JobStatus::kExited);
+    EXPECT_EQ(result.program_counter, 0x18);
+    EXPECT_EQ(result.instruction_count, 5 * n + 1);
+    EXPECT_EQ(result.registers[1], fibonacci(n)) << "n=" << n;
+  }
+  EXPECT_EQ(seen.size(), jobs.size());
+}
+
+TEST(JobFarmTest, FaultedJobIsReported) {
+  simulator::JobFarm farm(fib_image(), kMemorySize, 2);
+  std::vector<simulator::JobConfig> jobs = {
+      {{{2, 1}, {3, 3}, {5, static_cast<std::uint32_t>(-1)}}, {}, 0},
+      {{}, {}, 2},
+  };
+
+  std::ostringstream output;
+  farm.run(jobs, output);
+
+  std::string text = output.str();
+  EXPECT_NE(text.find("job=0 status=exited pc=0x18"), std::string::npos);
+  EXPECT_NE(text.find("job=1 status=faulted"), std::string::npos);
+  EXPECT_NE(text.find("fault=\""), std::string::npos);
+}
+
+TEST(JobFarmTest, InstructionBudgetStopsRunawayJob) {
+  simulator::JobFarm farm(fib_image(), kMemorySize, 2, 1000);
+  // r3 = 0 decrements past zero and loops for 2^32 iterations.
+  std::vector<simulator::JobConfig> jobs = {
+      {{{2, 1}, {3, 3}, {5, static_cast<std::uint32_t>(-1)}}, {}, 0},
+      {{{2, 1}, {3, 0}, {5, static_cast<std::uint32_t>(-1)}}, {}, 0},
+  };
+
+  std::vector<simulator::JobResult> results(jobs.size());
+  farm.run(jobs, [&results](const simulator::JobResult& result) {
+    results[result.job] = result;
+  });
+
+  EXPECT_EQ(results[0].status, simulator::JobStatus::kExited);
+  EXPECT_EQ(results[1].status, simulator::JobStatus::kLimit);
+  EXPECT_EQ(results[1].instruction_count, 1000);
+
+  std::ostringstream output;
+  simulator::write_job_result(output, results[1]);
+  EXPECT_NE(output.str().find("job=1 status=limit pc=0x"), std::string::npos);
+}
+
+TEST(JobFarmTest, RejectsMemoryBeyondAddressSpace) {
+  EXPECT_THROW(simulator::JobFarm(fib_image(), std::size_t{1} << 33, 2, 100),
+               std::range_error);
+}
@@ -86,12 +86,12 @@ TEST_F(MemoryTest, WordBoundary) {
 // Тест работы с блоками данных
 TEST_F(MemoryTest, BlockReadWrite) {
   std::vector<uint8_t> write_block = {0x01, 0x02, 0x03, 0x04, 0x05};
-  std::vector<uint8_t> read_block;
-  
+
   // Записываем и читаем блок
-  memory_->write_block(100, write_block);
-  read_block = memory_->read_block(100, 5);
-  
+  memory_->write_block(100, write_block.data(), write_block.size());
+  const uint8_t* data = memory_->read_block(100, write_block.size());
+  std::vector<uint8_t> read_block(data, data + write_block.size());
+
   EXPECT_EQ(read_block, write_block);
 }
 
@@ -100,11 +100,11 @@ TEST_F(MemoryTest, BlockBoundary) {
   std::vector<uint8_t> block = {0x01, 0x02, 0x03};
   
   // Валидный блок
-  EXPECT_NO_THROW(memory_->write_block(0, block));
-  EXPECT_NO_THROW(memory_->write_block(1021, {0x04, 0x05, 0x06}));
-  
+  EXPECT_NO_THROW(memory_->write_block(0, block.data(), block.size()));
+  EXPECT_NO_THROW(memory_->write_block(1021, block.data(), block.size()));
+
   // Блок слишком большой
-  EXPECT_THROW(memory_->write_block(1022, {0x07, 0x08, 0x09}), std::range_error);
+  EXPECT_THROW(memory_->write_block(1022, block.data(), block.size()), std::range_error);
   EXPECT_THROW(memory_->read_block(1022, 3), std::range_error);
 }
 
@@ -152,6 +152,27 @@ TEST_F(MemoryTest, Endianness) {
   EXPECT_EQ(memory_->read_byte(3), 0x12);
 }
 
+// Тест полного 32-битного адресного пространства
+TEST(MemoryAddressSpaceTest, FullAddressSpace) {
+  simulator::Memory memory(simulator::Memory::kAddressSpaceSize);
+
+  EXPECT_EQ(memory.size(), simulator::Memory::kAddressSpaceSize);
+  EXPECT_EQ(memory.read_word(0x80000000), 0);
+
+  memory.write_word(0, 0x11223344);
+  memory.write_word(0xFFFFFFFC, 0x55667788);
+
+  EXPECT_EQ(memory.read_word(0), 0x11223344);
+  EXPECT_EQ(memory.read_word(0xFFFFFFFC), 0x55667788);
+  EXPECT_TRUE(memory.is_valid_address(UINT32_MAX));
+  EXPECT_THROW(memory.read_word(UINT32_MAX), std::range_error);
+}
+
+TEST(MemoryAddressSpaceTest, SizeAboveAddressSpace) {
+  EXPECT_THROW(simulator::Memory(simulator::Memory::kAddressSpaceSize + 1),
+               std::range_error);
+}
+
 // Тест работы с нулевым размером памяти
 //TEST(MemoryZeroSizeTest, ZeroSize) {
 //  simulator::Memory zero_memory_(0);
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "cpu.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "pipeline_model.hpp"
+
+namespace {
+
+using simulator::DecodedInstruction;
+namespace opcodes = simulator::opcodes;
+
+DecodedInstruction make(std::uint8_t opcode, std::uint8_t rd, std::uint8_t rs,
+                        std::uint8_t rt) {
+  return {0, opcode, rd, rs, rt, 0};
+}
+
+// Feeds straight-line code starting at 0.
+simulator::PipelineStats run(const std::vector<DecodedInstruction>& program,
+                             simulator::PipelineConfig config = {}) {
+  simulator::PipelineModel model(config);
+  std::uint32_t program_counter = 0;
+  for (const DecodedInstruction& instruction : program) {
+    model.retire(instruction, program_counter, program_counter + 4);
+    program_counter += 4;
+  }
+  return model.stats();
+}
+
+constexpr simulator::PipelineConfig kNoForwarding {false};
+
+} // namespace
+
+TEST(PipelineModelTest, IndependentInstructionsIssueEveryCycle) {
+  simulator::PipelineStats stats = run({
+      make(opcodes::kADD, 1, 2, 3),
+      make(opcodes::kXOR, 4, 5, 6),
+      make(opcodes::kNOR, 7, 8, 9),
+  });
+  EXPECT_EQ(stats.instructions, 3);
+  EXPECT_EQ(stats.cycles, 3 + 4);
+  EXPECT_EQ(stats.data_stalls, 0);
+  EXPECT_EQ(run({}).cycles, 0);
+}
+
+TEST(PipelineModelTest, ForwardingHidesAluDependencies) {
+  std::vector<DecodedInstruction> chain = {
+      make(opcodes::kADD, 1, 2, 3),
+      make(opcodes::kADD, 4, 1, 1),
+      make(opcodes::kADD, 5, 4, 1),
+  };
+  EXPECT_EQ(run(chain).cycles, 3 + 4);
+
+  // Each consumer waits in ID until its producer reaches WB.
+  simulator::PipelineStats stats = run(chain, kNoForwarding);
+  EXPECT_EQ(stats.data_stalls, 4);
+  EXPECT_EQ(stats.cycles, 3 + 4 + 4);
+}
+
+TEST(PipelineModelTest, LoadUseStallsOneCycle) {
+  simulator::PipelineStats stats = run({
+      make(opcodes::kLD, 1, 2, 0),
+      make(opcodes::kADD, 3, 1, 0),
+  });
+  EXPECT_EQ(stats.data_stalls, 1);
+  EXPECT_EQ(stats.cycles, 2 + 4 + 1);
+
+  // A use two instructions later and store data, which is forwarded into
+  // MEM, do not stall.
+  EXPECT_EQ(run({make(opcodes::kLD, 1, 2, 0), make(opcodes::kADD, 3, 4, 0),
+                 make(opcodes::kADD, 5, 1, 0)}).data_stalls, 0);
+  EXPECT_EQ(run({make(opcodes::kLD, 1, 2, 0), make(opcodes::kST, 0, 4, 1)}).data_stalls, 0);
+  EXPECT_EQ(run({make(opcodes::kLDP, 1, 2, 5), make(opcodes::kADD, 3, 5, 0)}).data_stalls, 1);
+  EXPECT_EQ(run({make(opcodes::kLD, 0, 2, 0), make(opcodes::kADD, 3, 0, 0)}).data_stalls, 0);
+}
+
+TEST(PipelineModelTest, TakenBranchesFlushFetchedInstructions) {
+  simulator::PipelineModel model;
+  DecodedInstruction add = make(opcodes::kADD, 1, 2, 3);
+  DecodedInstruction branch = make(opcodes::kBNE, 0, 4, 5);
+  DecodedInstruction jump = make(opcodes::kJj, 0, 0, 0);
+
+  model.retire(branch, 0, 4);
+  model.retire(add, 4, 8);
+  EXPECT_EQ(model.stats().branch_stalls, 0);
+
+  model.retire(branch, 8, 0x100);
+  model.retire(add, 0x100, 0x104);
+  EXPECT_EQ(model.stats().branch_stalls, 2);
+
+  model.retire(jump, 0x104, 0x200);
+  model.retire(add, 0x200, 0x204);
+  simulator::PipelineStats stats = model.stats();
+  EXPECT_EQ(stats.jump_stalls, 1);
+  EXPECT_EQ(stats.cycles, 6 + 4 + 2 + 1);
+
+  model.clear();
+  EXPECT_EQ(model.stats().cycles, 0);
+}
+
+TEST(PipelineModelTest, CpuReportsCyclesOfFibonacci) {
+  // examples/fib.rb
+  const std::vector<std::uint32_t> program = {
+      0x0022201a,  // add r4, r1, r2
+      0x0040081a,  // add r1, r2, r0
+      0x0080101a,  // add r2, r4, r0
+      0x0065181a,  // add r3, r3, r5
+      0x1860fffc,  // bne r3, r0, loop
+      0x00000038,  // syscall
+  };
+  simulator::Memory memory(0x1000);
+  simulator::Cpu cpu(memory);
+  for (std::size_t i = 0; i < program.size(); ++i) {
+    memory.write_word(i * 4, program[i]);
+  }
+  cpu.set_register(2, 1);
+  cpu.set_register(3, 10);
+  cpu.set_register(5, 0xFFFFFFFF);
+  cpu.set_timing_enabled(true);
+  cpu.run_program();
+  EXPECT_EQ(cpu.get_register(1), 55);
+
+  simulator::PipelineStats stats = cpu.get_timing_model()->stats();
+  EXPECT_EQ(stats.instructions, cpu.get_instruction_count());
+  EXPECT_EQ(stats.branch_stalls, 9 * 2);
+  EXPECT_EQ(stats.data_stalls, 0);
+  EXPECT_EQ(stats.cycles, stats.instructions + 4 + 18);
+
+  std::ostringstream report;
+  cpu.get_timing_model()->write_report(report);
+  EXPECT_NE(report.str().find("CPI: 1.431"), std::string::npos) << report.str();
+
+  cpu.set_timing_enabled(false);
+  EXPECT_EQ(cpu.get_timing_model(), nullptr);
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cpu.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "profiler.hpp"
+#include "test_encoding.hpp"
+
+namespace {
+
+using simulator::test::create_memory_format;
+
+constexpr std::uint32_t kSyscall = 0x00000038;
+
+// examples/fib.rb
+const std::vector<std::uint32_t> kFibProgram = {
+    0x0022201a,  // add r4, r1, r2
+    0x0040081a,  // add r1, r2, r0
+    0x0080101a,  // add r2, r4, r0
+    0x0065181a,  // add r3, r3, r5
+    0x1860fffc,  // bne r3, r0, loop
+    kSyscall,
+};
+
+class ProfilerTest : public ::testing::TestWithParam<simulator::ExecutionEngine> {
+ protected:
+  simulator::Memory memory_ {0x4000};
+  simulator::Cpu cpu_ {memory_, GetParam()};
+
+  void load(const std::vector<std::uint32_t>& program) {
+    for (std::size_t i = 0; i < program.size(); ++i) {
+      memory_.write_word(i * 4, program[i]);
+    }
+  }
+
+  void run_fib(std::uint32_t n) {
+    load(kFibProgram);
+    cpu_.set_register(2, 1);
+    cpu_.set_register(3, n);
+    cpu_.set_register(5, 0xFFFFFFFF);
+    cpu_.run_program();
+  }
+};
+
+} // namespace
+
+TEST_P(ProfilerTest, DisabledByDefault) {
+  EXPECT_FALSE(cpu_.is_profiling_enabled());
+  EXPECT_EQ(cpu_.get_profiler(), nullptr);
+}
+
+TEST_P(ProfilerTest, CountsEveryInstruction) {
+  cpu_.set_profiling_enabled(true);
+  run_fib(10);
+
+  const simulator::Profiler& profiler = *cpu_.get_profiler();
+  EXPECT_EQ(profiler.total_instructions(), cpu_.get_instruction_count());
+  EXPECT_EQ(profiler.total_instructions(), 51);
+  EXPECT_EQ(profiler.opcode_count(simulator::opcodes::kADD), 40);
+  EXPECT_EQ(profiler.opcode_count(simulator::opcodes::kBNE), 10);
+  EXPECT_EQ(profiler.opcode_count(simulator::opcodes::kSYSCALL), 1);
+  EXPECT_EQ(profiler.pc_counts(0x0).executed, 10);
+  EXPECT_EQ(profiler.pc_counts(0x14).executed, 1);
+  EXPECT_EQ(profiler.pc_counts(0x18).executed, 0);
+}
+
+TEST_P(ProfilerTest, RecordsTakenBranchesAndLoops) {
+  cpu_.set_profiling_enabled(true);
+  run_fib(10);
+
+  const simulator::Profiler& profiler = *cpu_.get_profiler();
+  EXPECT_EQ(profiler.pc_counts(0x10).taken, 9);
+  EXPECT_EQ(profiler.pc_counts(0x10).branch_target, 0);
+
+  auto loops = profiler.hot_loops();
+  ASSERT_EQ(loops.size(), 1);
+  EXPECT_EQ(loops[0].head, 0x0);
+  EXPECT_EQ(loops[0].branch, 0x10);
+  EXPECT_EQ(loops[0].iterations, 9);
+  EXPECT_EQ(loops[0].instructions, 50);
+}
+
+TEST_P(ProfilerTest, CountsLoadsAndStoresPerPage) {
+  using simulator::opcodes::kLD;
+  using simulator::opcodes::kST;
+  cpu_.set_profiling_enabled(true);
+  load({
+      create_memory_format(kST, 1, 0, 4),
+      create_memory_format(kLD, 2, 0, 4),
+      create_memory_format(kLD, 3, 4, 6),
+      kSyscall,
+  });
+  cpu_.set_register(1, 7);
+  cpu_.set_register(4, 0x1000);
+  cpu_.set_register(6, 0x2000);
+  cpu_.run_program();
+
+  const simulator::Profiler& profiler = *cpu_.get_profiler();
+  EXPECT_EQ(cpu_.get_register(2), 7);
+  EXPECT_EQ(profiler.page_counts(1).loads, 1);
+  EXPECT_EQ(profiler.page_counts(1).stores, 1);
+  EXPECT_EQ(profiler.page_counts(2).loads, 1);
+  EXPECT_EQ(profiler.page_counts(2).stores, 0);
+  EXPECT_EQ(profiler.page_counts(0).loads, 0);
+}
+
+TEST_P(ProfilerTest, FaultingAccessIsNotCounted) {
+  using simulator::opcodes::kLD;
+  cpu_.set_profiling_enabled(true);
+  load({
+      create_memory_format(kLD, 3, 0, 4),
+      kSyscall,
+  });
+  cpu_.set_register(4, 0x10000);
+
+  EXPECT_THROW(cpu_.run_program(), std::range_error);
+  EXPECT_EQ(cpu_.get_profiler()->total_instructions(), 0);
+  EXPECT_EQ(cpu_.get_profiler()->page_counts(0x10).loads, 0);
+}
+
+TEST_P(ProfilerTest, ReportListsHotSpots) {
+  cpu_.set_profiling_enabled(true);
+  run_fib(10);
+
+  std::ostringstream report;
+  cpu_.get_profiler()->write_report(report);
+  EXPECT_NE(report.str().find("Instructions: 51"), std::string::npos);
+  EXPECT_NE(report.str().find("BNE     taken 9 not-taken 1"), std::string::npos);
+  EXPECT_NE(report.str().find("0x00000000-0x00000010  iterations 9"),
+            std::string::npos);
+}
+
+TEST_P(ProfilerTest, FoldedStacksNestInsideLoops) {
+  cpu_.set_profiling_enabled(true);
+  run_fib(10);
+
+  std::ostringstream folded;
+  cpu_.get_profiler()->write_folded(folded);
+  EXPECT_EQ(folded.str(),
+            "program;loop_0x00000000-0x00000010;0x00000000_ADD 10\n"
+            "program;loop_0x00000000-0x00000010;0x00000004_ADD 10\n"
+            "program;loop_0x00000000-0x00000010;0x00000008_ADD 10\n"
+            "program;loop_0x00000000-0x00000010;0x0000000c_ADD 10\n"
+            "program;loop_0x00000000-0x00000010;0x00000010_BNE 10\n"
+            "program;0x00000014_SYSCALL 1\n");
+}
+
+TEST_P(ProfilerTest, DisablingDiscardsProfile) {
+  cpu_.set_profiling_enabled(true);
+  run_fib(3);
+  cpu_.set_profiling_enabled(false);
+  EXPECT_EQ(cpu_.get_profiler(), nullptr);
+
+  cpu_.set_profiling_enabled(true);
+  EXPECT_EQ(cpu_.get_profiler()->total_instructions(), 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(Engines, ProfilerTest,
+                         ::testing::Values(simulator::ExecutionEngine::kStaged,
+                                           simulator::ExecutionEngine::kThreaded,
+                                           simulator::ExecutionEngine::kBlock));
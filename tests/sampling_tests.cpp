@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cpu.hpp"
+#include "memory.hpp"
+#include "sampling.hpp"
+
+namespace {
+
+// examples/fib.rb
+const std::vector<std::uint32_t> kFibProgram = {
+    0x0022201a,  // add r4, r1, r2
+    0x0040081a,  // add r1, r2, r0
+    0x0080101a,  // add r2, r4, r0
+    0x0065181a,  // add r3, r3, r5
+    0x1860fffc,  // bne r3, r0, loop
+    0x00000038,  // syscall
+};
+
+class SamplingTest : public ::testing::Test {
+ protected:
+  simulator::Memory memory_ {0x1000};
+  simulator::Cpu cpu_ {memory_};
+
+  void SetUp() override {
+    for (std::size_t i = 0; i < kFibProgram.size(); ++i) {
+      memory_.write_word(i * 4, kFibProgram[i]);
+    }
+    cpu_.set_register(2, 1);
+    cpu_.set_register(3, 100000);
+    cpu_.set_register(5, 0xFFFFFFFF);
+  }
+
+  static simulator::SamplingConfig config() {
+    simulator::SamplingConfig config;
+    config.period = 10000;
+    config.warmup = 100;
+    config.window = 1000;
+    return config;
+  }
+};
+
+} // namespace
+
+TEST_F(SamplingTest, ExtrapolatesCyclesOfWholeRun) {
+  simulator::SampledEstimate estimate;
+  EXPECT_EQ(simulator::run_sampled(cpu_, config(), estimate),
+            simulator::StopReason::kExited);
+
+  EXPECT_EQ(cpu_.get_instruction_count(), 500001);
+  EXPECT_EQ(estimate.instructions, 500001);
+  EXPECT_EQ(estimate.window_cpi.size(), 50);
+  EXPECT_EQ(estimate.measured.instructions, 50 * 1000);
+  EXPECT_FALSE(cpu_.is_timing_enabled());
+
+  // Every iteration is five instructions and two flushed fetch slots.
+  EXPECT_NEAR(estimate.cpi, 1.4, 0.01);
+  EXPECT_LT(estimate.cpi_margin, 0.01);
+  EXPECT_NEAR(estimate.cycles, 1.4 * 500001, 0.01 * 500001);
+  EXPECT_EQ(estimate.measured.data_stalls, 0);
+  EXPECT_GT(estimate.measured.branch_stalls, 0);
+}
+
+TEST_F(SamplingTest, RandomizedOffsetsKeepOneWindowPerPeriod) {
+  simulator::SamplingConfig randomized = config();
+  randomized.randomized = true;
+  randomized.seed = 7;
+  simulator::SampledEstimate estimate;
+  simulator::run_sampled(cpu_, randomized, estimate);
+
+  EXPECT_GE(estimate.window_cpi.size(), 49);
+  EXPECT_LE(estimate.window_cpi.size(), 50);
+  EXPECT_NEAR(estimate.cpi, 1.4, 0.01);
+  EXPECT_EQ(cpu_.get_register(3), 0);
+
+  std::ostringstream report;
+  simulator::write_sampling_report(report, estimate);
+  EXPECT_EQ(report.str().rfind("Instructions: 500001\n", 0), 0) << report.str();
+}
+
+TEST_F(SamplingTest, StopsAtInstructionLimit) {
+  simulator::SampledEstimate estimate;
+  EXPECT_EQ(simulator::run_sampled(cpu_, config(), estimate, 25000),
+            simulator::StopReason::kInstructionLimit);
+  EXPECT_EQ(cpu_.get_instruction_count(), 25000);
+  EXPECT_EQ(estimate.window_cpi.size(), 2);
+}
+
+TEST_F(SamplingTest, RejectsWindowsLongerThanPeriod) {
+  simulator::SamplingConfig invalid = config();
+  invalid.window = invalid.period;
+  simulator::SampledEstimate estimate;
+  EXPECT_THROW(simulator::run_sampled(cpu_, invalid, estimate), std::runtime_error);
+  invalid.window = 0;
+  EXPECT_THROW(simulator::run_sampled(cpu_, invalid, estimate), std::runtime_error);
+}
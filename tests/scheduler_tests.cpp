@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "scheduler.hpp"
+#include "simulator.hpp"
+
+namespace {
+
+using simulator::ContextStatus;
+
+// examples/fib.rb
+constexpr std::array<std::uint32_t, 6> kFibProgram = {
+    0x0022201a,  // add r4, r1, r2
+    0x0040081a,  // add r1, r2, r0
+    0x0080101a,  // add r2, r4, r0
+    0x0065181a,  // add r3, r3, r5
+    0x1860fffc,  // bne r3, r0, loop
+    0x00000038,  // syscall
+};
+constexpr std::uint32_t kDecrement = 0x0c;
+
+// Fibonacci of n; n == 0 decrements past zero and runs 2^32 iterations.
+std::unique_ptr<simulator::Simulator> fib_context(
+    std::uint32_t n,
+    simulator::ExecutionEngine engine = simulator::ExecutionEngine::kBlock) {
+  auto machine = std::make_unique<simulator::Simulator>(0x1000, engine);
+  for (std::size_t i = 0; i < kFibProgram.size(); ++i) {
+    machine->get_memory().write_word(i * 4, kFibProgram[i]);
+  }
+  simulator::Cpu& cpu = machine->get_cpu();
+  cpu.set_register(2, 1);
+  cpu.set_register(3, n);
+  cpu.set_register(5, 0xFFFFFFFF);
+  return machine;
+}
+
+} // namespace
+
+TEST(SchedulerTest, InterleavesContextsToCompletion) {
+  simulator::Scheduler scheduler(7);
+  std::vector<std::uint32_t> inputs = {30, 1, 12};
+  scheduler.add(fib_context(inputs[0], simulator::ExecutionEngine::kStaged));
+  scheduler.add(fib_context(inputs[1], simulator::ExecutionEngine::kThreaded));
+  scheduler.add(fib_context(inputs[2]));
+  EXPECT_EQ(scheduler.runnable(), 3);
+
+  // One quantum each, in order; the second context exits in its first turn.
+  EXPECT_TRUE(scheduler.step());
+  EXPECT_EQ(scheduler.get_retired(0), 7);
+  EXPECT_TRUE(scheduler.step());
+  EXPECT_EQ(scheduler.get_status(1), ContextStatus::kExited);
+  EXPECT_TRUE(scheduler.step());
+  EXPECT_EQ(scheduler.get_retired(2), 7);
+  EXPECT_EQ(scheduler.runnable(), 2);
+
+  scheduler.run();
+  const std::array<std::uint32_t, 3> expected = {832040, 1, 144};
+  for (std::size_t i = 0; i < scheduler.size(); ++i) {
+    EXPECT_EQ(scheduler.get_status(i), ContextStatus::kExited);
+    EXPECT_EQ(scheduler.get_retired(i), 5 * inputs[i] + 1);
+    EXPECT_EQ(scheduler.get_simulator(i).get_cpu().get_register(1), expected[i]);
+  }
+  EXPECT_FALSE(scheduler.step());
+}
+
+TEST(SchedulerTest, BudgetStopsRunawayContext) {
+  simulator::Scheduler scheduler(1000);
+  std::size_t runaway = scheduler.add(fib_context(0), 10500);
+  std::size_t finite = scheduler.add(fib_context(3000));
+
+  scheduler.run();
+  EXPECT_EQ(scheduler.get_status(runaway), ContextStatus::kBudgetExhausted);
+  EXPECT_EQ(scheduler.get_retired(runaway), 10500);
+  EXPECT_EQ(scheduler.get_status(finite), ContextStatus::kExited);
+  EXPECT_EQ(scheduler.get_retired(finite), 15001);
+
+  scheduler.resume(runaway, 2500);
+  EXPECT_EQ(scheduler.runnable(), 1);
+  scheduler.run();
+  EXPECT_EQ(scheduler.get_status(runaway), ContextStatus::kBudgetExhausted);
+  EXPECT_EQ(scheduler.get_retired(runaway), 13000);
+  EXPECT_EQ(scheduler.get_simulator(runaway).get_cpu().get_instruction_count(), 13000);
+}
+
+TEST(SchedulerTest, FaultIsIsolatedToItsContext) {
+  simulator::Scheduler scheduler(16);
+  auto misaligned = fib_context(5);
+  misaligned->get_cpu().set_pc(2);
+  std::size_t faulted = scheduler.add(std::move(misaligned));
+  std::size_t healthy = scheduler.add(fib_context(20));
+
+  scheduler.run();
+  EXPECT_EQ(scheduler.get_status(faulted), ContextStatus::kFaulted);
+  EXPECT_FALSE(scheduler.get_fault(faulted).empty());
+  EXPECT_EQ(scheduler.get_status(healthy), ContextStatus::kExited);
+  EXPECT_EQ(scheduler.get_simulator(healthy).get_cpu().get_register(1), 6765);
+
+  EXPECT_THROW(scheduler.resume(faulted), std::runtime_error);
+  EXPECT_THROW(scheduler.resume(healthy), std::runtime_error);
+}
+
+TEST(SchedulerTest, BreakpointParksContextUntilResumed) {
+  simulator::Scheduler scheduler(4);
+  auto machine = fib_context(10);
+  machine->get_cpu().set_breakpoint(kDecrement, simulator::BreakCondition {
+      3, simulator::BreakCondition::Compare::kEqual, 2});
+  std::size_t stopped = scheduler.add(std::move(machine));
+  std::size_t other = scheduler.add(fib_context(0), 100);
+
+  scheduler.run();
+  EXPECT_EQ(scheduler.get_status(stopped), ContextStatus::kBreakpoint);
+  EXPECT_EQ(scheduler.get_simulator(stopped).get_cpu().get_pc(), kDecrement);
+  EXPECT_EQ(scheduler.get_simulator(stopped).get_cpu().get_register(3), 2);
+  EXPECT_EQ(scheduler.get_status(other), ContextStatus::kBudgetExhausted);
+
+  scheduler.get_simulator(stopped).get_cpu().remove_breakpoint(kDecrement);
+  scheduler.resume(stopped);
+  scheduler.run();
+  EXPECT_EQ(scheduler.get_status(stopped), ContextStatus::kExited);
+  EXPECT_EQ(scheduler.get_simulator(stopped).get_cpu().get_register(1), 55);
+}
+
+TEST(SchedulerTest, RejectsInvalidArguments) {
+  EXPECT_THROW(simulator::Scheduler(0), std::runtime_error);
+  simulator::Scheduler scheduler;
+  EXPECT_EQ(scheduler.quantum(), simulator::Scheduler::kDefaultQuantum);
+  EXPECT_THROW(scheduler.add(nullptr), std::runtime_error);
+  EXPECT_THROW(scheduler.get_status(0), std::out_of_range);
+
+  std::size_t idle = scheduler.add(fib_context(1), 0);
+  EXPECT_EQ(scheduler.get_status(idle), ContextStatus::kBudgetExhausted);
+  EXPECT_FALSE(scheduler.step());
+}
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "simulator.hpp"
+
+namespace {
+
+// examples/fib.rb
+constexpr std::array<std::uint32_t, 6> kFibProgram = {
+    0x0022201a,  // add r4, r1, r2
+    0x0040081a,  // add r1, r2, r0
+    0x0080101a,  // add r2, r4, r0
+    0x0065181a,  // add r3, r3, r5
+    0x1860fffc,  // bne r3, r0, loop
+    0x00000038,  // syscall
+};
+
+constexpr std::uint32_t kPageSize = simulator::Memory::kPageSize;
+
+class SnapshotTest : public ::testing::Test {
+ protected:
+  simulator::Simulator simulator_ {16 * kPageSize};
+  simulator::Memory& memory_ = simulator_.get_memory();
+  simulator::Cpu& cpu_ = simulator_.get_cpu();
+
+  void load_fib(std::uint32_t n) {
+    for (std::size_t i = 0; i < kFibProgram.size(); ++i) {
+      memory_.write_word(i * 4, kFibProgram[i]);
+    }
+    cpu_.set_pc(0);
+    cpu_.set_register(2, 1);
+    cpu_.set_register(3, n);
+    cpu_.set_register(5, 0xFFFFFFFF);
+  }
+};
+
+} // namespace
+
+TEST_F(SnapshotTest, TracksDirtyPagesOnce) {
+  memory_.write_word(0x10, 1);
+  memory_.write_byte(0x20, 2);
+  memory_.write_word(3 * kPageSize + 8, 3);
+  std::vector<std::uint8_t> block(kPageSize, 4);
+  memory_.write_block(5 * kPageSize + 16, block.data(), block.size());
+
+  std::vector<std::uint32_t> expected = {0, 3, 5, 6};
+  EXPECT_EQ(memory_.dirty_pages(), expected);
+
+  memory_.clear_dirty_pages();
+  EXPECT_TRUE(memory_.dirty_pages().empty());
+  memory_.write_word(3 * kPageSize, 5);
+  EXPECT_EQ(memory_.dirty_pages(), std::vector<std::uint32_t>{3});
+}
+
+TEST_F(SnapshotTest, CheckpointCopiesOnlyDirtyPages) {
+  memory_.write_word(0, 1);
+  memory_.write_word(7 * kPageSize, 2);
+  auto first = simulator_.checkpoint();
+  EXPECT_EQ(first->page_count(), 2);
+  EXPECT_EQ(first->get_parent(), nullptr);
+  EXPECT_TRUE(memory_.dirty_pages().empty());
+
+  memory_.write_word(7 * kPageSize + 4, 3);
+  auto second = simulator_.checkpoint();
+  EXPECT_EQ(second->page_count(), 1);
+  EXPECT_EQ(second->get_parent(), first);
+
+  auto third = simulator_.checkpoint();
+  EXPECT_EQ(third->page_count(), 0);
+}
+
+TEST_F(SnapshotTest, RestoreRewindsMachineState) {
+  load_fib(10);
+  memory_.write_word(2 * kPageSize, 0x1234);
+  auto loaded = simulator_.checkpoint();
+
+  cpu_.run_program();
+  memory_.write_word(2 * kPageSize, 0xdead);
+  memory_.write_word(9 * kPageSize, 0xbeef);
+  ASSERT_EQ(cpu_.get_register(1), 55);
+
+  simulator_.restore(loaded);
+  EXPECT_EQ(cpu_.get_pc(), 0);
+  EXPECT_EQ(cpu_.get_instruction_count(), 0);
+  EXPECT_EQ(cpu_.get_register(1), 0);
+  EXPECT_EQ(cpu_.get_register(3), 10);
+  EXPECT_EQ(memory_.read_word(2 * kPageSize), 0x1234);
+  EXPECT_EQ(memory_.read_word(9 * kPageSize), 0);
+  EXPECT_TRUE(memory_.dirty_pages().empty());
+
+  cpu_.run_program();
+  EXPECT_EQ(cpu_.get_register(1), 55);
+}
+
+TEST_F(SnapshotTest, RestoreAcrossBranches) {
+  memory_.write_word(0, 1);
+  auto root = simulator_.checkpoint();
+
+  memory_.write_word(kPageSize, 2);
+  cpu_.set_register(7, 2);
+  auto left = simulator_.checkpoint();
+
+  simulator_.restore(root);
+  memory_.write_word(2 * kPageSize, 3);
+  memory_.write_word(0, 4);
+  auto right = simulator_.checkpoint();
+  auto full = simulator_.take_snapshot();
+  EXPECT_EQ(full->get_parent(), nullptr);
+  EXPECT_EQ(full->page_count(), 2);
+
+  simulator_.restore(left);
+  EXPECT_EQ(memory_.read_word(0), 1);
+  EXPECT_EQ(memory_.read_word(kPageSize), 2);
+  EXPECT_EQ(memory_.read_word(2 * kPageSize), 0);
+  EXPECT_EQ(cpu_.get_register(7), 2);
+
+  simulator_.restore(full);
+  EXPECT_EQ(memory_.read_word(0), 4);
+  EXPECT_EQ(memory_.read_word(kPageSize), 0);
+  EXPECT_EQ(memory_.read_word(2 * kPageSize), 3);
+  EXPECT_EQ(cpu_.get_register(7), 0);
+
+  simulator_.restore(left);
+  simulator_.restore(right);
+  EXPECT_EQ(memory_.read_word(0), 4);
+  EXPECT_EQ(memory_.read_word(kPageSize), 0);
+  EXPECT_EQ(memory_.read_word(2 * kPageSize), 3);
+
+  EXPECT_THROW(simulator_.restore(nullptr), std::runtime_error);
+}
+
+TEST_F(SnapshotTest, RestoreInvalidatesRewrittenCode) {
+  for (auto engine : {simulator::ExecutionEngine::kStaged,
+                      simulator::ExecutionEngine::kThreaded,
+                      simulator::ExecutionEngine::kBlock}) {
+    simulator::Simulator simulator(16 * kPageSize, engine);
+    simulator::Memory& memory = simulator.get_memory();
+    simulator::Cpu& cpu = simulator.get_cpu();
+    for (std::size_t i = 0; i < kFibProgram.size(); ++i) {
+      memory.write_word(i * 4, kFibProgram[i]);
+    }
+    cpu.set_register(2, 1);
+    cpu.set_register(3, 10);
+    cpu.set_register(5, 0xFFFFFFFF);
+    auto loaded = simulator.checkpoint();
+
+    cpu.run_program();
+    EXPECT_EQ(cpu.get_register(1), 55);
+
+    simulator.restore(loaded);
+    memory.write_word(8, 0x0080101a | (1 << 16));  // add r2, r4, r1
+    cpu.run_program();
+    EXPECT_NE(cpu.get_register(1), 55);
+
+    simulator.restore(loaded);
+    cpu.run_program();
+    EXPECT_EQ(cpu.get_register(1), 55);
+  }
+}
+
+TEST(SnapshotPartialPageTest, CopiesLastPartialPage) {
+  simulator::Simulator simulator(1024);
+  simulator::Memory& memory = simulator.get_memory();
+  memory.write_word(1020, 7);
+  auto snapshot = simulator.checkpoint();
+
+  memory.write_word(1020, 8);
+  memory.write_word(0, 9);
+  simulator.restore(snapshot);
+  EXPECT_EQ(memory.read_word(1020), 7);
+  EXPECT_EQ(memory.read_word(0), 0);
+}
@@ -0,0 +1,62 @@
+#ifndef TEST_ENCODING_HPP_
+#define TEST_ENCODING_HPP_
+
+#include <cstdint>
+#include "opcodes.hpp"
+
+// Instruction encoders for the tests and benchmarks. Operands follow the
+// assembly order: add rd, rs, rt and ld rt, offset(base).
+namespace simulator::test {
+
+// ADD, XOR and NOR.
+inline std::uint32_t create_rformat(std::uint8_t opcode, std::uint8_t rd, std::uint8_t rs, std::uint8_t rt) {
+  return (static_cast<std::uint32_t>(rs) << 21) |
+         (static_cast<std::uint32_t>(rt) << 16) |
+         (static_cast<std::uint32_t>(rd) << 11) |
+         (static_cast<std::uint32_t>(opcode));
+}
+
+// BDEP rd, rs, field and CLZ rd, rs with the opcode in the low bits.
+inline std::uint32_t create_two_reg(std::uint8_t opcode, std::uint8_t rd, std::uint8_t rs, std::uint8_t field) {
+  return (static_cast<std::uint32_t>(rd) << 21) |
+         (static_cast<std::uint32_t>(rs) << 16) |
+         (static_cast<std::uint32_t>(field) << 11) |
+         (static_cast<std::uint32_t>(opcode));
+}
+
+// CBIT and SSAT.
+inline std::uint32_t create_imm5(std::uint8_t opcode, std::uint8_t rd, std::uint8_t rs, std::uint8_t imm) {
+  return (static_cast<std::uint32_t>(opcode) << 26) | create_two_reg(0, rd, rs, imm);
+}
+
+// LD and ST.
+inline std::uint32_t create_memory_format(std::uint8_t opcode, std::uint8_t rt, std::uint16_t offset, std::uint8_t base) {
+  return (static_cast<std::uint32_t>(opcode) << 26) |
+         (static_cast<std::uint32_t>(base) << 21) |
+         (static_cast<std::uint32_t>(rt) << 16) |
+         (static_cast<std::uint32_t>(offset));
+}
+
+inline std::uint32_t create_ldp(std::uint8_t rt1, std::uint8_t rt2, std::uint16_t offset, std::uint8_t base) {
+  return (static_cast<std::uint32_t>(opcodes::kLDP) << 26) |
+         (static_cast<std::uint32_t>(base) << 21) |
+         (static_cast<std::uint32_t>(rt1) << 16) |
+         (static_cast<std::uint32_t>(rt2) << 11) |
+         (static_cast<std::uint32_t>(offset & 0x7FF));
+}
+
+// BEQ and BNE, offset in instructions from the branch.
+inline std::uint32_t create_branch(std::uint8_t opcode, std::uint8_t rs, std::uint8_t rt, std::int16_t offset) {
+  return (static_cast<std::uint32_t>(opcode) << 26) |
+         (static_cast<std::uint32_t>(rs) << 21) |
+         (static_cast<std::uint32_t>(rt) << 16) |
+         static_cast<std::uint16_t>(offset);
+}
+
+inline std::uint32_t create_jump(std::uint32_t target) {
+  return (static_cast<std::uint32_t>(opcodes::kJj) << 26) | (target >> 2);
+}
+
+} // namespace simulator::test
+
+#endif // TEST_ENCODING_HPP_
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <cstdint>
+#include "cpu.hpp"
+#include "memory.hpp"
+
+namespace {
+
+// examples/fib.rb
+constexpr std::array<std::uint32_t, 6> kFibProgram = {
+    0x0022201a,  // add r4, r1, r2
+    0x0040081a,  // add r1, r2, r0
+    0x0080101a,  // add r2, r4, r0
+    0x0065181a,  // add r3, r3, r5
+    0x1860fffc,  // bne r3, r0, loop
+    0x00000038,  // syscall
+};
+
+void load_fib(simulator::Memory& memory) {
+  for (std::size_t i = 0; i < kFibProgram.size(); ++i) {
+    memory.write_word(i * 4, kFibProgram[i]);
+  }
+}
+
+void run_fib(simulator::Cpu& cpu, std::uint32_t n) {
+  cpu.set_pc(0);
+  cpu.set_register(2, 1);
+  cpu.set_register(3, n);
+  cpu.set_register(5, static_cast<std::uint32_t>(-1));
+  cpu.run_program();
+}
+
+} // namespace
+
+TEST(ThreadedEngineTest, Fibonacci) {
+  simulator::Memory memory {1024};
+  load_fib(memory);
+  simulator::Cpu cpu(memory, simulator::ExecutionEngine::kThreaded);
+
+  run_fib(cpu, 5);
+
+  EXPECT_EQ(cpu.get_pc(), 0x18);
+  EXPECT_EQ(cpu.get_register(1), 5);
+  EXPECT_EQ(cpu.get_register(2), 8);
+  EXPECT_EQ(cpu.get_register(3), 0);
+}
+
+TEST(ThreadedEngineTest, MatchesStagedEngine) {
+  simulator::Memory staged_memory {1024};
+  simulator::Memory threaded_memory {1024};
+  load_fib(staged_memory);
+  load_fib(threaded_memory);
+  simulator::Cpu staged(staged_memory, simulator::ExecutionEngine::kStaged);
+  simulator::Cpu threaded(threaded_memory, simulator::ExecutionEngine::kThreaded);
+
+  run_fib(staged, 40);
+  run_fib(threaded, 40);
+
+  EXPECT_EQ(staged.get_pc(), threaded.get_pc());
+  for (std::uint8_t i = 0; i < 32; ++i) {
+    EXPECT_EQ(staged.get_register(i), threaded.get_register(i)) << "R" << int(i);
+  }
+}
+
+TEST(ThreadedEngineTest, MemoryFaultLeavesPcAtFaultingInstruction) {
+  simulator::Memory memory {1024};
+  // ld r1, 0(r2) with r2 out of range
+  memory.write_word(0, 0x28410000);
+  simulator::Cpu cpu(memory, simulator::ExecutionEngine::kThreaded);
+  cpu.set_register(2, 0x10000);
+
+  EXPECT_THROW(cpu.run_program(), std::range_error);
+  EXPECT_EQ(cpu.get_pc(), 0);
+}
@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "opcodes.hpp"
+#include "simulator.hpp"
+#include "syscalls.hpp"
+#include "test_encoding.hpp"
+#include "time_travel.hpp"
+
+namespace {
+
+namespace opcodes = simulator::opcodes;
+using simulator::test::create_memory_format;
+using simulator::test::create_rformat;
+
+constexpr std::size_t kMemorySize = 0x10000;
+constexpr std::uint32_t kTable = 0x1000;
+constexpr std::uint32_t kIterations = 50;
+constexpr std::uint64_t kProgramLength = kIterations * 7 + 1;
+
+// Fibonacci numbers stored to a table spanning several pages.
+const std::vector<std::uint32_t> kProgram = {
+    create_rformat(opcodes::kADD, 4, 1, 2),
+    create_rformat(opcodes::kADD, 1, 2, 0),
+    create_rformat(opcodes::kADD, 2, 4, 0),
+    create_memory_format(opcodes::kST, 4, 0, 6),
+    create_rformat(opcodes::kADD, 6, 6, 7),
+    create_rformat(opcodes::kADD, 3, 3, 5),
+    0x1860fffa,  // bne r3, r0, loop
+    0x00000038,  // syscall
+};
+
+namespace syscalls = simulator::syscalls;
+constexpr std::uint32_t kOutput = 0x800;
+constexpr std::uint32_t kInput = 0x900;
+
+// WRITEs the four bytes at kOutput, READs four bytes to kInput and keeps the
+// count in r14.
+const std::vector<std::uint32_t> kConsoleProgram = {
+    0x00000038,                                // syscall
+    create_rformat(opcodes::kADD, 8, 12, 0),   // r8 = READ
+    create_rformat(opcodes::kADD, 9, 13, 0),   // r9 = input
+    0x00000038,                                // syscall
+    create_rformat(opcodes::kADD, 14, 9, 0),
+    create_rformat(opcodes::kADD, 8, 0, 0),    // r8 = EXIT
+    0x00000038,                                // syscall
+};
+
+void load(simulator::Simulator& simulator) {
+  for (std::size_t i = 0; i < kProgram.size(); ++i) {
+    simulator.get_memory().write_word(i * 4, kProgram[i]);
+  }
+  simulator::Cpu& cpu = simulator.get_cpu();
+  cpu.set_register(2, 1);
+  cpu.set_register(3, kIterations);
+  cpu.set_register(5, 0xFFFFFFFF);
+  cpu.set_register(6, kTable);
+  cpu.set_register(7, 0x400);
+}
+
+void expect_same_state(simulator::Simulator& actual,
+                       simulator::Simulator& expected) {
+  const simulator::Cpu& cpu = actual.get_cpu();
+  const simulator::Cpu& reference = expected.get_cpu();
+  EXPECT_EQ(cpu.get_instruction_count(), reference.get_instruction_count());
+  EXPECT_EQ(cpu.get_pc(), reference.get_pc());
+  for (std::uint8_t i = 0; i < 32; ++i) {
+    EXPECT_EQ(cpu.get_register(i), reference.get_register(i)) << "R" << int(i);
+  }
+  for (std::uint32_t address = kTable; address < kTable + kIterations * 0x400;
+       address += 0x400) {
+    EXPECT_EQ(actual.get_memory().read_word(address),
+              expected.get_memory().read_word(address))
+        << "address " << address;
+  }
+}
+
+class TimeTravelTest : public ::testing::Test {
+ protected:
+  simulator::Simulator simulator_ {kMemorySize};
+  simulator::TimeTravel time_travel_ {simulator_, 8, 8};
+
+  void SetUp() override {
+    load(simulator_);
+  }
+
+  void expect_state_after(std::uint64_t instructions) {
+    simulator::Simulator reference(kMemorySize);
+    load(reference);
+    reference.get_cpu().run_program(instructions);
+    expect_same_state(simulator_, reference);
+  }
+};
+
+} // namespace
+
+TEST_F(TimeTravelTest, SeekMatchesFreshRun) {
+  EXPECT_EQ(time_travel_.run(), simulator::StopReason::kExited);
+  ASSERT_EQ(simulator_.get_cpu().get_instruction_count(), kProgramLength);
+
+  for (std::uint64_t target : {100, 0, 7, 349, 8, 9, 200, 1, 351}) {
+    time_travel_.seek(target);
+    expect_state_after(target);
+  }
+}
+
+TEST_F(TimeTravelTest, SeekRunsForwardPastHistory) {
+  time_travel_.run(20);
+  time_travel_.seek(120);
+  expect_state_after(120);
+
+  time_travel_.seek(10000);
+  EXPECT_EQ(simulator_.get_cpu().get_instruction_count(), kProgramLength);
+}
+
+TEST_F(TimeTravelTest, StepBackUndoesInstruction) {
+  time_travel_.run(20);
+  time_travel_.step_back();
+  expect_state_after(19);
+
+  time_travel_.step();
+  time_travel_.step();
+  expect_state_after(21);
+
+  time_travel_.rewind();
+  expect_state_after(0);
+  EXPECT_THROW(time_travel_.step_back(), std::runtime_error);
+}
+
+TEST_F(TimeTravelTest, ThinningBoundsCheckpoints) {
+  time_travel_.run();
+
+  EXPECT_LE(time_travel_.checkpoint_count(), 8);
+  EXPECT_GE(time_travel_.interval(), kProgramLength / 8);
+  EXPECT_EQ(time_travel_.first_instruction(), 0);
+
+  time_travel_.seek(3);
+  expect_state_after(3);
+}
+
+TEST_F(TimeTravelTest, ChangedStateReplacesFuture) {
+  time_travel_.run(100);
+  time_travel_.seek(50);
+  simulator_.get_cpu().set_register(1, 1000);
+  time_travel_.state_changed();
+
+  time_travel_.seek(40);
+  expect_state_after(40);
+  time_travel_.run(20);
+  EXPECT_EQ(time_travel_.first_instruction(), 0);
+
+  simulator::Simulator reference(kMemorySize);
+  load(reference);
+  reference.get_cpu().run_program(50);
+  reference.get_cpu().set_register(1, 1000);
+  reference.get_cpu().run_program(10);
+  expect_same_state(simulator_, reference);
+
+  // The changed state survives thinning.
+  time_travel_.run();
+  time_travel_.seek(55);
+  time_travel_.seek(60);
+  expect_same_state(simulator_, reference);
+  time_travel_.seek(300);
+  reference.get_cpu().run_program(240);
+  expect_same_state(simulator_, reference);
+}
+
+TEST(TimeTravelConsoleTest, ReplayRepeatsSyscalls) {
+  // The console has to outlive the cpu.
+  std::istringstream input("abcdefgh");
+  std::ostringstream output;
+  simulator::Simulator simulator(kMemorySize);
+  simulator::TimeTravel time_travel(simulator, 2, 8);
+  simulator::Cpu& cpu = simulator.get_cpu();
+  cpu.set_console(output, input);
+  for (std::size_t i = 0; i < kConsoleProgram.size(); ++i) {
+    simulator.get_memory().write_word(i * 4, kConsoleProgram[i]);
+  }
+  simulator.get_memory().write_word(kOutput, 0x676E6970);  // "ping"
+  cpu.set_register(syscalls::kNumberRegister, syscalls::WRITE);
+  cpu.set_register(syscalls::kArgument0, kOutput);
+  cpu.set_register(syscalls::kArgument1, 4);
+  cpu.set_register(12, syscalls::READ);
+  cpu.set_register(13, kInput);
+
+  EXPECT_EQ(time_travel.run(), simulator::StopReason::kExited);
+  std::vector<std::uint32_t> registers;
+  for (std::uint8_t i = 0; i < 32; ++i) {
+    registers.push_back(cpu.get_register(i));
+  }
+  EXPECT_EQ(registers[14], 4);
+
+  // Every seek goes back over the READ, the ones to 0 also over the WRITE.
+  for (std::uint64_t target : {3, 0, 4, 1, 0}) {
+    time_travel.seek(target);
+    EXPECT_EQ(time_travel.run(), simulator::StopReason::kExited);
+    EXPECT_EQ(output.str(), "ping");
+    EXPECT_EQ(simulator.get_memory().read_word(kInput), 0x64636261);  // "abcd"
+    EXPECT_EQ(cpu.get_instruction_count(), kConsoleProgram.size());
+    for (std::uint8_t i = 0; i < 32; ++i) {
+      EXPECT_EQ(cpu.get_register(i), registers[i]) << "R" << int(i);
+    }
+  }
+}
@@ -0,0 +1,247 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cpu.hpp"
+#include "memory.hpp"
+#include "opcodes.hpp"
+#include "test_encoding.hpp"
+#include "trace_reader.hpp"
+
+namespace {
+
+using simulator::test::create_memory_format;
+
+constexpr std::uint32_t kSyscall = 0x00000038;
+
+// examples/fib.rb
+const std::vector<std::uint32_t> kFibProgram = {
+    0x0022201a,  // add r4, r1, r2
+    0x0040081a,  // add r1, r2, r0
+    0x0080101a,  // add r2, r4, r0
+    0x0065181a,  // add r3, r3, r5
+    0x1860fffc,  // bne r3, r0, loop
+    kSyscall,
+};
+
+class TraceTest : public ::testing::Test {
+ protected:
+  simulator::Memory memory_ {0x4000};
+  simulator::Cpu cpu_ {memory_};
+
+  void TearDown() override {
+    for (const std::string& path : paths_) {
+      std::filesystem::remove(path);
+    }
+  }
+
+  std::string temporary_path(const std::string& name) {
+    paths_.push_back((std::filesystem::temp_directory_path()
+                      / ("simulator_trace_" + name + "_"
+                         + std::to_string(::testing::UnitTest::GetInstance()->random_seed())))
+                         .string());
+    return paths_.back();
+  }
+
+  void load(const std::vector<std::uint32_t>& program) {
+    for (std::size_t i = 0; i < program.size(); ++i) {
+      memory_.write_word(i * 4, program[i]);
+    }
+  }
+
+  std::string trace_fib(std::uint32_t n, const std::string& name) {
+    std::string path = temporary_path(name);
+    load(kFibProgram);
+    for (std::uint8_t i = 0; i < 32; ++i) {
+      cpu_.set_register(i, 0);
+    }
+    cpu_.set_pc(0);
+    cpu_.set_register(2, 1);
+    cpu_.set_register(3, n);
+    cpu_.set_register(5, 0xFFFFFFFF);
+    cpu_.start_trace(path);
+    cpu_.run_program();
+    cpu_.stop_trace();
+    return path;
+  }
+
+ private:
+  std::vector<std::string> paths_;
+};
+
+} // namespace
+
+TEST_F(TraceTest, ReplayReachesFinalState) {
+  std::string path = trace_fib(20, "fib");
+
+  simulator::TraceReader reader(path);
+  simulator::TraceEvent event;
+  while (reader.next(event)) {
+  }
+  EXPECT_EQ(reader.instruction_count(), cpu_.get_instruction_count());
+  EXPECT_EQ(reader.get_pc(), cpu_.get_pc());
+  for (std::uint8_t i = 0; i < 32; ++i) {
+    EXPECT_EQ(reader.get_register(i), cpu_.get_register(i)) << "R" << int(i);
+  }
+}
+
+TEST_F(TraceTest, EventsDescribeRetiredInstructions) {
+  std::string path = trace_fib(3, "events");
+
+  simulator::TraceReader reader(path);
+  simulator::TraceEvent event;
+  ASSERT_TRUE(reader.next(event));
+  EXPECT_EQ(event.index, 0);
+  EXPECT_EQ(event.program_counter, 0);
+  EXPECT_EQ(event.raw, kFibProgram[0]);
+  ASSERT_EQ(event.register_count, 1);
+  EXPECT_EQ(event.register_indices[0], 4);
+  EXPECT_EQ(event.register_values[0], 1);
+
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(reader.next(event));
+  }
+  EXPECT_EQ(event.index, 5);
+  EXPECT_EQ(event.program_counter, 0);
+  EXPECT_EQ(event.raw, kFibProgram[0]);
+}
+
+TEST_F(TraceTest, SeekReconstructsStateBeforeInstruction) {
+  std::string path = trace_fib(10, "seek");
+
+  simulator::Memory memory(0x4000);
+  simulator::Cpu reference(memory);
+  for (std::size_t i = 0; i < kFibProgram.size(); ++i) {
+    memory.write_word(i * 4, kFibProgram[i]);
+  }
+  reference.set_register(2, 1);
+  reference.set_register(3, 10);
+  reference.set_register(5, 0xFFFFFFFF);
+  reference.run_program(24);
+
+  simulator::TraceReader reader(path);
+  reader.seek(24);
+  EXPECT_EQ(reader.instruction_count(), 24);
+  EXPECT_EQ(reader.get_pc(), reference.get_pc());
+  for (std::uint8_t i = 0; i < 32; ++i) {
+    EXPECT_EQ(reader.get_register(i), reference.get_register(i)) << "R" << int(i);
+  }
+  EXPECT_THROW(reader.seek(1000), std::runtime_error);
+
+  // Seeking back rescans from the start.
+  reader.seek(24);
+  EXPECT_EQ(reader.instruction_count(), 24);
+  EXPECT_EQ(reader.get_pc(), reference.get_pc());
+  for (std::uint8_t i = 0; i < 32; ++i) {
+    EXPECT_EQ(reader.get_register(i), reference.get_register(i)) << "R" << int(i);
+  }
+}
+
+TEST_F(TraceTest, RecordsStores) {
+  using simulator::opcodes::kLD;
+  using simulator::opcodes::kST;
+  std::string path = temporary_path("stores");
+  load({
+      create_memory_format(kST, 1, 0, 4),
+      create_memory_format(kST, 1, 8, 4),
+      create_memory_format(kLD, 2, 8, 4),
+      kSyscall,
+  });
+  cpu_.set_register(1, 0x1234);
+  cpu_.set_register(4, 0x1000);
+  cpu_.start_trace(path);
+  cpu_.run_program();
+  cpu_.stop_trace();
+
+  simulator::TraceReader reader(path);
+  simulator::TraceEvent event;
+  ASSERT_TRUE(reader.next(event));
+  EXPECT_TRUE(event.stores);
+  EXPECT_EQ(event.address, 0x1000);
+  EXPECT_EQ(event.store_value, 0x1234);
+  ASSERT_TRUE(reader.next(event));
+  ASSERT_TRUE(reader.next(event));
+  EXPECT_TRUE(event.accesses_memory);
+  EXPECT_FALSE(event.stores);
+  EXPECT_EQ(event.address, 0x1008);
+  EXPECT_EQ(reader.get_register(2), 0x1234);
+  EXPECT_EQ(reader.stored_words().size(), 2);
+  EXPECT_EQ(reader.stored_words().at(0x1008), 0x1234);
+
+  reader.seek(1);
+  EXPECT_EQ(reader.stored_words().size(), 1);
+  EXPECT_EQ(reader.get_register(2), 0);
+}
+
+TEST_F(TraceTest, FaultingInstructionIsNotTraced) {
+  using simulator::opcodes::kLD;
+  std::string path = temporary_path("fault");
+  load({
+      create_memory_format(kLD, 3, 0, 4),
+      kSyscall,
+  });
+  cpu_.set_register(4, 0x10000);
+  cpu_.start_trace(path);
+  EXPECT_THROW(cpu_.run_program(), std::range_error);
+  cpu_.stop_trace();
+
+  simulator::TraceReader reader(path);
+  simulator::TraceEvent event;
+  EXPECT_FALSE(reader.next(event));
+  EXPECT_EQ(reader.get_register(4), 0x10000);
+}
+
+TEST_F(TraceTest, LongTraceSpansBuffers) {
+  std::string path = trace_fib(2000000, "long");
+  EXPECT_GT(std::filesystem::file_size(path), simulator::TraceWriter::kBufferSize);
+
+  simulator::TraceReader reader(path);
+  simulator::TraceEvent event;
+  while (reader.next(event)) {
+  }
+  EXPECT_EQ(reader.instruction_count(), cpu_.get_instruction_count());
+  EXPECT_EQ(reader.get_register(1), cpu_.get_register(1));
+}
+
+TEST_F(TraceTest, DiffFindsFirstDivergence) {
+  std::string first = trace_fib(10, "first");
+  std::string same = trace_fib(10, "same");
+
+  std::ostringstream output;
+  {
+    simulator::TraceReader lhs(first);
+    simulator::TraceReader rhs(same);
+    EXPECT_TRUE(simulator::diff_traces(output, lhs, rhs));
+  }
+
+  simulator::Memory memory(0x4000);
+  simulator::Cpu other(memory);
+  for (std::size_t i = 0; i < kFibProgram.size(); ++i) {
+    memory.write_word(i * 4, kFibProgram[i]);
+  }
+  memory.write_word(8, 0x0080101a | (1 << 16));  // add r2, r4, r1
+  std::string diverged = temporary_path("diverged");
+  other.set_register(2, 1);
+  other.set_register(3, 10);
+  other.set_register(5, 0xFFFFFFFF);
+  other.start_trace(diverged);
+  other.run_program();
+  other.stop_trace();
+
+  simulator::TraceReader lhs(first);
+  simulator::TraceReader rhs(diverged);
+  output.str("");
+  EXPECT_FALSE(simulator::diff_traces(output, lhs, rhs));
+  EXPECT_EQ(output.str().rfind("Traces diverge at 2:", 0), 0) << output.str();
+}
+
+TEST_F(TraceTest, RejectsOtherFiles) {
+  std::string path = temporary_path("garbage");
+  std::ofstream(path) << "not a trace";
+  EXPECT_THROW(simulator::TraceReader reader(path), std::runtime_error);
+  EXPECT_THROW(simulator::TraceReader reader(path + ".missing"), std::runtime_error);
+}